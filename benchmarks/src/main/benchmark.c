@@ -248,6 +248,7 @@ run_benchmark(arguments* args)
 	data.throughput = args->throughput;
 	data.read_pct = args->read_pct;
 	data.del_bin = args->del_bin;
+	data.scale_seconds = args->scale_seconds;
 	data.bintype = args->bintype;
 	data.binlen = args->binlen;
 	data.binlen_type = args->binlen_type;
@@ -305,6 +306,10 @@ run_benchmark(arguments* args)
 		data.n_keys = (uint64_t)((double)args->keys / 100.0 * args->init_pct + 0.5);
 		ret = linear_write(&data);
 	}
+	else if (args->scale_seconds > 0) {
+		data.n_keys = args->keys;
+		ret = scaling_read(&data);
+	}
 	else {
 		data.n_keys = args->keys;
 		ret = random_read_write(&data);
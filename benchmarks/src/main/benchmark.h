@@ -52,6 +52,7 @@ typedef struct arguments_t {
 	int init_pct;
 	int read_pct;
 	bool del_bin;
+	int scale_seconds;
 	uint64_t transactions_limit;
 	int threads;
 	int throughput;
@@ -103,6 +104,7 @@ typedef struct clientdata_t {
 	uint32_t valid;
 	
 	int async_max_commands;
+	int scale_seconds;
 	int threads;
 	int throughput;
 	int read_pct;
@@ -133,6 +135,7 @@ typedef struct threaddata_t {
 int run_benchmark(arguments* args);
 int linear_write(clientdata* data);
 int random_read_write(clientdata* data);
+int scaling_read(clientdata* data);
 
 threaddata* create_threaddata(clientdata* cdata, uint64_t key_start, uint64_t n_keys);
 void destroy_threaddata(threaddata* tdata);
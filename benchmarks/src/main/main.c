@@ -158,11 +158,14 @@ print_usage(const char* program)
 	blog_line("    Stop approximately after number of transaction performed in random read/write mode.");
 	blog_line("");
 
-	blog_line("-w --workload I,<percent> | RU,<read percent> | DB  # Default: RU,50");
+	blog_line("-w --workload I,<percent> | RU,<read percent> | DB | SG,<seconds>  # Default: RU,50");
 	blog_line("   Desired workload.");
 	blog_line("   -w I,60  : Linear 'insert' workload initializing 60%% of the keys.");
 	blog_line("   -w RU,80 : Random read/update workload with 80%% reads and 20%% writes.");
 	blog_line("   -w DB    : Bin delete workload.");
+	blog_line("   -w SG,10 : Scaling get workload. Run random reads for 10 seconds at 1, 2, 4 ...");
+	blog_line("              threads up to the --threads count and print throughput per step.");
+	blog_line("              Synchronous mode only.");
 	blog_line("");
 	
 	blog_line("-z --threads <count> # Default: 16");
@@ -364,6 +367,8 @@ print_args(arguments* args)
 		blog_line("initialize %d%% of records", args->init_pct);
 	} else if (args->del_bin) {
 		blog_line("delete %d bins in %d records", args->numbins, args->keys);
+	} else if (args->scale_seconds > 0) {
+		blog_line("scaling get %d seconds per thread count", args->scale_seconds);
 	} else if (args->read_pct) {
 		blog_line("read %d%% write %d%%", args->read_pct, 100 - args->read_pct);
 		blog_line("stop after:     %" PRIu64 " transactions", args->transactions_limit);
@@ -511,6 +516,11 @@ validate_args(arguments* args)
 		return 1;
 	}
 
+	if (args->scale_seconds > 0 && args->async) {
+		blog_line("Scaling get workload does not support async mode");
+		return 1;
+	}
+
 	if (args->async) {
 		if (args->async_max_commands <= 0 || args->async_max_commands > 5000) {
 			blog_line("Invalid asyncMaxCommands: %d  Valid values: [1-5000]", args->async_max_commands);
@@ -630,6 +640,14 @@ set_args(int argc, char * const * argv, arguments* args)
 				} else if (strncmp(tmp, "DB", 2) == 0) {
 					args->init = true;
 					args->del_bin = true;
+				} else if (strncmp(tmp, "SG", 2) == 0) {
+					args->scale_seconds = p ? atoi(p + 1) : 10;
+
+					if (args->scale_seconds <= 0) {
+						blog_line("Invalid scaling get seconds: %d  Valid values: [> 0]", args->scale_seconds);
+						free(tmp);
+						return 1;
+					}
 				}
 
 				free(tmp);
@@ -828,6 +846,7 @@ main(int argc, char * const * argv)
 	args.init_pct = 100;
 	args.read_pct = 50;
 	args.del_bin = false;
+	args.scale_seconds = 0;
 	args.threads = 16;
 	args.throughput = 0;
 	args.read_timeout = 0;
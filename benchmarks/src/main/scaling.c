@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * Copyright 2008-2017 by Aerospike.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ******************************************************************************/
+#include "benchmark.h"
+#include "benchmark.h"
+#include <aerospike/as_random.h>
+#include <aerospike/as_sleep.h>
+#include <citrusleaf/cf_clock.h>
+#include <pthread.h>
+
+static void*
+scaling_worker(void* udata)
+{
+	clientdata* cdata = (clientdata*)udata;
+	threaddata* tdata = create_threaddata(cdata, cdata->key_start, cdata->n_keys);
+	uint64_t key_min = cdata->key_start;
+	uint64_t n_keys = cdata->n_keys;
+
+	while (cdata->valid) {
+		uint64_t key = as_random_next_uint64(tdata->random) % n_keys + key_min;
+		read_record_sync(key, cdata);
+	}
+	destroy_threaddata(tdata);
+	return 0;
+}
+
+static int
+scaling_step(clientdata* cdata, int max)
+{
+	pthread_t* threads = alloca(sizeof(pthread_t) * max);
+	cdata->valid = true;
+
+	for (int i = 0; i < max; i++) {
+		if (pthread_create(&threads[i], 0, scaling_worker, cdata) != 0) {
+			cdata->valid = false;
+			blog_error("Failed to create thread.");
+
+			for (int j = 0; j < i; j++) {
+				pthread_join(threads[j], 0);
+			}
+			return -1;
+		}
+	}
+
+	// Warm up connection pools before measuring.
+	as_sleep(1000);
+	as_fas_uint32(&cdata->read_count, 0);
+	as_fas_uint32(&cdata->read_timeout_count, 0);
+	as_fas_uint32(&cdata->read_error_count, 0);
+
+	uint64_t begin = cf_getms();
+	as_sleep(cdata->scale_seconds * 1000);
+
+	uint32_t count = as_fas_uint32(&cdata->read_count, 0);
+	uint32_t timeouts = as_fas_uint32(&cdata->read_timeout_count, 0);
+	uint32_t errors = as_fas_uint32(&cdata->read_error_count, 0);
+	uint64_t elapsed = cf_getms() - begin;
+
+	cdata->valid = false;
+
+	for (int i = 0; i < max; i++) {
+		pthread_join(threads[i], 0);
+	}
+
+	double tps = (double)count * 1000 / elapsed;
+	blog_line("%7d %12.0f %11.0f %9u %7u", max, tps, tps / max, timeouts, errors);
+	return 0;
+}
+
+int
+scaling_read(clientdata* cdata)
+{
+	blog_info("Scaling get using %" PRIu64 " records, %d seconds per step, up to %d threads",
+		cdata->n_keys, cdata->scale_seconds, cdata->threads);
+	blog_line("threads          tps  tps/thread  timeouts  errors");
+
+	// Double thread count each step until the configured thread count is reached.
+	int max = 1;
+
+	while (true) {
+		if (scaling_step(cdata, max) != 0) {
+			return -1;
+		}
+
+		if (max >= cdata->threads) {
+			break;
+		}
+
+		max *= 2;
+
+		if (max > cdata->threads) {
+			max = cdata->threads;
+		}
+	}
+	return 0;
+}
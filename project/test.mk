@@ -4,14 +4,18 @@
 
 TEST_AEROSPIKE = aerospike_test.c
 TEST_AEROSPIKE += aerospike_batch/*.c
+TEST_AEROSPIKE += aerospike_cluster/*.c
+TEST_AEROSPIKE += aerospike_event/*.c
 TEST_AEROSPIKE += aerospike_index/*.c
 TEST_AEROSPIKE += aerospike_geo/*.c
 TEST_AEROSPIKE += aerospike_info/*.c
 TEST_AEROSPIKE += aerospike_key/*.c
 TEST_AEROSPIKE += aerospike_list/*.c
 TEST_AEROSPIKE += aerospike_map/*.c
+TEST_AEROSPIKE += aerospike_partition/*.c
 TEST_AEROSPIKE += aerospike_query/*.c
 TEST_AEROSPIKE += aerospike_scan/*.c
+TEST_AEROSPIKE += aerospike_shm/*.c
 TEST_AEROSPIKE += aerospike_udf/*.c
 TEST_AEROSPIKE += policy/*.c
 TEST_AEROSPIKE += util/*.c
@@ -20,6 +24,9 @@ TEST_SOURCE = $(wildcard $(addprefix $(SOURCE_TEST)/, $(TEST_AEROSPIKE)))
 
 TEST_OBJECT = $(patsubst %.c,%.o,$(subst $(SOURCE_TEST)/,$(TARGET_TEST)/,$(TEST_SOURCE)))
 
+# C++20 coroutine bindings are tested by a separate program.
+TEST_CORO_SOURCE = $(SOURCE_TEST)/aerospike_coroutine/coroutine_scan.cpp
+
 ###############################################################################
 ##  FLAGS                                                                    ##
 ###############################################################################
@@ -28,6 +35,9 @@ TEST_VALGRIND = --tool=memcheck --leak-check=yes --show-reachable=yes --num-call
 
 TEST_CFLAGS = -I$(TARGET_INCL)
 
+CXX = c++
+TEST_CORO_CXXFLAGS = -std=c++20 -g -Wall $(filter -D%,$(CC_FLAGS)) -I$(TARGET_INCL) $(addprefix -I, $(INC_PATH))
+
 TEST_LDFLAGS = -L/usr/local/lib -lssl -lcrypto $(LIB_LUA) -lpthread -lm -lz
 
 ifeq ($(OS),Darwin)
@@ -70,6 +80,10 @@ test-valgrind: test-build
 .PHONY: test-build
 test-build: $(TARGET_TEST)/aerospike_test
 
+.PHONY: test-coro
+test-coro: $(TARGET_TEST)/coroutine_test
+	$(TARGET_TEST)/coroutine_test $(AS_HOST) $(AS_PORT)
+
 .PHONY: test-clean
 test-clean: 
 	@rm -rf $(TARGET_TEST)
@@ -87,3 +101,7 @@ $(TARGET_TEST)/%.o: $(SOURCE_TEST)/%.c
 $(TARGET_TEST)/aerospike_test: CFLAGS += $(TEST_CFLAGS)
 $(TARGET_TEST)/aerospike_test: $(TEST_OBJECT) $(TARGET_TEST)/test.o $(TARGET_LIB)/libaerospike.a | build prepare
 	$(executable) $(TEST_LDFLAGS)
+
+$(TARGET_TEST)/coroutine_test: $(TEST_CORO_SOURCE) $(TARGET_LIB)/libaerospike.a | build prepare
+	@if [ ! -d `dirname $@` ]; then mkdir -p `dirname $@`; fi
+	$(CXX) $(TEST_CORO_CXXFLAGS) -o $@ $(TEST_CORO_SOURCE) $(TARGET_LIB)/libaerospike.a $(TEST_LDFLAGS)
@@ -346,7 +346,7 @@ aerospike_batch_read(
  * 						async method will return immediately after queueing command.
  * @param listener 		User function to be called with command results.
  * @param udata 		User data to be forwarded to user callback.
- * @param event_loop 	Event loop assigned to run this command. If NULL, an event loop will be choosen by round-robin.
+ * @param event_loop 	Event loop assigned to run this command. If NULL, the less loaded of two random event loops is used.
  *
  * @return AEROSPIKE_OK if async command succesfully queued. Otherwise an error.
  *
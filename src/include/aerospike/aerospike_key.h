@@ -104,7 +104,7 @@ aerospike_key_get(
  * @param key				The key of the record.
  * @param listener			User function to be called with command results.
  * @param udata 			User data to be forwarded to user callback.
- * @param event_loop 		Event loop assigned to run this command. If NULL, an event loop will be choosen by round-robin.
+ * @param event_loop 		Event loop assigned to run this command. If NULL, the less loaded of two random event loops is used.
  * @param pipe_listener		Enables command pipelining, if not NULL. The given callback is invoked after the current command
  * 							has been sent to the server. This allows for issuing the next command even before receiving a
  * 							result for the current command.
@@ -184,7 +184,7 @@ aerospike_key_select(
  * @param bins				The bins to select. A NULL terminated array of NULL terminated strings.
  * @param listener			User function to be called with command results.
  * @param udata				User data to be forwarded to user callback.
- * @param event_loop		Event loop assigned to run this command. If NULL, an event loop will be choosen by round-robin.
+ * @param event_loop		Event loop assigned to run this command. If NULL, the less loaded of two random event loops is used.
  * @param pipe_listener		Enables command pipelining, if not NULL. The given callback is invoked after the current command
  * 							has been sent to the server. This allows for issuing the next command even before receiving a
  * 							result for the current command.
@@ -269,7 +269,7 @@ aerospike_key_exists(
  * @param key				The key of the record.
  * @param listener			User function to be called with command results.
  * @param udata				User data to be forwarded to user callback.
- * @param event_loop		Event loop assigned to run this command. If NULL, an event loop will be choosen by round-robin.
+ * @param event_loop		Event loop assigned to run this command. If NULL, the less loaded of two random event loops is used.
  * @param pipe_listener		Enables command pipelining, if not NULL. The given callback is invoked after the current command
  * 							has been sent to the server. This allows for issuing the next command even before receiving a
  * 							result for the current command.
@@ -350,7 +350,7 @@ aerospike_key_put(
  * @param rec				The record containing the data to be written.
  * @param listener			User function to be called with command results.
  * @param udata				User data to be forwarded to user callback.
- * @param event_loop		Event loop assigned to run this command. If NULL, an event loop will be choosen by round-robin.
+ * @param event_loop		Event loop assigned to run this command. If NULL, the less loaded of two random event loops is used.
  * @param pipe_listener		Enables command pipelining, if not NULL. The given callback is invoked after the current command
  * 							has been sent to the server. This allows for issuing the next command even before receiving a
  * 							result for the current command.
@@ -416,7 +416,7 @@ aerospike_key_remove(
  * @param key				The key of the record.
  * @param listener			User function to be called with command results.
  * @param udata				User data to be forwarded to user callback.
- * @param event_loop		Event loop assigned to run this command. If NULL, an event loop will be choosen by round-robin.
+ * @param event_loop		Event loop assigned to run this command. If NULL, the less loaded of two random event loops is used.
  * @param pipe_listener		Enables command pipelining, if not NULL. The given callback is invoked after the current command
  * 							has been sent to the server. This allows for issuing the next command even before receiving a
  * 							result for the current command.
@@ -507,7 +507,7 @@ aerospike_key_operate(
  * @param ops				The operations to perform on the record.
  * @param listener			User function to be called with command results.
  * @param udata				User data to be forwarded to user callback.
- * @param event_loop		Event loop assigned to run this command. If NULL, an event loop will be choosen by round-robin.
+ * @param event_loop		Event loop assigned to run this command. If NULL, the less loaded of two random event loops is used.
  * @param pipe_listener		Enables command pipelining, if not NULL. The given callback is invoked after the current command
  * 							has been sent to the server. This allows for issuing the next command even before receiving a
  * 							result for the current command.
@@ -602,7 +602,7 @@ aerospike_key_apply(
  * @param arglist			The arguments for the function.
  * @param listener			User function to be called with command results.
  * @param udata				User data to be forwarded to user callback.
- * @param event_loop		Event loop assigned to run this command. If NULL, an event loop will be choosen by round-robin.
+ * @param event_loop		Event loop assigned to run this command. If NULL, the less loaded of two random event loops is used.
  * @param pipe_listener		Enables command pipelining, if not NULL. The given callback is invoked after the current command
  * 							has been sent to the server. This allows for issuing the next command even before receiving a
  * 							result for the current command.
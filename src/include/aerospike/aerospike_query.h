@@ -224,7 +224,7 @@ aerospike_query_foreach(
  * @param query			The query to execute against the cluster.
  * @param listener		The function to be called for each returned value.
  * @param udata			User-data to be passed to the callback.
- * @param event_loop 	Event loop assigned to run this command. If NULL, an event loop will be choosen by round-robin.
+ * @param event_loop 	Event loop assigned to run this command. If NULL, the less loaded of two random event loops is used.
  *
  * @return AEROSPIKE_OK if async query succesfully queued. Otherwise an error.
  *
@@ -94,6 +94,7 @@
  */
 
 #include <aerospike/aerospike.h>
+#include <aerospike/as_column_batch.h>
 #include <aerospike/as_listener.h>
 #include <aerospike/as_error.h>
 #include <aerospike/as_policy.h>
@@ -134,6 +135,21 @@ extern "C" {
  */
 typedef bool (*aerospike_scan_foreach_callback)(const as_val* val, void* udata);
 
+/**
+ * This callback will be called for each batch of rows returned from aerospike_scan_columns().
+ * Each node fills its own batch, so multiple threads will likely be calling this callback
+ * in parallel.  The batch is reused after the callback returns, so data that must outlive
+ * the callback has to be copied.
+ *
+ * @param batch 		The batch of rows, or NULL when the scan has completed.
+ * @param udata 		User-data provided to the calling function.
+ *
+ * @return `true` to continue to the next batch. Otherwise, the scan will end.
+ *
+ * @ingroup scan_operations
+ */
+typedef bool (*aerospike_scan_columns_callback)(const as_column_batch* batch, void* udata);
+
 /**
  * Asynchronous scan user callback.  This function is called for each record returned.
  * This function is also called once when the scan completes or an error has occurred.
@@ -285,6 +301,51 @@ aerospike_scan_foreach(
 	aerospike_scan_foreach_callback callback, void* udata
 	);
 
+/**
+ * Scan the records in the specified namespace and set for all nodes and decode bins
+ * directly into typed column buffers.  No as_record or as_val objects are created.
+ *
+ * Each column definition maps a bin name to a column type.  Bins that are not defined as
+ * columns are skipped.  Bins that are missing or whose type does not match the column type
+ * are stored as null.  Select only the column bins with as_scan_select() to avoid
+ * transferring unused bins.
+ *
+ * The callback is called each time batch_size rows have been decoded from a node and once
+ * more for each node's final partial batch.  When all nodes have completed, the callback
+ * is called with a NULL batch.
+ *
+ * ~~~~~~~~~~{.c}
+ * as_column_def defs[2] = {
+ *     {"id", AS_COLUMN_INTEGER},
+ *     {"name", AS_COLUMN_STRING}
+ * };
+ *
+ * if (aerospike_scan_columns(&as, &err, NULL, &scan, defs, 2, 4096, callback, NULL) != AEROSPIKE_OK) {
+ * 	   fprintf(stderr, "error(%d) %s at [%s:%d]", err.code, err.message, err.file, err.line);
+ * }
+ * ~~~~~~~~~~
+ *
+ * @param as			The aerospike instance to use for this operation.
+ * @param err			The as_error to be populated if an error occurs.
+ * @param policy		The policy to use for this operation. If NULL, then the default policy will be used.
+ * @param scan			The scan to execute against the cluster.
+ * @param defs			Column definitions.
+ * @param n_defs		Number of column definitions.
+ * @param batch_size	Maximum number of rows in each batch.
+ * @param callback		The function to be called for each batch.
+ * @param udata			User-data to be passed to the callback.
+ *
+ * @return AEROSPIKE_OK on success. Otherwise an error occurred.
+ *
+ * @ingroup scan_operations
+ */
+AS_EXTERN as_status
+aerospike_scan_columns(
+	aerospike* as, as_error* err, const as_policy_scan* policy, const as_scan* scan,
+	const as_column_def* defs, uint32_t n_defs, uint32_t batch_size,
+	aerospike_scan_columns_callback callback, void* udata
+	);
+
 /**
  * Scan the records in the specified namespace and set for a single node.
  *
@@ -369,7 +430,7 @@ aerospike_scan_node(
  * @param scan_id		The id for the scan job.  Use NULL if the scan_id will not be used.
  * @param listener		The function to be called for each record scanned.
  * @param udata			User-data to be passed to the callback.
- * @param event_loop 	Event loop assigned to run this command. If NULL, an event loop will be choosen by round-robin.
+ * @param event_loop 	Event loop assigned to run this command. If NULL, the less loaded of two random event loops is used.
  *
  * @return AEROSPIKE_OK if async scan succesfully queued. Otherwise an error.
  *
@@ -429,7 +490,7 @@ aerospike_scan_async(
  * @param node_name		The node name to scan.
  * @param listener		The function to be called for each record scanned.
  * @param udata			User-data to be passed to the callback.
- * @param event_loop 	Event loop assigned to run this command. If NULL, an event loop will be choosen by round-robin.
+ * @param event_loop 	Event loop assigned to run this command. If NULL, the less loaded of two random event loops is used.
  *
  * @return AEROSPIKE_OK if async scan succesfully queued. Otherwise an error.
  *
@@ -18,6 +18,7 @@
 
 #include <aerospike/as_async_proto.h>
 #include <aerospike/as_cluster.h>
+#include <aerospike/as_command_pool.h>
 #include <aerospike/as_event_internal.h>
 #include <aerospike/as_listener.h>
 #include <citrusleaf/alloc.h>
@@ -36,6 +37,7 @@ extern "C" {
 #define AS_ASYNC_TYPE_BATCH 3
 #define AS_ASYNC_TYPE_SCAN 4
 #define AS_ASYNC_TYPE_QUERY 5
+#define AS_ASYNC_TYPE_CONNECTOR 6
 	
 #define AS_AUTHENTICATION_MAX_SIZE 158
 
@@ -73,16 +75,16 @@ as_async_write_command_create(
 	)
 {
 	// Allocate enough memory to cover: struct size + write buffer size + auth max buffer size
-	// Then, round up memory size in 1KB increments.
-	size_t s = (sizeof(as_async_write_command) + size + AS_AUTHENTICATION_MAX_SIZE + 1023) & ~1023;
-	as_event_command* cmd = (as_event_command*)cf_malloc(s);
+	// Buffer pool rounds up to the next size class, which is used as read capacity.
+	size_t s = sizeof(as_async_write_command) + size + AS_AUTHENTICATION_MAX_SIZE;
+	as_event_command* cmd = (as_event_command*)as_command_pool_alloc(s, &s);
 	as_async_write_command* wcmd = (as_async_write_command*)cmd;
-	cmd->total_deadline = policy->total_timeout;
-	cmd->socket_timeout = policy->socket_timeout;
+	cmd->total_deadline = as_policy_total_timeout_us(policy);
+	cmd->socket_timeout = as_policy_socket_timeout_us(policy);
 	cmd->max_retries = policy->max_retries;
 	cmd->iteration = 0;
 	cmd->replica = replica;
-	cmd->event_loop = as_event_assign(event_loop);
+	cmd->event_loop = as_event_assign(cluster, event_loop);
 	cmd->cluster = cluster;
 	cmd->node = NULL;
 	cmd->partition = partition;
@@ -93,7 +95,8 @@ as_async_write_command_create(
 	cmd->read_capacity = (uint32_t)(s - size - sizeof(as_async_write_command));
 	cmd->type = AS_ASYNC_TYPE_WRITE;
 	cmd->state = AS_ASYNC_STATE_UNREGISTERED;
-	cmd->flags = flags;
+	cmd->flags = flags | as_event_steal_flag(event_loop, pipe_listener);
+	cmd->replica_index = 0;
 	cmd->deserialize = false;
 	wcmd->listener = listener;
 	return cmd;
@@ -108,17 +111,21 @@ as_async_record_command_create(
 	)
 {
 	// Allocate enough memory to cover: struct size + write buffer size + auth max buffer size
-	// Then, round up memory size in 4KB increments to reduce fragmentation and to allow socket
-	// read to reuse buffer for small socket write sizes.
-	size_t s = (sizeof(as_async_record_command) + size + AS_AUTHENTICATION_MAX_SIZE + 4095) & ~4095;
-	as_event_command* cmd = (as_event_command*)cf_malloc(s);
+	// Buffer pool rounds up to the next size class (at least 4KB) to allow socket read to
+	// reuse buffer for small socket write sizes.
+	size_t s = sizeof(as_async_record_command) + size + AS_AUTHENTICATION_MAX_SIZE;
+
+	if (s < 4096 - AS_COMMAND_POOL_HEADER_SIZE) {
+		s = 4096 - AS_COMMAND_POOL_HEADER_SIZE;
+	}
+	as_event_command* cmd = (as_event_command*)as_command_pool_alloc(s, &s);
 	as_async_record_command* rcmd = (as_async_record_command*)cmd;
-	cmd->total_deadline = policy->total_timeout;
-	cmd->socket_timeout = policy->socket_timeout;
+	cmd->total_deadline = as_policy_total_timeout_us(policy);
+	cmd->socket_timeout = as_policy_socket_timeout_us(policy);
 	cmd->max_retries = policy->max_retries;
 	cmd->iteration = 0;
 	cmd->replica = replica;
-	cmd->event_loop = as_event_assign(event_loop);
+	cmd->event_loop = as_event_assign(cluster, event_loop);
 	cmd->cluster = cluster;
 	cmd->node = NULL;
 	cmd->partition = partition;
@@ -129,7 +136,8 @@ as_async_record_command_create(
 	cmd->read_capacity = (uint32_t)(s - size - sizeof(as_async_record_command));
 	cmd->type = AS_ASYNC_TYPE_RECORD;
 	cmd->state = AS_ASYNC_STATE_UNREGISTERED;
-	cmd->flags = flags;
+	cmd->flags = flags | as_event_steal_flag(event_loop, pipe_listener);
+	cmd->replica_index = 0;
 	cmd->deserialize = deserialize;
 	rcmd->listener = listener;
 	return cmd;
@@ -143,17 +151,21 @@ as_async_value_command_create(
 	)
 {
 	// Allocate enough memory to cover: struct size + write buffer size + auth max buffer size
-	// Then, round up memory size in 4KB increments to reduce fragmentation and to allow socket
-	// read to reuse buffer for small socket write sizes.
-	size_t s = (sizeof(as_async_value_command) + size + AS_AUTHENTICATION_MAX_SIZE + 4095) & ~4095;
-	as_event_command* cmd = (as_event_command*)cf_malloc(s);
+	// Buffer pool rounds up to the next size class (at least 4KB) to allow socket read to
+	// reuse buffer for small socket write sizes.
+	size_t s = sizeof(as_async_value_command) + size + AS_AUTHENTICATION_MAX_SIZE;
+
+	if (s < 4096 - AS_COMMAND_POOL_HEADER_SIZE) {
+		s = 4096 - AS_COMMAND_POOL_HEADER_SIZE;
+	}
+	as_event_command* cmd = (as_event_command*)as_command_pool_alloc(s, &s);
 	as_async_value_command* vcmd = (as_async_value_command*)cmd;
-	cmd->total_deadline = policy->total_timeout;
-	cmd->socket_timeout = policy->socket_timeout;
+	cmd->total_deadline = as_policy_total_timeout_us(policy);
+	cmd->socket_timeout = as_policy_socket_timeout_us(policy);
 	cmd->max_retries = policy->max_retries;
 	cmd->iteration = 0;
 	cmd->replica = replica;
-	cmd->event_loop = as_event_assign(event_loop);
+	cmd->event_loop = as_event_assign(cluster, event_loop);
 	cmd->cluster = cluster;
 	cmd->node = NULL;
 	cmd->partition = partition;
@@ -164,7 +176,8 @@ as_async_value_command_create(
 	cmd->read_capacity = (uint32_t)(s - size - sizeof(as_async_value_command));
 	cmd->type = AS_ASYNC_TYPE_VALUE;
 	cmd->state = AS_ASYNC_STATE_UNREGISTERED;
-	cmd->flags = flags;
+	cmd->flags = flags | as_event_steal_flag(event_loop, pipe_listener);
+	cmd->replica_index = 0;
 	cmd->deserialize = false;
 	vcmd->listener = listener;
 	return cmd;
@@ -18,15 +18,19 @@
 
 #include <aerospike/as_atomic.h>
 #include <aerospike/as_config.h>
+#include <aerospike/as_epoch.h>
 #include <aerospike/as_node.h>
 #include <aerospike/as_partition.h>
 #include <aerospike/as_policy.h>
 #include <aerospike/as_thread_pool.h>
+#include <citrusleaf/cf_clock.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+struct as_namespace_handle_s;
+
 /******************************************************************************
  * TYPES
  *****************************************************************************/
@@ -77,8 +81,30 @@ typedef struct as_gc_item_s {
 	 * Release function.
 	 */
 	as_release_fn release_fn;
+
+	/**
+	 * @private
+	 * Epoch when data was removed from shared structures.  Data is released
+	 * after all request threads that could have read it have left their read section.
+	 * Items removed in the same tend share one epoch.
+	 */
+	uint64_t epoch;
 } as_gc_item;
 
+/**
+ * @private
+ * Add data removed from shared structures to garbage collector.
+ */
+static inline void
+as_gc_add(as_vector* /* <as_gc_item> */ gc, void* data, as_release_fn release_fn)
+{
+	as_gc_item item;
+	item.data = data;
+	item.release_fn = release_fn;
+	item.epoch = as_epoch_current();
+	as_vector_append(gc, &item);
+}
+
 /**
  * Cluster of server nodes.
  */
@@ -106,6 +132,18 @@ typedef struct as_cluster_s {
 	 * Shared memory implementation of cluster.
 	 */
 	struct as_shm_info_s* shm_info;
+
+	/**
+	 * @private
+	 * Client side record cache.  NULL if disabled.
+	 */
+	struct as_near_cache_s* near_cache;
+
+	/**
+	 * @private
+	 * Reads in progress that concurrent reads of the same key can join.
+	 */
+	struct as_single_flight_s* single_flight;
 	
 	/**
 	 * @private
@@ -207,6 +245,12 @@ typedef struct as_cluster_s {
 	 * Maximum number of synchronous connections allowed per server node.
 	 */
 	uint32_t max_conns_per_node;
+
+	/**
+	 * @private
+	 * Minimum number of synchronous connections kept open per server node.
+	 */
+	uint32_t min_conns_per_node;
 	
 	/**
 	 * @private
@@ -215,6 +259,12 @@ typedef struct as_cluster_s {
 	 * This variable is ignored if asynchronous event loops are not created.
 	 */
 	uint32_t async_max_conns_per_node;
+
+	/**
+	 * @private
+	 * Minimum number of asynchronous (non-pipeline) connections kept open for each node.
+	 */
+	uint32_t async_min_conns_per_node;
 	
 	/**
 	 * @private
@@ -259,6 +309,79 @@ typedef struct as_cluster_s {
 	 * If "services-alternate" should be used instead of "services"
 	 */
 	bool use_services_alternate;
+
+	/**
+	 * @private
+	 * Should server rack data be tracked.
+	 */
+	bool rack_aware;
+
+	/**
+	 * @private
+	 * Rack where this client instance resides.
+	 */
+	int rack_id;
+
+	/**
+	 * @private
+	 * Node error percentage that opens circuit breaker.  Zero if disabled.
+	 */
+	uint32_t breaker_error_pct;
+
+	/**
+	 * @private
+	 * Minimum node commands per tend interval before error rate is evaluated.
+	 */
+	uint32_t breaker_min_commands;
+
+	/**
+	 * @private
+	 * Milliseconds open circuit breaker rejects commands.
+	 */
+	uint32_t breaker_open_ms;
+
+	/**
+	 * @private
+	 * Node latency percentile used for adaptive socket timeouts.  Zero if disabled.
+	 */
+	uint32_t timeout_percentile;
+
+	/**
+	 * @private
+	 * Adaptive socket timeout multiple of latency percentile.
+	 */
+	uint32_t timeout_multiplier;
+
+	/**
+	 * @private
+	 * Minimum adaptive socket timeout in microseconds.
+	 */
+	uint32_t min_timeout_us;
+
+	/**
+	 * @private
+	 * Hundredths of a retry added to retry budget per server response.  Zero if disabled.
+	 */
+	uint32_t retry_budget_pct;
+
+	/**
+	 * @private
+	 * Maximum retry budget in hundredths of a retry.
+	 */
+	uint32_t retry_tokens_max;
+
+	/**
+	 * @private
+	 * Available retry budget in hundredths of a retry.
+	 */
+	uint32_t retry_tokens;
+
+	/**
+	 * @private
+	 * Have event loops been asked to close this cluster.  Set under tend_lock, so the tend
+	 * thread stops queuing connection warm-up before cluster close is queued on event loops.
+	 */
+	bool async_closing;
 	
 	/**
 	 * @private
@@ -346,6 +469,14 @@ as_cluster_change_password(as_cluster* cluster, const char* user, const char* pa
 AS_EXTERN as_node*
 as_node_get_random(as_cluster* cluster);
 
+/**
+ * @private
+ * Get random node in the cluster without reserving it.
+ * Caller must be in an as_epoch_enter() read section.
+ */
+as_node*
+as_node_get_random_epoch(as_cluster* cluster);
+
 /**
  * @private
  * Get node given node name.
@@ -354,6 +485,156 @@ as_node_get_random(as_cluster* cluster);
 AS_EXTERN as_node*
 as_node_get_by_name(as_cluster* cluster, const char* name);
 
+/**
+ * @private
+ * Can node be selected for a command.  Returns false while the node's circuit breaker
+ * is open.  Once the open period expires, returns true until a selected command claims
+ * the probe with as_node_breaker_begin().
+ */
+static inline bool
+as_node_breaker_allow(as_node* node)
+{
+	if (as_load_uint8(&node->breaker_state) == AS_BREAKER_CLOSED) {
+		return true;
+	}
+	return cf_getms() >= as_load_uint64(&node->breaker_retry_ms);
+}
+
+/**
+ * @private
+ * Start command on node selected by as_node_breaker_allow().  If the node's circuit
+ * breaker is not closed, exactly one caller claims the probe that closes or reopens the
+ * breaker and receives its id in probe.  Other callers receive a zero probe id.  Returns
+ * false if the breaker is open and the probe was claimed by another command.
+ */
+static inline bool
+as_node_breaker_begin(as_node* node, uint32_t* probe)
+{
+	*probe = 0;
+
+	if (as_load_uint8(&node->breaker_state) == AS_BREAKER_CLOSED) {
+		return true;
+	}
+
+	uint64_t retry_ms = as_load_uint64(&node->breaker_retry_ms);
+	uint64_t now = cf_getms();
+
+	if (now < retry_ms) {
+		return false;
+	}
+
+	// Open period expired or previous probe never completed.  Claim probe and give it
+	// one open period to complete.
+	if (! as_cas_uint64(&node->breaker_retry_ms, retry_ms, now + node->cluster->breaker_open_ms)) {
+		return false;
+	}
+
+	// A new id also disowns a previous probe that never completed.
+	*probe = as_faa_uint32(&node->breaker_probe, 1) + 1;
+	as_store_uint8(&node->breaker_state, AS_BREAKER_HALF_OPEN);
+	return true;
+}
+
+/**
+ * @private
+ * Record command result for node's circuit breaker.  Connection errors and timeouts
+ * count against the node.  Server responses, including server errors, show the node
+ * is reachable.  Other client errors are ignored.  Only the current probe, identified
+ * by the id from as_node_breaker_begin(), moves a half open breaker to closed or open.
+ * Commands started before the breaker opened do not.
+ */
+static inline void
+as_node_breaker_result(as_node* node, as_status status, uint32_t probe)
+{
+	as_cluster* cluster = node->cluster;
+
+	if (cluster->breaker_error_pct == 0) {
+		return;
+	}
+
+	switch (status) {
+		case AEROSPIKE_ERR_TIMEOUT:
+		case AEROSPIKE_ERR_CONNECTION:
+		case AEROSPIKE_ERR_ASYNC_CONNECTION:
+			as_incr_uint32(&node->breaker_commands);
+			as_incr_uint32(&node->breaker_errors);
+
+			if (probe && probe == as_load_uint32(&node->breaker_probe) &&
+				as_cas_uint8(&node->breaker_state, AS_BREAKER_HALF_OPEN, AS_BREAKER_OPEN)) {
+				// Probe failed.
+				as_store_uint64(&node->breaker_retry_ms, cf_getms() + cluster->breaker_open_ms);
+			}
+			break;
+
+		default:
+			if (status < 0) {
+				break;
+			}
+			as_incr_uint32(&node->breaker_commands);
+
+			if (probe && probe == as_load_uint32(&node->breaker_probe)) {
+				// Probe succeeded.
+				as_cas_uint8(&node->breaker_state, AS_BREAKER_HALF_OPEN, AS_BREAKER_CLOSED);
+			}
+			break;
+	}
+}
+
+/**
+ * @private
+ * Add to retry budget after a command received a server response.
+ */
+static inline void
+as_cluster_retry_deposit(as_cluster* cluster)
+{
+	if (cluster->retry_budget_pct == 0) {
+		return;
+	}
+
+	uint32_t tokens;
+	uint32_t next;
+
+	do {
+		// Budget is normally full, so avoid writing the shared counter when it is.
+		tokens = as_load_uint32(&cluster->retry_tokens);
+
+		if (tokens >= cluster->retry_tokens_max) {
+			return;
+		}
+
+		// Concurrent deposits must not push the budget past its maximum.
+		next = tokens + cluster->retry_budget_pct;
+
+		if (next > cluster->retry_tokens_max) {
+			next = cluster->retry_tokens_max;
+		}
+	} while (! as_cas_uint32(&cluster->retry_tokens, tokens, next));
+}
+
+/**
+ * @private
+ * Take one retry from retry budget.  Return false if budget is exhausted.
+ */
+static inline bool
+as_cluster_retry_withdraw(as_cluster* cluster)
+{
+	if (cluster->retry_budget_pct == 0) {
+		return true;
+	}
+
+	uint32_t tokens;
+
+	do {
+		tokens = as_load_uint32(&cluster->retry_tokens);
+
+		if (tokens < 100) {
+			return false;
+		}
+	} while (! as_cas_uint32(&cluster->retry_tokens, tokens, tokens - 100));
+
+	return true;
+}
+
 /**
  * @private
  * Reserve reference counted access to partition tables.
@@ -398,11 +679,32 @@ as_cluster_get_partition_table(as_cluster* cluster, const char* ns)
 
 /**
  * @private
- * Get mapped node given partition.  
+ * Get partition table given namespace without reserving the tables array.
+ * Caller must be in an as_epoch_enter() read section.
+ */
+static inline as_partition_table*
+as_cluster_get_partition_table_epoch(as_cluster* cluster, const char* ns)
+{
+	as_partition_tables* tables = (as_partition_tables*)as_load_ptr(&cluster->partition_tables);
+	return as_partition_tables_get(tables, ns);
+}
+
+/**
+ * @private
+ * Get mapped node given partition.  sequence is the number of times the command
+ * has moved to the next replica on retry.
  * as_nodes_release() must be called when done with node.
  */
 as_node*
-as_partition_get_node(as_cluster* cluster, as_partition* p, as_policy_replica replica, bool use_master, bool cp_mode);
+as_partition_get_node(as_cluster* cluster, as_partition* p, as_policy_replica replica, uint32_t sequence, bool cp_mode);
+
+/**
+ * @private
+ * Get mapped node given partition without reserving it.
+ * Caller must be in an as_epoch_enter() read section.
+ */
+as_node*
+as_partition_get_node_epoch(as_cluster* cluster, as_partition* p, as_policy_replica replica, uint32_t sequence, bool cp_mode);
 
 /**
  * @private
@@ -412,9 +714,28 @@ as_partition_get_node(as_cluster* cluster, as_partition* p, as_policy_replica re
 as_status
 as_cluster_get_node(
 	struct as_cluster_s* cluster, as_error* err, const char* ns, const uint8_t* digest,
-	as_policy_replica replica, bool master, as_node** node
+	as_policy_replica replica, uint32_t sequence, as_node** node
+	);
+
+/**
+ * @private
+ * Get mapped node given digest key without reserving it.  If nsh is set, the namespace
+ * lookup is skipped.  The node is only valid until as_epoch_exit() is called, so the
+ * caller must be in an as_epoch_enter() read section for the node's entire use.
+ */
+as_status
+as_cluster_get_node_epoch(
+	struct as_cluster_s* cluster, as_error* err, const char* ns, const struct as_namespace_handle_s* nsh,
+	const uint8_t* digest, as_policy_replica replica, uint32_t sequence, as_node** node
 	);
 
+/**
+ * @private
+ * Resolve namespace into a handle that references its partition table.
+ */
+as_status
+as_cluster_resolve_namespace(as_cluster* cluster, as_error* err, const char* ns, struct as_namespace_handle_s* handle);
+
 #ifdef __cplusplus
 } // end extern "C"
 #endif
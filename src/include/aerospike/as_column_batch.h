@@ -0,0 +1,255 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#pragma once
+
+#include <aerospike/as_bin.h>
+#include <aerospike/as_std.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * Value type stored in a column.
+ *
+ * @ingroup scan_operations
+ */
+typedef enum as_column_type_e {
+	/**
+	 * Integer bins stored in as_column.ints.
+	 */
+	AS_COLUMN_INTEGER,
+
+	/**
+	 * Double bins stored in as_column.doubles.
+	 */
+	AS_COLUMN_DOUBLE,
+
+	/**
+	 * String bins stored in as_column.data with row boundaries in as_column.offsets.
+	 * Strings are not null terminated.
+	 */
+	AS_COLUMN_STRING,
+
+	/**
+	 * Blob bins stored in as_column.data with row boundaries in as_column.offsets.
+	 */
+	AS_COLUMN_BLOB
+} as_column_type;
+
+/**
+ * Column definition.  Maps a bin name to the column type it should be decoded into.
+ * Bins whose server type does not match the column type are stored as null.
+ *
+ * @ingroup scan_operations
+ */
+typedef struct as_column_def_s {
+	/**
+	 * Bin name.
+	 */
+	as_bin_name name;
+
+	/**
+	 * Column type.
+	 */
+	as_column_type type;
+} as_column_def;
+
+/**
+ * Typed column buffers for one bin.  Row i is present when bit (i % 8) of
+ * validity[i / 8] is set.  Fixed width values of null rows are zero.  For string and
+ * blob columns, the value of row i is data[offsets[i]] to data[offsets[i + 1]].
+ *
+ * @ingroup scan_operations
+ */
+typedef struct as_column_s {
+	/**
+	 * Bin name.
+	 */
+	as_bin_name name;
+
+	/**
+	 * Column type.
+	 */
+	as_column_type type;
+
+	/**
+	 * Validity bitmap with one bit per row.
+	 */
+	uint8_t* validity;
+
+	/**
+	 * Values for AS_COLUMN_INTEGER.
+	 */
+	int64_t* ints;
+
+	/**
+	 * Values for AS_COLUMN_DOUBLE.
+	 */
+	double* doubles;
+
+	/**
+	 * Row offsets into data for AS_COLUMN_STRING and AS_COLUMN_BLOB. Has capacity + 1 entries.
+	 */
+	uint32_t* offsets;
+
+	/**
+	 * Variable length bytes for AS_COLUMN_STRING and AS_COLUMN_BLOB.
+	 */
+	uint8_t* data;
+
+	/**
+	 * Bytes used in data.
+	 */
+	uint32_t data_size;
+
+	/**
+	 * Bytes allocated for data.
+	 */
+	uint32_t data_capacity;
+
+	/**
+	 * Number of null rows in current batch.
+	 */
+	uint32_t null_count;
+} as_column;
+
+/**
+ * Batch of rows decoded into columns.  Column order matches the column definitions
+ * passed to aerospike_scan_columns().
+ *
+ * @ingroup scan_operations
+ */
+typedef struct as_column_batch_s {
+	/**
+	 * Columns.
+	 */
+	as_column* columns;
+
+	/**
+	 * Number of columns.
+	 */
+	uint32_t n_columns;
+
+	/**
+	 * Number of rows in current batch.
+	 */
+	uint32_t size;
+
+	/**
+	 * Maximum number of rows per batch.
+	 */
+	uint32_t capacity;
+} as_column_batch;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @private
+ * Create column batch with room for capacity rows.
+ */
+as_column_batch*
+as_column_batch_create(const as_column_def* defs, uint32_t n_defs, uint32_t capacity);
+
+/**
+ * @private
+ * Destroy column batch.
+ */
+void
+as_column_batch_destroy(as_column_batch* batch);
+
+/**
+ * @private
+ * Remove all rows from batch.  Allocated buffers are kept for the next batch.
+ */
+void
+as_column_batch_reset(as_column_batch* batch);
+
+/**
+ * @private
+ * Find column by bin name.  The name does not need to be null terminated.
+ */
+as_column*
+as_column_batch_find(as_column_batch* batch, const char* name, uint32_t name_len);
+
+/**
+ * @private
+ * Append variable length value to column at current row.
+ * Return false if memory could not be allocated.
+ */
+bool
+as_column_set_bytes(as_column* col, uint32_t row, const uint8_t* bytes, uint32_t size);
+
+/**
+ * @private
+ * Complete current row.  Variable length columns not set in this row are recorded as null.
+ */
+void
+as_column_batch_end_row(as_column_batch* batch);
+
+/**
+ * @private
+ * Mark row as present in column.
+ */
+static inline void
+as_column_set_valid(as_column* col, uint32_t row)
+{
+	col->validity[row >> 3] |= (uint8_t)(1 << (row & 7));
+}
+
+/**
+ * Is row present in column.
+ *
+ * @relates as_column
+ */
+static inline bool
+as_column_is_valid(const as_column* col, uint32_t row)
+{
+	return (col->validity[row >> 3] & (1 << (row & 7))) != 0;
+}
+
+/**
+ * @private
+ * Set integer value at row.
+ */
+static inline void
+as_column_set_int64(as_column* col, uint32_t row, int64_t value)
+{
+	col->ints[row] = value;
+	as_column_set_valid(col, row);
+}
+
+/**
+ * @private
+ * Set double value at row.
+ */
+static inline void
+as_column_set_double(as_column* col, uint32_t row, double value)
+{
+	col->doubles[row] = value;
+	as_column_set_valid(col, row);
+}
+
+#ifdef __cplusplus
+} // end extern "C"
+#endif
@@ -19,6 +19,7 @@
 #include <aerospike/as_bin.h>
 #include <aerospike/as_buffer.h>
 #include <aerospike/as_cluster.h>
+#include <aerospike/as_command_pool.h>
 #include <aerospike/as_key.h>
 #include <aerospike/as_operations.h>
 #include <aerospike/as_proto.h>
@@ -104,25 +105,25 @@ extern "C" {
 
 /**
  * @private
- * Macros use these stand-ins for cf_malloc() / cf_free(), so that
+ * Macros use these stand-ins for the command buffer pool, so that
  * instrumentation properly substitutes them.
  */
 
 static inline void*
 local_malloc(size_t size)
 {
-	return cf_malloc(size);
+	return as_command_pool_alloc(size, NULL);
 }
 
 static inline void
 local_free(void* memory)
 {
-	cf_free(memory);
+	as_command_pool_free(memory);
 }
 
 /**
  * @private
- * Allocate command buffer on stack or heap depending on given size.
+ * Allocate command buffer on stack or from thread local buffer pool depending on given size.
  */
 #define as_command_init(_sz) (_sz > AS_STACK_BUF_SIZE) ? (uint8_t*)local_malloc(_sz) : (uint8_t*)alloca(_sz)
 
@@ -143,6 +144,7 @@ local_free(void* memory)
 typedef struct as_command_node_s {
 	as_node* node;
 	const char* ns;
+	const struct as_namespace_handle_s* nsh;
 	const uint8_t* digest;
 	as_policy_replica replica;
 } as_command_node;
@@ -158,14 +160,41 @@ typedef struct as_command_parse_result_data_s {
 
 /**
  * @private
- * Parse results callback used in as_command_execute().
+ * Unparsed record returned by as_command_parse_raw().  Record bins remain in server
+ * wire format, so they can be shared and parsed later.
  */
-typedef as_status (*as_parse_results_fn) (as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout, uint64_t deadline_ms, void* user_data);
+typedef struct as_command_raw_record_s {
+	as_msg msg;
+	uint8_t* buf;
+	uint8_t* bins;
+	uint32_t size;
+} as_command_raw_record;
+
+/**
+ * @private
+ * Parse results callback used in as_command_execute().  Socket timeout and deadline
+ * are in microseconds.
+ */
+typedef as_status (*as_parse_results_fn) (as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* user_data);
 
 /******************************************************************************
  * FUNCTIONS
  ******************************************************************************/
 
+/**
+ * @private
+ * Initialize node map data for key.
+ */
+static inline void
+as_command_node_init(as_command_node* cn, const as_key* key, as_policy_replica replica)
+{
+	cn->node = 0;
+	cn->ns = key->ns;
+	cn->nsh = key->nsh;
+	cn->digest = key->digest.value;
+	cn->replica = replica;
+}
+
 /**
  * @private
  * Calculate size of command header plus key fields.
@@ -439,21 +468,29 @@ as_command_execute(
  * Parse header of server response.
  */
 as_status
-as_command_parse_header(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout, uint64_t deadline_ms, void* user_data);
+as_command_parse_header(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* user_data);
 
 /**
  * @private
  * Parse server record.  Used for reads.
  */
 as_status
-as_command_parse_result(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout, uint64_t deadline_ms, void* user_data);
+as_command_parse_result(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* user_data);
+
+/**
+ * @private
+ * Read server record into as_command_raw_record without parsing bins.
+ * On success, the caller must free raw->buf with cf_free().
+ */
+as_status
+as_command_parse_raw(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* user_data);
 
 /**
  * @private
  * Parse server success or failure result.
  */
 as_status
-as_command_parse_success_failure(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout, uint64_t deadline_ms, void* user_data);
+as_command_parse_success_failure(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* user_data);
 
 /**
  * @private
@@ -462,6 +499,14 @@ as_command_parse_success_failure(as_error* err, as_socket* sock, as_node* node,
 as_status
 as_command_parse_success_failure_bins(uint8_t** pp, as_error* err, as_msg* msg, as_val** value);
 
+/**
+ * @private
+ * Populate record from bins that have already been read from the server.
+ * p points to the first bin.  A new record is allocated when *data->record is NULL.
+ */
+as_status
+as_command_parse_record(as_error* err, uint8_t* p, uint16_t n_bins, uint32_t gen, uint32_t ttl, as_command_parse_result_data* data);
+
 /**
  * @private
  * Parse bins received from the server.
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#pragma once
+
+#include <aerospike/as_std.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+/**
+ * @private
+ * Smallest pooled buffer size is 1 << AS_COMMAND_POOL_MIN_SHIFT (1KB).
+ */
+#define AS_COMMAND_POOL_MIN_SHIFT 10
+
+/**
+ * @private
+ * Largest pooled buffer size is 1 << AS_COMMAND_POOL_MAX_SHIFT (1MB).  Larger buffers
+ * are allocated and freed directly.
+ */
+#define AS_COMMAND_POOL_MAX_SHIFT 20
+
+/**
+ * @private
+ * Bytes reserved in front of each pooled buffer.  A request of
+ * (1 << n) - AS_COMMAND_POOL_HEADER_SIZE bytes fits exactly in size class n.
+ */
+#define AS_COMMAND_POOL_HEADER_SIZE 16
+
+/**
+ * @private
+ * Number of buffer size classes.
+ */
+#define AS_COMMAND_POOL_CLASSES (AS_COMMAND_POOL_MAX_SHIFT - AS_COMMAND_POOL_MIN_SHIFT + 1)
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * Command buffer pool statistics summed over all threads.
+ *
+ * @ingroup client_objects
+ */
+typedef struct as_command_pool_stats_s {
+	/**
+	 * Buffers served from a thread cache or the shared depot.
+	 */
+	uint64_t hits;
+
+	/**
+	 * Buffers allocated from the heap because no cached buffer was available
+	 * or the requested size exceeded the largest size class.
+	 */
+	uint64_t misses;
+
+	/**
+	 * Buffers returned to the heap because caches were full.
+	 */
+	uint64_t releases;
+} as_command_pool_stats;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @private
+ * Allocate command or response buffer of at least size bytes.  Buffers are taken from a
+ * thread local cache of power of two size classes, so repeated commands do not reach the
+ * allocator.  If capacity is not NULL, it is set to the usable size of the buffer, which
+ * may be larger than requested.
+ */
+void*
+as_command_pool_alloc(size_t size, size_t* capacity);
+
+/**
+ * @private
+ * Return buffer allocated by as_command_pool_alloc().  The buffer may be freed by a
+ * different thread than the one that allocated it.
+ */
+void
+as_command_pool_free(void* buf);
+
+/**
+ * Get command buffer pool statistics.
+ *
+ * @ingroup client_objects
+ */
+AS_EXTERN void
+as_command_pool_get_stats(as_command_pool_stats* stats);
+
+#ifdef __cplusplus
+} // end extern "C"
+#endif
@@ -0,0 +1,304 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#pragma once
+
+#include <aerospike/as_atomic.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_event.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_val.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * Listener type of the command that produced a completion.
+ *
+ * @ingroup async_events
+ */
+typedef enum as_completion_type_e {
+	/**
+	 * Write, remove or touch command (as_async_write_listener).
+	 */
+	AS_COMPLETION_WRITE,
+
+	/**
+	 * Get, select, exists or operate command (as_async_record_listener).
+	 */
+	AS_COMPLETION_RECORD,
+
+	/**
+	 * Apply command (as_async_value_listener).
+	 */
+	AS_COMPLETION_VALUE
+} as_completion_type;
+
+/**
+ * Result of a single record async command delivered in a batch.
+ *
+ * @ingroup async_events
+ */
+typedef struct as_completion_s {
+	/**
+	 * Error if command failed, otherwise NULL.
+	 */
+	as_error* err;
+
+	/**
+	 * Record returned by AS_COMPLETION_RECORD commands on success.
+	 */
+	as_record* record;
+
+	/**
+	 * Value returned by AS_COMPLETION_VALUE commands on success.
+	 */
+	as_val* val;
+
+	/**
+	 * User data passed to the async command.
+	 */
+	void* udata;
+
+	/**
+	 * Listener type of the command.
+	 */
+	as_completion_type type;
+} as_completion;
+
+/**
+ * Batch completion listener.  Called from the event loop thread with all completions
+ * collected in one event loop iteration.  Completions are destroyed after the listener
+ * returns, so records and values must be copied if they are needed later.
+ *
+ * @param completions		Completion array.
+ * @param n_completions		Number of completions.
+ * @param udata				User data passed to as_event_loop_set_completion_listener().
+ * @param event_loop		Event loop that executed the commands.
+ *
+ * @ingroup async_events
+ */
+typedef void (*as_async_completion_listener) (
+	as_completion* completions, uint32_t n_completions, void* udata, as_event_loop* event_loop
+	);
+
+/**
+ * Single producer, single consumer completion ring.  The event loop thread is the
+ * producer and one application thread is the consumer, so no locks are taken on either
+ * side.  Each event loop must have its own ring.
+ *
+ * The ring should be sized for the maximum number of async commands in flight on its
+ * event loop.  When the ring is full, completions are held on the event loop and pushed on
+ * later event loop passes, and new single record commands on the event loop fail with
+ * AEROSPIKE_ERR_ASYNC_QUEUE_FULL until the held completions fit in the ring.
+ *
+ * @ingroup async_events
+ */
+typedef struct as_completion_ring_s {
+	/**
+	 * @private
+	 * Completion slots.
+	 */
+	as_completion* entries;
+
+	/**
+	 * @private
+	 * Number of slots minus one.  Capacity is a power of two.
+	 */
+	uint32_t mask;
+
+	/**
+	 * @private
+	 * Pad so consumer and producer positions are on different cache lines.
+	 */
+	char pad1[52];
+
+	/**
+	 * @private
+	 * Next slot to read.  Written by consumer.
+	 */
+	uint64_t head;
+
+	/**
+	 * @private
+	 * Pad so consumer and producer positions are on different cache lines.
+	 */
+	char pad2[56];
+
+	/**
+	 * @private
+	 * Next slot to write.  Written by producer.
+	 */
+	uint64_t tail;
+} as_completion_ring;
+
+/**
+ * @private
+ * Per event loop completion state.
+ */
+typedef struct as_completion_queue_s {
+	as_async_completion_listener listener;
+	void* udata;
+	as_completion_ring* ring;
+	as_completion* entries;
+	as_completion* spare;
+	uint32_t size;
+	uint32_t capacity;
+	uint32_t max_batch;
+	bool flush_scheduled;
+	uint8_t backlog;
+} as_completion_queue;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * Deliver single record async command results on this event loop to listener in batches
+ * instead of calling each command's listener.  Completions are collected during one event
+ * loop iteration and delivered when the iteration ends or when max_batch completions are
+ * pending.  Batch, scan and query commands are not affected.
+ *
+ * Must be called before async commands are issued on the event loop, or from the event
+ * loop thread.  Pass a NULL listener to deliver pending completions and return to
+ * per command listeners.  Commands issued without an event loop may be moved to a less
+ * loaded loop before they start, so set the same listener on every loop when mixing
+ * delivery modes is not desired.
+ *
+ * ~~~~~~~~~~{.c}
+ * static void my_completions(as_completion* c, uint32_t n, void* udata, as_event_loop* event_loop)
+ * {
+ *     for (uint32_t i = 0; i < n; i++) {
+ *         if (c[i].err) {
+ *             printf("Command failed: %d %s\n", c[i].err->code, c[i].err->message);
+ *         }
+ *     }
+ * }
+ *
+ * as_event_loop_set_completion_listener(event_loop, my_completions, NULL, 1024);
+ * ~~~~~~~~~~
+ *
+ * @param event_loop	Event loop.
+ * @param listener		Batch completion listener.
+ * @param udata			User data forwarded to listener.
+ * @param max_batch		Maximum completions per listener call.
+ *
+ * @ingroup async_events
+ */
+AS_EXTERN void
+as_event_loop_set_completion_listener(
+	as_event_loop* event_loop, as_async_completion_listener listener, void* udata, uint32_t max_batch
+	);
+
+/**
+ * Post single record async command results on this event loop to a completion ring instead
+ * of calling each command's listener.  The application drains the ring with
+ * as_completion_ring_drain() and must call as_completion_destroy() on each completion.
+ *
+ * Must be called before async commands are issued on the event loop, or from the event
+ * loop thread.  Pass a NULL ring to post pending completions and return to per command
+ * listeners.  Pending completions that do not fit in the previous ring are destroyed.
+ *
+ * @param event_loop	Event loop.
+ * @param ring			Ring initialized with as_completion_ring_init().
+ *
+ * @ingroup async_events
+ */
+AS_EXTERN void
+as_event_loop_set_completion_ring(as_event_loop* event_loop, as_completion_ring* ring);
+
+/**
+ * Initialize completion ring.  Capacity is rounded up to a power of two.
+ *
+ * @relates as_completion_ring
+ */
+AS_EXTERN bool
+as_completion_ring_init(as_completion_ring* ring, uint32_t capacity);
+
+/**
+ * Destroy completions remaining in ring and free ring slots.
+ *
+ * @relates as_completion_ring
+ */
+AS_EXTERN void
+as_completion_ring_destroy(as_completion_ring* ring);
+
+/**
+ * Move up to max completions from ring to out.  Only one thread may drain a ring.
+ * Return number of completions moved.
+ *
+ * @relates as_completion_ring
+ */
+AS_EXTERN uint32_t
+as_completion_ring_drain(as_completion_ring* ring, as_completion* out, uint32_t max);
+
+/**
+ * Release error, record and value held by completion.
+ *
+ * @relates as_completion
+ */
+AS_EXTERN void
+as_completion_destroy(as_completion* completion);
+
+/**
+ * @private
+ * Are completions on event loop delivered in batches.
+ */
+static inline bool
+as_completion_enabled(as_event_loop* event_loop)
+{
+	as_completion_queue* cq = event_loop->completions;
+	return cq && (cq->listener || cq->ring);
+}
+
+/**
+ * @private
+ * Are completions on event loop waiting for room in a full completion ring.
+ * May be called from any thread.
+ */
+static inline bool
+as_completion_backlog(as_event_loop* event_loop)
+{
+	as_completion_queue* cq = event_loop->completions;
+	return cq && as_load_uint8(&cq->backlog);
+}
+
+/**
+ * @private
+ * Queue completion for batch delivery.  Error is copied.  Ownership of record and val
+ * is transferred to the completion.
+ */
+void
+as_completion_add(
+	as_event_loop* event_loop, as_completion_type type, as_error* err, as_record* record,
+	as_val* val, void* udata
+	);
+
+/**
+ * @private
+ * Free completion state of event loop.
+ */
+void
+as_completion_queue_destroy(as_event_loop* event_loop);
+
+#ifdef __cplusplus
+} // end extern "C"
+#endif
@@ -288,6 +288,120 @@ typedef struct as_config_tls_s {
 
 } as_config_tls;
 
+/**
+ * Near cache config.  The near cache keeps recently read records in process
+ * memory, so repeated reads of hot keys avoid a full server round trip.
+ *
+ * @ingroup as_config_object
+ */
+typedef struct as_config_near_cache_s {
+
+	/**
+	 * Maximum memory in bytes used by cached records summed over all shards.
+	 * Zero disables the near cache.
+	 * Default: 0
+	 */
+	uint64_t max_memory;
+
+	/**
+	 * Number of independently locked cache shards.  Rounded up to a power of two.
+	 * Default: 16
+	 */
+	uint32_t n_shards;
+
+	/**
+	 * Cached records younger than this many milliseconds are returned without
+	 * contacting the server.  Older records are revalidated with a header only
+	 * read that returns the record generation.  Zero revalidates on every read.
+	 * Default: 1000
+	 */
+	uint32_t revalidate_ms;
+
+} as_config_near_cache;
+
+/**
+ * Node circuit breaker config.  A node whose connection error and timeout rate
+ * exceeds error_pct is removed from command routing for open_ms, after which a
+ * single probe command tests whether the node has recovered.
+ *
+ * @ingroup as_config_object
+ */
+typedef struct as_config_breaker_s {
+
+	/**
+	 * Percentage of a node's commands within one cluster tend interval that must fail
+	 * with a connection error or timeout to open the node's circuit breaker.
+	 * Zero disables circuit breakers.
+	 * Default: 0
+	 */
+	uint32_t error_pct;
+
+	/**
+	 * Minimum number of commands sent to a node within one cluster tend interval
+	 * before its error rate is evaluated.
+	 * Default: 20
+	 */
+	uint32_t min_commands;
+
+	/**
+	 * Milliseconds an open circuit breaker rejects commands before a probe command
+	 * is allowed through.  Also the time allowed for a probe to complete before
+	 * another probe is sent.
+	 * Default: 1000
+	 */
+	uint32_t open_ms;
+
+} as_config_breaker;
+
+/**
+ * Adaptive timeout and retry budget config.  Adaptive socket timeouts follow each
+ * node's recently observed latency instead of waiting for the full policy socket
+ * timeout.  The retry budget limits retries to a fraction of successful commands,
+ * so retries do not multiply load when the cluster is struggling.
+ *
+ * @ingroup as_config_object
+ */
+typedef struct as_config_adaptive_s {
+
+	/**
+	 * Latency percentile (1-100) of a node's synchronous single record commands within
+	 * one cluster tend interval used to derive that node's socket timeout.  Only applies
+	 * to single record commands whose policy sets a socket timeout, and is never larger
+	 * than the policy socket timeout or total timeout.
+	 * Zero disables adaptive socket timeouts.
+	 * Default: 0
+	 */
+	uint32_t timeout_percentile;
+
+	/**
+	 * Adaptive socket timeout is the latency percentile multiplied by this factor.
+	 * Default: 3
+	 */
+	uint32_t timeout_multiplier;
+
+	/**
+	 * Minimum adaptive socket timeout in microseconds.
+	 * Default: 10000
+	 */
+	uint32_t min_timeout_us;
+
+	/**
+	 * Number of retries allowed per 100 commands that received a server response.
+	 * Retries that would exceed the budget are not attempted and the last error is
+	 * returned.  Zero disables the retry budget.
+	 * Default: 0
+	 */
+	uint32_t retry_budget_pct;
+
+	/**
+	 * Maximum number of retries that can be saved up in the retry budget.  The budget
+	 * starts full.
+	 * Default: 100
+	 */
+	uint32_t retry_budget_max;
+
+} as_config_adaptive;
+
 /**
  * The `as_config` contains the settings for the `aerospike` client. Including
  * default policies, seed hosts in the cluster and other settings.
@@ -441,6 +555,19 @@ typedef struct as_config_s {
 	 * Default: 300
 	 */
 	uint32_t max_conns_per_node;
+
+	/**
+	 * Minimum number of synchronous connections kept open per server node.  The cluster tend
+	 * thread opens connections in the background until each node's pools reach this count, so
+	 * the first transactions after startup or after a node joins do not pay the cost of a
+	 * connection handshake.  At most 8 connections are opened per node on each tend, so large
+	 * minimums are reached over several tends.  Pooled connections that would exceed
+	 * max_socket_idle before the next tend are closed and replaced.  Values greater than
+	 * max_conns_per_node are reduced to max_conns_per_node.
+	 *
+	 * Default: 0 (connections are only created on demand)
+	 */
+	uint32_t min_conns_per_node;
 	
 	/**
 	 * Maximum number of asynchronous (non-pipeline) connections allowed for each node.
@@ -452,6 +579,18 @@ typedef struct as_config_s {
 	 */
 	uint32_t async_max_conns_per_node;
 
+	/**
+	 * Minimum number of asynchronous (non-pipeline) connections kept open for each node.
+	 * This count is distributed evenly over the event loops that have been created or
+	 * registered.  The cluster tend thread asks each event loop to open connections until its
+	 * node pool reaches its share.  Values greater than async_max_conns_per_node are reduced to
+	 * async_max_conns_per_node.  This variable is ignored if asynchronous event loops are
+	 * not created.
+	 *
+	 * Default: 0 (connections are only created on demand)
+	 */
+	uint32_t async_min_conns_per_node;
+
 	/**
 	 * Maximum number of pipeline connections allowed for each node.
 	 * This limit will be enforced at the node/event loop level.  If the value is 100 and 2 event
@@ -544,6 +683,26 @@ typedef struct as_config_s {
 	 * TLS configuration parameters.
 	 */
 	as_config_tls tls;
+
+	/**
+	 * Near cache configuration parameters.  When enabled, synchronous
+	 * aerospike_key_get(), aerospike_key_select() and aerospike_batch_get() reads
+	 * are served from the near cache when possible.  Writes through this client
+	 * invalidate cached records.
+	 */
+	as_config_near_cache near_cache;
+
+	/**
+	 * Node circuit breaker configuration parameters.  While a node's breaker is open,
+	 * reads are routed to other replicas and commands that can only use that node,
+	 * such as writes, fail immediately instead of waiting for a socket timeout.
+	 */
+	as_config_breaker breaker;
+
+	/**
+	 * Adaptive socket timeout and retry budget configuration parameters.
+	 */
+	as_config_adaptive adaptive;
 	
 	/**
 	 * Action to perform if client fails to connect to seed hosts.
@@ -562,6 +721,27 @@ typedef struct as_config_s {
 	 */
 	bool use_services_alternate;
 
+	/**
+	 * Track server rack data.  This is useful when directing read commands to the
+	 * server node that contains the key and exists on the same rack as the client.
+	 * This serves to lower cloud provider costs when nodes are distributed across
+	 * different racks or availability zones.
+	 *
+	 * This field is used in combination with rack_id and a read policy replica of
+	 * AS_POLICY_REPLICA_PREFER_RACK.  Tracking racks adds one info request per node
+	 * whenever the server's rebalance generation changes.
+	 *
+	 * Default: false
+	 */
+	bool rack_aware;
+
+	/**
+	 * Rack where this client instance resides.  Only used when rack_aware is true.
+	 *
+	 * Default: 0
+	 */
+	int rack_id;
+
 	/**
 	 * Indicates if shared memory should be used for cluster tending.  Shared memory
 	 * is useful when operating in single threaded mode with multiple client processes.
@@ -598,6 +778,15 @@ typedef struct as_config_s {
 	 * Default: 8
 	 */
 	uint32_t shm_max_namespaces;
+
+	/**
+	 * Shared memory maximum number of client processes that publish node statistics.  This
+	 * value is used to size the fixed shared memory segment.  Processes attached beyond this
+	 * limit still share the cluster map, but their connections and commands are not included
+	 * in host-wide node statistics.
+	 * Default: 128
+	 */
+	uint32_t shm_max_processes;
 	
 	/**
 	 * Take over shared memory cluster tending if the cluster hasn't been tended by this
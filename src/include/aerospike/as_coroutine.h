@@ -0,0 +1,894 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#pragma once
+
+/**
+ * @defgroup coroutine_bindings C++20 Coroutine Bindings
+ *
+ * Header only C++20 bindings that expose the async API as awaitables.  This
+ * header is ignored when not compiled as C++20 or later.
+ *
+ * Each awaitable lives in the awaiting coroutine's frame and is passed to the
+ * async API as udata, so awaiting a command does not allocate.  The coroutine is
+ * resumed on the event loop thread that completed the command, so code following
+ * co_await runs on that event loop.  Coroutines that issue commands on a specific
+ * event loop should pass that loop, otherwise the client selects one.
+ *
+ * Awaitables rely on the per-command listener, so commands must not be issued on
+ * event loops that deliver completions through as_event_loop_set_completion_listener().
+ *
+ * ~~~~~~~~~~{.cpp}
+ * task handle(aerospike* as, as_key* key)
+ * {
+ *     auto res = co_await aerospike_coro::get(as, key);
+ *
+ *     if (! res.ok()) {
+ *         fprintf(stderr, "error(%d) %s\n", res.code, res.message.c_str());
+ *         co_return;
+ *     }
+ *     int64_t count = as_record_get_int64(res.value.get(), "count", 0);
+ *
+ *     auto stream = aerospike_coro::scan(as, &scan);
+ *
+ *     while (as_record* rec = co_await stream.next()) {
+ *         // Process record.
+ *     }
+ * }
+ * ~~~~~~~~~~
+ */
+
+#if defined(__cplusplus) && __cplusplus >= 202002L
+
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_batch.h>
+#include <aerospike/aerospike_key.h>
+#include <aerospike/aerospike_query.h>
+#include <aerospike/aerospike_scan.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_event.h>
+#include <aerospike/as_record.h>
+#include <citrusleaf/alloc.h>
+
+#include <coroutine>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace aerospike_coro {
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * Record owned by C++ code.  Listener records are only valid for the duration
+ * of the listener callback, so their bins and key are moved into this wrapper
+ * before the awaiting coroutine is resumed.  Moving transfers bin values without
+ * copying them.
+ *
+ * @ingroup coroutine_bindings
+ */
+class record {
+public:
+	record() noexcept
+	{
+		as_record_init(&rec_, 0);
+	}
+
+	/**
+	 * Take bins and key from C record.  The C record is left empty.
+	 */
+	explicit record(as_record* src)
+	{
+		as_record_init(&rec_, 0);
+		take(src);
+	}
+
+	record(record&& other) noexcept
+	{
+		as_record_init(&rec_, 0);
+		take(&other.rec_);
+	}
+
+	record&
+	operator=(record&& other) noexcept
+	{
+		if (this != &other) {
+			clear();
+			take(&other.rec_);
+		}
+		return *this;
+	}
+
+	record(const record&) = delete;
+	record& operator=(const record&) = delete;
+
+	~record()
+	{
+		as_record_destroy(&rec_);
+	}
+
+	/**
+	 * Replace contents with bins and key from C record.  The C record is left empty.
+	 * Bin storage is reused when large enough, so assigning a stream of records to
+	 * the same wrapper does not allocate.
+	 */
+	void
+	assign(as_record* src)
+	{
+		clear();
+		take(src);
+	}
+
+	/**
+	 * Destroy bin values and key, but keep bin storage.
+	 */
+	void
+	clear() noexcept
+	{
+		for (uint16_t i = 0; i < rec_.bins.size; i++) {
+			as_val_destroy((as_val*)rec_.bins.entries[i].valuep);
+			rec_.bins.entries[i].valuep = NULL;
+		}
+		rec_.bins.size = 0;
+
+		as_val_destroy((as_val*)rec_.key.valuep);
+		rec_.key.valuep = NULL;
+		rec_.key.digest.init = false;
+		rec_.gen = 0;
+		rec_.ttl = 0;
+	}
+
+	as_record* get() noexcept { return &rec_; }
+	const as_record* get() const noexcept { return &rec_; }
+	as_record* operator->() noexcept { return &rec_; }
+	const as_record* operator->() const noexcept { return &rec_; }
+
+private:
+	void
+	take(as_record* src) noexcept
+	{
+		rec_.gen = src->gen;
+		rec_.ttl = src->ttl;
+
+		// Key value may point into the source key.
+		bool key_free = rec_.key._free;
+		rec_.key = src->key;
+		rec_.key._free = key_free;
+
+		if (src->key.valuep == &src->key.value) {
+			rec_.key.valuep = &rec_.key.value;
+		}
+		src->key.valuep = NULL;
+
+		uint16_t n = src->bins.size;
+
+		if (src->bins._free) {
+			// Heap bins: steal the array.  Bin values that point into the array stay valid.
+			if (rec_.bins._free) {
+				cf_free(rec_.bins.entries);
+			}
+			rec_.bins = src->bins;
+			src->bins.entries = NULL;
+			src->bins.capacity = 0;
+			src->bins.size = 0;
+			src->bins._free = false;
+			return;
+		}
+
+		// Stack bins: copy entries into owned storage.
+		if (rec_.bins.capacity < n) {
+			if (rec_.bins._free) {
+				cf_free(rec_.bins.entries);
+			}
+			rec_.bins.entries = (as_bin*)cf_malloc(sizeof(as_bin) * n);
+			rec_.bins.capacity = n;
+			rec_.bins._free = true;
+		}
+
+		as_bin* from = src->bins.entries;
+		as_bin* to = rec_.bins.entries;
+
+		for (uint16_t i = 0; i < n; i++) {
+			std::memcpy(to[i].name, from[i].name, sizeof(as_bin_name));
+
+			if (from[i].valuep == &from[i].value) {
+				to[i].value = from[i].value;
+				to[i].valuep = &to[i].value;
+			}
+			else {
+				to[i].valuep = from[i].valuep;
+			}
+		}
+		rec_.bins.size = n;
+		src->bins.size = 0;
+	}
+
+	as_record rec_;
+};
+
+/**
+ * Value owned by C++ code.  Destroys the value when the wrapper is destroyed.
+ *
+ * @ingroup coroutine_bindings
+ */
+class value {
+public:
+	value() noexcept : val_(NULL) {}
+	explicit value(as_val* val) noexcept : val_(val) {}
+	value(value&& other) noexcept : val_(std::exchange(other.val_, (as_val*)NULL)) {}
+
+	value&
+	operator=(value&& other) noexcept
+	{
+		if (this != &other) {
+			as_val_destroy(val_);
+			val_ = std::exchange(other.val_, (as_val*)NULL);
+		}
+		return *this;
+	}
+
+	value(const value&) = delete;
+	value& operator=(const value&) = delete;
+
+	~value()
+	{
+		as_val_destroy(val_);
+	}
+
+	as_val* get() const noexcept { return val_; }
+	as_val* release() noexcept { return std::exchange(val_, (as_val*)NULL); }
+
+private:
+	as_val* val_;
+};
+
+/**
+ * Command status returned by co_await.  The message is only populated on error.
+ *
+ * @ingroup coroutine_bindings
+ */
+struct status {
+	as_status code = AEROSPIKE_OK;
+	std::string message;
+
+	bool ok() const noexcept { return code == AEROSPIKE_OK; }
+};
+
+/**
+ * Command status and result returned by co_await.
+ *
+ * @ingroup coroutine_bindings
+ */
+template <class T>
+struct result : status {
+	T value;
+};
+
+namespace detail {
+
+/**
+ * @private
+ * State shared by all single command awaitables.
+ */
+class awaitable_base {
+public:
+	bool await_ready() const noexcept { return false; }
+
+protected:
+	/**
+	 * @private
+	 * Issue command.  Return true if coroutine should stay suspended until the listener
+	 * is called.  Members must not be accessed after the command has been issued,
+	 * because the listener may already be running on an event loop thread.
+	 */
+	template <class Issue, class Listener>
+	bool
+	suspend(std::coroutine_handle<> handle, Issue& issue, Listener listener, void* udata)
+	{
+		handle_ = handle;
+
+		as_error err;
+		as_status status = issue(&err, listener, udata);
+
+		if (status != AEROSPIKE_OK) {
+			set_error(&err);
+			return false;
+		}
+		return true;
+	}
+
+	void
+	set_error(const as_error* err)
+	{
+		code_ = err->code;
+		message_ = err->message;
+	}
+
+	void
+	complete(as_error* err)
+	{
+		if (err) {
+			set_error(err);
+		}
+		handle_.resume();
+	}
+
+	void
+	fill(status& s)
+	{
+		s.code = code_;
+		s.message = std::move(message_);
+	}
+
+	std::coroutine_handle<> handle_;
+	as_status code_ = AEROSPIKE_OK;
+	std::string message_;
+};
+
+} // namespace detail
+
+/**
+ * Awaitable for commands that complete with a record.
+ *
+ * @ingroup coroutine_bindings
+ */
+template <class Issue>
+class record_awaitable : detail::awaitable_base {
+public:
+	explicit record_awaitable(Issue issue) : issue_(std::move(issue)) {}
+
+	using detail::awaitable_base::await_ready;
+
+	bool
+	await_suspend(std::coroutine_handle<> handle)
+	{
+		return suspend(handle, issue_, listener, this);
+	}
+
+	result<record>
+	await_resume()
+	{
+		result<record> r;
+		fill(r);
+		r.value = std::move(rec_);
+		return r;
+	}
+
+	/**
+	 * @private
+	 */
+	static void
+	listener(as_error* err, as_record* rec, void* udata, as_event_loop* event_loop)
+	{
+		record_awaitable* self = static_cast<record_awaitable*>(udata);
+
+		if (! err && rec) {
+			self->rec_.assign(rec);
+		}
+		self->complete(err);
+	}
+
+private:
+	Issue issue_;
+	record rec_;
+};
+
+/**
+ * Awaitable for commands that complete without a result.
+ *
+ * @ingroup coroutine_bindings
+ */
+template <class Issue>
+class write_awaitable : detail::awaitable_base {
+public:
+	explicit write_awaitable(Issue issue) : issue_(std::move(issue)) {}
+
+	using detail::awaitable_base::await_ready;
+
+	bool
+	await_suspend(std::coroutine_handle<> handle)
+	{
+		return suspend(handle, issue_, listener, this);
+	}
+
+	status
+	await_resume()
+	{
+		status s;
+		fill(s);
+		return s;
+	}
+
+	/**
+	 * @private
+	 */
+	static void
+	listener(as_error* err, void* udata, as_event_loop* event_loop)
+	{
+		static_cast<write_awaitable*>(udata)->complete(err);
+	}
+
+private:
+	Issue issue_;
+};
+
+/**
+ * Awaitable for commands that complete with a value.
+ *
+ * @ingroup coroutine_bindings
+ */
+template <class Issue>
+class value_awaitable : detail::awaitable_base {
+public:
+	explicit value_awaitable(Issue issue) : issue_(std::move(issue)) {}
+
+	using detail::awaitable_base::await_ready;
+
+	bool
+	await_suspend(std::coroutine_handle<> handle)
+	{
+		return suspend(handle, issue_, listener, this);
+	}
+
+	result<value>
+	await_resume()
+	{
+		result<value> r;
+		fill(r);
+		r.value = std::move(val_);
+		return r;
+	}
+
+	/**
+	 * @private
+	 */
+	static void
+	listener(as_error* err, as_val* val, void* udata, as_event_loop* event_loop)
+	{
+		value_awaitable* self = static_cast<value_awaitable*>(udata);
+
+		if (! err && val) {
+			// Value is destroyed after listener returns.
+			as_val_reserve(val);
+			self->val_ = value(val);
+		}
+		self->complete(err);
+	}
+
+private:
+	Issue issue_;
+	value val_;
+};
+
+/**
+ * Awaitable for batch reads.  Results are stored in the caller's as_batch_read_records,
+ * which remain owned by the caller.
+ *
+ * @ingroup coroutine_bindings
+ */
+template <class Issue>
+class batch_awaitable : detail::awaitable_base {
+public:
+	explicit batch_awaitable(Issue issue) : issue_(std::move(issue)) {}
+
+	using detail::awaitable_base::await_ready;
+
+	bool
+	await_suspend(std::coroutine_handle<> handle)
+	{
+		return suspend(handle, issue_, listener, this);
+	}
+
+	status
+	await_resume()
+	{
+		status s;
+		fill(s);
+		return s;
+	}
+
+	/**
+	 * @private
+	 */
+	static void
+	listener(as_error* err, as_batch_read_records* records, void* udata, as_event_loop* event_loop)
+	{
+		static_cast<batch_awaitable*>(udata)->complete(err);
+	}
+
+private:
+	Issue issue_;
+};
+
+/**
+ * Async generator over scan or query records.  Call co_await next() until it returns
+ * NULL, then check status().  The returned record is owned by the stream and is
+ * valid until the next call to next().
+ *
+ * The command is issued on the first call to next().  Records that arrive while
+ * the consumer is not waiting, for example while it awaits another command, are
+ * queued in the stream.  If the stream is destroyed before the end of the results,
+ * remaining records are discarded as they arrive.  Node commands of one scan or query
+ * may run on different event loops, so stream state is guarded by a mutex and the
+ * consumer is resumed on whichever event loop delivered the record it waits for.
+ *
+ * @ingroup coroutine_bindings
+ */
+template <class Issue>
+class record_stream {
+	/**
+	 * @private
+	 * State shared with the listener.  Allocated once per stream, because the listener
+	 * may outlive the stream when the consumer stops early.
+	 */
+	struct state {
+		explicit state(Issue&& issue) : issue(std::move(issue)) {}
+
+		Issue issue;
+		std::mutex lock;
+		std::coroutine_handle<> waiter;
+		std::deque<record> pending;
+		record current;
+		status result;
+		bool started = false;
+		bool ready = false;
+		bool done = false;
+		bool abandoned = false;
+	};
+
+public:
+	class next_awaitable {
+	public:
+		explicit next_awaitable(state* s) noexcept : s_(s) {}
+
+		bool
+		await_ready() const noexcept
+		{
+			std::lock_guard<std::mutex> guard(s_->lock);
+			return s_->ready || ! s_->pending.empty() || s_->done;
+		}
+
+		bool
+		await_suspend(std::coroutine_handle<> handle)
+		{
+			state* s = s_;
+			{
+				std::lock_guard<std::mutex> guard(s->lock);
+
+				if (s->ready || ! s->pending.empty() || s->done) {
+					// Record or completion arrived after await_ready().
+					return false;
+				}
+				s->waiter = handle;
+
+				if (s->started) {
+					return true;
+				}
+				s->started = true;
+			}
+
+			// Lock is not held while issuing, because the listener may be called from
+			// this thread when the command fails before it is queued.
+			as_error err;
+			as_status status = s->issue(&err, listener, s);
+
+			if (status != AEROSPIKE_OK) {
+				std::lock_guard<std::mutex> guard(s->lock);
+				s->waiter = nullptr;
+				s->result.code = err.code;
+				s->result.message = err.message;
+				s->done = true;
+				return false;
+			}
+			// State must not be accessed here, because the listener may already have
+			// resumed the coroutine on an event loop thread.
+			return true;
+		}
+
+		as_record*
+		await_resume()
+		{
+			state* s = s_;
+			std::lock_guard<std::mutex> guard(s->lock);
+
+			if (s->ready) {
+				s->ready = false;
+				return s->current.get();
+			}
+
+			if (! s->pending.empty()) {
+				s->current = std::move(s->pending.front());
+				s->pending.pop_front();
+				return s->current.get();
+			}
+			return NULL;
+		}
+
+	private:
+		state* s_;
+	};
+
+	explicit record_stream(Issue issue) : s_(new state(std::move(issue))) {}
+
+	record_stream(record_stream&& other) noexcept : s_(std::exchange(other.s_, nullptr)) {}
+
+	record_stream(const record_stream&) = delete;
+	record_stream& operator=(const record_stream&) = delete;
+	record_stream& operator=(record_stream&&) = delete;
+
+	~record_stream()
+	{
+		if (! s_) {
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(s_->lock);
+
+			if (s_->started && ! s_->done) {
+				// Listener frees state when the command completes.
+				s_->abandoned = true;
+				s_->pending.clear();
+				s_->current.clear();
+				return;
+			}
+		}
+		delete s_;
+	}
+
+	/**
+	 * Return awaitable that yields the next record, or NULL when all records have
+	 * been received or an error occurred.
+	 */
+	next_awaitable
+	next() noexcept
+	{
+		return next_awaitable(s_);
+	}
+
+	/**
+	 * Status of the command.  Only final after next() has returned NULL.
+	 */
+	const status&
+	result() const noexcept
+	{
+		return s_->result;
+	}
+
+	/**
+	 * @private
+	 */
+	static bool
+	listener(as_error* err, as_record* rec, void* udata, as_event_loop* event_loop)
+	{
+		state* s = static_cast<state*>(udata);
+		std::unique_lock<std::mutex> guard(s->lock);
+
+		if (err || ! rec) {
+			if (s->abandoned) {
+				guard.unlock();
+				delete s;
+				return false;
+			}
+
+			if (err) {
+				s->result.code = err->code;
+				s->result.message = err->message;
+			}
+			s->done = true;
+
+			// Consumer may free state as soon as the lock is released.
+			std::coroutine_handle<> waiter = std::exchange(s->waiter, nullptr);
+			guard.unlock();
+
+			if (waiter) {
+				waiter.resume();
+			}
+			return false;
+		}
+
+		if (s->abandoned) {
+			// Returning false would stop notifications while commands on other nodes
+			// can still call this listener, so drain records until completion instead.
+			return true;
+		}
+
+		if (s->waiter) {
+			s->current.assign(rec);
+			s->ready = true;
+
+			std::coroutine_handle<> waiter = std::exchange(s->waiter, nullptr);
+			guard.unlock();
+			waiter.resume();
+		}
+		else {
+			s->pending.emplace_back(rec);
+		}
+		// State may have been marked abandoned by the resumed consumer, but is not freed
+		// until the final callback, so continue receiving records.
+		return true;
+	}
+
+private:
+	state* s_;
+};
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * Read all bins of a record.
+ *
+ * @ingroup coroutine_bindings
+ */
+inline auto
+get(aerospike* as, const as_key* key, const as_policy_read* policy = NULL,
+	as_event_loop* event_loop = NULL)
+{
+	auto issue = [=](as_error* err, auto listener, void* udata) {
+		return aerospike_key_get_async(as, err, policy, key, listener, udata, event_loop, NULL);
+	};
+	return record_awaitable<decltype(issue)>(issue);
+}
+
+/**
+ * Read selected bins of a record.  The bins array must remain valid until the
+ * awaitable is resumed.
+ *
+ * @ingroup coroutine_bindings
+ */
+inline auto
+select(aerospike* as, const as_key* key, const char* bins[], const as_policy_read* policy = NULL,
+	as_event_loop* event_loop = NULL)
+{
+	auto issue = [=](as_error* err, auto listener, void* udata) {
+		return aerospike_key_select_async(as, err, policy, key, bins, listener, udata, event_loop, NULL);
+	};
+	return record_awaitable<decltype(issue)>(issue);
+}
+
+/**
+ * Read record metadata.  The result record has no bins.
+ *
+ * @ingroup coroutine_bindings
+ */
+inline auto
+exists(aerospike* as, const as_key* key, const as_policy_read* policy = NULL,
+	as_event_loop* event_loop = NULL)
+{
+	auto issue = [=](as_error* err, auto listener, void* udata) {
+		return aerospike_key_exists_async(as, err, policy, key, listener, udata, event_loop, NULL);
+	};
+	return record_awaitable<decltype(issue)>(issue);
+}
+
+/**
+ * Write record.  The record is serialized when the command is issued.
+ *
+ * @ingroup coroutine_bindings
+ */
+inline auto
+put(aerospike* as, const as_key* key, as_record* rec, const as_policy_write* policy = NULL,
+	as_event_loop* event_loop = NULL)
+{
+	auto issue = [=](as_error* err, auto listener, void* udata) {
+		return aerospike_key_put_async(as, err, policy, key, rec, listener, udata, event_loop, NULL);
+	};
+	return write_awaitable<decltype(issue)>(issue);
+}
+
+/**
+ * Remove record.
+ *
+ * @ingroup coroutine_bindings
+ */
+inline auto
+remove(aerospike* as, const as_key* key, const as_policy_remove* policy = NULL,
+	as_event_loop* event_loop = NULL)
+{
+	auto issue = [=](as_error* err, auto listener, void* udata) {
+		return aerospike_key_remove_async(as, err, policy, key, listener, udata, event_loop, NULL);
+	};
+	return write_awaitable<decltype(issue)>(issue);
+}
+
+/**
+ * Perform operations on a record.  Operations are serialized when the command is issued.
+ *
+ * @ingroup coroutine_bindings
+ */
+inline auto
+operate(aerospike* as, const as_key* key, const as_operations* ops,
+	const as_policy_operate* policy = NULL, as_event_loop* event_loop = NULL)
+{
+	auto issue = [=](as_error* err, auto listener, void* udata) {
+		return aerospike_key_operate_async(as, err, policy, key, ops, listener, udata, event_loop, NULL);
+	};
+	return record_awaitable<decltype(issue)>(issue);
+}
+
+/**
+ * Apply user defined function on a record.
+ *
+ * @ingroup coroutine_bindings
+ */
+inline auto
+apply(aerospike* as, const as_key* key, const char* module, const char* function,
+	as_list* arglist, const as_policy_apply* policy = NULL, as_event_loop* event_loop = NULL)
+{
+	auto issue = [=](as_error* err, auto listener, void* udata) {
+		return aerospike_key_apply_async(as, err, policy, key, module, function, arglist,
+			listener, udata, event_loop, NULL);
+	};
+	return value_awaitable<decltype(issue)>(issue);
+}
+
+/**
+ * Read multiple records.  Results are stored in records, which must remain valid
+ * until the awaitable is resumed and must be destroyed by the caller.
+ *
+ * @ingroup coroutine_bindings
+ */
+inline auto
+batch_read(aerospike* as, as_batch_read_records* records, const as_policy_batch* policy = NULL,
+	as_event_loop* event_loop = NULL)
+{
+	auto issue = [=](as_error* err, auto listener, void* udata) {
+		return aerospike_batch_read_async(as, err, policy, records, listener, udata, event_loop);
+	};
+	return batch_awaitable<decltype(issue)>(issue);
+}
+
+/**
+ * Stream scan records.  The scan must remain valid until the first call to next()
+ * has been resumed.
+ *
+ * @ingroup coroutine_bindings
+ */
+inline auto
+scan(aerospike* as, const as_scan* scan, const as_policy_scan* policy = NULL,
+	as_event_loop* event_loop = NULL)
+{
+	auto issue = [=](as_error* err, auto listener, void* udata) {
+		return aerospike_scan_async(as, err, policy, scan, NULL, listener, udata, event_loop);
+	};
+	return record_stream<decltype(issue)>(issue);
+}
+
+/**
+ * Stream query records.  The query must remain valid until the first call to next()
+ * has been resumed.
+ *
+ * @ingroup coroutine_bindings
+ */
+inline auto
+query(aerospike* as, const as_query* query, const as_policy_query* policy = NULL,
+	as_event_loop* event_loop = NULL)
+{
+	auto issue = [=](as_error* err, auto listener, void* udata) {
+		return aerospike_query_async(as, err, policy, query, listener, udata, event_loop);
+	};
+	return record_stream<decltype(issue)>(issue);
+}
+
+} // namespace aerospike_coro
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#pragma once
+
+#include <aerospike/as_atomic.h>
+#include <aerospike/as_std.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * @private
+ * Per thread epoch reader slot.  Each slot is padded to and allocated on its own cache
+ * line so entering and leaving a read section only touches memory owned by the calling
+ * thread.
+ */
+typedef struct as_epoch_slot_s {
+	/**
+	 * @private
+	 * Global epoch observed on entering outermost read section.  Zero when thread
+	 * is not in a read section.
+	 */
+	uint64_t epoch;
+
+	/**
+	 * @private
+	 * Read section nesting depth.  Only accessed by owning thread.
+	 */
+	uint32_t depth;
+
+	/**
+	 * @private
+	 * Is slot owned by a thread.
+	 */
+	uint32_t in_use;
+
+	/**
+	 * @private
+	 * Next slot in global slot list.
+	 */
+	struct as_epoch_slot_s* next;
+
+	/**
+	 * @private
+	 * Pad to cache line size.
+	 */
+	char pad[40];
+} as_epoch_slot;
+
+/******************************************************************************
+ * GLOBAL VARIABLES
+ *****************************************************************************/
+
+/**
+ * @private
+ * Current global epoch.  Starts at one because zero indicates an inactive slot.
+ */
+extern uint64_t as_epoch_global;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @private
+ * Return calling thread's epoch slot.  Slot is allocated on first use and
+ * recycled when the thread exits.
+ */
+as_epoch_slot*
+as_epoch_slot_get(void);
+
+/**
+ * @private
+ * Advance global epoch.  Called once per cluster tend, so data removed from shared
+ * structures during a tend shares one epoch instead of advancing it for each item.
+ */
+void
+as_epoch_advance(void);
+
+/**
+ * @private
+ * Return oldest epoch observed by threads currently in a read section, or UINT64_MAX
+ * if no thread is in a read section.  Data retired with an epoch less than this value
+ * is no longer referenced by request threads and can be released.
+ */
+uint64_t
+as_epoch_oldest(void);
+
+/**
+ * @private
+ * Return epoch to be assigned to data removed from shared structures.  Data is
+ * released once all read sections entered before the next as_epoch_advance() are done.
+ */
+static inline uint64_t
+as_epoch_current(void)
+{
+	return as_load_uint64(&as_epoch_global);
+}
+
+/**
+ * @private
+ * Enter read section.  Nodes and partition tables read from cluster in this section
+ * are not released until as_epoch_exit() is called, so request threads do not need
+ * to reserve them.  Read sections may be nested.
+ */
+static inline as_epoch_slot*
+as_epoch_enter(void)
+{
+	as_epoch_slot* slot = as_epoch_slot_get();
+
+	if (slot->depth++ == 0) {
+		as_store_uint64(&slot->epoch, as_load_uint64(&as_epoch_global));
+		// Slot epoch must be visible before any shared pointers are read.
+		as_fence_memory();
+	}
+	return slot;
+}
+
+/**
+ * @private
+ * Exit read section started by as_epoch_enter().
+ */
+static inline void
+as_epoch_exit(as_epoch_slot* slot)
+{
+	if (--slot->depth == 0) {
+		as_fence_release();
+		as_store_uint64(&slot->epoch, 0);
+	}
+}
+
+#ifdef __cplusplus
+} // end extern "C"
+#endif
@@ -70,11 +70,23 @@ typedef struct as_event_loop {
 	pthread_mutex_t lock;
 	as_queue queue;
 	as_queue pipe_cb_queue;
+	// Batch completion state.  NULL when listeners are called per command.
+	struct as_completion_queue_s* completions;
+	// Loop to steal queued commands from.  Only valid while steal_pending is set.
+	struct as_event_loop* steal_victim;
+	// Buffer that responses are read into before being copied to their commands.
+	// Allocated on first read.
+	uint8_t* read_buf;
+	// Pipelined connection whose responses are being parsed from read_buf.
+	// Cleared if the connection is canceled while parsing.
+	void* read_conn;
 	pthread_t thread;
 	uint32_t index;
 	// Count of consecutive errors occurring before event loop registration.
 	// Used to prevent deep recursion.
 	uint32_t errors;
+	// Is a steal request queued to this loop.
+	uint32_t steal_pending;
 	bool pipe_cb_calling;
 } as_event_loop;
 
@@ -103,6 +115,35 @@ AS_EXTERN extern uint32_t as_event_loop_size;
 AS_EXTERN as_event_loop*
 as_event_create_loops(uint32_t capacity);
 
+/**
+ * Pin event loop threads created by as_event_create_loops() to CPUs.  Event loop i is
+ * pinned to cpus[i % n_cpus].  Must be called before as_event_create_loops().
+ *
+ * Memory first touched by a pinned event loop thread, like connections, response buffers
+ * and the loop thread's command buffer pool, is placed on that CPU's NUMA node by the
+ * operating system.  Choose CPUs on the NUMA node closest to the network interface
+ * when possible.
+ *
+ * ~~~~~~~~~~{.c}
+ * // Pin 4 event loops to the first 4 CPUs of the second socket.
+ * int cpus[] = {8, 9, 10, 11};
+ * as_event_set_loop_cpus(cpus, 4);
+ * as_event_create_loops(4);
+ * ~~~~~~~~~~
+ *
+ * The CPU list is released by as_event_close_loops(), so it must be set again before
+ * loops are recreated.
+ *
+ * @param cpus		CPU numbers.  Copied, so the array does not need to remain valid.
+ * @param n_cpus	Number of CPU numbers.  Pass zero to disable pinning.
+ * @return			False if CPU pinning is not supported on this platform or a CPU number
+ *					is invalid.
+ *
+ * @ingroup async_events
+ */
+AS_EXTERN bool
+as_event_set_loop_cpus(const int* cpus, uint32_t n_cpus);
+
 /**
  * Set the number of externally created event loops.  This method should be called when the 
  * calling program wants to share event loops with the client.  This reduces resource usage and
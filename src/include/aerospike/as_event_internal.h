@@ -53,13 +53,13 @@ extern "C" {
 #define AS_ASYNC_STATE_COMMAND_READ_BODY 8
 #define AS_ASYNC_STATE_COMPLETE 9
 
-#define AS_ASYNC_FLAGS_MASTER 1
 #define AS_ASYNC_FLAGS_READ 2
 #define AS_ASYNC_FLAGS_HAS_TIMER 4
 #define AS_ASYNC_FLAGS_USING_SOCKET_TIMER 8
 #define AS_ASYNC_FLAGS_EVENT_RECEIVED 16
 #define AS_ASYNC_FLAGS_FREE_BUF 32
 #define AS_ASYNC_FLAGS_CP_MODE 64
+#define AS_ASYNC_FLAGS_STEALABLE 128
 
 #define AS_ASYNC_AUTH_RETURN_CODE 1
 
@@ -68,6 +68,16 @@ extern "C" {
 #define AS_EVENT_CONNECTION_ERROR 2
 
 #define AS_EVENT_QUEUE_INITIAL_CAPACITY 256
+
+// Queued commands on a loop before an idle loop is asked to steal from it.
+#define AS_EVENT_STEAL_THRESHOLD 32
+
+// Maximum commands stolen per steal request.
+#define AS_EVENT_STEAL_MAX 64
+
+// Size of event loop buffer that responses are read into.  Large enough for the header
+// and body of typical responses, so both usually arrive in one read.
+#define AS_EVENT_READ_BUFFER_SIZE 16384
 	
 struct as_event_command;
 struct as_event_executor;
@@ -116,10 +126,11 @@ typedef struct as_event_command {
 	struct event timer;
 #else
 #endif
-	uint64_t total_deadline;
-	uint32_t socket_timeout;
+	uint64_t total_deadline;  // Microseconds
+	uint32_t socket_timeout;  // Microseconds
 	uint32_t max_retries;
 	uint32_t iteration;
+	uint32_t breaker_probe;  // Non-zero if command is its node's circuit breaker probe.
 	as_policy_replica replica;
 	as_event_loop* event_loop;
 	as_event_connection* conn;
@@ -141,7 +152,9 @@ typedef struct as_event_command {
 	uint8_t type;
 	uint8_t state;
 	uint8_t flags;
+	uint8_t replica_index;
 	bool deserialize;
+	bool in_flight;  // Counted in node's in flight commands.
 } as_event_command;
 
 typedef struct {
@@ -197,6 +210,9 @@ as_event_socket_error(as_event_command* cmd, as_error* err);
 void
 as_event_response_error(as_event_command* cmd, as_error* err);
 
+bool
+as_event_command_parse_buffer(as_event_command* cmd, uint8_t* buf, uint32_t size);
+
 bool
 as_event_command_parse_result(as_event_command* cmd);
 	
@@ -212,6 +228,41 @@ as_event_command_free(as_event_command* cmd);
 void
 as_event_close_cluster(as_cluster* cluster);
 
+void
+as_event_balance_connections(as_node* node);
+
+as_event_loop*
+as_event_loop_balance(as_cluster* cluster);
+
+/**
+ * @private
+ * Return less loaded of two distinct loops chosen from random value r.  Size must be
+ * at least two.
+ */
+as_event_loop*
+as_event_loop_select(as_cluster* cluster, as_event_loop* loops, uint32_t size, uint64_t r);
+
+/**
+ * @private
+ * Move up to AS_EVENT_STEAL_MAX stealable commands from the newer half of victim's
+ * queue to stolen.  Remaining entries keep their order.  Return number of commands moved.
+ */
+uint32_t
+as_event_steal_queued(as_event_loop* victim, as_event_loop* thief, as_event_commander* stolen);
+
+void
+as_event_command_execute_in_loop(as_event_command* cmd);
+
+/**
+ * @private
+ * Return cpu that event loop at index is pinned to, or -1 when loops are not pinned.
+ */
+int
+as_event_loop_cpu(uint32_t index);
+
+bool
+as_event_thread_create(as_event_loop* event_loop, void* (*worker)(void*), void* udata);
+
 /******************************************************************************
  * IMPLEMENTATION SPECIFIC FUNCTIONS
  *****************************************************************************/
@@ -273,10 +324,16 @@ as_event_set_conn_last_used(as_event_connection* conn, uint32_t max_socket_idle)
 	}
 }
 
+static inline bool
+as_event_connection_expiring(as_event_connection* conn, uint32_t now, uint32_t margin)
+{
+	return as_socket_expiring(&conn->socket, now, margin);
+}
+
 static inline void
 as_event_init_total_timer(as_event_command* cmd, uint64_t timeout)
 {
-	ev_timer_init(&cmd->timer, as_ev_total_timeout, (double)timeout / 1000.0, 0.0);
+	ev_timer_init(&cmd->timer, as_ev_total_timeout, (double)timeout / 1000000.0, 0.0);
 	cmd->timer.data = cmd;
 	ev_timer_start(cmd->event_loop->loop, &cmd->timer);
 }
@@ -284,6 +341,7 @@ as_event_init_total_timer(as_event_command* cmd, uint64_t timeout)
 static inline void
 as_event_set_total_timer(as_event_command* cmd, uint64_t timeout)
 {
+	ev_timer_init(&cmd->timer, as_ev_total_timeout, (double)timeout / 1000000.0, 0.0);
 	ev_timer_start(cmd->event_loop->loop, &cmd->timer);
 }
 
@@ -291,7 +349,7 @@ static inline void
 as_event_init_socket_timer(as_event_command* cmd)
 {
 	ev_init(&cmd->timer, as_ev_socket_timeout);
-	cmd->timer.repeat = ((double)cmd->socket_timeout) / 1000.0;
+	cmd->timer.repeat = ((double)cmd->socket_timeout) / 1000000.0;
 	cmd->timer.data = cmd;
 	ev_timer_again(cmd->event_loop->loop, &cmd->timer);
 }
@@ -299,7 +357,7 @@ as_event_init_socket_timer(as_event_command* cmd)
 static inline void
 as_event_repeat_socket_timer(as_event_command* cmd)
 {
-	cmd->timer.repeat = (double)cmd->socket_timeout/ 1000.0;
+	cmd->timer.repeat = (double)cmd->socket_timeout / 1000000.0;
 	ev_timer_again(cmd->event_loop->loop, &cmd->timer);
 }
 
@@ -347,26 +405,41 @@ as_event_set_conn_last_used(as_event_connection* conn, uint32_t max_socket_idle)
 {
 }
 
+static inline bool
+as_event_connection_expiring(as_event_connection* conn, uint32_t now, uint32_t margin)
+{
+	return false;
+}
+
+// libuv timers have millisecond resolution, so round microsecond timeouts up.
+static inline uint64_t
+as_uv_timeout_ms(uint64_t timeout_us)
+{
+	return (timeout_us + 999) / 1000;
+}
+
 static inline void
 as_event_init_total_timer(as_event_command* cmd, uint64_t timeout)
 {
 	uv_timer_init(cmd->event_loop->loop, &cmd->timer);
 	cmd->timer.data = cmd;
-	uv_timer_start(&cmd->timer, as_uv_total_timeout, timeout, 0);
+	uv_timer_start(&cmd->timer, as_uv_total_timeout, as_uv_timeout_ms(timeout), 0);
 }
 
 static inline void
 as_event_set_total_timer(as_event_command* cmd, uint64_t timeout)
 {
-	uv_timer_start(&cmd->timer, as_uv_total_timeout, timeout, 0);
+	uv_timer_start(&cmd->timer, as_uv_total_timeout, as_uv_timeout_ms(timeout), 0);
 }
 
 static inline void
 as_event_init_socket_timer(as_event_command* cmd)
 {
+	uint64_t timeout = as_uv_timeout_ms(cmd->socket_timeout);
+
 	uv_timer_init(cmd->event_loop->loop, &cmd->timer);
 	cmd->timer.data = cmd;
-	uv_timer_start(&cmd->timer, as_uv_socket_timeout, cmd->socket_timeout, cmd->socket_timeout);
+	uv_timer_start(&cmd->timer, as_uv_socket_timeout, timeout, timeout);
 }
 
 static inline void
@@ -434,14 +507,20 @@ as_event_set_conn_last_used(as_event_connection* conn, uint32_t max_socket_idle)
 	}
 }
 
+static inline bool
+as_event_connection_expiring(as_event_connection* conn, uint32_t now, uint32_t margin)
+{
+	return as_socket_expiring(&conn->socket, now, margin);
+}
+
 static inline void
 as_event_init_total_timer(as_event_command* cmd, uint64_t timeout)
 {
 	evtimer_assign(&cmd->timer, cmd->event_loop->loop, as_libevent_total_timeout, cmd);
 
 	struct timeval tv;
-	tv.tv_sec = (uint32_t)timeout / 1000;
-	tv.tv_usec = ((uint32_t)timeout % 1000) * 1000;
+	tv.tv_sec = (long)(timeout / 1000000);
+	tv.tv_usec = (long)(timeout % 1000000);
 
 	evtimer_add(&cmd->timer, &tv);
 }
@@ -450,8 +529,8 @@ static inline void
 as_event_set_total_timer(as_event_command* cmd, uint64_t timeout)
 {
 	struct timeval tv;
-	tv.tv_sec = (uint32_t)timeout / 1000;
-	tv.tv_usec = ((uint32_t)timeout % 1000) * 1000;
+	tv.tv_sec = (long)(timeout / 1000000);
+	tv.tv_usec = (long)(timeout % 1000000);
 
 	evtimer_add(&cmd->timer, &tv);
 }
@@ -462,8 +541,8 @@ as_event_init_socket_timer(as_event_command* cmd)
 	event_assign(&cmd->timer, cmd->event_loop->loop, -1, EV_PERSIST, as_libevent_socket_timeout, cmd);
 
 	struct timeval tv;
-	tv.tv_sec = cmd->socket_timeout / 1000;
-	tv.tv_usec = (cmd->socket_timeout % 1000) * 1000;
+	tv.tv_sec = cmd->socket_timeout / 1000000;
+	tv.tv_usec = cmd->socket_timeout % 1000000;
 
 	evtimer_add(&cmd->timer, &tv);
 }
@@ -509,6 +588,12 @@ as_event_set_conn_last_used(as_event_connection* conn, uint32_t max_socket_idle)
 {
 }
 
+static inline bool
+as_event_connection_expiring(as_event_connection* conn, uint32_t now, uint32_t margin)
+{
+	return false;
+}
+
 static inline void
 as_event_init_total_timer(as_event_command* cmd, uint64_t timeout)
 {
@@ -551,10 +636,18 @@ as_event_command_release(as_event_command* cmd)
  *****************************************************************************/
 
 static inline as_event_loop*
-as_event_assign(as_event_loop* event_loop)
+as_event_assign(as_cluster* cluster, as_event_loop* event_loop)
 {
-	// Assign event loop using round robin distribution if not specified.
-	return event_loop ? event_loop : as_event_loop_get();
+	// Assign least loaded of two random event loops if not specified.
+	return event_loop ? event_loop : as_event_loop_balance(cluster);
+}
+
+static inline uint8_t
+as_event_steal_flag(as_event_loop* event_loop, as_pipe_listener pipe_listener)
+{
+	// Commands not bound to an event loop by the caller may be moved to another
+	// loop before they start.  Pipelined commands must stay on their loop's connection.
+	return (! event_loop && ! pipe_listener) ? AS_ASYNC_FLAGS_STEALABLE : 0;
 }
 
 static inline void
@@ -587,6 +680,22 @@ as_event_set_auth_parse_header(as_event_command* cmd)
 	cmd->state = AS_ASYNC_STATE_AUTH_READ_BODY;
 }
 
+static inline uint8_t*
+as_event_get_read_buffer(as_event_loop* event_loop)
+{
+	if (! event_loop->read_buf) {
+		event_loop->read_buf = cf_malloc(AS_EVENT_READ_BUFFER_SIZE);
+	}
+	return event_loop->read_buf;
+}
+
+static inline bool
+as_event_read_buffered(as_event_command* cmd)
+{
+	// Read response through event loop buffer unless remaining body is too large.
+	return cmd->len - cmd->pos < AS_EVENT_READ_BUFFER_SIZE;
+}
+
 static inline void
 as_event_set_write(as_event_command* cmd)
 {
@@ -642,7 +751,16 @@ as_event_socket_retry(as_event_command* cmd)
 
 	as_event_stop_watcher(cmd, cmd->conn);
 	as_event_release_async_connection(cmd);
-	return as_event_command_retry(cmd, true);
+
+	// Record error only on retry.  Otherwise, as_event_socket_error() records it.
+	as_node* node = cmd->node;
+	uint32_t probe = cmd->breaker_probe;
+
+	if (as_event_command_retry(cmd, true)) {
+		as_node_breaker_result(node, AEROSPIKE_ERR_CONNECTION, probe);
+		return true;
+	}
+	return false;
 }
 
 #ifdef __cplusplus
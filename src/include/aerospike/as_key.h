@@ -228,6 +228,13 @@ typedef struct as_key_s {
 	 */
 	as_digest digest;
 
+	/**
+	 * @private
+	 * Optional resolved namespace handle used for routing.
+	 * Set with as_key_set_namespace_handle().
+	 */
+	const struct as_namespace_handle_s* nsh;
+
 } as_key;
 
 /******************************************************************************
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#pragma once
+
+#include <aerospike/aerospike.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_key.h>
+#include <aerospike/as_status.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * Namespace resolved to its partition table.  Keys that reference a handle are
+ * routed directly from digest to partition to node, without looking up the
+ * namespace by name on every command.
+ *
+ * Partition tables are never removed while the cluster exists, so a handle is
+ * valid until aerospike_close() is called on the client that resolved it.
+ *
+ * ~~~~~~~~~~{.c}
+ * as_namespace_handle nsh;
+ *
+ * if (aerospike_namespace_resolve(&as, &err, "test", &nsh) != AEROSPIKE_OK) {
+ *     fprintf(stderr, "error(%d) %s at [%s:%d]", err.code, err.message, err.file, err.line);
+ * }
+ *
+ * as_key key;
+ * as_key_init_int64(&key, "test", "demo", 1);
+ * as_key_set_namespace_handle(&key, &nsh);
+ * ~~~~~~~~~~
+ *
+ * @ingroup client_objects
+ */
+typedef struct as_namespace_handle_s {
+	/**
+	 * @private
+	 * Cluster that owns the partition table.
+	 */
+	struct as_cluster_s* cluster;
+
+	/**
+	 * @private
+	 * Partition table.  as_partition_table_shm when shm is true, otherwise as_partition_table.
+	 */
+	void* table;
+
+	/**
+	 * @private
+	 * Number of partitions in table.
+	 */
+	uint32_t n_partitions;
+
+	/**
+	 * @private
+	 * Is namespace in strong consistency mode.
+	 */
+	bool cp_mode;
+
+	/**
+	 * @private
+	 * Is partition table in shared memory.
+	 */
+	bool shm;
+
+	/**
+	 * Namespace name.
+	 */
+	as_namespace ns;
+} as_namespace_handle;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * Resolve namespace into a handle that can be attached to keys with
+ * as_key_set_namespace_handle().  The client must be connected and the
+ * namespace must exist on the server.
+ *
+ * @param as		The aerospike instance to use for this operation.
+ * @param err		The as_error to be populated if an error occurs.
+ * @param ns		The namespace name.
+ * @param handle	The handle to populate.
+ *
+ * @return AEROSPIKE_OK on success. Otherwise an error occurred.
+ *
+ * @ingroup client_objects
+ */
+AS_EXTERN as_status
+aerospike_namespace_resolve(aerospike* as, as_error* err, const char* ns, as_namespace_handle* handle);
+
+/**
+ * Route commands for key using a resolved namespace handle.  The handle must
+ * refer to the key's namespace and must remain valid while the key is used.
+ *
+ * @relates as_key
+ */
+static inline void
+as_key_set_namespace_handle(as_key* key, const as_namespace_handle* handle)
+{
+	key->nsh = handle;
+}
+
+#ifdef __cplusplus
+} // end extern "C"
+#endif
@@ -0,0 +1,327 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#pragma once
+
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_command.h>
+#include <aerospike/as_config.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_key.h>
+#include <aerospike/as_policy.h>
+#include <aerospike/as_record.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+/**
+ * @private
+ * Number of invalidation version slots per shard.
+ */
+#define AS_NEAR_CACHE_VERSIONS 256
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * Near cache statistics summed over all shards.
+ */
+typedef struct as_near_cache_stats_s {
+	/**
+	 * Reads served from cache without contacting the server.
+	 */
+	uint64_t hits;
+
+	/**
+	 * Reads served from cache after a header only read confirmed the cached generation.
+	 */
+	uint64_t revalidations;
+
+	/**
+	 * Reads that required a full record read from the server.
+	 */
+	uint64_t misses;
+
+	/**
+	 * Records evicted to stay under the memory limit.
+	 */
+	uint64_t evictions;
+
+	/**
+	 * Records removed because of writes through this client or expiration.
+	 */
+	uint64_t invalidations;
+
+	/**
+	 * Records currently cached.
+	 */
+	uint64_t entries;
+
+	/**
+	 * Bytes currently used by cached records.
+	 */
+	uint64_t memory;
+} as_near_cache_stats;
+
+/**
+ * @private
+ * Cached record.  Bins are stored in server wire format and parsed on each hit,
+ * so every caller receives its own record.
+ */
+typedef struct as_near_cache_entry_s {
+	/**
+	 * @private
+	 * Next entry in hash bucket.
+	 */
+	struct as_near_cache_entry_s* next;
+
+	/**
+	 * @private
+	 * Previous entry in clock ring.
+	 */
+	struct as_near_cache_entry_s* clock_prev;
+
+	/**
+	 * @private
+	 * Next entry in clock ring.
+	 */
+	struct as_near_cache_entry_s* clock_next;
+
+	/**
+	 * @private
+	 * Time record generation was last confirmed by the server.
+	 */
+	uint64_t validated_ms;
+
+	/**
+	 * @private
+	 * Time record expires.  Zero if record never expires.
+	 */
+	uint64_t expire_ms;
+
+	/**
+	 * @private
+	 * Record generation.
+	 */
+	uint32_t gen;
+
+	/**
+	 * @private
+	 * Size of bins in bytes.
+	 */
+	uint32_t size;
+
+	/**
+	 * @private
+	 * Number of bins.
+	 */
+	uint16_t n_bins;
+
+	/**
+	 * @private
+	 * Was entry read since clock hand last passed.
+	 */
+	uint8_t referenced;
+
+	/**
+	 * @private
+	 * Key digest.
+	 */
+	uint8_t digest[AS_DIGEST_VALUE_SIZE];
+
+	/**
+	 * @private
+	 * Key namespace.
+	 */
+	as_namespace ns;
+
+	/**
+	 * @private
+	 * Bins in server wire format.
+	 */
+	uint8_t data[];
+} as_near_cache_entry;
+
+/**
+ * @private
+ * Independently locked part of near cache.
+ */
+typedef struct as_near_cache_shard_s {
+	/**
+	 * @private
+	 * Lock for all shard fields.
+	 */
+	pthread_mutex_t lock;
+
+	/**
+	 * @private
+	 * Hash buckets.  Count is a power of two.
+	 */
+	as_near_cache_entry** buckets;
+
+	/**
+	 * @private
+	 * Clock hand.  Next eviction candidate.
+	 */
+	as_near_cache_entry* hand;
+
+	/**
+	 * @private
+	 * Bytes used by entries.
+	 */
+	uint64_t memory;
+
+	/**
+	 * @private
+	 * Maximum bytes used by entries.
+	 */
+	uint64_t max_memory;
+
+	/**
+	 * @private
+	 * Statistics.
+	 */
+	uint64_t hits;
+	uint64_t revalidations;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t invalidations;
+
+	/**
+	 * @private
+	 * Number of entries.
+	 */
+	uint32_t n_entries;
+
+	/**
+	 * @private
+	 * Number of hash buckets.
+	 */
+	uint32_t n_buckets;
+
+	/**
+	 * @private
+	 * Invalidation versions indexed by key digest.  A record read from the server is
+	 * only cached if its version slot did not change during the read.
+	 */
+	uint32_t versions[AS_NEAR_CACHE_VERSIONS];
+} as_near_cache_shard;
+
+/**
+ * @private
+ * Client side record cache keyed by namespace and digest.
+ */
+typedef struct as_near_cache_s {
+	/**
+	 * @private
+	 * Cache shards.
+	 */
+	as_near_cache_shard* shards;
+
+	/**
+	 * @private
+	 * Number of shards minus one.
+	 */
+	uint32_t shard_mask;
+
+	/**
+	 * @private
+	 * Maximum age of entries returned without revalidation.
+	 */
+	uint32_t revalidate_ms;
+} as_near_cache;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @private
+ * Create near cache.
+ */
+as_near_cache*
+as_near_cache_create(const as_config_near_cache* config);
+
+/**
+ * @private
+ * Destroy near cache and all cached records.
+ */
+void
+as_near_cache_destroy(as_near_cache* cache);
+
+/**
+ * @private
+ * Remove cached record.  Reads of the key that are in progress will not cache their result.
+ * Key digest must be set.
+ */
+void
+as_near_cache_invalidate(as_near_cache* cache, const as_key* key);
+
+/**
+ * @private
+ * Read record through cache.  If bins is not NULL, only the given NULL terminated bin
+ * names are returned.  Cache misses read the full record, so later reads of other
+ * bins can also be served from cache.
+ */
+as_status
+as_near_cache_read(
+	as_cluster* cluster, as_error* err, const as_policy_read* policy, const as_key* key,
+	const char* bins[], as_record** rec
+	);
+
+/**
+ * @private
+ * Populate record from cache if cached record does not need revalidation.
+ * Otherwise, return false and set version for a later as_near_cache_put().
+ */
+bool
+as_near_cache_get_fresh(as_near_cache* cache, const as_key* key, bool deserialize, as_record* rec, uint32_t* version);
+
+/**
+ * @private
+ * Cache record bins read from the server if key was not invalidated since version was taken.
+ */
+void
+as_near_cache_put(as_near_cache* cache, const as_key* key, uint32_t version, as_msg* msg, uint8_t* bins, uint32_t size);
+
+/**
+ * Get near cache statistics.  Return false if near cache is not enabled.
+ */
+AS_EXTERN bool
+as_near_cache_get_stats(as_cluster* cluster, as_near_cache_stats* stats);
+
+/**
+ * @private
+ * Invalidate key if near cache is enabled.
+ */
+static inline void
+as_near_cache_invalidate_key(as_cluster* cluster, const as_key* key)
+{
+	if (cluster->near_cache) {
+		as_near_cache_invalidate(cluster->near_cache, key);
+	}
+}
+
+#ifdef __cplusplus
+} // end extern "C"
+#endif
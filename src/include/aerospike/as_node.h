@@ -61,6 +61,27 @@ extern "C" {
 #define AS_ADDRESS4_MAX 4
 #define AS_ADDRESS6_MAX 8
 
+/**
+ * Node rack is not known.
+ */
+#define AS_RACK_UNKNOWN -1
+
+/**
+ * @private
+ * Node circuit breaker states.
+ */
+#define AS_BREAKER_CLOSED 0
+#define AS_BREAKER_OPEN 1
+#define AS_BREAKER_HALF_OPEN 2
+
+/**
+ * @private
+ * Number of power of two latency buckets used for adaptive socket timeouts.
+ * Bucket i counts latencies less than 2^i microseconds.  The last bucket also
+ * counts all larger latencies.
+ */
+#define AS_LATENCY_BUCKETS 25
+
 /******************************************************************************
  * TYPES
  *****************************************************************************/
@@ -124,6 +145,12 @@ typedef struct as_conn_pool_s {
 	 */
 	uint32_t limit;
 
+	/**
+	 * @private
+	 * Peak number of connections taken out of the pool since the pool was last trimmed.
+	 */
+	uint32_t peak;
+
 } as_conn_pool;
 
 /**
@@ -168,6 +195,12 @@ typedef struct as_node_s {
 	 * TLS certificate name (needed for TLS only, NULL otherwise).
 	 */
 	char* tls_name;
+
+	/**
+	 * @private
+	 * Cached TLS session used to resume new connections (needed for TLS only).
+	 */
+	as_tls_session tls_session;
 	
 	/**
 	 * The name of the node.
@@ -225,6 +258,12 @@ typedef struct as_node_s {
 	 */
 	as_conn_pool* pipe_conn_pools;
 
+	/**
+	 * @private
+	 * Last partition bitmaps received from node.  Only accessed by cluster tend thread.
+	 */
+	as_vector /* <as_partition_bitmap> */ partition_bitmaps;
+
 	/**
 	 * @private
 	 * Socket used exclusively for cluster tend thread info requests.
@@ -249,6 +288,20 @@ typedef struct as_node_s {
 	 */
 	uint32_t peers_generation;
 
+	/**
+	 * @private
+	 * Server's generation count for partition rebalancing.  Only tracked when cluster
+	 * is rack aware.
+	 */
+	uint32_t rebalance_generation;
+
+	/**
+	 * @private
+	 * Rack where node resides.  AS_RACK_UNKNOWN if racks are not tracked, not yet
+	 * received or differ between namespaces on this node.
+	 */
+	int rack_id;
+
 	/**
 	 * @private
 	 * Number of peers returned by server node.
@@ -272,6 +325,91 @@ typedef struct as_node_s {
 	 * Shared memory node array index.
 	 */
 	uint32_t index;
+
+	/**
+	 * @private
+	 * Sum of command latencies in microseconds since last shared memory stats publish.
+	 * Only tracked in shared memory mode.
+	 */
+	uint64_t latency_sum;
+
+	/**
+	 * @private
+	 * Number of commands included in latency_sum.
+	 */
+	uint32_t latency_count;
+
+	/**
+	 * @private
+	 * Commands in progress on node.  Only tracked in shared memory mode.
+	 */
+	uint32_t in_flight;
+
+	/**
+	 * Number of idle synchronous connections closed by cluster tend because pools were
+	 * larger than recent peak usage.
+	 */
+	uint64_t sync_conns_trimmed;
+
+	/**
+	 * Number of idle async (non-pipeline) connections closed because pools were larger
+	 * than recent peak usage.
+	 */
+	uint64_t async_conns_trimmed;
+
+	/**
+	 * Number of idle pipeline connections closed because pools were larger than recent
+	 * peak usage.
+	 */
+	uint64_t pipe_conns_trimmed;
+
+	/**
+	 * Number of times the node's circuit breaker opened.
+	 */
+	uint64_t breaker_trips;
+
+	/**
+	 * @private
+	 * Time after which an open circuit breaker allows a probe command.
+	 */
+	uint64_t breaker_retry_ms;
+
+	/**
+	 * @private
+	 * Commands completed since last cluster tend.
+	 */
+	uint32_t breaker_commands;
+
+	/**
+	 * @private
+	 * Commands that failed with a connection error or timeout since last cluster tend.
+	 */
+	uint32_t breaker_errors;
+
+	/**
+	 * @private
+	 * Id of the last probe command.  Only the command that claimed this id can close or
+	 * reopen a half open circuit breaker.
+	 */
+	uint32_t breaker_probe;
+
+	/**
+	 * @private
+	 * Circuit breaker state.
+	 */
+	uint8_t breaker_state;
+
+	/**
+	 * Current adaptive socket timeout in microseconds.  Zero if adaptive timeouts are
+	 * disabled or no latency has been measured yet.
+	 */
+	uint32_t adaptive_timeout_us;
+
+	/**
+	 * @private
+	 * Synchronous command latency histogram since last cluster tend.
+	 */
+	uint32_t latency_buckets[AS_LATENCY_BUCKETS];
 	
 	/**
 	 * @private
@@ -284,6 +422,12 @@ typedef struct as_node_s {
 	 * Did partition change in current cluster tend.
 	 */
 	bool partition_changed;
+
+	/**
+	 * @private
+	 * Did rebalance generation change in current cluster tend.
+	 */
+	bool rebalance_changed;
 	
 } as_node;
 
@@ -326,6 +470,7 @@ as_conn_pool_init(as_conn_pool* pool, uint32_t size, uint32_t limit)
 {
 	pool->limit = limit;
 	pool->total = 0;
+	pool->peak = 0;
 
 	as_queue_init(&pool->queue, size, limit);
 }
@@ -340,6 +485,20 @@ as_conn_pool_destroy(as_conn_pool* pool)
 	as_queue_destroy(&pool->queue);
 }
 
+/**
+ * @private
+ * Record number of connections currently taken out of the pool.
+ */
+static inline void
+as_conn_pool_update_peak(as_conn_pool* pool)
+{
+	uint32_t in_use = pool->total - as_queue_size(&pool->queue);
+
+	if (in_use > pool->peak) {
+		pool->peak = in_use;
+	}
+}
+
 /**
  *  @private
  *  Reduce the total count of connections associated with this pool.
@@ -362,9 +521,22 @@ as_conn_pool_inc(as_conn_pool* pool)
 	}
 
 	pool->total++;
+	as_conn_pool_update_peak(pool);
 	return true;
 }
 
+/**
+ * @private
+ * Return number of connections assigned to pool at index when count is distributed
+ * over n_pools, taking remainder into account.
+ */
+static inline uint32_t
+as_conn_pool_share(uint32_t count, uint32_t n_pools, uint32_t index)
+{
+	uint32_t share = count / n_pools;
+	return (index < count - (share * n_pools))? share + 1 : share;
+}
+
 /**
  *  @private
  * Get a connection from the pool.
@@ -372,7 +544,31 @@ as_conn_pool_inc(as_conn_pool* pool)
 static inline bool
 as_conn_pool_get(as_conn_pool* pool, void* conn)
 {
-	return as_queue_pop(&pool->queue, conn);
+	if (! as_queue_pop(&pool->queue, conn)) {
+		return false;
+	}
+	as_conn_pool_update_peak(pool);
+	return true;
+}
+
+/**
+ * @private
+ * Start a new peak usage period and return number of idle connections to close, so the
+ * pool shrinks toward the larger of min and peak usage since the last trim.  Only half of
+ * the excess is returned, so pools shrink gradually after a traffic spike.
+ */
+static inline uint32_t
+as_conn_pool_trim_count(as_conn_pool* pool, uint32_t min)
+{
+	uint32_t idle = as_queue_size(&pool->queue);
+	uint32_t target = (pool->peak > min)? pool->peak : min;
+	uint32_t excess = (pool->total > target)? pool->total - target : 0;
+
+	if (excess > idle) {
+		excess = idle;
+	}
+	pool->peak = (pool->total > idle)? pool->total - idle : 0;
+	return (excess + 1) / 2;
 }
 
 /**
@@ -441,6 +637,69 @@ as_node_release(as_node* node)
 	}
 }
 
+/**
+ * @private
+ * Count command as in progress on node for shared memory node stats.
+ */
+static inline void
+as_node_begin_command(as_node* node)
+{
+	as_incr_uint32(&node->in_flight);
+}
+
+/**
+ * @private
+ * Remove command counted by as_node_begin_command().
+ */
+static inline void
+as_node_end_command(as_node* node)
+{
+	as_decr_uint32(&node->in_flight);
+}
+
+/**
+ * @private
+ * Record command latency for shared memory node stats.
+ */
+static inline void
+as_node_add_latency(as_node* node, uint64_t latency_us)
+{
+	as_faa_uint64(&node->latency_sum, latency_us);
+	as_incr_uint32(&node->latency_count);
+}
+
+/**
+ * @private
+ * Record command latency for adaptive socket timeouts.
+ */
+static inline void
+as_node_add_latency_bucket(as_node* node, uint64_t latency_us)
+{
+	uint32_t index = 0;
+
+	while (latency_us > 0 && index < AS_LATENCY_BUCKETS - 1) {
+		latency_us >>= 1;
+		index++;
+	}
+	as_incr_uint32(&node->latency_buckets[index]);
+}
+
+/**
+ * @private
+ * Return socket timeout in microseconds to use for node.  The adaptive socket timeout
+ * is used when the policy sets a socket timeout and the adaptive timeout is less than it.
+ */
+static inline uint32_t
+as_node_socket_timeout(as_node* node, uint32_t socket_timeout_us)
+{
+	uint32_t timeout = as_load_uint32(&node->adaptive_timeout_us);
+
+	if (timeout == 0 || socket_timeout_us == 0 || socket_timeout_us <= timeout) {
+		return socket_timeout_us;
+	}
+	return timeout;
+}
+
 /**
  * @private
  * Add socket address to node addresses.
@@ -487,6 +746,40 @@ as_node_authenticate_connection(struct as_cluster_s* cluster, const char* user,
 as_status
 as_node_get_connection(as_error* err, as_node* node, uint32_t socket_timeout, uint64_t deadline_ms, as_socket* sock);
 
+/**
+ * @private
+ * Trim idle pooled connections toward recent peak usage, close pooled connections that
+ * would exceed maximum idle time before the next cluster tend and open new connections
+ * until node pools contain their share of min_conns_per_node and async_min_conns_per_node.
+ * Called by cluster tend thread.
+ */
+void
+as_node_balance_connections(as_node* node);
+
+/**
+ * @private
+ * Open node's circuit breaker if its error rate since the last cluster tend exceeds the
+ * configured percentage.  Called by cluster tend thread.
+ */
+void
+as_node_tend_breaker(as_node* node);
+
+/**
+ * @private
+ * Derive node's adaptive socket timeout from command latencies since the last cluster
+ * tend.  Called by cluster tend thread.
+ */
+void
+as_node_tend_latency(as_node* node);
+
+/**
+ * @private
+ * Parse rack-ids info response, which is modified in place.  Return node's rack if all
+ * namespaces report the same rack, otherwise AS_RACK_UNKNOWN.
+ */
+int
+as_node_parse_racks(as_node* node, char* p);
+
 /**
  * @private
  * Close a node's connection and do not put back into pool.
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <aerospike/as_std.h>
+#include <aerospike/as_vector.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,6 +32,12 @@ extern "C" {
  */
 #define AS_MAX_NAMESPACE_SIZE 32
 
+/**
+ * Maximum number of replicas stored per partition.  Master is replica zero.  Replicas
+ * beyond this count are not used by the client.
+ */
+#define AS_MAX_REPLICAS 3
+
 /******************************************************************************
  * TYPES
  *****************************************************************************/
@@ -43,16 +50,9 @@ struct as_node_s;
 typedef struct as_partition_s {
 	/**
 	 * @private
-	 * Master node for this partition.
-	 */
-	struct as_node_s* master;
-	
-	/**
-	 * @private
-	 * Prole node for this partition.
-	 * TODO - not ideal for replication factor > 2.
+	 * Nodes for this partition in replica order.  Master is first.
 	 */
-	struct as_node_s* prole;
+	struct as_node_s* nodes[AS_MAX_REPLICAS];
 
 	/**
 	 * @private
@@ -92,6 +92,43 @@ typedef struct as_partition_table_s {
 	as_partition partitions[];
 } as_partition_table;
 
+/**
+ * @private
+ * Last partition bitmap received from a node for one namespace and replica level.
+ * Only accessed by cluster tend thread.
+ */
+typedef struct as_partition_bitmap_s {
+	/**
+	 * @private
+	 * Namespace.
+	 */
+	char ns[AS_MAX_NAMESPACE_SIZE];
+
+	/**
+	 * @private
+	 * Replica level.  Zero is master.
+	 */
+	uint32_t replica;
+
+	/**
+	 * @private
+	 * Length of base64 encoded bitmap.
+	 */
+	uint32_t encoded_len;
+
+	/**
+	 * @private
+	 * Base64 encoded bitmap as received from node.
+	 */
+	char* encoded;
+
+	/**
+	 * @private
+	 * Decoded bitmap.  Partition ownership bits are stored most significant bit first.
+	 */
+	uint8_t* bitmap;
+} as_partition_bitmap;
+
 /**
  * @private
  * Reference counted array of partition table pointers.
@@ -148,6 +185,48 @@ as_partition_tables_get(as_partition_tables* tables, const char* ns);
 bool
 as_partition_tables_find_node(as_partition_tables* tables, struct as_node_s* node);
 	
+/**
+ * @private
+ * Decode base64 partition bitmap received from node for namespace and replica level.
+ * Only 4 character groups that differ from the node's previous bitmap are decoded.
+ *
+ * On return, visit contains partitions owned by node in either the previous or the new
+ * bitmap, or all partitions if there is no previous bitmap.  Partitions not in visit do
+ * not reference node and do not need to be updated.  visit must have room for
+ * cf_b64_decoded_buf_size(len) bytes.
+ *
+ * Return new decoded bitmap, which remains valid until the next call for the same node.
+ */
+const uint8_t*
+as_partition_bitmap_update(
+	struct as_node_s* node, const char* ns, uint32_t replica, const char* bitmap_b64, uint32_t len,
+	uint8_t* visit
+	);
+
+/**
+ * @private
+ * Return first partition ID greater than or equal to id that is set in bitmap, or max if none.
+ */
+uint32_t
+as_partition_bitmap_next(const uint8_t* bitmap, uint32_t id, uint32_t max);
+
+/**
+ * @private
+ * Is partition ID set in bitmap.
+ */
+static inline bool
+as_partition_bitmap_get(const uint8_t* bitmap, uint32_t id)
+{
+	return (bitmap[id >> 3] & (0x80 >> (id & 7))) != 0;
+}
+
+/**
+ * @private
+ * Release node's previous partition bitmaps.
+ */
+void
+as_partition_bitmaps_destroy(as_vector* bitmaps);
+
 /**
  * @private
  * Return partition ID given digest.
@@ -79,6 +79,9 @@ as_pipe_write_start(as_event_command* cmd);
 extern void
 as_pipe_read_start(as_event_command* cmd);
 
+extern uint32_t
+as_pipe_trim_connections(as_conn_pool* pool, uint32_t count);
+
 static inline as_event_command*
 as_pipe_link_to_command(cf_ll_element* link)
 {
@@ -267,17 +267,26 @@ typedef enum as_policy_replica_e {
 	AS_POLICY_REPLICA_MASTER,
 
 	/**
-	 * Distribute reads across nodes containing key's master and replicated partition
-	 * in round-robin fashion.  Currently restricted to master and one prole.
+	 * Distribute reads across nodes containing key's master and replicated partitions
+	 * in round-robin fashion.
 	 */
 	AS_POLICY_REPLICA_ANY,
 
 	/**
 	 * Always try node containing master partition first. If connection fails and
-	 * `retry_on_timeout` is true, try node containing prole partition.
-	 * Currently restricted to master and one prole.
+	 * `retry_on_timeout` is true, try nodes containing prole partitions in order.
 	 */
-	AS_POLICY_REPLICA_SEQUENCE
+	AS_POLICY_REPLICA_SEQUENCE,
+
+	/**
+	 * Try node on the same rack as the client first.  If there are no nodes on the
+	 * same rack, use AS_POLICY_REPLICA_SEQUENCE instead.  Retries move to the next
+	 * replica on the same rack before falling back to other racks.
+	 *
+	 * as_config.rack_aware and as_config.rack_id must be set for this policy to take
+	 * effect.  This policy is only intended for reads.
+	 */
+	AS_POLICY_REPLICA_PREFER_RACK
 	
 } as_policy_replica;
 
@@ -364,6 +373,23 @@ typedef struct as_policy_base_s {
 	 */
 	uint32_t total_timeout;
 
+	/**
+	 * Socket idle timeout in microseconds.  If not zero, overrides socket_timeout,
+	 * so socket timeouts below one millisecond can be used.
+	 *
+	 * Default: 0 (use socket_timeout).
+	 */
+	uint32_t socket_timeout_us;
+
+	/**
+	 * Total transaction timeout in microseconds.  If not zero, overrides total_timeout,
+	 * so total timeouts below one millisecond can be used.  The server receives this
+	 * timeout rounded up to milliseconds.
+	 *
+	 * Default: 0 (use total_timeout).
+	 */
+	uint32_t total_timeout_us;
+
 	/**
 	 * Maximum number of retries before aborting the current transaction.
 	 * The initial attempt is not counted as a retry.
@@ -443,6 +469,16 @@ typedef struct as_policy_read_s {
 	 */
 	bool linearize_read;
 
+	/**
+	 * Share one server request among concurrent synchronous reads of the same key, bins,
+	 * replica, consistency level and linearize setting.  Callers that join a read in
+	 * progress receive their own copy of its record, or its error, and wait at most their
+	 * own total timeout.  A read never joins a read that started before a synchronous
+	 * write of the same key through this client completed.
+	 * Default: false
+	 */
+	bool coalesce;
+
 } as_policy_read;
 	
 /**
@@ -790,6 +826,20 @@ typedef struct as_policy_query_s {
 	 */
 	bool deserialize;
 
+	/**
+	 * Run the aggregation stream function in each node's query thread once that node's
+	 * results have been received, then combine the per-node partial results with one final pass
+	 * of the same stream function.  This spreads client-side lua work across the
+	 * query thread pool instead of funneling every node's results through one thread.
+	 *
+	 * Only valid when the client-side part of the stream function is a reduce (or
+	 * aggregate) whose combining function is associative, because the function is
+	 * applied once per node and again over the partial results.  Enable
+	 * as_config_lua.cache_enabled so lua states are reused across nodes and queries.
+	 * Default: false
+	 */
+	bool parallel_aggregate;
+
 } as_policy_query;
 
 /**
@@ -923,6 +973,45 @@ typedef struct as_policies_s {
  * FUNCTIONS
  *****************************************************************************/
 
+/**
+ * @private
+ * Return socket timeout in microseconds.
+ */
+static inline uint32_t
+as_policy_socket_timeout_us(const as_policy_base* p)
+{
+	if (p->socket_timeout_us > 0) {
+		return p->socket_timeout_us;
+	}
+	return (p->socket_timeout > UINT32_MAX / 1000)? UINT32_MAX : p->socket_timeout * 1000;
+}
+
+/**
+ * @private
+ * Return total timeout in microseconds.
+ */
+static inline uint64_t
+as_policy_total_timeout_us(const as_policy_base* p)
+{
+	if (p->total_timeout_us > 0) {
+		return p->total_timeout_us;
+	}
+	return (uint64_t)p->total_timeout * 1000;
+}
+
+/**
+ * @private
+ * Return total timeout in milliseconds sent to the server.
+ */
+static inline uint32_t
+as_policy_server_timeout(const as_policy_base* p)
+{
+	if (p->total_timeout_us > 0) {
+		return (p->total_timeout_us + 999) / 1000;
+	}
+	return p->total_timeout;
+}
+
 /**
  * Initialize as_policy_read to default values.
  *
@@ -938,11 +1027,14 @@ as_policy_read_init(as_policy_read* p)
 	p->base.total_timeout = AS_POLICY_TOTAL_TIMEOUT_DEFAULT;
 	p->base.max_retries = 2;
 	p->base.sleep_between_retries = 0;
+	p->base.socket_timeout_us = 0;
+	p->base.total_timeout_us = 0;
 	p->key = AS_POLICY_KEY_DEFAULT;
 	p->replica = AS_POLICY_REPLICA_DEFAULT;
 	p->consistency_level = AS_POLICY_CONSISTENCY_LEVEL_DEFAULT;
 	p->deserialize = true;
 	p->linearize_read = false;
+	p->coalesce = false;
 	return p;
 }
 
@@ -975,6 +1067,8 @@ as_policy_write_init(as_policy_write* p)
 	p->base.total_timeout = AS_POLICY_TOTAL_TIMEOUT_DEFAULT;
 	p->base.max_retries = 0;
 	p->base.sleep_between_retries = 0;
+	p->base.socket_timeout_us = 0;
+	p->base.total_timeout_us = 0;
 	p->key = AS_POLICY_KEY_DEFAULT;
 	p->replica = AS_POLICY_REPLICA_DEFAULT;
 	p->commit_level = AS_POLICY_COMMIT_LEVEL_DEFAULT;
@@ -1014,6 +1108,8 @@ as_policy_operate_init(as_policy_operate* p)
 	p->base.total_timeout = AS_POLICY_TOTAL_TIMEOUT_DEFAULT;
 	p->base.max_retries = 0;
 	p->base.sleep_between_retries = 0;
+	p->base.socket_timeout_us = 0;
+	p->base.total_timeout_us = 0;
 	p->key = AS_POLICY_KEY_DEFAULT;
 	p->replica = AS_POLICY_REPLICA_DEFAULT;
 	p->consistency_level = AS_POLICY_CONSISTENCY_LEVEL_DEFAULT;
@@ -1054,6 +1150,8 @@ as_policy_remove_init(as_policy_remove* p)
 	p->base.total_timeout = AS_POLICY_TOTAL_TIMEOUT_DEFAULT;
 	p->base.max_retries = 0;
 	p->base.sleep_between_retries = 0;
+	p->base.socket_timeout_us = 0;
+	p->base.total_timeout_us = 0;
 	p->key = AS_POLICY_KEY_DEFAULT;
 	p->replica = AS_POLICY_REPLICA_DEFAULT;
 	p->commit_level = AS_POLICY_COMMIT_LEVEL_DEFAULT;
@@ -1092,6 +1190,8 @@ as_policy_apply_init(as_policy_apply* p)
 	p->base.total_timeout = AS_POLICY_TOTAL_TIMEOUT_DEFAULT;
 	p->base.max_retries = 0;
 	p->base.sleep_between_retries = 0;
+	p->base.socket_timeout_us = 0;
+	p->base.total_timeout_us = 0;
 	p->key = AS_POLICY_KEY_DEFAULT;
 	p->replica = AS_POLICY_REPLICA_DEFAULT;
 	p->commit_level = AS_POLICY_COMMIT_LEVEL_DEFAULT;
@@ -1132,6 +1232,8 @@ as_policy_batch_init(as_policy_batch* p)
 	p->base.total_timeout = AS_POLICY_TOTAL_TIMEOUT_DEFAULT;
 	p->base.max_retries = 2;
 	p->base.sleep_between_retries = 0;
+	p->base.socket_timeout_us = 0;
+	p->base.total_timeout_us = 0;
 	p->consistency_level = AS_POLICY_CONSISTENCY_LEVEL_ONE;
 	p->concurrent = false;
 	p->use_batch_direct = false;
@@ -1171,6 +1273,8 @@ as_policy_scan_init(as_policy_scan* p)
 	p->base.total_timeout = 0;
 	p->base.max_retries = 0;
 	p->base.sleep_between_retries = 0;
+	p->base.socket_timeout_us = 0;
+	p->base.total_timeout_us = 0;
 	p->fail_on_cluster_change = false;
 	p->durable_delete = false;
 	return p;
@@ -1205,7 +1309,10 @@ as_policy_query_init(as_policy_query* p)
 	p->base.total_timeout = 0;
 	p->base.max_retries = 0;
 	p->base.sleep_between_retries = 0;
+	p->base.socket_timeout_us = 0;
+	p->base.total_timeout_us = 0;
 	p->deserialize = true;
+	p->parallel_aggregate = false;
 	return p;
 }
 
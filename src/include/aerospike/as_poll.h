@@ -55,7 +55,7 @@ typedef struct as_poll_s {
 	(_poll)->set = ((_poll)->size > AS_STACK_LIMIT)? cf_malloc((_poll)->size) : alloca((_poll)->size);
 
 static inline int
-as_poll_socket(as_poll* poll, as_socket_fd fd, uint32_t timeout, bool read)
+as_poll_socket(as_poll* poll, as_socket_fd fd, uint64_t timeout_us, bool read)
 {
 	// From glibc-2.15 (ubuntu 12.0.4+), the FD_* functions has a check on the
 	// number of fds passed. According to the man page of FD_SET, the behavior
@@ -70,9 +70,9 @@ as_poll_socket(as_poll* poll, as_socket_fd fd, uint32_t timeout, bool read)
 	struct timeval* tvp;
 	int rv;
 
-	if (timeout > 0) {
-		tv.tv_sec = timeout / 1000;
-		tv.tv_usec = (timeout % 1000) * 1000;
+	if (timeout_us > 0) {
+		tv.tv_sec = (long)(timeout_us / 1000000);
+		tv.tv_usec = (long)(timeout_us % 1000000);
 		tvp = &tv;
 	}
 	else {
@@ -106,7 +106,7 @@ as_poll_destroy(as_poll* poll)
 #define as_poll_init(_poll, _fd)
 
 static inline int
-as_poll_socket(as_poll* poll, as_socket_fd fd, uint32_t timeout, bool read)
+as_poll_socket(as_poll* poll, as_socket_fd fd, uint64_t timeout_us, bool read)
 {
 	FD_ZERO(&poll->set);
 	FD_SET(fd, &poll->set);
@@ -115,9 +115,9 @@ as_poll_socket(as_poll* poll, as_socket_fd fd, uint32_t timeout, bool read)
 	struct timeval* tvp;
 	int rv;
 
-	if (timeout > 0) {
-		tv.tv_sec = timeout / 1000;
-		tv.tv_usec = (timeout % 1000) * 1000;
+	if (timeout_us > 0) {
+		tv.tv_sec = (long)(timeout_us / 1000000);
+		tv.tv_usec = (long)(timeout_us % 1000000);
 		tvp = &tv;
 	}
 	else {
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#pragma once
+
+#include <aerospike/aerospike.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_key.h>
+#include <aerospike/as_operations.h>
+#include <aerospike/as_policy.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+#include <aerospike/as_val.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * @private
+ * Location of a patchable value in a prepared command.
+ */
+typedef struct as_prepared_value_s {
+	/**
+	 * @private
+	 * Offset of value bytes from start of command.
+	 */
+	uint32_t offset;
+
+	/**
+	 * @private
+	 * Serialized value size.
+	 */
+	uint32_t size;
+
+	/**
+	 * @private
+	 * Particle type (AS_BYTES_INTEGER, AS_BYTES_STRING ...).
+	 */
+	uint8_t type;
+} as_prepared_value;
+
+/**
+ * Put or operate command serialized once and executed many times.  The message header,
+ * namespace, set, bin names and operation layout are written when the command is
+ * prepared.  Each execution only copies the template and patches the digest, user key,
+ * bin values and ttl in place, so the command size is never recomputed.
+ *
+ * Since the layout is fixed, replacement values must serialize to the same size and
+ * particle type as the values the command was prepared with.  Integers and doubles
+ * can always be replaced.  Strings and blobs can be replaced by values of the same
+ * length.  The same rule applies to the user key when the key policy is
+ * AS_POLICY_KEY_SEND.  Executed keys must have the namespace and set the command was
+ * prepared with, and must have a user key if the prepared command sends one.
+ *
+ * A prepared command is read-only after it is created, so it can be executed
+ * concurrently by multiple threads.
+ *
+ * ~~~~~~~~~~{.c}
+ * as_operations ops;
+ * as_operations_inita(&ops, 2);
+ * as_operations_add_incr(&ops, "count", 0);
+ * as_operations_add_read(&ops, "count");
+ *
+ * as_prepared prep;
+ *
+ * if (aerospike_prepare_operate(&as, &err, NULL, &key, &ops, &prep) != AEROSPIKE_OK) {
+ *     fprintf(stderr, "error(%d) %s at [%s:%d]", err.code, err.message, err.file, err.line);
+ * }
+ * as_operations_destroy(&ops);
+ *
+ * for (int64_t i = 0; i < 1000; i++) {
+ *     as_key k;
+ *     as_key_init_int64(&k, "test", "demo", i);
+ *
+ *     as_integer incr;
+ *     as_integer_init(&incr, i);
+ *     as_val* values[] = {(as_val*)&incr, NULL};
+ *
+ *     as_record* rec = NULL;
+ *     aerospike_prepared_execute(&as, &err, &prep, &k, values, AS_RECORD_DEFAULT_TTL, &rec);
+ *     as_record_destroy(rec);
+ * }
+ * as_prepared_destroy(&prep);
+ * ~~~~~~~~~~
+ *
+ * @ingroup key_operations
+ */
+typedef struct as_prepared_s {
+	/**
+	 * @private
+	 * Serialized command template.
+	 */
+	uint8_t* buf;
+
+	/**
+	 * @private
+	 * Command size.
+	 */
+	size_t size;
+
+	/**
+	 * @private
+	 * Bin value locations in operation order.
+	 */
+	as_prepared_value* values;
+
+	/**
+	 * @private
+	 * User key location.  Size is zero when user key is not sent.
+	 */
+	as_prepared_value key;
+
+	/**
+	 * @private
+	 * Namespace written in template.  Executed keys must use the same namespace.
+	 */
+	as_namespace ns;
+
+	/**
+	 * @private
+	 * Set written in template.  Executed keys must use the same set.
+	 */
+	as_set set;
+
+	/**
+	 * @private
+	 * Digest offset from start of command.
+	 */
+	uint32_t digest_offset;
+
+	/**
+	 * @private
+	 * Compress commands larger than this size.  Zero disables compression.
+	 */
+	uint32_t compression_threshold;
+
+	/**
+	 * @private
+	 * Base policy copied from the policy the command was prepared with.
+	 */
+	as_policy_base base;
+
+	/**
+	 * @private
+	 * Replica policy used for read only commands.
+	 */
+	as_policy_replica replica;
+
+	/**
+	 * @private
+	 * Deserialize list and map bins in results.
+	 */
+	bool deserialize;
+
+	/**
+	 * @private
+	 * Does command write to the record.
+	 */
+	bool write;
+
+	/**
+	 * @private
+	 * Is command an operate command that returns a record.
+	 */
+	bool operate;
+
+	/**
+	 * Number of bin values that can be replaced in each execution.  This is the number
+	 * of bins for put and the number of operations for operate.
+	 */
+	uint32_t n_values;
+} as_prepared;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * Prepare put command for key's namespace and set with the bins of rec.
+ *
+ * @param as		The aerospike instance to use for this operation.
+ * @param err		The as_error to be populated if an error occurs.
+ * @param policy	The policy to use for this operation. If NULL, then the default policy will be used.
+ * @param key		Key that supplies namespace, set and the initial user key.
+ * @param rec		Record that supplies bin names, initial values and generation.
+ * @param prep		The prepared command to populate.
+ *
+ * @return AEROSPIKE_OK if successful. Otherwise an error.
+ *
+ * @relates as_prepared
+ */
+AS_EXTERN as_status
+aerospike_prepare_put(
+	aerospike* as, as_error* err, const as_policy_write* policy, const as_key* key, as_record* rec,
+	as_prepared* prep
+	);
+
+/**
+ * Prepare operate command for key's namespace and set with the given operations.
+ *
+ * @param as		The aerospike instance to use for this operation.
+ * @param err		The as_error to be populated if an error occurs.
+ * @param policy	The policy to use for this operation. If NULL, then the default policy will be used.
+ * @param key		Key that supplies namespace, set and the initial user key.
+ * @param ops		Operations that supply bin names, initial values, generation and ttl.
+ * @param prep		The prepared command to populate.
+ *
+ * @return AEROSPIKE_OK if successful. Otherwise an error.
+ *
+ * @relates as_prepared
+ */
+AS_EXTERN as_status
+aerospike_prepare_operate(
+	aerospike* as, as_error* err, const as_policy_operate* policy, const as_key* key,
+	const as_operations* ops, as_prepared* prep
+	);
+
+/**
+ * Execute prepared command for key.  The key's namespace and set must match the key the
+ * command was prepared with.
+ *
+ * @param as		The aerospike instance to use for this operation.
+ * @param err		The as_error to be populated if an error occurs.
+ * @param prep		The prepared command.
+ * @param key		The key of the record.
+ * @param values	Replacement bin values in bin or operation order.  Array length must be
+ *					prep->n_values.  A NULL array or NULL entry keeps the prepared value.
+ * @param ttl		Record ttl in seconds.
+ * @param rec		Populated with results of read operations.  Only used by operate commands
+ *					and may be NULL for put commands.
+ *
+ * @return AEROSPIKE_OK if successful. Otherwise an error.
+ *
+ * @relates as_prepared
+ */
+AS_EXTERN as_status
+aerospike_prepared_execute(
+	aerospike* as, as_error* err, const as_prepared* prep, const as_key* key, as_val** values,
+	uint32_t ttl, as_record** rec
+	);
+
+/**
+ * Release resources held by prepared command.
+ *
+ * @relates as_prepared
+ */
+AS_EXTERN void
+as_prepared_destroy(as_prepared* prep);
+
+#ifdef __cplusplus
+} // end extern "C"
+#endif
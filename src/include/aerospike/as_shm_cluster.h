@@ -22,6 +22,8 @@
 #include <aerospike/as_partition.h>
 #include <citrusleaf/cf_queue.h>
 
+#include <string.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -65,6 +67,12 @@ typedef struct as_node_shm_s {
 	 */
 	uint32_t features;
 
+	/**
+	 * @private
+	 * Exponentially weighted moving average of command latency in microseconds.
+	 */
+	uint32_t latency_us;
+
 	/**
 	 * @private
 	 * Is node currently active.
@@ -73,44 +81,109 @@ typedef struct as_node_shm_s {
 	
 	/**
 	 * @private
-	 * Pad to 8 byte boundary.
+	 * Pad to 4 byte boundary.
 	 */
 	char pad[3];
+
+	/**
+	 * @private
+	 * Rack where node resides.  AS_RACK_UNKNOWN if not known.
+	 */
+	int32_t rack_id;
 } as_node_shm;
 
+/**
+ * Host-wide node statistics from shared memory.
+ */
+typedef struct as_shm_node_stats_s {
+	/**
+	 * Open connections to node from all attached processes.
+	 */
+	uint32_t conns;
+
+	/**
+	 * Commands in progress on node from all attached processes.
+	 */
+	uint32_t in_flight;
+
+	/**
+	 * Moving average of command latency in microseconds.
+	 */
+	uint32_t latency_us;
+} as_shm_node_stats;
+
 /**
  * @private
- *  Shared memory representation of map of namespace data partitions to nodes. 8 bytes.
+ * Node counts published by one process.
  */
-typedef struct as_partition_shm_s {
+typedef struct as_node_counts_shm_s {
 	/**
 	 * @private
-	 * Master node index offset.
+	 * Open connections to node.
 	 */
-	uint32_t master;
+	uint32_t conns;
 
 	/**
 	 * @private
-	 * Prole node index offset.
+	 * Commands in progress on node.
 	 */
-	uint32_t prole;
+	uint32_t in_flight;
+} as_node_counts_shm;
 
+/**
+ * @private
+ * Node stats slot owned by one attached process.  Slots that have not been published within
+ * the takeover threshold belong to processes that exited without cleanup.  Readers skip them
+ * and new processes reuse them.
+ */
+typedef struct as_process_stats_shm_s {
 	/**
 	 * @private
-	 * Current regime for CP mode.
+	 * Last time this slot was published or claimed in milliseconds since epoch.
 	 */
-	uint32_t regime;
+	uint64_t timestamp;
+
+	/**
+	 * @private
+	 * Owner process id.  Zero if slot is free or being reset.
+	 */
+	uint32_t pid;
 
 	/**
 	 * @private
 	 * Pad to 8 byte boundary.
 	 */
 	uint32_t pad;
+
+	/**
+	 * @private
+	 * Node counts.  Array index offsets are synchronized with shared memory node offsets.
+	 */
+	as_node_counts_shm nodes[];
+} as_process_stats_shm;
+
+/**
+ * @private
+ *  Shared memory representation of map of namespace data partitions to nodes. 16 bytes.
+ */
+typedef struct as_partition_shm_s {
+	/**
+	 * @private
+	 * Node index offsets in replica order.  Master is first.
+	 */
+	uint32_t nodes[AS_MAX_REPLICAS];
+
+	/**
+	 * @private
+	 * Current regime for CP mode.
+	 */
+	uint32_t regime;
 } as_partition_shm;
 
 /**
  * @private
- * Shared memory representation of map of namespace to data partitions. 32 bytes + partitions size.
+ * Shared memory representation of map of namespace to data partitions. 40 bytes + partitions size
+ * times AS_SHM_PARTITION_COPIES.
  */
 typedef struct as_partition_table_shm_s {
 	/**
@@ -127,13 +200,22 @@ typedef struct as_partition_table_shm_s {
 
 	/**
 	 * @private
-	 * Pad to 8 byte boundary.
+	 * Pad to 4 byte boundary.
 	 */
-	char pad[7];
+	char pad[3];
+
+	/**
+	 * @private
+	 * Sequence lock count.  Odd while the tender is updating the first partitions copy and
+	 * even while it is copying the update to the second copy.  Readers use the copy that is
+	 * not being written and retry when the count changed during their read.
+	 */
+	uint32_t seq;
 
 	/**
 	 * @private
-	 * Array of partitions for a given namespace.
+	 * Array of partitions for a given namespace, followed by a second copy of the array.
+	 * See AS_SHM_PARTITION_COPIES.
 	 */
 	as_partition_shm partitions[];
 } as_partition_table_shm;
@@ -207,6 +289,12 @@ typedef struct as_cluster_shm_s {
 	 */
 	uint32_t partition_table_byte_size;
 
+	/**
+	 * @private
+	 * Number of process stats slots.
+	 */
+	uint32_t processes_capacity;
+
 	/**
 	 * @private
 	 * Spin lock for taking over from a dead cluster tender.
@@ -229,7 +317,7 @@ typedef struct as_cluster_shm_s {
 	 * @private
 	 * Pad to 8 byte boundary.
 	 */
-	char pad[6];
+	char pad[2];
 
 	/*
 	 * @private
@@ -238,6 +326,7 @@ typedef struct as_cluster_shm_s {
 	as_node_shm nodes[];
 	
 	// This is where the dynamically allocated partition tables are located.
+	// Process stats slots follow the partition tables.
 } as_cluster_shm;
 
 /**
@@ -258,6 +347,12 @@ typedef struct as_shm_info_s {
 	 */
 	as_node** local_nodes;
 	
+	/**
+	 * @private
+	 * Shared memory node stats slot owned by this process.  NULL if all slots are in use.
+	 */
+	as_process_stats_shm* process_stats;
+
 	/**
 	 * @private
 	 * Shared memory identifier.
@@ -280,6 +375,12 @@ typedef struct as_shm_info_s {
 	 * Is this process responsible for performing cluster tending.
 	 */
 	volatile bool is_tend_master;
+
+	/**
+	 * @private
+	 * Has the warning that all process stats slots are in use been logged.
+	 */
+	bool process_stats_warned;
 } as_shm_info;
 
 /******************************************************************************
@@ -333,7 +434,14 @@ as_shm_find_partition_table(as_cluster_shm* cluster_shm, const char* ns);
  * Update shared memory partition tables for given namespace.
  */
 void
-as_shm_update_partitions(as_shm_info* shm_info, const char* ns, char* bitmap_b64, int64_t len, as_node* node, bool master, uint32_t regime);
+as_shm_update_partitions(as_shm_info* shm_info, const char* ns, char* bitmap_b64, int64_t len, as_node* node, uint32_t replica, uint32_t regime);
+
+/**
+ * @private
+ * Update shared memory node rack.
+ */
+void
+as_shm_update_rack(as_shm_info* shm_info, as_node* node, int rack_id);
 
 /**
  * @private
@@ -341,7 +449,29 @@ as_shm_update_partitions(as_shm_info* shm_info, const char* ns, char* bitmap_b64
  * If successful, as_nodes_release() must be called when done with node.
  */
 as_status
-as_shm_cluster_get_node(struct as_cluster_s* cluster, as_error* err, const char* ns, const uint8_t* digest, as_policy_replica replica, bool use_master, as_node** node_pp);
+as_shm_cluster_get_node(struct as_cluster_s* cluster, as_error* err, const char* ns, const uint8_t* digest, as_policy_replica replica, uint32_t sequence, as_node** node_pp);
+
+/**
+ * @private
+ * Get shared memory mapped node given digest key without reserving it.
+ * Caller must be in an as_epoch_enter() read section.
+ */
+as_status
+as_shm_cluster_get_node_epoch(struct as_cluster_s* cluster, as_error* err, const char* ns, const uint8_t* digest, as_policy_replica replica, uint32_t sequence, as_node** node_pp);
+
+/**
+ * @private
+ * Publish this process's node connection, in-flight and latency stats to shared memory.
+ */
+void
+as_shm_publish_node_stats(struct as_cluster_s* cluster);
+
+/**
+ * Get host-wide stats for node from shared memory.  Return false if node is not
+ * found in shared memory or shared memory is not enabled.
+ */
+AS_EXTERN bool
+as_shm_get_node_stats(struct as_cluster_s* cluster, const char* node_name, as_shm_node_stats* stats);
 
 /**
  * @private
@@ -349,7 +479,97 @@ as_shm_cluster_get_node(struct as_cluster_s* cluster, as_error* err, const char*
  * as_nodes_release() must be called when done with node.
  */
 as_node*
-as_partition_shm_get_node(struct as_cluster_s* cluster, as_partition_shm* p, as_policy_replica replica, bool use_master, bool cp_mode);
+as_partition_shm_get_node(struct as_cluster_s* cluster, as_partition_shm* p, as_policy_replica replica, uint32_t sequence, bool cp_mode);
+
+/**
+ * @private
+ * Get shared memory mapped node given partition without reserving it.
+ * Caller must be in an as_epoch_enter() read section.
+ */
+as_node*
+as_partition_shm_get_node_epoch(struct as_cluster_s* cluster, as_partition_shm* p, as_policy_replica replica, uint32_t sequence, bool cp_mode);
+
+/**
+ * @private
+ * Number of partition array copies in each partition table.  The tender updates one copy while
+ * readers use the other, so readers never wait on an update.  A tender process that dies
+ * mid-update leaves readers on the last consistent copy until the next tender takes over.
+ */
+#define AS_SHM_PARTITION_COPIES 2
+
+/**
+ * @private
+ * Begin partition table update.  Only called by the shared memory tend master.
+ * Readers switch to the second copy while the first copy is updated.
+ */
+static inline void
+as_partition_table_shm_write_begin(as_partition_table_shm* table)
+{
+	as_incr_uint32(&table->seq);
+	as_fence_memory();
+}
+
+/**
+ * @private
+ * End partition table update.  Only called by the shared memory tend master.
+ * Readers switch back to the updated first copy before the second copy is brought up to date.
+ */
+static inline void
+as_partition_table_shm_write_end(as_partition_table_shm* table, uint32_t n_partitions)
+{
+	as_fence_memory();
+	as_incr_uint32(&table->seq);
+	as_fence_memory();
+	memcpy(&table->partitions[n_partitions], table->partitions, sizeof(as_partition_shm) * n_partitions);
+	as_fence_memory();
+}
+
+/**
+ * @private
+ * Copy partition node indexes that were all written by the same partition table update.
+ * The partition must be in the first copy.
+ */
+static inline void
+as_partition_shm_read(as_partition_table_shm* table, as_partition_shm* p, uint32_t n_partitions, as_partition_shm* snapshot)
+{
+	uint32_t seq;
+
+	do {
+		seq = as_load_uint32(&table->seq);
+		as_fence_memory();
+
+		// First copy is being updated while the sequence is odd.
+		as_partition_shm* src = (seq & 1)? p + n_partitions : p;
+
+		for (uint32_t i = 0; i < AS_MAX_REPLICAS; i++) {
+			snapshot->nodes[i] = as_load_uint32(&src->nodes[i]);
+		}
+		snapshot->regime = as_load_uint32(&src->regime);
+		as_fence_memory();
+	} while (seq != as_load_uint32(&table->seq));
+}
+
+/**
+ * @private
+ * Get byte size of one process stats slot.
+ */
+static inline uint32_t
+as_shm_process_stats_size(uint32_t nodes_capacity)
+{
+	return sizeof(as_process_stats_shm) + (sizeof(as_node_counts_shm) * nodes_capacity);
+}
+
+/**
+ * @private
+ * Get process stats slot located after the partition tables.
+ */
+static inline as_process_stats_shm*
+as_shm_get_process_stats(as_cluster_shm* cluster_shm, uint32_t index)
+{
+	uint8_t* base = (uint8_t*)cluster_shm + cluster_shm->partition_tables_offset +
+		(cluster_shm->partition_table_byte_size * cluster_shm->partition_tables_capacity);
+	return (as_process_stats_shm*)(base + (as_shm_process_stats_size(cluster_shm->nodes_capacity) * index));
+}
 
 /**
  * @private
@@ -381,6 +601,18 @@ as_shm_next_partition_table(as_cluster_shm* cluster_shm, as_partition_table_shm*
 	return (as_partition_table_shm*) ((char*)table + cluster_shm->partition_table_byte_size);
 }
 
+/**
+ * @private
+ * Get partition table that contains the given partition.
+ */
+static inline as_partition_table_shm*
+as_shm_find_partition_table_by_partition(as_cluster_shm* cluster_shm, as_partition_shm* p)
+{
+	as_partition_table_shm* tables = as_shm_get_partition_tables(cluster_shm);
+	uint32_t index = (uint32_t)(((char*)p - (char*)tables) / cluster_shm->partition_table_byte_size);
+	return as_shm_get_partition_table(cluster_shm, tables, index);
+}
+
 #ifdef __cplusplus
 } // end extern "C"
 #endif
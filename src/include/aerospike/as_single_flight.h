@@ -0,0 +1,259 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#pragma once
+
+#include <aerospike/as_atomic.h>
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_command.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_key.h>
+#include <aerospike/as_policy.h>
+#include <aerospike/as_record.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+/**
+ * @private
+ * Number of independently locked in-flight read lists.  Must be a power of two.
+ */
+#define AS_SINGLE_FLIGHT_SHARDS 64
+
+/**
+ * @private
+ * Number of write version slots per shard.  Must be a power of two.
+ */
+#define AS_SINGLE_FLIGHT_VERSIONS 64
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * @private
+ * Server read shared by concurrent callers.
+ */
+typedef struct as_flight_s {
+	/**
+	 * @private
+	 * Next in-flight read in shard.
+	 */
+	struct as_flight_s* next;
+
+	/**
+	 * @private
+	 * Signaled when read completes.
+	 */
+	pthread_cond_t cond;
+
+	/**
+	 * @private
+	 * Unparsed record.  Each caller parses its own copy.
+	 */
+	as_command_raw_record raw;
+
+	/**
+	 * @private
+	 * Error returned by server read.
+	 */
+	as_error err;
+
+	/**
+	 * @private
+	 * Status returned by server read.
+	 */
+	as_status status;
+
+	/**
+	 * @private
+	 * Number of callers using this read.  Last caller frees it.
+	 */
+	uint32_t ref_count;
+
+	/**
+	 * @private
+	 * Write version of key's slot when read started.
+	 */
+	uint32_t version;
+
+	/**
+	 * @private
+	 * Replica policy used by read.
+	 */
+	as_policy_replica replica;
+
+	/**
+	 * @private
+	 * Consistency level used by read.
+	 */
+	as_policy_consistency_level consistency_level;
+
+	/**
+	 * @private
+	 * Is read linearized.
+	 */
+	bool linearize_read;
+
+	/**
+	 * @private
+	 * Size of bin name list.
+	 */
+	uint32_t bins_size;
+
+	/**
+	 * @private
+	 * Has read completed.
+	 */
+	bool done;
+
+	/**
+	 * @private
+	 * Are all bins read.
+	 */
+	bool all;
+
+	/**
+	 * @private
+	 * Key digest.
+	 */
+	uint8_t digest[AS_DIGEST_VALUE_SIZE];
+
+	/**
+	 * @private
+	 * Key namespace.
+	 */
+	as_namespace ns;
+
+	/**
+	 * @private
+	 * Requested bin names, each null terminated.
+	 */
+	char bins[];
+} as_flight;
+
+/**
+ * @private
+ * Independently locked list of in-flight reads.
+ */
+typedef struct as_single_flight_shard_s {
+	pthread_mutex_t lock;
+	as_flight* flights;
+
+	/**
+	 * @private
+	 * Write versions indexed by key digest.  Incremented when a write completes, so
+	 * reads that start after the write do not join reads that started before it.
+	 */
+	uint32_t versions[AS_SINGLE_FLIGHT_VERSIONS];
+} as_single_flight_shard;
+
+/**
+ * @private
+ * Send record read to server and store unparsed response in raw.
+ */
+typedef as_status (*as_single_flight_command_fn) (
+	as_cluster* cluster, as_error* err, const as_policy_read* policy, const as_key* key,
+	const char* bins[], as_command_raw_record* raw
+	);
+
+/**
+ * @private
+ * In-flight reads that concurrent reads of the same key and bins can join.
+ */
+typedef struct as_single_flight_s {
+	as_single_flight_shard shards[AS_SINGLE_FLIGHT_SHARDS];
+
+	/**
+	 * @private
+	 * Command used by the first caller of each read.  Set to the single record read
+	 * command by as_single_flight_create().
+	 */
+	as_single_flight_command_fn command;
+} as_single_flight;
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+/**
+ * @private
+ * Get shard that contains in-flight reads of digest.
+ */
+static inline as_single_flight_shard*
+as_single_flight_get_shard(as_single_flight* sf, const uint8_t* digest)
+{
+	return &sf->shards[*(uint32_t*)(digest + 4) & (AS_SINGLE_FLIGHT_SHARDS - 1)];
+}
+
+/**
+ * @private
+ * Get write version slot of digest.
+ */
+static inline uint32_t*
+as_single_flight_version(as_single_flight_shard* shard, const uint8_t* digest)
+{
+	return &shard->versions[*(uint32_t*)(digest + 8) & (AS_SINGLE_FLIGHT_VERSIONS - 1)];
+}
+
+/**
+ * @private
+ * Record completed write of key.  Reads of key that start later do not join reads that
+ * are already in progress.  Must be called after the write completes.
+ */
+static inline void
+as_single_flight_invalidate_key(as_cluster* cluster, const as_key* key)
+{
+	as_single_flight_shard* shard = as_single_flight_get_shard(cluster->single_flight, key->digest.value);
+	as_incr_uint32(as_single_flight_version(shard, key->digest.value));
+}
+
+/**
+ * @private
+ * Create in-flight read table.
+ */
+as_single_flight*
+as_single_flight_create(void);
+
+/**
+ * @private
+ * Destroy in-flight read table.  No reads may be in progress.
+ */
+void
+as_single_flight_destroy(as_single_flight* sf);
+
+/**
+ * @private
+ * Read record, or join a read of the same key, bins and read policy that is already in
+ * progress and started after the last completed write of the key.  Callers that join
+ * wait at most their own total timeout.  If bins is NULL, all bins are read.  Key digest
+ * must be set.
+ */
+as_status
+as_single_flight_read(
+	as_cluster* cluster, as_error* err, const as_policy_read* policy, const as_key* key,
+	const char* bins[], as_record** rec
+	);
+
+#ifdef __cplusplus
+} // end extern "C"
+#endif
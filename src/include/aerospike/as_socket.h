@@ -56,18 +56,42 @@ extern "C" {
 #endif
 
 struct ssl_ctx_st;
+struct ssl_session_st;
 
 /**
  * This structure holds TLS context which can be shared (read-only)
  * by all the connections to a specific cluster.
+ *
+ * session_hits counts connections that resumed a cached TLS session.
+ * session_misses counts connections that required a full handshake.
  */
 typedef struct as_tls_context_s {
 	pthread_mutex_t lock;
 	struct ssl_ctx_st* ssl_ctx;
 	void* cert_blacklist;
 	bool log_session_info;
+	uint64_t session_hits;
+	uint64_t session_misses;
 } as_tls_context;
 
+/**
+ * @private
+ * Last negotiated TLS session for a server node.  New connections to the
+ * same node offer this session so the server can skip the full handshake.
+ */
+typedef struct as_tls_session_s {
+	pthread_mutex_t lock;
+	struct ssl_session_st* session;
+} as_tls_session;
+
+/**
+ * @private
+ * Size of buffer used to read small responses from non-TLS sync sockets.  The buffer is
+ * allocated on a socket's first small read and kept until the socket is closed, so each
+ * pooled sync connection holds one buffer of this size.
+ */
+#define AS_SOCKET_READ_BUFFER_SIZE 16384
+
 struct as_conn_pool_lock_s;
 struct as_node_s;
 
@@ -91,6 +115,9 @@ typedef struct as_socket_s {
 	as_tls_context* ctx;
 	const char* tls_name;
 	struct ssl_st* ssl;
+	uint8_t* rbuf;                             // Bytes read ahead of sync non-TLS reads.
+	uint32_t rbuf_pos;                         // Offset of next unread byte in rbuf.
+	uint32_t rbuf_len;                         // Number of bytes in rbuf.
 } as_socket;
 
 /**
@@ -193,6 +220,18 @@ as_socket_validate_fd(as_socket_fd fd);
 int
 as_socket_validate(as_socket* sock);
 
+/**
+ * @private
+ * Return if pooled socket will have been idle longer than its maximum idle time
+ * margin seconds from now.
+ */
+static inline bool
+as_socket_expiring(as_socket* sock, uint32_t now, uint32_t margin)
+{
+	uint32_t max_socket_idle = sock->idle_check.max_socket_idle;
+	return max_socket_idle > 0 && now - sock->idle_check.last_used + margin > max_socket_idle;
+}
+
 /**
  * @private
  * Calculate future deadline given timeout.
@@ -205,25 +244,56 @@ as_socket_deadline(uint32_t timeout_ms)
 
 /**
  * @private
- * Write socket data with future deadline in milliseconds.
+ * Write socket data with socket timeout and future deadline in microseconds.
  * If deadline is zero, do not set deadline.
  */
 as_status
+as_socket_write_deadline_us(
+	as_error* err, as_socket* sock, struct as_node_s* node, uint8_t *buf, size_t buf_len,
+	uint32_t socket_timeout_us, uint64_t deadline_us
+	);
+
+/**
+ * @private
+ * Read socket data with socket timeout and future deadline in microseconds.
+ * If deadline is zero, do not set deadline.
+ */
+as_status
+as_socket_read_deadline_us(
+	as_error* err, as_socket* sock, struct as_node_s* node, uint8_t *buf, size_t buf_len,
+	uint32_t socket_timeout_us, uint64_t deadline_us
+	);
+
+/**
+ * @private
+ * Write socket data with future deadline in milliseconds.
+ * If deadline is zero, do not set deadline.
+ */
+static inline as_status
 as_socket_write_deadline(
 	as_error* err, as_socket* sock, struct as_node_s* node, uint8_t *buf, size_t buf_len,
 	uint32_t socket_timeout, uint64_t deadline
-	);
+	)
+{
+	// Millisecond and microsecond clocks share the same monotonic time base.
+	uint32_t socket_timeout_us = (socket_timeout > UINT32_MAX / 1000)? UINT32_MAX : socket_timeout * 1000;
+	return as_socket_write_deadline_us(err, sock, node, buf, buf_len, socket_timeout_us, deadline * 1000);
+}
 
 /**
  * @private
  * Read socket data with future deadline in milliseconds.
  * If deadline is zero, do not set deadline.
  */
-as_status
+static inline as_status
 as_socket_read_deadline(
 	as_error* err, as_socket* sock, struct as_node_s* node, uint8_t *buf, size_t buf_len,
 	uint32_t socket_timeout, uint64_t deadline
-	);
+	)
+{
+	uint32_t socket_timeout_us = (socket_timeout > UINT32_MAX / 1000)? UINT32_MAX : socket_timeout * 1000;
+	return as_socket_read_deadline_us(err, sock, node, buf, buf_len, socket_timeout_us, deadline * 1000);
+}
 
 #ifdef __cplusplus
 } // end extern "C"
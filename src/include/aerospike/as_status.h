@@ -32,6 +32,11 @@ typedef enum as_status_e {
 	/***************************************************************************
 	 * Client Errors
 	 **************************************************************************/
+	/**
+	 * Async command was not started because the completion ring of its event loop is full.
+	 */
+	AEROSPIKE_ERR_ASYNC_QUEUE_FULL = -11,
+
 	/**
 	 * Synchronous connection error.
 	 */
@@ -40,8 +40,16 @@ int as_tls_wrap(as_tls_context* ctx, as_socket* sock, const char* tls_name);
 
 void as_tls_set_name(as_socket* sock, const char* tls_name);
 
+void as_tls_session_init(as_tls_session* session);
+
+void as_tls_session_destroy(as_tls_session* session);
+
+// Offer cached session on next connect and cache the session it negotiates.
+void as_tls_set_session(as_socket* sock, as_tls_session* session);
+
 int as_tls_connect_once(as_socket* sock);
 
+// Deadline is in milliseconds.
 int as_tls_connect(as_socket* sock, uint64_t deadline);
 
 // int as_tls_peek(as_socket* sock, void* buf, int num);
@@ -50,8 +58,10 @@ int as_tls_read_pending(as_socket* sock);
 
 int as_tls_read_once(as_socket* sock, void* buf, size_t num);
 
-int as_tls_read(as_socket* sock, void* buf, size_t num, uint32_t socket_timeout, uint64_t deadline);
+// Socket timeout and deadline are in microseconds.
+int as_tls_read(as_socket* sock, void* buf, size_t num, uint32_t socket_timeout_us, uint64_t deadline_us);
 
 int as_tls_write_once(as_socket* sock, void* buf, size_t num);
 
-int as_tls_write(as_socket* sock, void* buf, size_t num, uint32_t socket_timeout, uint64_t deadline);
+// Socket timeout and deadline are in microseconds.
+int as_tls_write(as_socket* sock, void* buf, size_t num, uint32_t socket_timeout_us, uint64_t deadline_us);
@@ -20,6 +20,7 @@
 #include <aerospike/as_info.h>
 #include <aerospike/as_log_macros.h>
 #include <aerospike/as_module.h>
+#include <aerospike/as_namespace_handle.h>
 #include <aerospike/as_string_builder.h>
 #include <aerospike/as_tls.h>
 #include <aerospike/mod_lua.h>
@@ -292,6 +293,17 @@ aerospike_truncate(aerospike* as, as_error* err, as_policy_info* policy, const c
 	return as_info_command_random_node(as, err, policy, sb.data);
 }
 
+as_status
+aerospike_namespace_resolve(aerospike* as, as_error* err, const char* ns, as_namespace_handle* handle)
+{
+	as_error_reset(err);
+
+	if (! as->cluster) {
+		return as_error_set_message(err, AEROSPIKE_ERR_CLIENT, "Client is not connected");
+	}
+	return as_cluster_resolve_namespace(as->cluster, err, ns, handle);
+}
+
 as_status
 aerospike_reload_tls_config(aerospike* as, as_error* err)
 {
@@ -22,6 +22,7 @@
 #include <aerospike/as_key.h>
 #include <aerospike/as_list.h>
 #include <aerospike/as_log_macros.h>
+#include <aerospike/as_near_cache.h>
 #include <aerospike/as_operations.h>
 #include <aerospike/as_policy.h>
 #include <aerospike/as_record.h>
@@ -57,6 +58,7 @@ typedef struct as_batch_task_s {
 	void* udata;            // XDR
 	as_batch_callback_xdr callback_xdr; // XDR
 	const char** bins;      // Old aerospike_batch_get()
+	uint32_t* nc_versions;  // Old aerospike_batch_get() near cache versions
 	
 	uint32_t n_bins;        // Old aerospike_batch_get()
 	uint32_t index;         // Old aerospike_batch_get()
@@ -305,11 +307,17 @@ as_batch_parse_records(as_error* err, uint8_t* buf, size_t size, as_batch_task*
 					result->result = msg->result_code;
 					
 					if (msg->result_code == AEROSPIKE_OK) {
+						uint8_t* bins = p;
 						as_status status = as_batch_parse_record(&p, err, msg, &result->record, deserialize);
 
 						if (status != AEROSPIKE_OK) {
 							return status;
 						}
+
+						if (task->nc_versions) {
+							as_near_cache_put(task->cluster->near_cache, key, task->nc_versions[offset], msg,
+								bins, (uint32_t)(p - bins));
+						}
 					}
 				}
 			}
@@ -324,7 +332,7 @@ as_batch_parse_records(as_error* err, uint8_t* buf, size_t size, as_batch_task*
 }
 
 static as_status
-as_batch_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout, uint64_t deadline_ms, void* udata)
+as_batch_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* udata)
 {
 	as_batch_task* task = udata;
 	as_status status = AEROSPIKE_OK;
@@ -334,7 +342,7 @@ as_batch_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_ti
 	while (true) {
 		// Read header
 		as_proto proto;
-		status = as_socket_read_deadline(err, sock, node, (uint8_t*)&proto, sizeof(as_proto), socket_timeout, deadline_ms);
+		status = as_socket_read_deadline_us(err, sock, node, (uint8_t*)&proto, sizeof(as_proto), socket_timeout_us, deadline_us);
 		
 		if (status) {
 			break;
@@ -351,7 +359,7 @@ as_batch_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_ti
 			}
 			
 			// Read remaining message bytes in group
-			status = as_socket_read_deadline(err, sock, node, buf, size, socket_timeout, deadline_ms);
+			status = as_socket_read_deadline_us(err, sock, node, buf, size, socket_timeout_us, deadline_us);
 			
 			if (status) {
 				break;
@@ -421,7 +429,7 @@ as_batch_index_records_write(as_vector* records, as_vector* offsets, const as_po
 
 	uint32_t n_offsets = offsets->size;
 	uint8_t* p = as_command_write_header_read(cmd, read_attr | AS_MSG_INFO1_BATCH_INDEX,
-					policy->consistency_level, policy->linearize_read, policy->base.total_timeout, 1, 0);
+					policy->consistency_level, policy->linearize_read, as_policy_server_timeout(&policy->base), 1, 0);
 	uint8_t* field_size_ptr = p;
 	p = as_command_write_field_header(p, policy->send_set_name ? AS_FIELD_BATCH_INDEX_WITH_SET : AS_FIELD_BATCH_INDEX, 0);  // Need to update size at end
 	*(uint32_t*)p = cf_swap_to_be32(n_offsets);
@@ -568,7 +576,7 @@ as_batch_index_execute(as_batch_task* task)
 	// Write command
 	uint8_t* cmd = as_command_init(size);
 	uint8_t* p = as_command_write_header_read(cmd, task->read_attr | AS_MSG_INFO1_BATCH_INDEX,
-					policy->consistency_level, policy->linearize_read, policy->base.total_timeout, 1, 0);
+					policy->consistency_level, policy->linearize_read, as_policy_server_timeout(&policy->base), 1, 0);
 	uint8_t* field_size_ptr = p;
 	p = as_command_write_field_header(p, policy->send_set_name ? AS_FIELD_BATCH_INDEX_WITH_SET : AS_FIELD_BATCH_INDEX, 0);  // Need to update size at end
 	*(uint32_t*)p = cf_swap_to_be32(n_offsets);
@@ -657,7 +665,7 @@ as_batch_direct_execute(as_batch_task* task)
 	
 	uint8_t* cmd = as_command_init(size);
 	uint8_t* p = as_command_write_header_read(cmd, task->read_attr, policy->consistency_level,
-					policy->linearize_read, policy->base.total_timeout, 2, task->n_bins);
+					policy->linearize_read, as_policy_server_timeout(&policy->base), 2, task->n_bins);
 	p = as_command_write_field_string(p, AS_FIELD_NAMESPACE, task->ns);
 	p = as_command_write_field_header(p, AS_FIELD_DIGEST_ARRAY, byte_size);
 	
@@ -788,6 +796,10 @@ as_batch_execute(
 	
 	// Allocate results array on stack.  May be an issue for huge batch.
 	as_batch_read* results = (callback)? (as_batch_read*)alloca(sizeof(as_batch_read) * n_keys) : 0;
+
+	// Full record reads can be served from near cache.  Versions detect writes during the batch.
+	uint32_t* nc_versions = (callback && cluster->near_cache && read_attr == (AS_MSG_INFO1_READ | AS_MSG_INFO1_GET_ALL))?
+		(uint32_t*)alloca(sizeof(uint32_t) * n_keys) : 0;
 	
 	as_batch_node* batch_nodes = alloca(sizeof(as_batch_node) * n_nodes);
 	char* ns = batch->keys.entries[0].ns;
@@ -822,8 +834,14 @@ as_batch_execute(
 			return status;
 		}
 
+		if (nc_versions && as_near_cache_get_fresh(cluster->near_cache, key, policy->deserialize,
+				&results[i].record, &nc_versions[i])) {
+			results[i].result = AEROSPIKE_OK;
+			continue;
+		}
+
 		as_node* node;
-		status = as_cluster_get_node(cluster, err, key->ns, key->digest.value, AS_POLICY_REPLICA_MASTER, false, &node);
+		status = as_cluster_get_node(cluster, err, key->ns, key->digest.value, AS_POLICY_REPLICA_MASTER, 0, &node);
 
 		if (status != AEROSPIKE_OK) {
 			as_batch_release_nodes(batch_nodes, n_batch_nodes);
@@ -866,6 +884,7 @@ as_batch_execute(
 	task.ns = ns;
 	task.err = err;
 	task.results = results;
+	task.nc_versions = nc_versions;
 	task.error_mutex = &error_mutex;
 	task.n_keys = n_keys;
 	task.bins = bins;
@@ -1051,12 +1070,17 @@ as_batch_read_execute_async(
 		// Estimate buffer size.
 		size_t size = as_batch_index_records_size(records, &batch_node->offsets, policy->send_set_name);
 		
-		// Allocate enough memory to cover, then, round up memory size in 8KB increments to reduce
-		// fragmentation and to allow socket read to reuse buffer.
-		size_t s = (sizeof(as_async_batch_command) + size + AS_AUTHENTICATION_MAX_SIZE + 8191) & ~8191;
-		as_event_command* cmd = cf_malloc(s);
-		cmd->total_deadline = policy->base.total_timeout;
-		cmd->socket_timeout = policy->base.socket_timeout;
+		// Allocate enough memory to cover, at least 8KB.  Buffer pool rounds up to the next size
+		// class, which allows socket read to reuse buffer.
+		size_t s = sizeof(as_async_batch_command) + size + AS_AUTHENTICATION_MAX_SIZE;
+
+		if (s < 8192 - AS_COMMAND_POOL_HEADER_SIZE) {
+			s = 8192 - AS_COMMAND_POOL_HEADER_SIZE;
+		}
+		size_t capacity;
+		as_event_command* cmd = as_command_pool_alloc(s, &capacity);
+		cmd->total_deadline = as_policy_total_timeout_us(&policy->base);
+		cmd->socket_timeout = as_policy_socket_timeout_us(&policy->base);
 		cmd->max_retries = policy->base.max_retries;
 		cmd->iteration = 0;
 		cmd->replica = AS_POLICY_REPLICA_MASTER;
@@ -1069,10 +1093,11 @@ as_batch_read_execute_async(
 		cmd->pipe_listener = NULL;
 		cmd->buf = ((as_async_batch_command*)cmd)->space;
 		cmd->write_len = (uint32_t)size;
-		cmd->read_capacity = (uint32_t)(s - size - sizeof(as_async_batch_command));
+		cmd->read_capacity = (uint32_t)(capacity - size - sizeof(as_async_batch_command));
 		cmd->type = AS_ASYNC_TYPE_BATCH;
 		cmd->state = AS_ASYNC_STATE_UNREGISTERED;
-		cmd->flags = AS_ASYNC_FLAGS_MASTER;
+		cmd->flags = 0;
+		cmd->replica_index = 0;
 		cmd->deserialize = policy->deserialize;
 		cmd->len = (uint32_t)as_batch_index_records_write(records, &batch_node->offsets, policy, cmd->buf);
 		
@@ -1165,7 +1190,7 @@ as_batch_read_execute(
 		}
 		
 		as_node* node;
-		status = as_cluster_get_node(cluster, err, key->ns, key->digest.value, AS_POLICY_REPLICA_MASTER, false, &node);
+		status = as_cluster_get_node(cluster, err, key->ns, key->digest.value, AS_POLICY_REPLICA_MASTER, 0, &node);
 
 		if (status != AEROSPIKE_OK) {
 			as_batch_read_cleanup(async_executor, nodes, batch_nodes, n_batch_nodes);
@@ -1261,7 +1286,7 @@ aerospike_batch_read_async(
 	as_event_executor* exec = &executor->executor;
 	pthread_mutex_init(&exec->lock, NULL);
 	exec->commands = 0;
-	exec->event_loop = as_event_assign(event_loop);
+	exec->event_loop = as_event_assign(as->cluster, event_loop);
 	exec->complete_fn = as_batch_complete_async;
 	exec->udata = udata;
 	exec->err = NULL;
@@ -26,13 +26,17 @@
 #include <aerospike/as_list.h>
 #include <aerospike/as_log.h>
 #include <aerospike/as_msgpack.h>
+#include <aerospike/as_namespace_handle.h>
+#include <aerospike/as_near_cache.h>
 #include <aerospike/as_operations.h>
 #include <aerospike/as_partition.h>
+#include <aerospike/as_prepared.h>
 #include <aerospike/as_policy.h>
 #include <aerospike/as_random.h>
 #include <aerospike/as_record.h>
 #include <aerospike/as_serializer.h>
 #include <aerospike/as_shm_cluster.h>
+#include <aerospike/as_single_flight.h>
 #include <aerospike/as_status.h>
 #include <citrusleaf/cf_clock.h>
 
@@ -42,15 +46,32 @@
  * FUNCTIONS
  *****************************************************************************/
 
-static inline void
-as_command_node_init(
-	as_command_node* cn, const char* ns, const uint8_t* digest, as_policy_replica replica
-	)
+static as_status
+as_event_command_init_handle(as_cluster* cluster, as_error* err, const as_key* key, void** partition, uint8_t* flags)
 {
-	cn->node = 0;
-	cn->ns = ns;
-	cn->digest = digest;
-	cn->replica = replica;
+	const as_namespace_handle* nsh = key->nsh;
+
+	if (nsh->cluster != cluster) {
+		*partition = NULL;
+		return as_error_update(err, AEROSPIKE_ERR_PARAM, "Namespace handle %s belongs to a different cluster", nsh->ns);
+	}
+
+	if (nsh->cp_mode) {
+		*flags |= AS_ASYNC_FLAGS_CP_MODE;
+	}
+
+	// Route directly from digest to partition without namespace lookup.
+	uint32_t partition_id = as_partition_getid(key->digest.value, nsh->n_partitions);
+
+	if (nsh->shm) {
+		as_partition_table_shm* table = nsh->table;
+		*partition = &table->partitions[partition_id];
+	}
+	else {
+		as_partition_table* table = nsh->table;
+		*partition = &table->partitions[partition_id];
+	}
+	return AEROSPIKE_OK;
 }
 
 static as_status
@@ -65,6 +86,10 @@ as_event_command_init(as_cluster* cluster, as_error* err, const as_key* key, voi
 		return status;
 	}
 
+	if (key->nsh) {
+		return as_event_command_init_handle(cluster, err, key, partition, flags);
+	}
+
 	if (cluster->shm_info) {
 		as_cluster_shm* cluster_shm = cluster->shm_info->cluster_shm;
 		as_partition_table_shm* table = as_shm_find_partition_table(cluster_shm, key->ns);
@@ -115,19 +140,27 @@ aerospike_key_get(
 	if (status != AEROSPIKE_OK) {
 		return status;
 	}
+
+	if (as->cluster->near_cache && ! policy->linearize_read) {
+		return as_near_cache_read(as->cluster, err, policy, key, NULL, rec);
+	}
+
+	if (policy->coalesce) {
+		return as_single_flight_read(as->cluster, err, policy, key, NULL, rec);
+	}
 	
 	uint16_t n_fields;
 	size_t size = as_command_key_size(policy->key, key, &n_fields);
 		
 	uint8_t* cmd = as_command_init(size);
 	uint8_t* p = as_command_write_header_read(cmd, AS_MSG_INFO1_READ | AS_MSG_INFO1_GET_ALL,
-		policy->consistency_level, policy->linearize_read, policy->base.total_timeout, n_fields, 0);
+		policy->consistency_level, policy->linearize_read, as_policy_server_timeout(&policy->base), n_fields, 0);
 
 	p = as_command_write_key(p, policy->key, key);
 	size = as_command_write_end(cmd, p);
 	
 	as_command_node cn;
-	as_command_node_init(&cn, key->ns, key->digest.value, policy->replica);
+	as_command_node_init(&cn, key, policy->replica);
 
 	as_command_parse_result_data data;
 	data.record = rec;
@@ -151,7 +184,7 @@ aerospike_key_get_async(
 	}
 	
 	void* partition;
-	uint8_t flags = AS_ASYNC_FLAGS_MASTER | AS_ASYNC_FLAGS_READ;
+	uint8_t flags = AS_ASYNC_FLAGS_READ;
 	as_status status = as_event_command_init(as->cluster, err, key, &partition, &flags);
 
 	if (status != AEROSPIKE_OK) {
@@ -166,7 +199,7 @@ aerospike_key_get_async(
 		listener, udata, event_loop, pipe_listener, size, as_event_command_parse_result);
 
 	uint8_t* p = as_command_write_header_read(cmd->buf, AS_MSG_INFO1_READ | AS_MSG_INFO1_GET_ALL,
-		policy->consistency_level, policy->linearize_read, policy->base.total_timeout, n_fields, 0);
+		policy->consistency_level, policy->linearize_read, as_policy_server_timeout(&policy->base), n_fields, 0);
 
 	p = as_command_write_key(p, policy->key, key);
 	cmd->write_len = (uint32_t)as_command_write_end(cmd->buf, p);
@@ -190,6 +223,14 @@ aerospike_key_select(
 	if (status != AEROSPIKE_OK) {
 		return status;
 	}
+
+	if (as->cluster->near_cache && ! policy->linearize_read) {
+		return as_near_cache_read(as->cluster, err, policy, key, bins, rec);
+	}
+
+	if (policy->coalesce) {
+		return as_single_flight_read(as->cluster, err, policy, key, bins, rec);
+	}
 	
 	uint16_t n_fields;
 	size_t size = as_command_key_size(policy->key, key, &n_fields);
@@ -205,7 +246,7 @@ aerospike_key_select(
 	
 	uint8_t* cmd = as_command_init(size);
 	uint8_t* p = as_command_write_header_read(cmd, AS_MSG_INFO1_READ, policy->consistency_level,
-		policy->linearize_read, policy->base.total_timeout, n_fields, nvalues);
+		policy->linearize_read, as_policy_server_timeout(&policy->base), n_fields, nvalues);
 
 	p = as_command_write_key(p, policy->key, key);
 	
@@ -215,7 +256,7 @@ aerospike_key_select(
 	size = as_command_write_end(cmd, p);
 
 	as_command_node cn;
-	as_command_node_init(&cn, key->ns, key->digest.value, policy->replica);
+	as_command_node_init(&cn, key, policy->replica);
 	
 	as_command_parse_result_data data;
 	data.record = rec;
@@ -238,7 +279,7 @@ aerospike_key_select_async(
 	}
 	
 	void* partition;
-	uint8_t flags = AS_ASYNC_FLAGS_MASTER | AS_ASYNC_FLAGS_READ;
+	uint8_t flags = AS_ASYNC_FLAGS_READ;
 	as_status status = as_event_command_init(as->cluster, err, key, &partition, &flags);
 
 	if (status != AEROSPIKE_OK) {
@@ -262,7 +303,7 @@ aerospike_key_select_async(
 		listener, udata, event_loop, pipe_listener, size, as_event_command_parse_result);
 
 	uint8_t* p = as_command_write_header_read(cmd->buf, AS_MSG_INFO1_READ, policy->consistency_level,
-		policy->linearize_read, policy->base.total_timeout, n_fields, nvalues);
+		policy->linearize_read, as_policy_server_timeout(&policy->base), n_fields, nvalues);
 
 	p = as_command_write_key(p, policy->key, key);
 	
@@ -295,13 +336,13 @@ aerospike_key_exists(
 	
 	uint8_t* cmd = as_command_init(size);
 	uint8_t* p = as_command_write_header_read(cmd, AS_MSG_INFO1_READ | AS_MSG_INFO1_GET_NOBINDATA,
-		policy->consistency_level, policy->linearize_read, policy->base.total_timeout, n_fields, 0);
+		policy->consistency_level, policy->linearize_read, as_policy_server_timeout(&policy->base), n_fields, 0);
 
 	p = as_command_write_key(p, policy->key, key);
 	size = as_command_write_end(cmd, p);
 
 	as_command_node cn;
-	as_command_node_init(&cn, key->ns, key->digest.value, policy->replica);
+	as_command_node_init(&cn, key, policy->replica);
 	
 	as_proto_msg msg;
 	status = as_command_execute(as->cluster, err, &policy->base, &cn, cmd, size, as_command_parse_header, &msg, true);
@@ -338,7 +379,7 @@ aerospike_key_exists_async(
 	}
 	
 	void* partition;
-	uint8_t flags = AS_ASYNC_FLAGS_MASTER | AS_ASYNC_FLAGS_READ;
+	uint8_t flags = AS_ASYNC_FLAGS_READ;
 	as_status status = as_event_command_init(as->cluster, err, key, &partition, &flags);
 
 	if (status != AEROSPIKE_OK) {
@@ -353,7 +394,7 @@ aerospike_key_exists_async(
 		event_loop, pipe_listener, size, as_event_command_parse_result);
 
 	uint8_t* p = as_command_write_header_read(cmd->buf, AS_MSG_INFO1_READ | AS_MSG_INFO1_GET_NOBINDATA,
-		policy->consistency_level, policy->linearize_read, policy->base.total_timeout, n_fields, 0);
+		policy->consistency_level, policy->linearize_read, as_policy_server_timeout(&policy->base), n_fields, 0);
 
 	p = as_command_write_key(p, policy->key, key);
 	cmd->write_len = (uint32_t)as_command_write_end(cmd->buf, p);
@@ -377,6 +418,8 @@ aerospike_key_put(
 		return status;
 	}
 	
+	as_near_cache_invalidate_key(as->cluster, key);
+
 	as_bin* bins = rec->bins.entries;
 	uint32_t n_bins = rec->bins.size;
 	as_buffer* buffers = (as_buffer*)alloca(sizeof(as_buffer) * n_bins);
@@ -397,7 +440,7 @@ aerospike_key_put(
 
 	uint8_t* cmd = as_command_init(size);
 	uint8_t* p = as_command_write_header(cmd, 0, AS_MSG_INFO2_WRITE, policy->commit_level, 0, false,
-					policy->exists, policy->gen, rec->gen, rec->ttl, policy->base.total_timeout, n_fields,
+					policy->exists, policy->gen, rec->gen, rec->ttl, as_policy_server_timeout(&policy->base), n_fields,
 					n_bins, policy->durable_delete);
 		
 	p = as_command_write_key(p, policy->key, key);
@@ -413,7 +456,7 @@ aerospike_key_put(
 	size = as_command_write_end(cmd, p);
 
 	as_command_node cn;
-	as_command_node_init(&cn, key->ns, key->digest.value, AS_POLICY_REPLICA_MASTER);
+	as_command_node_init(&cn, key, AS_POLICY_REPLICA_MASTER);
 	as_proto_msg msg;
 	
 	if (policy->compression_threshold == 0 || (size <= policy->compression_threshold)) {
@@ -424,8 +467,9 @@ aerospike_key_put(
 	}
 	else {
 		// Send compressed command.
-		size_t comp_size = as_command_compress_max_size(size);
-		uint8_t* comp_cmd = as_command_init(comp_size);
+		size_t comp_capacity = as_command_compress_max_size(size);
+		size_t comp_size = comp_capacity;
+		uint8_t* comp_cmd = as_command_init(comp_capacity);
 		status = as_command_compress(err, cmd, size, comp_cmd, &comp_size);
 		
 		if (status == AEROSPIKE_OK) {
@@ -433,9 +477,13 @@ aerospike_key_put(
 			status = as_command_execute(as->cluster, err, &policy->base, &cn, comp_cmd, comp_size, as_command_parse_header, &msg, false);
 			AEROSPIKE_PUT_EXECUTE_FINISHED(task_id);
 		}
-		as_command_free(comp_cmd, comp_size);
+		as_command_free(comp_cmd, comp_capacity);
 	}
 	as_command_free(cmd, size);
+
+	// Invalidate again in case a concurrent read cached the record before the write completed.
+	as_near_cache_invalidate_key(as->cluster, key);
+	as_single_flight_invalidate_key(as->cluster, key);
 	return status;
 }
 
@@ -451,12 +499,14 @@ aerospike_key_put_async_ex(
 	}
 
 	void* partition;
-	uint8_t flags = AS_ASYNC_FLAGS_MASTER;
+	uint8_t flags = 0;
 	as_status status = as_event_command_init(as->cluster, err, key, &partition, &flags);
 	
 	if (status != AEROSPIKE_OK) {
 		return status;
 	}
+
+	as_near_cache_invalidate_key(as->cluster, key);
 		
 	as_bin* bins = rec->bins.entries;
 	uint32_t n_bins = rec->bins.size;
@@ -477,7 +527,7 @@ aerospike_key_put_async_ex(
 				event_loop, pipe_listener, size, as_event_command_parse_header);
 		
 		uint8_t* p = as_command_write_header(cmd->buf, 0, AS_MSG_INFO2_WRITE, policy->commit_level, 0,
-				false, policy->exists, policy->gen, rec->gen, rec->ttl, policy->base.total_timeout,
+				false, policy->exists, policy->gen, rec->gen, rec->ttl, as_policy_server_timeout(&policy->base),
 				n_fields, n_bins, policy->durable_delete);
 		
 		p = as_command_write_key(p, policy->key, key);
@@ -502,7 +552,7 @@ aerospike_key_put_async_ex(
 		// First write uncompressed buffer.
 		uint8_t* cmd = as_command_init(size);
 		uint8_t* p = as_command_write_header(cmd, 0, AS_MSG_INFO2_WRITE, policy->commit_level, 0,
-				false, policy->exists, policy->gen, rec->gen, rec->ttl, policy->base.total_timeout,
+				false, policy->exists, policy->gen, rec->gen, rec->ttl, as_policy_server_timeout(&policy->base),
 				n_fields, n_bins, policy->durable_delete);
 		
 		p = as_command_write_key(p, policy->key, key);
@@ -569,25 +619,29 @@ aerospike_key_remove(
 		return status;
 	}
 
+	as_near_cache_invalidate_key(as->cluster, key);
+
 	uint16_t n_fields;
 	size_t size = as_command_key_size(policy->key, key, &n_fields);
 		
 	uint8_t* cmd = as_command_init(size);
 	uint8_t* p = as_command_write_header(cmd, 0, AS_MSG_INFO2_WRITE | AS_MSG_INFO2_DELETE,
 					policy->commit_level, 0, false, AS_POLICY_EXISTS_IGNORE, policy->gen,
-					policy->generation, 0, policy->base.total_timeout, n_fields, 0,
+					policy->generation, 0, as_policy_server_timeout(&policy->base), n_fields, 0,
 					policy->durable_delete);
 
 	p = as_command_write_key(p, policy->key, key);
 	size = as_command_write_end(cmd, p);
 
 	as_command_node cn;
-	as_command_node_init(&cn, key->ns, key->digest.value, AS_POLICY_REPLICA_MASTER);
+	as_command_node_init(&cn, key, AS_POLICY_REPLICA_MASTER);
 	
 	as_proto_msg msg;
 	status = as_command_execute(as->cluster, err, &policy->base, &cn, cmd, size, as_command_parse_header, &msg, false);
 	
 	as_command_free(cmd, size);
+	as_near_cache_invalidate_key(as->cluster, key);
+	as_single_flight_invalidate_key(as->cluster, key);
 	return status;
 }
 
@@ -603,12 +657,14 @@ aerospike_key_remove_async_ex(
 	}
 	
 	void* partition;
-	uint8_t flags = AS_ASYNC_FLAGS_MASTER;
+	uint8_t flags = 0;
 	as_status status = as_event_command_init(as->cluster, err, key, &partition, &flags);
 
 	if (status != AEROSPIKE_OK) {
 		return status;
 	}
+
+	as_near_cache_invalidate_key(as->cluster, key);
 	
 	uint16_t n_fields;
 	size_t size = as_command_key_size(policy->key, key, &n_fields);
@@ -619,7 +675,7 @@ aerospike_key_remove_async_ex(
 
 	uint8_t* p = as_command_write_header(cmd->buf, 0, AS_MSG_INFO2_WRITE | AS_MSG_INFO2_DELETE,
 						policy->commit_level, 0, false, AS_POLICY_EXISTS_IGNORE, policy->gen,
-						policy->generation, 0, policy->base.total_timeout, n_fields, 0,
+						policy->generation, 0, as_policy_server_timeout(&policy->base), n_fields, 0,
 						policy->durable_delete);
 	
 	p = as_command_write_key(p, policy->key, key);
@@ -727,13 +783,17 @@ aerospike_key_operate(
 		}
 	}
 
+	if (write_attr & AS_MSG_INFO2_WRITE) {
+		as_near_cache_invalidate_key(as->cluster, key);
+	}
+
 	uint16_t n_fields;
 	size += as_command_key_size(policy->key, key, &n_fields);
 
 	uint8_t* cmd = as_command_init(size);
 	uint8_t* p = as_command_write_header(cmd, read_attr, write_attr, policy->commit_level,
 				policy->consistency_level, policy->linearize_read, AS_POLICY_EXISTS_IGNORE,
-				policy->gen, ops->gen, ops->ttl, policy->base.total_timeout, n_fields, n_operations,
+				policy->gen, ops->gen, ops->ttl, as_policy_server_timeout(&policy->base), n_fields, n_operations,
 				policy->durable_delete);
 
 	p = as_command_write_key(p, policy->key, key);
@@ -746,7 +806,7 @@ aerospike_key_operate(
 	size = as_command_write_end(cmd, p);
 
 	as_command_node cn;
-	as_command_node_init(&cn, key->ns, key->digest.value, write_attr ? AS_POLICY_REPLICA_MASTER : policy->replica);
+	as_command_node_init(&cn, key, write_attr ? AS_POLICY_REPLICA_MASTER : policy->replica);
 	
 	as_command_parse_result_data data;
 	data.record = rec;
@@ -755,6 +815,11 @@ aerospike_key_operate(
 	status = as_command_execute(as->cluster, err, &policy->base, &cn, cmd, size, as_command_parse_result, &data, false);
 	
 	as_command_free(cmd, size);
+
+	if (write_attr & AS_MSG_INFO2_WRITE) {
+		as_near_cache_invalidate_key(as->cluster, key);
+		as_single_flight_invalidate_key(as->cluster, key);
+	}
 	return status;
 }
 
@@ -796,7 +861,7 @@ aerospike_key_operate_async(
 	size += as_command_key_size(policy->key, key, &n_fields);
 
 	void* partition;
-	uint8_t flags = AS_ASYNC_FLAGS_MASTER;
+	uint8_t flags = 0;
 	as_status status = as_event_command_init(as->cluster, err, key, &partition, &flags);
 
 	if (status != AEROSPIKE_OK) {
@@ -810,13 +875,17 @@ aerospike_key_operate_async(
 		return status;
 	}
 
+	if (write_attr & AS_MSG_INFO2_WRITE) {
+		as_near_cache_invalidate_key(as->cluster, key);
+	}
+
 	as_event_command* cmd = as_async_record_command_create(
 		as->cluster, &policy->base, policy->replica, partition, policy->deserialize, flags,
 		listener, udata, event_loop, pipe_listener, size, as_event_command_parse_result);
 
 	uint8_t* p = as_command_write_header(cmd->buf, read_attr, write_attr, policy->commit_level,
 		policy->consistency_level, policy->linearize_read, AS_POLICY_EXISTS_IGNORE, policy->gen,
-		ops->gen, ops->ttl, policy->base.total_timeout, n_fields, n_operations,
+		ops->gen, ops->ttl, as_policy_server_timeout(&policy->base), n_fields, n_operations,
 		policy->durable_delete);
 
 	p = as_command_write_key(p, policy->key, key);
@@ -829,6 +898,340 @@ aerospike_key_operate_async(
 	return as_event_command_execute(cmd, err);
 }
 
+static void
+as_prepared_locate(uint8_t* begin, uint8_t* end, uint32_t header_size, uint8_t type, as_prepared_value* pv, uint8_t* cmd)
+{
+	pv->offset = (uint32_t)(begin + header_size - cmd);
+	pv->size = (uint32_t)(end - begin - header_size);
+	pv->type = type;
+}
+
+static as_status
+as_prepared_init(
+	as_error* err, as_prepared* prep, const as_policy_base* base, as_policy_key key_policy,
+	const as_key* key, uint32_t n_values
+	)
+{
+	as_status status = as_key_set_digest(err, (as_key*)key);
+
+	if (status != AEROSPIKE_OK) {
+		return status;
+	}
+
+	if (key_policy == AS_POLICY_KEY_SEND && key->valuep) {
+		as_val* val = (as_val*)key->valuep;
+
+		if (val->type != AS_INTEGER && val->type != AS_DOUBLE && val->type != AS_STRING && val->type != AS_BYTES) {
+			return as_error_set_message(err, AEROSPIKE_ERR_PARAM, "Invalid prepared user key type");
+		}
+	}
+
+	memset(prep, 0, sizeof(as_prepared));
+	as_strncpy(prep->ns, key->ns, AS_NAMESPACE_MAX_SIZE);
+	as_strncpy(prep->set, key->set, AS_SET_MAX_SIZE);
+	prep->base = *base;
+	prep->n_values = n_values;
+	prep->values = cf_malloc(sizeof(as_prepared_value) * n_values);
+	return AEROSPIKE_OK;
+}
+
+static uint8_t*
+as_prepared_write_key(as_prepared* prep, uint8_t* p, as_policy_key key_policy, const as_key* key)
+{
+	uint8_t* cmd = prep->buf;
+	uint8_t* digest = p + strlen(key->ns) + strlen(key->set) + (AS_FIELD_HEADER_SIZE * 3);
+	prep->digest_offset = (uint32_t)(digest - cmd);
+	p = as_command_write_key(p, key_policy, key);
+
+	uint8_t* begin = digest + AS_DIGEST_VALUE_SIZE;
+
+	if (p > begin) {
+		// User key field data starts with the particle type.
+		as_prepared_locate(begin, p, AS_FIELD_HEADER_SIZE + 1, begin[AS_FIELD_HEADER_SIZE], &prep->key, cmd);
+	}
+	return p;
+}
+
+static uint8_t*
+as_prepared_write_bin(as_prepared* prep, uint32_t i, uint8_t* p, uint8_t operation_type, const as_bin* bin, as_buffer* buffer)
+{
+	uint8_t* begin = p;
+	p = as_command_write_bin(p, operation_type, bin, buffer);
+	// Operation header is size (4), operation (1), particle type (1), version (1), name length (1).
+	as_prepared_locate(begin, p, AS_OPERATION_HEADER_SIZE + begin[7], begin[5], &prep->values[i], prep->buf);
+	return p;
+}
+
+static as_status
+as_prepared_patch(as_error* err, uint8_t* cmd, const as_prepared_value* pv, as_val* val)
+{
+	uint8_t* p = cmd + pv->offset;
+
+	switch (val->type) {
+		case AS_INTEGER: {
+			if (pv->type != AS_BYTES_INTEGER) {
+				break;
+			}
+			*(uint64_t*)p = cf_swap_to_be64(as_integer_fromval(val)->value);
+			return AEROSPIKE_OK;
+		}
+		case AS_DOUBLE: {
+			if (pv->type != AS_BYTES_DOUBLE) {
+				break;
+			}
+			*(double*)p = cf_swap_to_big_float64(as_double_fromval(val)->value);
+			return AEROSPIKE_OK;
+		}
+		case AS_STRING: {
+			as_string* v = as_string_fromval(val);
+
+			if (pv->type != AS_BYTES_STRING || as_string_len(v) != pv->size) {
+				break;
+			}
+			memcpy(p, v->value, pv->size);
+			return AEROSPIKE_OK;
+		}
+		case AS_BYTES: {
+			as_bytes* v = as_bytes_fromval(val);
+
+			if (pv->type != v->type || v->size != pv->size) {
+				break;
+			}
+			memcpy(p, v->value, pv->size);
+			return AEROSPIKE_OK;
+		}
+		default: {
+			break;
+		}
+	}
+	return as_error_update(err, AEROSPIKE_ERR_PARAM,
+		"Value type %d does not match prepared particle type %u size %u", val->type, pv->type, pv->size);
+}
+
+as_status
+aerospike_prepare_put(
+	aerospike* as, as_error* err, const as_policy_write* policy, const as_key* key, as_record* rec,
+	as_prepared* prep
+	)
+{
+	as_error_reset(err);
+
+	if (! policy) {
+		policy = &as->config.policies.write;
+	}
+
+	as_bin* bins = rec->bins.entries;
+	uint32_t n_bins = rec->bins.size;
+	as_status status = as_prepared_init(err, prep, &policy->base, policy->key, key, n_bins);
+
+	if (status != AEROSPIKE_OK) {
+		return status;
+	}
+
+	as_buffer* buffers = (as_buffer*)alloca(sizeof(as_buffer) * n_bins);
+
+	uint16_t n_fields;
+	size_t size = as_command_key_size(policy->key, key, &n_fields);
+	memset(buffers, 0, sizeof(as_buffer) * n_bins);
+
+	for (uint32_t i = 0; i < n_bins; i++) {
+		size += as_command_bin_size(&bins[i], &buffers[i]);
+	}
+
+	prep->buf = cf_malloc(size);
+	prep->compression_threshold = policy->compression_threshold;
+	prep->replica = AS_POLICY_REPLICA_MASTER;
+	prep->write = true;
+
+	uint8_t* p = as_command_write_header(prep->buf, 0, AS_MSG_INFO2_WRITE, policy->commit_level, 0,
+					false, policy->exists, policy->gen, rec->gen, rec->ttl, as_policy_server_timeout(&policy->base),
+					n_fields, n_bins, policy->durable_delete);
+
+	p = as_prepared_write_key(prep, p, policy->key, key);
+
+	for (uint32_t i = 0; i < n_bins; i++) {
+		p = as_prepared_write_bin(prep, i, p, AS_OPERATOR_WRITE, &bins[i], &buffers[i]);
+	}
+	prep->size = as_command_write_end(prep->buf, p);
+	return AEROSPIKE_OK;
+}
+
+as_status
+aerospike_prepare_operate(
+	aerospike* as, as_error* err, const as_policy_operate* policy, const as_key* key,
+	const as_operations* ops, as_prepared* prep
+	)
+{
+	as_error_reset(err);
+
+	uint32_t n_operations = ops->binops.size;
+
+	if (n_operations == 0) {
+		return as_error_set_message(err, AEROSPIKE_ERR_PARAM, "No operations defined");
+	}
+
+	as_buffer* buffers = (as_buffer*)alloca(sizeof(as_buffer) * n_operations);
+	memset(buffers, 0, sizeof(as_buffer) * n_operations);
+
+	uint8_t read_attr;
+	uint8_t write_attr;
+	size_t size = as_operate_set_attr(ops, buffers, &read_attr, &write_attr);
+
+	as_policy_operate policy_local;
+
+	if (! policy) {
+		if (write_attr & AS_MSG_INFO2_WRITE) {
+			// Write operations should not retry by default.
+			policy = &as->config.policies.operate;
+		}
+		else {
+			// Read operations should retry by default.
+			as_policy_operate_copy(&as->config.policies.operate, &policy_local);
+			policy_local.base.max_retries = 2;
+			policy = &policy_local;
+		}
+	}
+
+	as_status status = as_prepared_init(err, prep, &policy->base, policy->key, key, n_operations);
+
+	if (status != AEROSPIKE_OK) {
+		for (uint32_t i = 0; i < n_operations; i++) {
+			cf_free(buffers[i].data);
+		}
+		return status;
+	}
+
+	uint16_t n_fields;
+	size += as_command_key_size(policy->key, key, &n_fields);
+
+	prep->buf = cf_malloc(size);
+	prep->replica = policy->replica;
+	prep->deserialize = policy->deserialize;
+	prep->write = write_attr != 0;
+	prep->operate = true;
+
+	uint8_t* p = as_command_write_header(prep->buf, read_attr, write_attr, policy->commit_level,
+				policy->consistency_level, policy->linearize_read, AS_POLICY_EXISTS_IGNORE,
+				policy->gen, ops->gen, ops->ttl, as_policy_server_timeout(&policy->base), n_fields, n_operations,
+				policy->durable_delete);
+
+	p = as_prepared_write_key(prep, p, policy->key, key);
+
+	for (uint32_t i = 0; i < n_operations; i++) {
+		as_binop* op = &ops->binops.entries[i];
+		p = as_prepared_write_bin(prep, i, p, op->op, &op->bin, &buffers[i]);
+	}
+	prep->size = as_command_write_end(prep->buf, p);
+	return AEROSPIKE_OK;
+}
+
+as_status
+aerospike_prepared_execute(
+	aerospike* as, as_error* err, const as_prepared* prep, const as_key* key, as_val** values,
+	uint32_t ttl, as_record** rec
+	)
+{
+	as_error_reset(err);
+
+	// Namespace and set are written in the template, so the key must match them.
+	if (strcmp(key->ns, prep->ns) != 0 || strcmp(key->set, prep->set) != 0) {
+		return as_error_update(err, AEROSPIKE_ERR_PARAM,
+			"Key namespace/set %s/%s does not match prepared command %s/%s",
+			key->ns, key->set, prep->ns, prep->set);
+	}
+
+	// Template user key would otherwise be stored with the new digest.
+	if (prep->key.size && ! key->valuep) {
+		return as_error_set_message(err, AEROSPIKE_ERR_PARAM,
+			"Prepared command sends user key, but key has no value");
+	}
+
+	as_status status = as_key_set_digest(err, (as_key*)key);
+
+	if (status != AEROSPIKE_OK) {
+		return status;
+	}
+
+	// Copy template so concurrent executions do not share a buffer.
+	size_t size = prep->size;
+	uint8_t* cmd = as_command_init(size);
+	memcpy(cmd, prep->buf, size);
+	memcpy(cmd + prep->digest_offset, key->digest.value, AS_DIGEST_VALUE_SIZE);
+	*(uint32_t*)&cmd[18] = cf_swap_to_be32(ttl);
+	// Server timeout is reset per execution, as as_command_execute() does on retry.
+	*(uint32_t*)&cmd[22] = cf_swap_to_be32(as_policy_server_timeout(&prep->base));
+
+	if (prep->key.size) {
+		status = as_prepared_patch(err, cmd, &prep->key, (as_val*)key->valuep);
+
+		if (status != AEROSPIKE_OK) {
+			as_command_free(cmd, size);
+			return status;
+		}
+	}
+
+	if (values) {
+		for (uint32_t i = 0; i < prep->n_values; i++) {
+			if (values[i]) {
+				status = as_prepared_patch(err, cmd, &prep->values[i], values[i]);
+
+				if (status != AEROSPIKE_OK) {
+					as_command_free(cmd, size);
+					return status;
+				}
+			}
+		}
+	}
+
+	if (prep->write) {
+		as_near_cache_invalidate_key(as->cluster, key);
+	}
+
+	as_command_node cn;
+	as_command_node_init(&cn, key, prep->write ? AS_POLICY_REPLICA_MASTER : prep->replica);
+
+	if (prep->operate) {
+		as_command_parse_result_data data;
+		data.record = rec;
+		data.deserialize = prep->deserialize;
+
+		status = as_command_execute(as->cluster, err, &prep->base, &cn, cmd, size, as_command_parse_result, &data, false);
+	}
+	else if (prep->compression_threshold == 0 || (size <= prep->compression_threshold)) {
+		as_proto_msg msg;
+		status = as_command_execute(as->cluster, err, &prep->base, &cn, cmd, size, as_command_parse_header, &msg, false);
+	}
+	else {
+		// Send compressed command.
+		as_proto_msg msg;
+		size_t comp_capacity = as_command_compress_max_size(size);
+		size_t comp_size = comp_capacity;
+		uint8_t* comp_cmd = as_command_init(comp_capacity);
+		status = as_command_compress(err, cmd, size, comp_cmd, &comp_size);
+
+		if (status == AEROSPIKE_OK) {
+			status = as_command_execute(as->cluster, err, &prep->base, &cn, comp_cmd, comp_size, as_command_parse_header, &msg, false);
+		}
+		as_command_free(comp_cmd, comp_capacity);
+	}
+	as_command_free(cmd, size);
+
+	if (prep->write) {
+		as_near_cache_invalidate_key(as->cluster, key);
+		as_single_flight_invalidate_key(as->cluster, key);
+	}
+	return status;
+}
+
+void
+as_prepared_destroy(as_prepared* prep)
+{
+	cf_free(prep->buf);
+	cf_free(prep->values);
+	prep->buf = NULL;
+	prep->values = NULL;
+}
+
 as_status
 aerospike_key_apply(
 	aerospike* as, as_error* err, const as_policy_apply* policy, const as_key* key,
@@ -846,6 +1249,8 @@ aerospike_key_apply(
 	if (status != AEROSPIKE_OK) {
 		return status;
 	}
+
+	as_near_cache_invalidate_key(as->cluster, key);
 	
 	uint16_t n_fields;
 	size_t size = as_command_key_size(policy->key, key, &n_fields);
@@ -863,7 +1268,7 @@ aerospike_key_apply(
 	uint8_t* cmd = as_command_init(size);
 	uint8_t* p = as_command_write_header(cmd, 0, AS_MSG_INFO2_WRITE, policy->commit_level, 0,
 		policy->linearize_read, 0, policy->gen, policy->gen_value, policy->ttl,
-		policy->base.total_timeout, n_fields, 0, policy->durable_delete);
+		as_policy_server_timeout(&policy->base), n_fields, 0, policy->durable_delete);
 
 	p = as_command_write_key(p, policy->key, key);
 	p = as_command_write_field_string(p, AS_FIELD_UDF_PACKAGE_NAME, module);
@@ -872,13 +1277,15 @@ aerospike_key_apply(
 	size = as_command_write_end(cmd, p);
 	
 	as_command_node cn;
-	as_command_node_init(&cn, key->ns, key->digest.value, AS_POLICY_REPLICA_MASTER);
+	as_command_node_init(&cn, key, AS_POLICY_REPLICA_MASTER);
 	
 	status = as_command_execute(as->cluster, err, &policy->base, &cn, cmd, size, as_command_parse_success_failure, result, false);
 	
 	as_command_free(cmd, size);
 	as_buffer_destroy(&args);
 	as_serializer_destroy(&ser);
+	as_near_cache_invalidate_key(as->cluster, key);
+	as_single_flight_invalidate_key(as->cluster, key);
 	return status;
 }
 
@@ -895,12 +1302,14 @@ aerospike_key_apply_async(
 	}
 	
 	void* partition;
-	uint8_t flags = AS_ASYNC_FLAGS_MASTER;
+	uint8_t flags = 0;
 	as_status status = as_event_command_init(as->cluster, err, key, &partition, &flags);
 
 	if (status != AEROSPIKE_OK) {
 		return status;
 	}
+
+	as_near_cache_invalidate_key(as->cluster, key);
 	
 	uint16_t n_fields;
 	size_t size = as_command_key_size(policy->key, key, &n_fields);
@@ -921,7 +1330,7 @@ aerospike_key_apply_async(
 
 	uint8_t* p = as_command_write_header(cmd->buf, 0, AS_MSG_INFO2_WRITE, policy->commit_level, 0,
 		policy->linearize_read, 0, policy->gen, policy->gen_value, policy->ttl,
-		policy->base.total_timeout, n_fields, 0, policy->durable_delete);
+		as_policy_server_timeout(&policy->base), n_fields, 0, policy->durable_delete);
 
 	p = as_command_write_key(p, policy->key, key);
 	p = as_command_write_field_string(p, AS_FIELD_UDF_PACKAGE_NAME, module);
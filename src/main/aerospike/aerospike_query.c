@@ -61,6 +61,7 @@ typedef struct as_query_task_s {
 	as_error* err;
 	cf_queue* input_queue;
 	cf_queue* complete_q;
+	cf_queue* partial_q;
 	uint64_t task_id;
 	
 	uint8_t* cmd;
@@ -187,6 +188,89 @@ static const as_stream_hooks output_stream_hooks = {
     .write    = as_output_stream_write
 };
 
+// Per-node aggregation writes partial results to the shared partial queue.  The end of stream
+// marker written by each node's lua stream is dropped.  The marker for the final reduce is
+// pushed only after all nodes have completed.
+static as_stream_status
+as_partial_stream_write(const as_stream* s, as_val* val)
+{
+	if (! val) {
+		return AS_STREAM_OK;
+	}
+	return as_input_stream_write(s, val);
+}
+
+static const as_stream_hooks partial_stream_hooks = {
+    .destroy  = as_input_stream_destroy,
+    .read     = NULL,
+    .write    = as_partial_stream_write
+};
+
+static void
+as_query_queue_destroy(cf_queue* queue)
+{
+	as_val* val = NULL;
+
+	while (cf_queue_pop(queue, &val, CF_QUEUE_NOWAIT) == CF_QUEUE_OK) {
+		as_val_destroy(val);
+	}
+	cf_queue_destroy(queue);
+}
+
+static as_status
+as_query_apply_stream(
+	const as_query* query, as_stream* input_stream, as_stream* output_stream, uint32_t* error_mutex,
+	as_error* err
+	)
+{
+	// Setup as_aerospike, so we can get log() function.
+	as_aerospike as;
+	as_aerospike_init(&as, NULL, &query_aerospike_hooks);
+	
+	as_udf_context ctx = {
+		.as = &as,
+		.timer = NULL,
+		.memtracker = NULL
+	};
+
+	// Apply the UDF to the result stream
+	as_result res;
+	as_result_init(&res);
+	
+	as_status status = as_module_apply_stream(&mod_lua, &ctx, query->apply.module, query->apply.function, input_stream, query->apply.arglist, output_stream, &res);
+	
+	if (status) {
+		// Aggregation failed. Abort entire query.
+		if (as_fas_uint32(error_mutex, 1) == 0) {
+			char* rs = as_module_err_string(status);
+			
+			if (res.value) {
+				switch (as_val_type(res.value)) {
+					case AS_STRING: {
+						as_string* lua_s = as_string_fromval(res.value);
+						char* lua_err  = (char*)as_string_tostring(lua_s);
+						status = as_error_update(err, AEROSPIKE_ERR_UDF, "%s : %s", rs, lua_err);
+						break;
+					}
+						
+					default:
+						status = as_error_update(err, AEROSPIKE_ERR_UDF, "%s : Unknown stack as_val type", rs);
+						break;
+				}
+			}
+			else {
+				status = as_error_set_message(err, AEROSPIKE_ERR_UDF, rs);
+			}
+			cf_free(rs);
+		}
+		else {
+			status = AEROSPIKE_ERR_UDF;
+		}
+	}
+	as_result_destroy(&res);
+	return status;
+}
+
 static void
 as_query_complete_async(as_event_executor* executor)
 {
@@ -370,7 +454,7 @@ as_query_parse_records(uint8_t* buf, size_t size, as_query_task* task, as_error*
 }
 
 static as_status
-as_query_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout, uint64_t deadline_ms, void* udata)
+as_query_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* udata)
 {
 	as_query_task* task = udata;
 	as_status status = AEROSPIKE_OK;
@@ -380,7 +464,7 @@ as_query_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_ti
 	while (true) {
 		// Read header
 		as_proto proto;
-		status = as_socket_read_deadline(err, sock, node, (uint8_t*)&proto, sizeof(as_proto), socket_timeout, deadline_ms);
+		status = as_socket_read_deadline_us(err, sock, node, (uint8_t*)&proto, sizeof(as_proto), socket_timeout_us, deadline_us);
 		
 		if (status) {
 			break;
@@ -397,7 +481,7 @@ as_query_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_ti
 			}
 			
 			// Read remaining message bytes in group
-			status = as_socket_read_deadline(err, sock, node, buf, size, socket_timeout, deadline_ms);
+			status = as_socket_read_deadline_us(err, sock, node, buf, size, socket_timeout_us, deadline_us);
 			
 			if (status) {
 				break;
@@ -456,6 +540,39 @@ as_query_command_execute(as_query_task* task)
 	return status;
 }
 
+static as_status
+as_query_node_execute(as_query_task* task)
+{
+	if (! task->partial_q) {
+		return as_query_command_execute(task);
+	}
+
+	// Buffer this node's aggregate results and then run the stream function over them
+	// in this thread.  Partial results are combined after all nodes have completed.
+	cf_queue* node_q = cf_queue_create(sizeof(void*), false);
+
+	as_stream node_stream;
+	as_stream_init(&node_stream, node_q, &input_stream_hooks);
+
+	task->input_queue = node_q;
+	task->callback = as_query_aggregate_callback;
+	task->udata = &node_stream;
+
+	as_status status = as_query_command_execute(task);
+
+	if (status == AEROSPIKE_OK) {
+		as_stream_write(&node_stream, AS_STREAM_END);
+
+		as_stream partial_stream;
+		as_stream_init(&partial_stream, task->partial_q, &partial_stream_hooks);
+
+		status = as_query_apply_stream(task->query, &node_stream, &partial_stream,
+									   task->error_mutex, task->err);
+	}
+	as_query_queue_destroy(node_q);
+	return status;
+}
+
 static void
 as_query_worker(void* data)
 {
@@ -464,7 +581,7 @@ as_query_worker(void* data)
 	as_query_complete_task complete_task;
 	complete_task.node = task->node;
 	complete_task.task_id = task->task_id;
-	complete_task.result = as_query_command_execute(task);
+	complete_task.result = as_query_node_execute(task);
 		
 	cf_queue_push(task->complete_q, &complete_task);
 }
@@ -829,7 +946,7 @@ as_query_execute(as_query_task* task, const as_query* query, as_nodes* nodes, ui
 	uint32_t predexp_size = 0;
 	uint32_t bin_name_size = 0;
 	uint16_t n_fields = 0;
-	uint32_t timeout = (task->query_policy)? task->query_policy->base.total_timeout : task->write_policy->base.total_timeout;
+	uint32_t timeout = (task->query_policy)? as_policy_server_timeout(&task->query_policy->base) : as_policy_server_timeout(&task->write_policy->base);
 	
 	size_t size = as_query_command_size(query, &n_fields, &argbuffer, &filter_size, &predexp_size, &bin_name_size);
 	uint8_t* cmd = as_command_init(size);
@@ -869,7 +986,7 @@ as_query_execute(as_query_task* task, const as_query* query, as_nodes* nodes, ui
 
 			AEROSPIKE_QUERY_ENQUEUE_TASK(task->task_id, task_node->node->name);
 		} else {
-			if ((status = as_query_command_execute(task_node)) != AEROSPIKE_OK) {
+			if ((status = as_query_node_execute(task_node)) != AEROSPIKE_OK) {
 				break;
 			}
 		}
@@ -912,55 +1029,14 @@ static void
 as_query_aggregate(void* data)
 {
 	as_query_task_aggr* task = (as_query_task_aggr*)data;
-	const as_query* query = task->query;
-	
-	// Setup as_aerospike, so we can get log() function.
-	as_aerospike as;
-	as_aerospike_init(&as, NULL, &query_aerospike_hooks);
-	
-	as_udf_context ctx = {
-		.as = &as,
-		.timer = NULL,
-		.memtracker = NULL
-	};
 
 	// The callback stream provides the ability to write to a user callback function
 	// when as_stream_write is called.
 	as_stream output_stream;
 	as_stream_init(&output_stream, task->callback_data, &output_stream_hooks);
-	
-	// Apply the UDF to the result stream
-	as_result res;
-	as_result_init(&res);
-	
-	as_status status = as_module_apply_stream(&mod_lua, &ctx, query->apply.module, query->apply.function, task->input_stream, query->apply.arglist, &output_stream, &res);
-	
-	if (status) {
-		// Aggregation failed. Abort entire query.
-		if (as_fas_uint32(task->error_mutex, 1) == 0) {
-			char* rs = as_module_err_string(status);
-			
-			if (res.value) {
-				switch (as_val_type(res.value)) {
-					case AS_STRING: {
-						as_string* lua_s = as_string_fromval(res.value);
-						char* lua_err  = (char*)as_string_tostring(lua_s);
-						status = as_error_update(task->err, AEROSPIKE_ERR_UDF, "%s : %s", rs, lua_err);
-						break;
-					}
-						
-					default:
-						status = as_error_update(task->err, AEROSPIKE_ERR_UDF, "%s : Unknown stack as_val type", rs);
-						break;
-				}
-			}
-			else {
-				status = as_error_set_message(task->err, AEROSPIKE_ERR_UDF, rs);
-			}
-			cf_free(rs);
-		}
-	}
-	as_result_destroy(&res);
+
+	as_status status = as_query_apply_stream(task->query, task->input_stream, &output_stream,
+											 task->error_mutex, task->err);
 	cf_queue_push(task->complete_q, &status);
 }
 
@@ -1009,6 +1085,7 @@ aerospike_query_foreach(
 		.err = err,
 		.input_queue = 0,
 		.complete_q = 0,
+		.partial_q = 0,
 		.task_id = as_random_get_uint64(),
 		.cmd = 0,
 		.cmd_size = 0
@@ -1016,7 +1093,29 @@ aerospike_query_foreach(
 	
 	AEROSPIKE_QUERY_FOREACH_STARTING(task.task_id);
 
-	if (query->apply.function[0]) {
+	if (query->apply.function[0] && policy->parallel_aggregate) {
+		// Query with aggregation applied in each node's thread.
+		task.partial_q = cf_queue_create(sizeof(void*), true);
+		status = as_query_execute(&task, query, nodes, n_nodes, QUERY_FOREGROUND);
+
+		if (status == AEROSPIKE_OK) {
+			// Combine partial results from all nodes.
+			as_stream partial_stream;
+			as_stream_init(&partial_stream, task.partial_q, &input_stream_hooks);
+			as_stream_write(&partial_stream, AS_STREAM_END);
+
+			as_query_user_callback callback_data;
+			callback_data.callback = callback;
+			callback_data.udata = udata;
+
+			as_stream output_stream;
+			as_stream_init(&output_stream, &callback_data, &output_stream_hooks);
+
+			status = as_query_apply_stream(query, &partial_stream, &output_stream, &error_mutex, err);
+		}
+		as_query_queue_destroy(task.partial_q);
+	}
+	else if (query->apply.function[0]) {
 		// Query with aggregation.
 		task.input_queue = cf_queue_create(sizeof(void*), true);
 		
@@ -1060,11 +1159,7 @@ aerospike_query_foreach(
 		cf_queue_destroy(task_aggr.complete_q);
 		
 		// Empty input queue.
-        as_val* val = NULL;
-        while (cf_queue_pop(task.input_queue, &val, CF_QUEUE_NOWAIT) == CF_QUEUE_OK) {
-            as_val_destroy(val);
-        }
-        cf_queue_destroy(task.input_queue);
+		as_query_queue_destroy(task.input_queue);
 	}
 	else {
 		// Normal query without aggregation.
@@ -1122,7 +1217,7 @@ aerospike_query_async(
 	as_async_query_executor* executor = cf_malloc(sizeof(as_async_query_executor));
 	as_event_executor* exec = &executor->executor;
 	pthread_mutex_init(&exec->lock, NULL);
-	exec->event_loop = as_event_assign(event_loop);
+	exec->event_loop = as_event_assign(as->cluster, event_loop);
 	exec->complete_fn = as_query_complete_async;
 	exec->udata = udata;
 	exec->err = NULL;
@@ -1142,20 +1237,25 @@ aerospike_query_async(
 	
 	size_t size = as_query_command_size(query, &n_fields, &argbuffer, &filter_size, &predexp_size, &bin_name_size);
 	uint8_t* cmd_buf = as_command_init(size);
-	size = as_query_command_init(cmd_buf, query, QUERY_FOREGROUND, NULL, task_id, policy->base.total_timeout,
+	size = as_query_command_init(cmd_buf, query, QUERY_FOREGROUND, NULL, task_id, as_policy_server_timeout(&policy->base),
 								 n_fields, filter_size, predexp_size, bin_name_size, &argbuffer);
 	
-	// Allocate enough memory to cover, then, round up memory size in 8KB increments to allow socket
-	// read to reuse buffer.
-	size_t s = (sizeof(as_async_query_command) + size + AS_AUTHENTICATION_MAX_SIZE + 8191) & ~8191;
+	// Allocate enough memory to cover, at least 8KB.  Buffer pool rounds up to the next size
+	// class, which allows socket read to reuse buffer.
+	size_t s = sizeof(as_async_query_command) + size + AS_AUTHENTICATION_MAX_SIZE;
+
+	if (s < 8192 - AS_COMMAND_POOL_HEADER_SIZE) {
+		s = 8192 - AS_COMMAND_POOL_HEADER_SIZE;
+	}
 	
 	as_status status = AEROSPIKE_OK;
 
 	// Create all query commands.
 	for (uint32_t i = 0; i < n_nodes; i++) {
-		as_event_command* cmd = cf_malloc(s);
-		cmd->total_deadline = policy->base.total_timeout;
-		cmd->socket_timeout = policy->base.socket_timeout;
+		size_t capacity;
+		as_event_command* cmd = as_command_pool_alloc(s, &capacity);
+		cmd->total_deadline = as_policy_total_timeout_us(&policy->base);
+		cmd->socket_timeout = as_policy_socket_timeout_us(&policy->base);
 		cmd->max_retries = policy->base.max_retries;
 		cmd->iteration = 0;
 		cmd->replica = AS_POLICY_REPLICA_MASTER;
@@ -1168,10 +1268,11 @@ aerospike_query_async(
 		cmd->pipe_listener = NULL;
 		cmd->buf = ((as_async_query_command*)cmd)->space;
 		cmd->write_len = (uint32_t)size;
-		cmd->read_capacity = (uint32_t)(s - size - sizeof(as_async_query_command));
+		cmd->read_capacity = (uint32_t)(capacity - size - sizeof(as_async_query_command));
 		cmd->type = AS_ASYNC_TYPE_QUERY;
 		cmd->state = AS_ASYNC_STATE_UNREGISTERED;
-		cmd->flags = AS_ASYNC_FLAGS_MASTER;
+		cmd->flags = 0;
+		cmd->replica_index = 0;
 		cmd->deserialize = policy->deserialize;
 		memcpy(cmd->buf, cmd_buf, size);
 		
@@ -1246,6 +1347,7 @@ aerospike_query_background(
 		.err = err,
 		.input_queue = 0,
 		.complete_q = 0,
+		.partial_q = 0,
 		.task_id = task_id,
 		.cmd = 0,
 		.cmd_size = 0
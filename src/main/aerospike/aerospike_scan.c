@@ -17,6 +17,7 @@
 #include <aerospike/aerospike_scan.h>
 #include <aerospike/aerospike_info.h>
 #include <aerospike/as_async.h>
+#include <aerospike/as_column_batch.h>
 #include <aerospike/as_command.h>
 #include <aerospike/as_job.h>
 #include <aerospike/as_key.h>
@@ -33,6 +34,14 @@
  * TYPES
  *****************************************************************************/
 
+typedef struct as_scan_columns_s {
+	const as_column_def* defs;
+	uint32_t n_defs;
+	uint32_t batch_size;
+	aerospike_scan_columns_callback callback;
+	void* udata;
+} as_scan_columns;
+
 typedef struct as_scan_task_s {
 	as_node* node;
 	
@@ -41,6 +50,8 @@ typedef struct as_scan_task_s {
 	const as_scan* scan;
 	aerospike_scan_foreach_callback callback;
 	void* udata;
+	const as_scan_columns* columns;
+	as_column_batch* batch;
 	as_error* err;
 	cf_queue* complete_q;
 	uint32_t* error_mutex;
@@ -148,9 +159,77 @@ as_scan_parse_records_async(as_event_command* cmd)
 	return false;
 }
 
+static as_status
+as_scan_parse_columns(uint8_t** pp, as_msg* msg, as_scan_task* task, as_error* err)
+{
+	// Decode bins directly into column buffers without creating as_record/as_val objects.
+	as_column_batch* batch = task->batch;
+	uint32_t row = batch->size;
+	uint8_t* p = as_command_ignore_fields(*pp, msg->n_fields);
+
+	for (uint32_t i = 0; i < msg->n_ops; i++) {
+		uint32_t op_size = cf_swap_from_be32(*(uint32_t*)p);
+		p += 5;
+		uint8_t type = *p;
+		p += 2;
+
+		uint8_t name_size = *p++;
+		as_column* col = as_column_batch_find(batch, (char*)p, name_size);
+		p += name_size;
+
+		uint32_t value_size = (op_size - (name_size + 4));
+
+		if (col) {
+			switch (col->type) {
+				case AS_COLUMN_INTEGER:
+					// The server always returns 8 byte integers.
+					if (type == AS_BYTES_INTEGER && value_size == 8) {
+						as_column_set_int64(col, row, (int64_t)cf_swap_from_be64(*(uint64_t*)p));
+					}
+					break;
+
+				case AS_COLUMN_DOUBLE:
+					if (type == AS_BYTES_DOUBLE) {
+						as_column_set_double(col, row, cf_swap_from_big_float64(*(double*)p));
+					}
+					break;
+
+				case AS_COLUMN_STRING:
+					if (type == AS_BYTES_STRING && ! as_column_set_bytes(col, row, p, value_size)) {
+						return as_error_update(err, AEROSPIKE_ERR_CLIENT, "Column allocation failed: %u", value_size);
+					}
+					break;
+
+				case AS_COLUMN_BLOB:
+					if (type == AS_BYTES_BLOB && ! as_column_set_bytes(col, row, p, value_size)) {
+						return as_error_update(err, AEROSPIKE_ERR_CLIENT, "Column allocation failed: %u", value_size);
+					}
+					break;
+			}
+		}
+		p += value_size;
+	}
+	*pp = p;
+	as_column_batch_end_row(batch);
+
+	if (batch->size == batch->capacity) {
+		bool rv = task->columns->callback(batch, task->columns->udata);
+		as_column_batch_reset(batch);
+
+		if (! rv) {
+			return AEROSPIKE_ERR_CLIENT_ABORT;
+		}
+	}
+	return AEROSPIKE_OK;
+}
+
 static as_status
 as_scan_parse_record(uint8_t** pp, as_msg* msg, as_scan_task* task, as_error* err)
 {
+	if (task->batch) {
+		return as_scan_parse_columns(pp, msg, task, err);
+	}
+
 	as_record rec;
 	as_record_inita(&rec, msg->n_ops);
 	
@@ -217,7 +296,7 @@ as_scan_parse_records(uint8_t* buf, size_t size, as_scan_task* task, as_error* e
 }
 
 static as_status
-as_scan_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout, uint64_t deadline_ms, void* udata)
+as_scan_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* udata)
 {
 	as_scan_task* task = udata;
 	as_status status = AEROSPIKE_OK;
@@ -227,7 +306,7 @@ as_scan_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_tim
 	while (true) {
 		// Read header
 		as_proto proto;
-		status = as_socket_read_deadline(err, sock, node, (uint8_t*)&proto, sizeof(as_proto), socket_timeout, deadline_ms);
+		status = as_socket_read_deadline_us(err, sock, node, (uint8_t*)&proto, sizeof(as_proto), socket_timeout_us, deadline_us);
 		
 		if (status) {
 			break;
@@ -244,7 +323,7 @@ as_scan_parse(as_error* err, as_socket* sock, as_node* node, uint32_t socket_tim
 			}
 			
 			// Read remaining message bytes in group
-			status = as_socket_read_deadline(err, sock, node, buf, size, socket_timeout, deadline_ms);
+			status = as_socket_read_deadline_us(err, sock, node, buf, size, socket_timeout_us, deadline_us);
 			
 			if (status) {
 				break;
@@ -273,9 +352,24 @@ as_scan_command_execute(as_scan_task* task)
 	as_error err;
 	as_error_init(&err);
 
+	if (task->columns) {
+		task->batch = as_column_batch_create(task->columns->defs, task->columns->n_defs,
+											 task->columns->batch_size);
+	}
+
 	as_status status = as_command_execute(task->cluster, &err, &task->policy->base, &cn, task->cmd, task->cmd_size,
 										  as_scan_parse, task, true);
 	
+	if (task->batch) {
+		// Deliver remaining rows for this node.
+		if (status == AEROSPIKE_OK && task->batch->size > 0 &&
+			! task->columns->callback(task->batch, task->columns->udata)) {
+			status = AEROSPIKE_ERR_CLIENT_ABORT;
+		}
+		as_column_batch_destroy(task->batch);
+		task->batch = NULL;
+	}
+
 	if (status) {
 		// Set main error only once.
 		if (as_fas_uint32(task->error_mutex, 1) == 0) {
@@ -383,13 +477,13 @@ uint64_t task_id, uint16_t n_fields, as_buffer* argbuffer, uint32_t predexp_size
 	if (scan->apply_each.function[0]) {
 		p = as_command_write_header(cmd, AS_MSG_INFO1_READ, AS_MSG_INFO2_WRITE,
 			AS_POLICY_COMMIT_LEVEL_ALL, AS_POLICY_CONSISTENCY_LEVEL_ONE, false,
-			AS_POLICY_EXISTS_IGNORE, AS_POLICY_GEN_IGNORE, 0, 0, policy->base.total_timeout,
+			AS_POLICY_EXISTS_IGNORE, AS_POLICY_GEN_IGNORE, 0, 0, as_policy_server_timeout(&policy->base),
 			n_fields, 0, policy->durable_delete);
 	}
 	else {
 		uint8_t read_attr = (scan->no_bins)? AS_MSG_INFO1_READ | AS_MSG_INFO1_GET_NOBINDATA : AS_MSG_INFO1_READ;
 		p = as_command_write_header_read(cmd, read_attr, AS_POLICY_CONSISTENCY_LEVEL_ONE, false,
-			policy->base.total_timeout, n_fields, scan->select.size);
+			as_policy_server_timeout(&policy->base), n_fields, scan->select.size);
 	}
 	
 	if (scan->ns[0]) {
@@ -411,9 +505,10 @@ uint64_t task_id, uint16_t n_fields, as_buffer* argbuffer, uint32_t predexp_size
 	*p++ = priority;
 	*p++ = scan->percent;
 
-	// Write socket timeout.
+	// Write socket timeout in milliseconds.
+	uint32_t socket_timeout = (uint32_t)(((uint64_t)as_policy_socket_timeout_us(&policy->base) + 999) / 1000);
 	p = as_command_write_field_header(p, AS_FIELD_SCAN_TIMEOUT, sizeof(uint32_t));
-	*(uint32_t*)p = cf_swap_to_be32(policy->base.socket_timeout);
+	*(uint32_t*)p = cf_swap_to_be32(socket_timeout);
 	p += sizeof(uint32_t);
 
 	// Write taskId field
@@ -450,7 +545,8 @@ uint64_t task_id, uint16_t n_fields, as_buffer* argbuffer, uint32_t predexp_size
 static as_status
 as_scan_generic(
 	aerospike* as, as_error* err, const as_policy_scan* policy, const as_scan* scan,
-	aerospike_scan_foreach_callback callback, void* udata, uint64_t* task_id_ptr)
+	aerospike_scan_foreach_callback callback, void* udata, const as_scan_columns* columns,
+	uint64_t* task_id_ptr)
 {
 	as_error_reset(err);
 	
@@ -499,6 +595,8 @@ as_scan_generic(
 	task.scan = scan;
 	task.callback = callback;
 	task.udata = udata;
+	task.columns = columns;
+	task.batch = NULL;
 	task.err = err;
 	task.error_mutex = &error_mutex;
 	task.task_id = task_id;
@@ -573,8 +671,13 @@ as_scan_generic(
 	}
 
 	// If completely successful, make the callback that signals completion.
-	if (callback && status == AEROSPIKE_OK) {
-		callback(NULL, udata);
+	if (status == AEROSPIKE_OK) {
+		if (callback) {
+			callback(NULL, udata);
+		}
+		else if (columns) {
+			columns->callback(NULL, columns->udata);
+		}
 	}
 	return status;
 }
@@ -609,7 +712,7 @@ as_scan_async(
 	as_async_scan_executor* executor = cf_malloc(sizeof(as_async_scan_executor));
 	as_event_executor* exec = &executor->executor;
 	pthread_mutex_init(&exec->lock, NULL);
-	exec->event_loop = as_event_assign(event_loop);
+	exec->event_loop = as_event_assign(as->cluster, event_loop);
 	exec->complete_fn = as_scan_complete_async;
 	exec->udata = udata;
 	exec->err = NULL;
@@ -636,17 +739,22 @@ as_scan_async(
 	uint8_t* cmd_buf = as_command_init(size);
 	size = as_scan_command_init(cmd_buf, policy, scan, task_id, n_fields, &argbuffer, predexp_sz);
 	
-	// Allocate enough memory to cover, then, round up memory size in 8KB increments to allow socket
-	// read to reuse buffer.
-	size_t s = (sizeof(as_async_scan_command) + size + AS_AUTHENTICATION_MAX_SIZE + 8191) & ~8191;
+	// Allocate enough memory to cover, at least 8KB.  Buffer pool rounds up to the next size
+	// class, which allows socket read to reuse buffer.
+	size_t s = sizeof(as_async_scan_command) + size + AS_AUTHENTICATION_MAX_SIZE;
+
+	if (s < 8192 - AS_COMMAND_POOL_HEADER_SIZE) {
+		s = 8192 - AS_COMMAND_POOL_HEADER_SIZE;
+	}
 
 	as_status status = AEROSPIKE_OK;
 
 	// Create all scan commands.
 	for (uint32_t i = 0; i < n_nodes; i++) {
-		as_event_command* cmd = cf_malloc(s);
-		cmd->total_deadline = policy->base.total_timeout;
-		cmd->socket_timeout = policy->base.socket_timeout;
+		size_t capacity;
+		as_event_command* cmd = as_command_pool_alloc(s, &capacity);
+		cmd->total_deadline = as_policy_total_timeout_us(&policy->base);
+		cmd->socket_timeout = as_policy_socket_timeout_us(&policy->base);
 		cmd->max_retries = policy->base.max_retries;
 		cmd->iteration = 0;
 		cmd->replica = AS_POLICY_REPLICA_MASTER;
@@ -659,10 +767,11 @@ as_scan_async(
 		cmd->pipe_listener = NULL;
 		cmd->buf = ((as_async_scan_command*)cmd)->space;
 		cmd->write_len = (uint32_t)size;
-		cmd->read_capacity = (uint32_t)(s - size - sizeof(as_async_scan_command));
+		cmd->read_capacity = (uint32_t)(capacity - size - sizeof(as_async_scan_command));
 		cmd->type = AS_ASYNC_TYPE_SCAN;
 		cmd->state = AS_ASYNC_STATE_UNREGISTERED;
-		cmd->flags = AS_ASYNC_FLAGS_MASTER;
+		cmd->flags = 0;
+		cmd->replica_index = 0;
 		cmd->deserialize = scan->deserialize_list_map;
 		memcpy(cmd->buf, cmd_buf, size);
 		
@@ -704,7 +813,7 @@ aerospike_scan_background(
 	uint64_t* scan_id
 	)
 {
-	return as_scan_generic(as, err, policy, scan, 0, 0, scan_id);
+	return as_scan_generic(as, err, policy, scan, 0, 0, 0, scan_id);
 }
 
 as_status
@@ -750,7 +859,34 @@ aerospike_scan_foreach(
 	aerospike_scan_foreach_callback callback, void* udata
 	)
 {
-	return as_scan_generic(as, err, policy, scan, callback, udata, 0);
+	return as_scan_generic(as, err, policy, scan, callback, udata, 0, 0);
+}
+
+as_status
+aerospike_scan_columns(
+	aerospike* as, as_error* err, const as_policy_scan* policy, const as_scan* scan,
+	const as_column_def* defs, uint32_t n_defs, uint32_t batch_size,
+	aerospike_scan_columns_callback callback, void* udata
+	)
+{
+	as_error_reset(err);
+
+	if (n_defs == 0 || batch_size == 0) {
+		return as_error_set_message(err, AEROSPIKE_ERR_PARAM, "Column scan requires columns and batch size");
+	}
+
+	if (scan->apply_each.function[0]) {
+		return as_error_set_message(err, AEROSPIKE_ERR_PARAM, "Column scan does not support background udf");
+	}
+
+	as_scan_columns columns = {
+		.defs = defs,
+		.n_defs = n_defs,
+		.batch_size = batch_size,
+		.callback = callback,
+		.udata = udata
+	};
+	return as_scan_generic(as, err, policy, scan, 0, 0, &columns, 0);
 }
 
 as_status
@@ -790,6 +926,8 @@ aerospike_scan_node(
 	task.scan = scan;
 	task.callback = callback;
 	task.udata = udata;
+	task.columns = NULL;
+	task.batch = NULL;
 	task.err = err;
 	task.complete_q = 0;
 	task.error_mutex = &error_mutex;
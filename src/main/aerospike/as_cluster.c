@@ -20,9 +20,12 @@
 #include <aerospike/as_info.h>
 #include <aerospike/as_log_macros.h>
 #include <aerospike/as_lookup.h>
+#include <aerospike/as_namespace_handle.h>
+#include <aerospike/as_near_cache.h>
 #include <aerospike/as_password.h>
 #include <aerospike/as_peers.h>
 #include <aerospike/as_shm_cluster.h>
+#include <aerospike/as_single_flight.h>
 #include <aerospike/as_socket.h>
 #include <aerospike/as_string.h>
 #include <aerospike/as_tls.h>
@@ -52,6 +55,9 @@ as_node_refresh_peers(as_cluster* cluster, as_error* err, as_node* node, as_peer
 as_status
 as_node_refresh_partitions(as_cluster* cluster, as_error* err, as_node* node, as_peers* peers);
 
+as_status
+as_node_refresh_racks(as_cluster* cluster, as_error* err, as_node* node);
+
 /******************************************************************************
  * Functions
  *****************************************************************************/
@@ -139,10 +145,7 @@ as_cluster_add_nodes_copy(as_cluster* cluster, as_vector* /* <as_node*> */ nodes
 	set_nodes(cluster, nodes_new);
 	
 	// Put old nodes on garbage collector stack.
-	as_gc_item item;
-	item.data = nodes_old;
-	item.release_fn = (as_release_fn)release_nodes;
-	as_vector_append(cluster->gc, &item);
+	as_gc_add(cluster->gc, nodes_old, (as_release_fn)release_nodes);
 }
 
 static void
@@ -351,10 +354,6 @@ as_cluster_remove_nodes_copy(as_cluster* cluster, as_vector* /* <as_node*> */ no
 		if (as_cluster_find_node_by_reference(nodes_to_remove, node)) {
 			as_log_info("Remove node %s %s", node->name, as_node_get_address_string(node));
 			as_cluster_event_notify(cluster, node, AS_CLUSTER_REMOVE_NODE);
-			as_gc_item item;
-			item.data = node;
-			item.release_fn = (as_release_fn)release_node;
-			as_vector_append(cluster->gc, &item);
 		}
 		else {
 			if (count < nodes_new->size) {
@@ -378,11 +377,15 @@ as_cluster_remove_nodes_copy(as_cluster* cluster, as_vector* /* <as_node*> */ no
 		as_cluster_event_notify(cluster, NULL, AS_CLUSTER_DISCONNECTED);
 	}
 
+	// Retire removed nodes only after the old array is unpublished, so the retire epoch
+	// follows the last point a reader could have found them.
+	for (uint32_t i = 0; i < nodes_to_remove->size; i++) {
+		node = as_vector_get_ptr(nodes_to_remove, i);
+		as_gc_add(cluster->gc, node, (as_release_fn)release_node);
+	}
+
 	// Put old nodes on garbage collector stack.
-	as_gc_item item;
-	item.data = nodes_old;
-	item.release_fn = (as_release_fn)release_nodes;
-	as_vector_append(cluster->gc, &item);
+	as_gc_add(cluster->gc, nodes_old, (as_release_fn)release_nodes);
 }
 
 static void
@@ -452,16 +455,28 @@ as_cluster_set_partition_size(as_cluster* cluster, as_error* err)
 }
 
 /**
- * Release data structures schuleduled for removal in previous cluster tend.
+ * Release data structures scheduled for removal that are no longer referenced by
+ * request threads.  Items retired at or after the oldest epoch are kept for a later tend.
  */
 static void
-as_cluster_gc(as_vector* /* <as_gc_item> */ vector)
+as_cluster_gc(as_vector* /* <as_gc_item> */ vector, uint64_t oldest)
 {
+	uint32_t count = 0;
+
 	for (uint32_t i = 0; i < vector->size; i++) {
 		as_gc_item* item = as_vector_get(vector, i);
-		item->release_fn(item->data);
+
+		if (item->epoch < oldest) {
+			item->release_fn(item->data);
+		}
+		else {
+			if (count < i) {
+				as_vector_set(vector, count, item);
+			}
+			count++;
+		}
 	}
-	as_vector_clear(vector);
+	vector->size = count;
 }
 
 /**
@@ -471,11 +486,12 @@ as_status
 as_cluster_tend(as_cluster* cluster, as_error* err, bool enable_seed_warnings)
 {
 	// All node additions/deletions are performed in tend thread.
-	// Garbage collect data structures released in previous tend.
-	// This tend interval delay substantially reduces the chance of
-	// deleting a ref counted data structure when other threads
-	// are stuck between assignment and incrementing the ref count.
-	as_cluster_gc(cluster->gc);
+	// Advance epoch once per tend, so data retired in previous tends is
+	// older than read sections entered from now on.  Garbage collect that
+	// data once request threads that could still reference it have left
+	// their epoch read section.
+	as_epoch_advance();
+	as_cluster_gc(cluster->gc, as_epoch_oldest());
 
 	// If active nodes don't exist, seed cluster.
 	as_nodes* nodes = cluster->nodes;
@@ -509,6 +525,7 @@ as_cluster_tend(as_cluster* cluster, as_error* err, bool enable_seed_warnings)
 		as_node* node = nodes->array[i];
 		node->friends = 0;
 		node->partition_changed = false;
+		node->rebalance_changed = false;
 		
 		if (! (node->features & AS_FEATURES_PEERS)) {
 			peers.use_peers = false;
@@ -577,6 +594,17 @@ as_cluster_tend(as_cluster* cluster, as_error* err, bool enable_seed_warnings)
 				node->failures++;
 			}
 		}
+
+		// Refresh racks when necessary.
+		if (node->rebalance_changed && node->failures == 0 && node->active) {
+			as_status status = as_node_refresh_racks(cluster, &error_local, node);
+
+			// Node remains usable without rack data.  Refresh is retried on next tend,
+			// because rebalance generation is only stored on success.
+			if (status != AEROSPIKE_OK) {
+				as_log_warn("Node %s rack refresh failed: %s %s", node->name, as_error_string(status), error_local.message);
+			}
+		}
 	}
 
 	if (peers.gen_changed || ! peers.use_peers) {
@@ -597,6 +625,20 @@ as_cluster_tend(as_cluster* cluster, as_error* err, bool enable_seed_warnings)
 	if (peers.nodes.size > 0) {
 		as_cluster_add_nodes(cluster, &peers.nodes);
 	}
+
+	// Trim idle connections, keep minimum connections open, evaluate circuit breakers
+	// and update adaptive socket timeouts on each node.
+	nodes = cluster->nodes;
+
+	for (uint32_t i = 0; i < nodes->size; i++) {
+		as_node* node = nodes->array[i];
+
+		if (node->active) {
+			as_node_balance_connections(node);
+			as_node_tend_breaker(node);
+			as_node_tend_latency(node);
+		}
+	}
 	
 	as_vector* hosts = &peers.hosts;
 	
@@ -807,6 +849,24 @@ as_node_get_random(as_cluster* cluster)
 	return NULL;
 }
 
+as_node*
+as_node_get_random_epoch(as_cluster* cluster)
+{
+	as_nodes* nodes = (as_nodes*)as_load_ptr(&cluster->nodes);
+	uint32_t size = nodes->size;
+
+	for (uint32_t i = 0; i < size; i++) {
+		// Must handle concurrency with other threads.
+		uint32_t index = as_faa_uint32(&cluster->node_index, 1);
+		as_node* node = nodes->array[index % size];
+
+		if (as_load_uint8(&node->active)) {
+			return node;
+		}
+	}
+	return NULL;
+}
+
 as_node*
 as_node_get_by_name(as_cluster* cluster, const char* name)
 {
@@ -856,14 +916,14 @@ as_cluster_get_node_names(as_cluster* cluster, int* n_nodes, char** node_names)
 as_status
 as_cluster_get_node(
 	as_cluster* cluster, as_error* err, const char* ns, const uint8_t* digest,
-	as_policy_replica replica, bool master, as_node** node_pp
+	as_policy_replica replica, uint32_t sequence, as_node** node_pp
 	)
 {
 #ifdef AS_TEST_PROXY
 	as_node* node = as_node_get_random(cluster);
 #else
 	if (cluster->shm_info) {
-		return as_shm_cluster_get_node(cluster, err, ns, digest, replica, master, node_pp);
+		return as_shm_cluster_get_node(cluster, err, ns, digest, replica, sequence, node_pp);
 	}
 
 	as_partition_table* table = as_cluster_get_partition_table(cluster, ns);
@@ -875,18 +935,111 @@ as_cluster_get_node(
 
 	uint32_t partition_id = as_partition_getid(digest, cluster->n_partitions);
 	as_partition* p = &table->partitions[partition_id];
-	as_node* node = as_partition_get_node(cluster, p, replica, master, table->cp_mode);
+	as_node* node = as_partition_get_node(cluster, p, replica, sequence, table->cp_mode);
+#endif
+
+	if (! node) {
+		*node_pp = NULL;
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "No available node for key.");
+	}
+
+	*node_pp = node;
+	return AEROSPIKE_OK;
+}
+
+as_status
+as_cluster_get_node_epoch(
+	as_cluster* cluster, as_error* err, const char* ns, const as_namespace_handle* nsh,
+	const uint8_t* digest, as_policy_replica replica, uint32_t sequence, as_node** node_pp
+	)
+{
+#ifdef AS_TEST_PROXY
+	as_node* node = as_node_get_random_epoch(cluster);
+#else
+	if (nsh) {
+		if (nsh->cluster != cluster) {
+			*node_pp = NULL;
+			return as_error_update(err, AEROSPIKE_ERR_PARAM, "Namespace handle %s belongs to a different cluster", nsh->ns);
+		}
+
+		// Route directly from digest to partition without namespace lookup.
+		uint32_t partition_id = as_partition_getid(digest, nsh->n_partitions);
+		as_node* node;
+
+		if (nsh->shm) {
+			as_partition_table_shm* table = nsh->table;
+			node = as_partition_shm_get_node_epoch(cluster, &table->partitions[partition_id], replica, sequence, nsh->cp_mode);
+		}
+		else {
+			as_partition_table* table = nsh->table;
+			node = as_partition_get_node_epoch(cluster, &table->partitions[partition_id], replica, sequence, nsh->cp_mode);
+		}
+
+		if (! node) {
+			*node_pp = NULL;
+			return as_error_update(err, AEROSPIKE_ERR_CLIENT, "No available node for key.");
+		}
+
+		*node_pp = node;
+		return AEROSPIKE_OK;
+	}
+
+	if (cluster->shm_info) {
+		return as_shm_cluster_get_node_epoch(cluster, err, ns, digest, replica, sequence, node_pp);
+	}
+
+	as_partition_table* table = as_cluster_get_partition_table_epoch(cluster, ns);
+
+	if (! table) {
+		*node_pp = NULL;
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "Invalid namespace: %s", ns);
+	}
+
+	uint32_t partition_id = as_partition_getid(digest, cluster->n_partitions);
+	as_partition* p = &table->partitions[partition_id];
+	as_node* node = as_partition_get_node_epoch(cluster, p, replica, sequence, table->cp_mode);
 #endif
 
 	if (! node) {
 		*node_pp = NULL;
-		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "Invalid node for key.");
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "No available node for key.");
 	}
 
 	*node_pp = node;
 	return AEROSPIKE_OK;
 }
 
+as_status
+as_cluster_resolve_namespace(as_cluster* cluster, as_error* err, const char* ns, as_namespace_handle* handle)
+{
+	if (cluster->shm_info) {
+		as_cluster_shm* cluster_shm = cluster->shm_info->cluster_shm;
+		as_partition_table_shm* table = as_shm_find_partition_table(cluster_shm, ns);
+
+		if (! table) {
+			return as_error_update(err, AEROSPIKE_ERR_CLIENT, "Invalid namespace: %s", ns);
+		}
+		handle->table = table;
+		handle->n_partitions = cluster_shm->n_partitions;
+		handle->cp_mode = table->cp_mode;
+		handle->shm = true;
+	}
+	else {
+		as_partition_table* table = as_cluster_get_partition_table(cluster, ns);
+
+		if (! table) {
+			return as_error_update(err, AEROSPIKE_ERR_CLIENT, "Invalid namespace: %s", ns);
+		}
+		handle->table = table;
+		handle->n_partitions = cluster->n_partitions;
+		handle->cp_mode = table->cp_mode;
+		handle->shm = false;
+	}
+	handle->cluster = cluster;
+	as_strncpy(handle->ns, ns, sizeof(handle->ns));
+	return AEROSPIKE_OK;
+}
+
 bool
 as_cluster_is_connected(as_cluster* cluster)
 {
@@ -972,7 +1125,34 @@ as_cluster_create(as_config* config, as_error* err, as_cluster** cluster_out)
 	cluster->async_max_conns_per_node = config->async_max_conns_per_node;
 	cluster->pipe_max_conns_per_node = config->pipe_max_conns_per_node;;
 	cluster->conn_pools_per_node = config->conn_pools_per_node;
+	cluster->min_conns_per_node = (config->min_conns_per_node > config->max_conns_per_node)?
+		config->max_conns_per_node : config->min_conns_per_node;
+	cluster->async_min_conns_per_node =
+		(config->async_min_conns_per_node > config->async_max_conns_per_node)?
+		config->async_max_conns_per_node : config->async_min_conns_per_node;
 	cluster->use_services_alternate = config->use_services_alternate;
+	cluster->rack_aware = config->rack_aware;
+	cluster->rack_id = config->rack_id;
+	cluster->breaker_error_pct = (config->breaker.error_pct > 100)? 100 : config->breaker.error_pct;
+	cluster->breaker_min_commands = (config->breaker.min_commands == 0)? 1 : config->breaker.min_commands;
+	cluster->breaker_open_ms = config->breaker.open_ms;
+	cluster->timeout_percentile = (config->adaptive.timeout_percentile > 100)?
+		100 : config->adaptive.timeout_percentile;
+	cluster->timeout_multiplier = (config->adaptive.timeout_multiplier == 0)?
+		1 : config->adaptive.timeout_multiplier;
+	cluster->min_timeout_us = config->adaptive.min_timeout_us;
+	cluster->retry_budget_pct = (config->adaptive.retry_budget_pct > 100)?
+		100 : config->adaptive.retry_budget_pct;
+
+	// Retry budget is kept in hundredths of a retry.
+	uint32_t retry_budget_max = (config->adaptive.retry_budget_max == 0)?
+		1 : config->adaptive.retry_budget_max;
+
+	if (retry_budget_max > 1000000) {
+		retry_budget_max = 1000000;
+	}
+	cluster->retry_tokens_max = retry_budget_max * 100;
+	cluster->retry_tokens = cluster->retry_tokens_max;
 
 	// Initialize seed hosts.  Round initial capacity up to multiple of 16.
 	as_vector* src = config->hosts;
@@ -1003,6 +1183,11 @@ as_cluster_create(as_config* config, as_error* err, as_cluster** cluster_out)
 		cluster->pending = cf_calloc(as_event_loop_capacity, sizeof(int));
 	}
 
+	if (config->near_cache.max_memory > 0) {
+		cluster->near_cache = as_near_cache_create(&config->near_cache);
+	}
+	cluster->single_flight = as_single_flight_create();
+
 	// Initialize tend lock and condition.
 	pthread_mutex_init(&cluster->tend_lock, NULL);
 	pthread_cond_init(&cluster->tend_cond, NULL);
@@ -1092,7 +1277,7 @@ as_cluster_destroy(as_cluster* cluster)
 	}
 
 	// Release everything in garbage collector.
-	as_cluster_gc(cluster->gc);
+	as_cluster_gc(cluster->gc, UINT64_MAX);
 	as_vector_destroy(cluster->gc);
 		
 	// Release partition tables.
@@ -1136,6 +1321,11 @@ as_cluster_destroy(as_cluster* cluster)
 	pthread_cond_destroy(&cluster->tend_cond);
 
 	cf_free(cluster->pending);
+
+	if (cluster->near_cache) {
+		as_near_cache_destroy(cluster->near_cache);
+	}
+	as_single_flight_destroy(cluster->single_flight);
 	cf_free(cluster->user);
 	cf_free(cluster->password);
 
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_column_batch.h>
+#include <aerospike/as_string.h>
+#include <citrusleaf/alloc.h>
+#include <string.h>
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static inline bool
+as_column_is_var(const as_column* col)
+{
+	return col->type == AS_COLUMN_STRING || col->type == AS_COLUMN_BLOB;
+}
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+as_column_batch*
+as_column_batch_create(const as_column_def* defs, uint32_t n_defs, uint32_t capacity)
+{
+	as_column_batch* batch = cf_malloc(sizeof(as_column_batch));
+	batch->columns = cf_calloc(n_defs, sizeof(as_column));
+	batch->n_columns = n_defs;
+	batch->size = 0;
+	batch->capacity = capacity;
+
+	uint32_t validity_size = (capacity + 7) >> 3;
+
+	for (uint32_t i = 0; i < n_defs; i++) {
+		as_column* col = &batch->columns[i];
+		as_strncpy(col->name, defs[i].name, sizeof(col->name));
+		col->type = defs[i].type;
+		col->validity = cf_calloc(validity_size, 1);
+
+		switch (col->type) {
+			case AS_COLUMN_INTEGER:
+				col->ints = cf_calloc(capacity, sizeof(int64_t));
+				break;
+
+			case AS_COLUMN_DOUBLE:
+				col->doubles = cf_calloc(capacity, sizeof(double));
+				break;
+
+			case AS_COLUMN_STRING:
+			case AS_COLUMN_BLOB:
+				// Start with 16 bytes per row.  Data buffer grows as needed.
+				col->offsets = cf_calloc(capacity + 1, sizeof(uint32_t));
+				col->data_capacity = capacity * 16;
+				col->data = cf_malloc(col->data_capacity);
+				break;
+		}
+	}
+	return batch;
+}
+
+void
+as_column_batch_destroy(as_column_batch* batch)
+{
+	for (uint32_t i = 0; i < batch->n_columns; i++) {
+		as_column* col = &batch->columns[i];
+		cf_free(col->validity);
+		cf_free(col->ints);
+		cf_free(col->doubles);
+		cf_free(col->offsets);
+		cf_free(col->data);
+	}
+	cf_free(batch->columns);
+	cf_free(batch);
+}
+
+void
+as_column_batch_reset(as_column_batch* batch)
+{
+	uint32_t validity_size = (batch->capacity + 7) >> 3;
+
+	for (uint32_t i = 0; i < batch->n_columns; i++) {
+		as_column* col = &batch->columns[i];
+		memset(col->validity, 0, validity_size);
+		col->data_size = 0;
+		col->null_count = 0;
+	}
+	batch->size = 0;
+}
+
+as_column*
+as_column_batch_find(as_column_batch* batch, const char* name, uint32_t name_len)
+{
+	if (name_len > AS_BIN_NAME_MAX_LEN) {
+		return NULL;
+	}
+
+	// Column count is small, so a linear search is faster than hashing.
+	for (uint32_t i = 0; i < batch->n_columns; i++) {
+		as_column* col = &batch->columns[i];
+
+		if (col->name[name_len] == 0 && memcmp(col->name, name, name_len) == 0) {
+			return col;
+		}
+	}
+	return NULL;
+}
+
+bool
+as_column_set_bytes(as_column* col, uint32_t row, const uint8_t* bytes, uint32_t size)
+{
+	uint32_t needed = col->data_size + size;
+
+	if (needed > col->data_capacity) {
+		uint32_t capacity = col->data_capacity * 2;
+
+		if (capacity < needed) {
+			capacity = needed;
+		}
+
+		uint8_t* data = cf_realloc(col->data, capacity);
+
+		if (! data) {
+			return false;
+		}
+		col->data = data;
+		col->data_capacity = capacity;
+	}
+	memcpy(col->data + col->data_size, bytes, size);
+	col->data_size = needed;
+	as_column_set_valid(col, row);
+	return true;
+}
+
+void
+as_column_batch_end_row(as_column_batch* batch)
+{
+	uint32_t row = batch->size;
+
+	for (uint32_t i = 0; i < batch->n_columns; i++) {
+		as_column* col = &batch->columns[i];
+
+		if (! as_column_is_valid(col, row)) {
+			col->null_count++;
+
+			switch (col->type) {
+				case AS_COLUMN_INTEGER:
+					col->ints[row] = 0;
+					break;
+
+				case AS_COLUMN_DOUBLE:
+					col->doubles[row] = 0.0;
+					break;
+
+				default:
+					break;
+			}
+		}
+
+		if (as_column_is_var(col)) {
+			col->offsets[row + 1] = col->data_size;
+		}
+	}
+	batch->size++;
+}
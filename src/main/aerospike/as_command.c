@@ -16,6 +16,7 @@
  */
 #include <aerospike/as_command.h>
 #include <aerospike/as_cluster.h>
+#include <aerospike/as_epoch.h>
 #include <aerospike/as_event.h>
 #include <aerospike/as_key.h>
 #include <aerospike/as_log_macros.h>
@@ -425,19 +426,27 @@ as_command_execute(
 )
 {
 	as_node* node;
-	uint64_t deadline_ms = 0;
-	uint32_t socket_timeout = policy->socket_timeout;
-	uint32_t total_timeout = policy->total_timeout;
+	uint64_t deadline_us = 0;
+	uint32_t socket_timeout = as_policy_socket_timeout_us(policy);
+	uint64_t total_timeout = as_policy_total_timeout_us(policy);
 	uint32_t iteration = 0;
 	as_status status;
-	bool master = true;
+	uint32_t sequence = 0;
+	uint32_t skipped = 0;
+	uint32_t probe;
 	bool release_node;
+	as_epoch_slot* epoch_slot = NULL;
 
+	// Adaptive timeouts are derived from single record command latencies, so batch, scan
+	// and query commands sent to a specific node neither use nor feed them.
+	bool adaptive = ! cn->node && cluster->timeout_percentile;
+
+	// Timeouts are tracked in microseconds, so sub-millisecond timeouts are honored.
 	if (total_timeout > 0) {
-		deadline_ms = cf_getms() + policy->total_timeout;
+		deadline_us = cf_getus() + total_timeout;
 
 		if (socket_timeout > total_timeout) {
-			socket_timeout = total_timeout;
+			socket_timeout = (uint32_t)total_timeout;
 		}
 	}
 
@@ -451,44 +460,104 @@ as_command_execute(
 				return as_error_set_message(err, AEROSPIKE_ERR_INVALID_NODE, "Invalid namespace or node");
 			}
 			release_node = false;
+			probe = 0;
 		}
 		else {
-			status = as_cluster_get_node(cluster, err, cn->ns, cn->digest, cn->replica, master, &node);
+			// Use epoch read section instead of reserving node.  This avoids atomic writes
+			// to the node's shared reference count on every command.
+			epoch_slot = as_epoch_enter();
+			status = as_cluster_get_node_epoch(cluster, err, cn->ns, cn->nsh, cn->digest, cn->replica, sequence, &node);
 
 			if (status) {
 				// Invalid namespace or there are no active nodes. It's not worth retrying.
+				as_epoch_exit(epoch_slot);
 				return status;
 			}
 			release_node = true;
+
+			if (! as_node_breaker_begin(node, &probe)) {
+				// Another command claimed the probe of this node's open circuit breaker.
+				// Nothing was sent, so move to the next replica without counting a retry.
+				// Commands that can only use the master fail fast.
+				if (cn->replica == AS_POLICY_REPLICA_MASTER || ++skipped >= AS_MAX_REPLICAS) {
+					as_error_update(err, AEROSPIKE_ERR_INVALID_NODE, "Node %s circuit breaker is open",
+						node->name);
+					as_epoch_exit(epoch_slot);
+					return err->code;
+				}
+				as_epoch_exit(epoch_slot);
+				sequence++;
+				continue;
+			}
 		}
 
+		// Adaptive socket timeout never exceeds policy socket timeout.
+		uint32_t node_timeout = adaptive ? as_node_socket_timeout(node, socket_timeout) : socket_timeout;
+
+		// New connections are created with millisecond timeouts.
 		as_socket socket;
-		status = as_node_get_connection(err, node, socket_timeout, deadline_ms, &socket);
+		status = as_node_get_connection(err, node, (node_timeout + 999) / 1000,
+			deadline_us ? (deadline_us + 999) / 1000 : 0, &socket);
 		
 		if (status) {
-			master = !master;  // Alternate between master and prole.
+			as_node_breaker_result(node, status, probe);
+			sequence++;  // Move to next replica.
 			goto Retry;
 		}
 		
+		// Latency is only tracked for shared memory node stats and adaptive timeouts.
+		uint64_t begin_us = (cluster->shm_info || adaptive) ? cf_getus() : 0;
+
+		if (cluster->shm_info) {
+			as_node_begin_command(node);
+		}
+
 		// Send command.
-		status = as_socket_write_deadline(err, &socket, node, command, command_len, socket_timeout, deadline_ms);
+		status = as_socket_write_deadline_us(err, &socket, node, command, command_len, node_timeout, deadline_us);
 		
 		if (status) {
+			if (cluster->shm_info) {
+				as_node_end_command(node);
+			}
+
 			// Socket errors are considered temporary anomalies.  Retry.
 			// Close socket to flush out possible garbage.	Do not put back in pool.
 			as_node_close_connection(&socket);
+			as_node_breaker_result(node, status, probe);
 
-			// Alternate between master and prole on socket errors or database reads.
+			if (status == AEROSPIKE_ERR_TIMEOUT && adaptive) {
+				// Timeouts count as slow commands, so adaptive timeouts can grow.
+				as_node_add_latency_bucket(node, cf_getus() - begin_us);
+			}
+
+			// Move to next replica on socket errors or database reads.
 			// Timeouts are not a good indicator of impending data migration.
 			if (status != AEROSPIKE_ERR_TIMEOUT || is_read) {
-				master = !master;
+				sequence++;
 			}
 			goto Retry;
 		}
 		
 		// Parse results returned by server.
-		status = parse_results_fn(err, &socket, node, socket_timeout, deadline_ms, parse_results_data);
+		status = parse_results_fn(err, &socket, node, node_timeout, deadline_us, parse_results_data);
+		as_node_breaker_result(node, status, probe);
+
+		if (cluster->shm_info) {
+			as_node_end_command(node);
+		}
 		
+		if (begin_us && (status == AEROSPIKE_OK || status == AEROSPIKE_ERR_TIMEOUT)) {
+			uint64_t latency_us = cf_getus() - begin_us;
+
+			if (adaptive) {
+				as_node_add_latency_bucket(node, latency_us);
+			}
+
+			if (status == AEROSPIKE_OK && cluster->shm_info) {
+				as_node_add_latency(node, latency_us);
+			}
+		}
+
 		if (status == AEROSPIKE_OK) {
 			// Reset error code if retry had occurred.
 			if (iteration > 0) {
@@ -502,16 +571,16 @@ as_command_execute(
 			switch (status) {
 				case AEROSPIKE_ERR_CONNECTION:
 					as_node_close_connection(&socket);
-					master = !master;  // Alternate between master and prole.
+					sequence++;  // Move to next replica.
 					goto Retry;
 
 				case AEROSPIKE_ERR_TIMEOUT:
 					as_node_close_connection(&socket);
 
-					// Alternate between master and prole on database reads.
+					// Move to next replica on database reads.
 					// Timeouts are not a good indicator of impending data migration.
 					if (is_read) {
-						master = !master;
+						sequence++;
 					}
 					goto Retry;
 
@@ -523,7 +592,7 @@ as_command_execute(
 				case AEROSPIKE_ERR_CLIENT:
 					as_node_close_connection(&socket);
 					if (release_node) {
-						as_node_release(node);
+						as_epoch_exit(epoch_slot);
 					}
 					return status;
 				
@@ -531,13 +600,16 @@ as_command_execute(
 					break;
 			}
 		}
+
+		// Server responded, so earn retry budget.
+		as_cluster_retry_deposit(cluster);
 		
 		// Put connection back in pool.
 		as_node_put_connection(&socket, cluster->max_socket_idle);
 		
 		// Release resources.
 		if (release_node) {
-			as_node_release(node);
+			as_epoch_exit(epoch_slot);
 		}
 		return status;
 
@@ -547,28 +619,36 @@ Retry:
 			break;
 		}
 
-		if (deadline_ms > 0) {
+		if (deadline_us > 0) {
 			// Check for total timeout.
-			int64_t remaining = deadline_ms - cf_getms() - policy->sleep_between_retries;
+			int64_t remaining = (int64_t)(deadline_us - cf_getus()) -
+				(int64_t)policy->sleep_between_retries * 1000;
 
 			if (remaining <= 0) {
 				break;
 			}
 
-			if (remaining < total_timeout) {
-				total_timeout = (uint32_t)remaining;
-				// Reset timeout in send buffer (destined for server).
-				*(uint32_t*)(command + 22) = cf_swap_to_be32(total_timeout);
+			if ((uint64_t)remaining < total_timeout) {
+				total_timeout = (uint64_t)remaining;
+				// Reset timeout in send buffer (destined for server).  Server timeout
+				// is in milliseconds.
+				*(uint32_t*)(command + 22) = cf_swap_to_be32((uint32_t)((total_timeout + 999) / 1000));
 
 				if (socket_timeout > total_timeout) {
-					socket_timeout = total_timeout;
+					socket_timeout = (uint32_t)total_timeout;
 				}
 			}
 		}
 
+		// Check if cluster wide retry budget is exhausted.  Only spend a token on a retry
+		// that will be sent.
+		if (! as_cluster_retry_withdraw(cluster)) {
+			break;
+		}
+
 		// Prepare for retry.
 		if (release_node) {
-			as_node_release(node);
+			as_epoch_exit(epoch_slot);
 		}
 
 		if (policy->sleep_between_retries > 0) {
@@ -581,22 +661,23 @@ Retry:
 	// Fill in timeout stats if timeout occurred.
 	if (err->code == AEROSPIKE_ERR_TIMEOUT) {
 		as_error_update(err, AEROSPIKE_ERR_TIMEOUT,
-			"Timeout: socket=%u total=%u iterations=%u lastNode=%s",
-			policy->socket_timeout, policy->total_timeout, iteration, as_node_get_address_string(node));
+			"Timeout: socket=%uus total=%" PRIu64 "us iterations=%u lastNode=%s",
+			as_policy_socket_timeout_us(policy), as_policy_total_timeout_us(policy), iteration,
+			as_node_get_address_string(node));
 	}
 
 	if (release_node) {
-		as_node_release(node);
+		as_epoch_exit(epoch_slot);
 	}
 	return err->code;
 }
 
 as_status
-as_command_parse_header(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout, uint64_t deadline_ms, void* user_data)
+as_command_parse_header(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* user_data)
 {
 	// Read header
 	as_proto_msg* msg = user_data;
-	as_status status = as_socket_read_deadline(err, sock, node, (uint8_t*)msg, sizeof(as_proto_msg), socket_timeout, deadline_ms);
+	as_status status = as_socket_read_deadline_us(err, sock, node, (uint8_t*)msg, sizeof(as_proto_msg), socket_timeout_us, deadline_us);
 	
 	if (status) {
 		return status;
@@ -619,7 +700,7 @@ as_command_parse_header(as_error* err, as_socket* sock, as_node* node, uint32_t
 		
 		// Empty socket.
 		uint8_t* buf = cf_malloc(size);
-		status = as_socket_read_deadline(err, sock, node, buf, size, socket_timeout, deadline_ms);
+		status = as_socket_read_deadline_us(err, sock, node, buf, size, socket_timeout_us, deadline_us);
 		cf_free(buf);
 		
 		if (status) {
@@ -1093,11 +1174,53 @@ as_command_parse_bins(uint8_t** pp, as_error* err, as_record* rec, uint32_t n_bi
 }
 
 as_status
-as_command_parse_result(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout, uint64_t deadline_ms, void* user_data)
+as_command_parse_record(as_error* err, uint8_t* p, uint16_t n_bins, uint32_t gen, uint32_t ttl, as_command_parse_result_data* data)
+{
+	as_record* rec = *data->record;
+	bool free_on_error;
+	
+	if (rec) {
+		// Must destroy existing record bin values before populating new bin values.
+		as_bin* bin = rec->bins.entries;
+		for (uint16_t i = 0; i < rec->bins.size; i++, bin++) {
+			as_val_destroy((as_val*)bin->valuep);
+			bin->valuep = NULL;
+		}
+
+		if (n_bins > rec->bins.capacity) {
+			if (rec->bins._free) {
+				cf_free(rec->bins.entries);
+			}
+			rec->bins.capacity = n_bins;
+			rec->bins.size = 0;
+			rec->bins.entries = cf_malloc(sizeof(as_bin) * n_bins);
+			rec->bins._free = true;
+		}
+		free_on_error = false;
+	}
+	else {
+		rec = as_record_new(n_bins);
+		*data->record = rec;
+		free_on_error = true;
+	}
+	rec->gen = gen;
+	rec->ttl = ttl;
+	
+	as_status status = as_command_parse_bins(&p, err, rec, n_bins, data->deserialize);
+
+	if (status != AEROSPIKE_OK && free_on_error) {
+		as_record_destroy(rec);
+		*data->record = NULL;
+	}
+	return status;
+}
+
+as_status
+as_command_parse_result(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* user_data)
 {
 	// Read header
 	as_proto_msg msg;
-	as_status status = as_socket_read_deadline(err, sock, node, (uint8_t*)&msg, sizeof(as_proto_msg), socket_timeout, deadline_ms);
+	as_status status = as_socket_read_deadline_us(err, sock, node, (uint8_t*)&msg, sizeof(as_proto_msg), socket_timeout_us, deadline_us);
 	
 	if (status) {
 		return status;
@@ -1111,7 +1234,7 @@ as_command_parse_result(as_error* err, as_socket* sock, as_node* node, uint32_t
 	if (size > 0) {
 		// Read remaining message bytes.
 		buf = as_command_init(size);
-		status = as_socket_read_deadline(err, sock, node, buf, size, socket_timeout, deadline_ms);
+		status = as_socket_read_deadline_us(err, sock, node, buf, size, socket_timeout_us, deadline_us);
 		
 		if (status) {
 			as_command_free(buf, size);
@@ -1126,42 +1249,9 @@ as_command_parse_result(as_error* err, as_socket* sock, as_node* node, uint32_t
 	switch (status) {
 		case AEROSPIKE_OK: {
 			if (data->record) {
-				as_record* rec = *data->record;
-				bool free_on_error;
-				
-				if (rec) {
-					// Must destroy existing record bin values before populating new bin values.
-					as_bin* bin = rec->bins.entries;
-					for (uint16_t i = 0; i < rec->bins.size; i++, bin++) {
-						as_val_destroy((as_val*)bin->valuep);
-						bin->valuep = NULL;
-					}
-
-					if (msg.m.n_ops > rec->bins.capacity) {
-						if (rec->bins._free) {
-							cf_free(rec->bins.entries);
-						}
-						rec->bins.capacity = msg.m.n_ops;
-						rec->bins.size = 0;
-						rec->bins.entries = cf_malloc(sizeof(as_bin) * msg.m.n_ops);
-						rec->bins._free = true;
-					}
-					free_on_error = false;
-				}
-				else {
-					rec = as_record_new(msg.m.n_ops);
-					*data->record = rec;
-					free_on_error = true;
-				}
-				rec->gen = msg.m.generation;
-				rec->ttl = cf_server_void_time_to_ttl(msg.m.record_ttl);
-				
 				uint8_t* p = as_command_ignore_fields(buf, msg.m.n_fields);
-				status = as_command_parse_bins(&p, err, rec, msg.m.n_ops, data->deserialize);
-
-				if (status != AEROSPIKE_OK && free_on_error) {
-					as_record_destroy(rec);
-				}
+				status = as_command_parse_record(err, p, msg.m.n_ops, msg.m.generation,
+					cf_server_void_time_to_ttl(msg.m.record_ttl), data);
 			}
 			break;
 		}
@@ -1180,11 +1270,53 @@ as_command_parse_result(as_error* err, as_socket* sock, as_node* node, uint32_t
 }
 
 as_status
-as_command_parse_success_failure(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout, uint64_t deadline_ms, void* user_data)
+as_command_parse_raw(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* user_data)
+{
+	// Read header
+	as_proto_msg msg;
+	as_status status = as_socket_read_deadline_us(err, sock, node, (uint8_t*)&msg, sizeof(as_proto_msg), socket_timeout_us, deadline_us);
+
+	if (status) {
+		return status;
+	}
+
+	as_proto_swap_from_be(&msg.proto);
+	as_msg_swap_header_from_be(&msg.m);
+	size_t size = msg.proto.sz - msg.m.header_sz;
+	uint8_t* buf = NULL;
+
+	if (size > 0) {
+		// Buffer outlives the command, so it can not come from as_command_init().
+		buf = cf_malloc(size);
+		status = as_socket_read_deadline_us(err, sock, node, buf, size, socket_timeout_us, deadline_us);
+
+		if (status) {
+			cf_free(buf);
+			return status;
+		}
+	}
+
+	status = msg.m.result_code;
+
+	if (status != AEROSPIKE_OK) {
+		cf_free(buf);
+		return as_error_set_message(err, status, as_error_string(status));
+	}
+
+	as_command_raw_record* raw = user_data;
+	memcpy(&raw->msg, &msg.m, sizeof(as_msg));
+	raw->buf = buf;
+	raw->bins = buf ? as_command_ignore_fields(buf, msg.m.n_fields) : NULL;
+	raw->size = buf ? (uint32_t)(buf + size - raw->bins) : 0;
+	return AEROSPIKE_OK;
+}
+
+as_status
+as_command_parse_success_failure(as_error* err, as_socket* sock, as_node* node, uint32_t socket_timeout_us, uint64_t deadline_us, void* user_data)
 {
 	// Read header
 	as_proto_msg msg;
-	as_status status = as_socket_read_deadline(err, sock, node, (uint8_t*)&msg, sizeof(as_proto_msg), socket_timeout, deadline_ms);
+	as_status status = as_socket_read_deadline_us(err, sock, node, (uint8_t*)&msg, sizeof(as_proto_msg), socket_timeout_us, deadline_us);
 	
 	if (status) {
 		return status;
@@ -1198,7 +1330,7 @@ as_command_parse_success_failure(as_error* err, as_socket* sock, as_node* node,
 	if (size > 0) {
 		// Read remaining message bytes.
 		buf = as_command_init(size);
-		status = as_socket_read_deadline(err, sock, node, buf, size, socket_timeout, deadline_ms);
+		status = as_socket_read_deadline_us(err, sock, node, buf, size, socket_timeout_us, deadline_us);
 		
 		if (status) {
 			as_command_free(buf, size);
@@ -0,0 +1,348 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_command_pool.h>
+#include <aerospike/as_atomic.h>
+#include <citrusleaf/alloc.h>
+#include <pthread.h>
+#include <string.h>
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * Header stored in front of each buffer.  AS_COMMAND_POOL_HEADER_SIZE bytes are
+ * reserved for it so returned buffers keep malloc alignment.
+ */
+typedef struct as_pool_block_s {
+	struct as_pool_block_s* next;
+	uint32_t cls;
+} as_pool_block;
+
+typedef struct as_pool_cache_s {
+	as_pool_block* free[AS_COMMAND_POOL_CLASSES];
+	uint32_t count[AS_COMMAND_POOL_CLASSES];
+
+	// Only written by owning thread.
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t releases;
+
+	struct as_pool_cache_s* next;
+	uint32_t in_use;
+} as_pool_cache;
+
+typedef struct as_pool_depot_s {
+	pthread_mutex_t lock;
+	as_pool_block* head;
+	uint32_t count;
+} as_pool_depot;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+// Size class used for buffers too large to pool.
+#define AS_POOL_CLASS_NONE UINT32_MAX
+
+// Bytes each thread may cache per size class.  Every class caches at least one buffer.
+#define AS_POOL_CACHE_BYTES (256 * 1024)
+
+// Shared depot holds this many thread cache loads per size class.
+#define AS_POOL_DEPOT_FACTOR 8
+
+/******************************************************************************
+ * GLOBAL VARIABLES
+ *****************************************************************************/
+
+static as_pool_cache* as_pool_caches = NULL;
+static pthread_mutex_t as_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t as_pool_key;
+static pthread_once_t as_pool_once = PTHREAD_ONCE_INIT;
+
+static as_pool_depot as_pool_depots[AS_COMMAND_POOL_CLASSES];
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static inline uint32_t
+as_pool_cache_max(uint32_t cls)
+{
+	uint32_t max = AS_POOL_CACHE_BYTES >> (cls + AS_COMMAND_POOL_MIN_SHIFT);
+	return max ? max : 1;
+}
+
+static void
+as_pool_depot_put(uint32_t cls, as_pool_block* head, as_pool_block* tail, uint32_t count, uint64_t* releases)
+{
+	as_pool_depot* depot = &as_pool_depots[cls];
+	uint32_t max = as_pool_cache_max(cls) * AS_POOL_DEPOT_FACTOR;
+
+	pthread_mutex_lock(&depot->lock);
+
+	if (depot->count + count <= max) {
+		tail->next = depot->head;
+		depot->head = head;
+		depot->count += count;
+		head = NULL;
+	}
+	pthread_mutex_unlock(&depot->lock);
+
+	if (! head) {
+		return;
+	}
+
+	// Depot is full. Release chain to heap.
+	for (uint32_t i = 0; i < count; i++) {
+		as_pool_block* next = head->next;
+		cf_free(head);
+		head = next;
+	}
+	*releases += count;
+}
+
+static as_pool_block*
+as_pool_depot_get(uint32_t cls, as_pool_cache* cache)
+{
+	as_pool_depot* depot = &as_pool_depots[cls];
+
+	// Move up to half a thread cache load so the next allocations are local.
+	uint32_t want = (as_pool_cache_max(cls) + 1) / 2;
+
+	pthread_mutex_lock(&depot->lock);
+
+	as_pool_block* head = depot->head;
+	uint32_t n = 0;
+	as_pool_block* tail = NULL;
+
+	for (as_pool_block* b = head; b && n < want; b = b->next) {
+		tail = b;
+		n++;
+	}
+
+	if (tail) {
+		depot->head = tail->next;
+		depot->count -= n;
+	}
+	pthread_mutex_unlock(&depot->lock);
+
+	if (! head) {
+		return NULL;
+	}
+
+	// Keep first block for caller and cache the rest.
+	tail->next = cache->free[cls];
+	cache->free[cls] = head->next;
+	cache->count[cls] += n - 1;
+	return head;
+}
+
+static void
+as_pool_cache_release(void* data)
+{
+	// Thread is exiting.  Move cached buffers to depot and make cache available to new threads.
+	as_pool_cache* cache = data;
+
+	for (uint32_t cls = 0; cls < AS_COMMAND_POOL_CLASSES; cls++) {
+		as_pool_block* head = cache->free[cls];
+
+		if (head) {
+			as_pool_block* tail = head;
+
+			while (tail->next) {
+				tail = tail->next;
+			}
+			as_pool_depot_put(cls, head, tail, cache->count[cls], &cache->releases);
+			cache->free[cls] = NULL;
+			cache->count[cls] = 0;
+		}
+	}
+
+	pthread_mutex_lock(&as_pool_lock);
+	cache->in_use = 0;
+	pthread_mutex_unlock(&as_pool_lock);
+}
+
+static void
+as_pool_key_create(void)
+{
+	for (uint32_t cls = 0; cls < AS_COMMAND_POOL_CLASSES; cls++) {
+		pthread_mutex_init(&as_pool_depots[cls].lock, NULL);
+	}
+	pthread_key_create(&as_pool_key, as_pool_cache_release);
+}
+
+static as_pool_cache*
+as_pool_cache_register(void)
+{
+	pthread_mutex_lock(&as_pool_lock);
+
+	// Reuse cache from exited thread.  Counters carry over so stats include exited threads.
+	as_pool_cache* cache = as_pool_caches;
+
+	while (cache) {
+		if (! cache->in_use) {
+			break;
+		}
+		cache = cache->next;
+	}
+
+	if (! cache) {
+		// Caches are never freed, so stats can scan the list without locking.
+		cache = cf_malloc(sizeof(as_pool_cache));
+		memset(cache, 0, sizeof(as_pool_cache));
+		cache->next = as_pool_caches;
+		as_store_ptr(&as_pool_caches, cache);
+	}
+	cache->in_use = 1;
+	pthread_mutex_unlock(&as_pool_lock);
+
+	pthread_setspecific(as_pool_key, cache);
+	return cache;
+}
+
+static inline as_pool_cache*
+as_pool_cache_get(void)
+{
+	pthread_once(&as_pool_once, as_pool_key_create);
+
+	as_pool_cache* cache = pthread_getspecific(as_pool_key);
+
+	if (! cache) {
+		cache = as_pool_cache_register();
+	}
+	return cache;
+}
+
+static inline uint32_t
+as_pool_class(size_t size)
+{
+	uint32_t cls = 0;
+
+	while (((size_t)1 << (cls + AS_COMMAND_POOL_MIN_SHIFT)) < size) {
+		if (++cls == AS_COMMAND_POOL_CLASSES) {
+			return AS_POOL_CLASS_NONE;
+		}
+	}
+	return cls;
+}
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+void*
+as_command_pool_alloc(size_t size, size_t* capacity)
+{
+	size_t total = size + AS_COMMAND_POOL_HEADER_SIZE;
+	uint32_t cls = as_pool_class(total);
+	as_pool_cache* cache = as_pool_cache_get();
+	as_pool_block* block;
+
+	if (cls == AS_POOL_CLASS_NONE) {
+		block = cf_malloc(total);
+		cache->misses++;
+	}
+	else {
+		total = (size_t)1 << (cls + AS_COMMAND_POOL_MIN_SHIFT);
+		block = cache->free[cls];
+
+		if (block) {
+			cache->free[cls] = block->next;
+			cache->count[cls]--;
+			cache->hits++;
+		}
+		else {
+			block = as_pool_depot_get(cls, cache);
+
+			if (block) {
+				cache->hits++;
+			}
+			else {
+				block = cf_malloc(total);
+				cache->misses++;
+			}
+		}
+	}
+
+	if (! block) {
+		return NULL;
+	}
+
+	block->cls = cls;
+
+	if (capacity) {
+		*capacity = total - AS_COMMAND_POOL_HEADER_SIZE;
+	}
+	return (uint8_t*)block + AS_COMMAND_POOL_HEADER_SIZE;
+}
+
+void
+as_command_pool_free(void* buf)
+{
+	if (! buf) {
+		return;
+	}
+
+	as_pool_block* block = (as_pool_block*)((uint8_t*)buf - AS_COMMAND_POOL_HEADER_SIZE);
+	uint32_t cls = block->cls;
+	as_pool_cache* cache = as_pool_cache_get();
+
+	if (cls == AS_POOL_CLASS_NONE) {
+		cf_free(block);
+		cache->releases++;
+		return;
+	}
+
+	uint32_t max = as_pool_cache_max(cls);
+
+	if (cache->count[cls] >= max) {
+		// Thread cache is full, which happens when buffers are allocated by one thread and
+		// freed by another (async commands are created by caller threads and freed by event
+		// loop threads).  Move half of the cache to the depot where other threads can take it.
+		uint32_t n = (max + 1) / 2;
+		as_pool_block* head = cache->free[cls];
+		as_pool_block* tail = head;
+
+		for (uint32_t i = 1; i < n; i++) {
+			tail = tail->next;
+		}
+		cache->free[cls] = tail->next;
+		cache->count[cls] -= n;
+		as_pool_depot_put(cls, head, tail, n, &cache->releases);
+	}
+
+	block->next = cache->free[cls];
+	cache->free[cls] = block;
+	cache->count[cls]++;
+}
+
+void
+as_command_pool_get_stats(as_command_pool_stats* stats)
+{
+	memset(stats, 0, sizeof(as_command_pool_stats));
+
+	as_pool_cache* cache = (as_pool_cache*)as_load_ptr(&as_pool_caches);
+
+	while (cache) {
+		stats->hits += as_load_uint64(&cache->hits);
+		stats->misses += as_load_uint64(&cache->misses);
+		stats->releases += as_load_uint64(&cache->releases);
+		cache = cache->next;
+	}
+}
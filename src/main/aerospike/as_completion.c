@@ -0,0 +1,373 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_completion.h>
+#include <aerospike/as_event_internal.h>
+#include <aerospike/as_log_macros.h>
+#include <citrusleaf/alloc.h>
+#include <string.h>
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+// Maximum completions held per event loop before they are pushed to a ring.
+#define AS_COMPLETION_RING_BATCH 256
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static as_completion_queue*
+as_completion_queue_get(as_event_loop* event_loop)
+{
+	as_completion_queue* cq = event_loop->completions;
+
+	if (! cq) {
+		cq = cf_malloc(sizeof(as_completion_queue));
+		memset(cq, 0, sizeof(as_completion_queue));
+		cq->capacity = 1;
+		cq->entries = cf_malloc(sizeof(as_completion) * cq->capacity);
+		event_loop->completions = cq;
+	}
+	return cq;
+}
+
+static void
+as_completion_queue_resize(as_completion_queue* cq, uint32_t capacity)
+{
+	// Completions that a full ring did not take are kept for the new delivery mode.
+	if (capacity < cq->size) {
+		capacity = cq->size;
+	}
+
+	if (cq->capacity == capacity) {
+		return;
+	}
+
+	cf_free(cq->spare);
+	cq->entries = cf_realloc(cq->entries, sizeof(as_completion) * capacity);
+	cq->spare = NULL;
+	cq->capacity = capacity;
+}
+
+static uint32_t
+as_completion_ring_push(as_completion_ring* ring, as_completion* entries, uint32_t n)
+{
+	uint64_t tail = ring->tail;
+	uint64_t head = as_load_uint64(&ring->head);
+	uint64_t avail = (uint64_t)ring->mask + 1 - (tail - head);
+
+	if (n > avail) {
+		n = (uint32_t)avail;
+	}
+
+	for (uint32_t i = 0; i < n; i++) {
+		ring->entries[(tail + i) & ring->mask] = entries[i];
+	}
+
+	// Entries must be visible before consumer observes new tail.
+	as_fence_release();
+	as_store_uint64(&ring->tail, tail + n);
+	return n;
+}
+
+static void
+as_completion_ring_flush(as_completion_queue* cq)
+{
+	uint32_t pushed = as_completion_ring_push(cq->ring, cq->entries, cq->size);
+
+	cq->size -= pushed;
+
+	if (cq->size == 0) {
+		if (cq->backlog) {
+			as_store_uint8(&cq->backlog, 0);
+		}
+		return;
+	}
+
+	// Ring is full.  Keep the rest instead of blocking the event loop on the consumer.
+	// New commands are rejected until the backlog is pushed, so only commands already in
+	// flight add to it.
+	memmove(cq->entries, cq->entries + pushed, sizeof(as_completion) * cq->size);
+
+	if (! cq->backlog) {
+		as_log_debug("Completion ring full. Holding %u completions", cq->size);
+		as_store_uint8(&cq->backlog, 1);
+	}
+}
+
+static void
+as_completion_flush(void* udata)
+{
+	as_event_loop* event_loop = udata;
+	as_completion_queue* cq = event_loop->completions;
+	cq->flush_scheduled = false;
+
+	if (cq->size == 0) {
+		return;
+	}
+
+	if (cq->ring) {
+		as_completion_ring_flush(cq);
+
+		if (cq->size > 0) {
+			// Push the rest on the next event loop pass.
+			cq->flush_scheduled = as_event_execute(event_loop, as_completion_flush, event_loop);
+		}
+		return;
+	}
+
+	if (! cq->listener) {
+		// Delivery mode was removed.  Completions can no longer be delivered.
+		as_log_warn("Dropping %u undelivered async completions", cq->size);
+
+		for (uint32_t i = 0; i < cq->size; i++) {
+			as_completion_destroy(&cq->entries[i]);
+		}
+		cq->size = 0;
+		return;
+	}
+
+	// Swap in spare array before calling listener because listener may issue commands
+	// that fail in this thread and add completions while the batch is being delivered.
+	as_completion* entries = cq->entries;
+	uint32_t capacity = cq->capacity;
+	uint32_t size = cq->size;
+
+	if (cq->spare) {
+		cq->entries = cq->spare;
+		cq->spare = NULL;
+	}
+	else {
+		cq->entries = cf_malloc(sizeof(as_completion) * capacity);
+	}
+	cq->size = 0;
+
+	cq->listener(entries, size, cq->udata, event_loop);
+
+	for (uint32_t i = 0; i < size; i++) {
+		as_completion_destroy(&entries[i]);
+	}
+
+	if (cq->spare || capacity != cq->capacity) {
+		// Nested flush already returned an array or listener changed capacity.
+		cf_free(entries);
+	}
+	else {
+		cq->spare = entries;
+	}
+}
+
+static void
+as_completion_mode_changed(as_event_loop* event_loop, as_completion_queue* cq)
+{
+	if (cq->size == 0) {
+		as_store_uint8(&cq->backlog, 0);
+		return;
+	}
+
+	// Completions held for a full ring are delivered in the new mode.
+	if (! cq->ring) {
+		as_store_uint8(&cq->backlog, 0);
+	}
+
+	if (! cq->flush_scheduled) {
+		cq->flush_scheduled = as_event_execute(event_loop, as_completion_flush, event_loop);
+	}
+}
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+void
+as_event_loop_set_completion_listener(
+	as_event_loop* event_loop, as_async_completion_listener listener, void* udata, uint32_t max_batch
+	)
+{
+	as_completion_queue* cq = as_completion_queue_get(event_loop);
+
+	// Deliver completions pending under previous mode.
+	as_completion_flush(event_loop);
+
+	cq->listener = listener;
+	cq->udata = udata;
+	cq->ring = NULL;
+	cq->max_batch = max_batch ? max_batch : 1;
+	as_completion_queue_resize(cq, cq->max_batch);
+	as_completion_mode_changed(event_loop, cq);
+}
+
+void
+as_event_loop_set_completion_ring(as_event_loop* event_loop, as_completion_ring* ring)
+{
+	as_completion_queue* cq = as_completion_queue_get(event_loop);
+
+	// Deliver completions pending under previous mode.
+	as_completion_flush(event_loop);
+
+	cq->listener = NULL;
+	cq->udata = NULL;
+	cq->ring = ring;
+	cq->max_batch = ring ? ring->mask + 1 : 1;
+
+	if (cq->max_batch > AS_COMPLETION_RING_BATCH) {
+		cq->max_batch = AS_COMPLETION_RING_BATCH;
+	}
+	as_completion_queue_resize(cq, cq->max_batch);
+	as_completion_mode_changed(event_loop, cq);
+}
+
+bool
+as_completion_ring_init(as_completion_ring* ring, uint32_t capacity)
+{
+	uint32_t size = 1;
+
+	while (size < capacity) {
+		size <<= 1;
+
+		if (size == 0) {
+			return false;
+		}
+	}
+
+	memset(ring, 0, sizeof(as_completion_ring));
+	ring->entries = cf_malloc(sizeof(as_completion) * size);
+
+	if (! ring->entries) {
+		return false;
+	}
+	ring->mask = size - 1;
+	return true;
+}
+
+void
+as_completion_ring_destroy(as_completion_ring* ring)
+{
+	as_completion c;
+
+	while (as_completion_ring_drain(ring, &c, 1) == 1) {
+		as_completion_destroy(&c);
+	}
+	cf_free(ring->entries);
+	ring->entries = NULL;
+}
+
+uint32_t
+as_completion_ring_drain(as_completion_ring* ring, as_completion* out, uint32_t max)
+{
+	uint64_t head = ring->head;
+	uint64_t tail = as_load_uint64(&ring->tail);
+	uint64_t avail = tail - head;
+
+	if (max > avail) {
+		max = (uint32_t)avail;
+	}
+
+	// Pairs with release fence in producer.
+	as_fence_acquire();
+
+	for (uint32_t i = 0; i < max; i++) {
+		out[i] = ring->entries[(head + i) & ring->mask];
+	}
+
+	// Slots must be read before producer observes new head and reuses them.
+	as_fence_release();
+	as_store_uint64(&ring->head, head + max);
+	return max;
+}
+
+void
+as_completion_destroy(as_completion* completion)
+{
+	if (completion->err) {
+		cf_free(completion->err);
+		completion->err = NULL;
+	}
+
+	if (completion->record) {
+		as_record_destroy(completion->record);
+		completion->record = NULL;
+	}
+
+	if (completion->val) {
+		as_val_destroy(completion->val);
+		completion->val = NULL;
+	}
+}
+
+void
+as_completion_add(
+	as_event_loop* event_loop, as_completion_type type, as_error* err, as_record* record,
+	as_val* val, void* udata
+	)
+{
+	as_completion_queue* cq = event_loop->completions;
+
+	if (cq->size == cq->capacity) {
+		// Ring is full.  Commands already in flight still need room for their completions.
+		cq->capacity *= 2;
+		cq->entries = cf_realloc(cq->entries, sizeof(as_completion) * cq->capacity);
+	}
+
+	as_completion* c = &cq->entries[cq->size++];
+
+	if (err) {
+		c->err = cf_malloc(sizeof(as_error));
+		as_error_copy(c->err, err);
+	}
+	else {
+		c->err = NULL;
+	}
+	c->record = record;
+	c->val = val;
+	c->udata = udata;
+	c->type = type;
+
+	if (cq->size >= cq->max_batch && ! cq->backlog) {
+		// Deliver now instead of growing the queue.
+		as_completion_flush(event_loop);
+		return;
+	}
+
+	if (! cq->flush_scheduled) {
+		// Deliver after events already pending in this loop iteration are processed.
+		cq->flush_scheduled = as_event_execute(event_loop, as_completion_flush, event_loop);
+
+		if (! cq->flush_scheduled) {
+			as_completion_flush(event_loop);
+		}
+	}
+}
+
+void
+as_completion_queue_destroy(as_event_loop* event_loop)
+{
+	as_completion_queue* cq = event_loop->completions;
+
+	if (! cq) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < cq->size; i++) {
+		as_completion_destroy(&cq->entries[i]);
+	}
+	cf_free(cq->entries);
+	cf_free(cq->spare);
+	cf_free(cq);
+	event_loop->completions = NULL;
+}
@@ -38,7 +38,9 @@ as_config_init(as_config* c)
 	c->ip_map = NULL;
 	c->ip_map_size = 0;
 	c->max_conns_per_node = 300;
+	c->min_conns_per_node = 0;
 	c->async_max_conns_per_node = 300;
+	c->async_min_conns_per_node = 0;
 	c->pipe_max_conns_per_node = 64;
 	c->conn_pools_per_node = 1;
 	c->conn_timeout_ms = 1000;
@@ -48,12 +50,26 @@ as_config_init(as_config* c)
 	as_policies_init(&c->policies);
 	as_config_lua_init(&c->lua);
 	memset(&c->tls, 0, sizeof(as_config_tls));
+	c->near_cache.max_memory = 0;
+	c->near_cache.n_shards = 16;
+	c->near_cache.revalidate_ms = 1000;
+	c->breaker.error_pct = 0;
+	c->breaker.min_commands = 20;
+	c->breaker.open_ms = 1000;
+	c->adaptive.timeout_percentile = 0;
+	c->adaptive.timeout_multiplier = 3;
+	c->adaptive.min_timeout_us = 10000;
+	c->adaptive.retry_budget_pct = 0;
+	c->adaptive.retry_budget_max = 100;
 	c->fail_if_not_connected = true;
 	c->use_services_alternate = false;
+	c->rack_aware = false;
+	c->rack_id = 0;
 	c->use_shm = false;
 	c->shm_key = 0xA7000000;
 	c->shm_max_nodes = 16;
 	c->shm_max_namespaces = 8;
+	c->shm_max_processes = 128;
 	c->shm_takeover_threshold_sec = 30;
 	return c;
 }
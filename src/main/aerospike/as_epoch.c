@@ -0,0 +1,155 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_epoch.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define AS_EPOCH_SLOT_ALIGN 64
+
+/******************************************************************************
+ * GLOBAL VARIABLES
+ *****************************************************************************/
+
+uint64_t as_epoch_global = 1;
+
+static as_epoch_slot* as_epoch_slots = NULL;
+static pthread_mutex_t as_epoch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t as_epoch_key;
+static pthread_once_t as_epoch_once = PTHREAD_ONCE_INIT;
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static as_epoch_slot*
+as_epoch_slot_create(void)
+{
+	// Align slot to cache line, so padding keeps slots of different threads apart.
+#if defined(_MSC_VER)
+	as_epoch_slot* slot = _aligned_malloc(sizeof(as_epoch_slot), AS_EPOCH_SLOT_ALIGN);
+#else
+	void* slot = NULL;
+
+	if (posix_memalign(&slot, AS_EPOCH_SLOT_ALIGN, sizeof(as_epoch_slot)) != 0) {
+		return NULL;
+	}
+#endif
+	memset(slot, 0, sizeof(as_epoch_slot));
+	return slot;
+}
+
+static void
+as_epoch_slot_release(void* data)
+{
+	// Thread is exiting.  Make slot available to new threads.
+	as_epoch_slot* slot = data;
+	as_store_uint64(&slot->epoch, 0);
+	slot->depth = 0;
+
+	pthread_mutex_lock(&as_epoch_lock);
+	slot->in_use = 0;
+	pthread_mutex_unlock(&as_epoch_lock);
+}
+
+static void
+as_epoch_key_create(void)
+{
+	pthread_key_create(&as_epoch_key, as_epoch_slot_release);
+}
+
+static as_epoch_slot*
+as_epoch_slot_register(void)
+{
+	pthread_mutex_lock(&as_epoch_lock);
+
+	// Reuse slot from exited thread.
+	as_epoch_slot* slot = as_epoch_slots;
+
+	while (slot) {
+		if (! slot->in_use) {
+			break;
+		}
+		slot = slot->next;
+	}
+
+	if (! slot) {
+		// Slots are never freed, so the tend thread can scan the list without locking.
+		// The list length is bounded by the maximum number of concurrent request threads.
+		slot = as_epoch_slot_create();
+		slot->next = as_epoch_slots;
+		as_store_ptr(&as_epoch_slots, slot);
+	}
+	slot->in_use = 1;
+	pthread_mutex_unlock(&as_epoch_lock);
+
+	pthread_setspecific(as_epoch_key, slot);
+	return slot;
+}
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+as_epoch_slot*
+as_epoch_slot_get(void)
+{
+	pthread_once(&as_epoch_once, as_epoch_key_create);
+
+	as_epoch_slot* slot = pthread_getspecific(as_epoch_key);
+
+	if (! slot) {
+		slot = as_epoch_slot_register();
+	}
+	return slot;
+}
+
+void
+as_epoch_advance(void)
+{
+	// Threads entering a read section after this point observe a newer epoch.
+	as_incr_uint64(&as_epoch_global);
+}
+
+uint64_t
+as_epoch_oldest(void)
+{
+	// Removal of retired data from shared structures must be visible before
+	// slots are read.  Pairs with fence in as_epoch_enter().
+	as_fence_memory();
+
+	uint64_t oldest = UINT64_MAX;
+	as_epoch_slot* slot = (as_epoch_slot*)as_load_ptr(&as_epoch_slots);
+
+	while (slot) {
+		uint64_t e = as_load_uint64(&slot->epoch);
+
+		if (e && e < oldest) {
+			oldest = e;
+		}
+		slot = slot->next;
+	}
+	return oldest;
+}
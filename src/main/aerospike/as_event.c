@@ -18,13 +18,20 @@
 #include <aerospike/as_event_internal.h>
 #include <aerospike/as_admin.h>
 #include <aerospike/as_command.h>
+#include <aerospike/as_completion.h>
 #include <aerospike/as_log_macros.h>
 #include <aerospike/as_monitor.h>
 #include <aerospike/as_pipe.h>
 #include <aerospike/as_proto.h>
+#include <aerospike/as_random.h>
 #include <aerospike/as_shm_cluster.h>
 #include <citrusleaf/alloc.h>
 #include <pthread.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 // Use pointer comparison for performance.  If portability becomes an issue, use
 // "pthread_equal(event_loop->thread, pthread_self())" instead.
@@ -46,6 +53,9 @@ int as_event_send_buffer_size = 0;
 int as_event_recv_buffer_size = 0;
 bool as_event_threads_created = false;
 
+static int* as_event_loop_cpus = NULL;
+static uint32_t as_event_loop_n_cpus = 0;
+
 bool aerospike_library_init();
 
 /******************************************************************************
@@ -94,6 +104,36 @@ as_event_initialize_loops(uint32_t capacity)
 	return true;
 }
 
+bool
+as_event_set_loop_cpus(const int* cpus, uint32_t n_cpus)
+{
+#if defined(__linux__)
+	for (uint32_t i = 0; i < n_cpus; i++) {
+		if (cpus[i] < 0 || cpus[i] >= CPU_SETSIZE) {
+			as_log_error("Invalid event loop cpu: %d", cpus[i]);
+			return false;
+		}
+	}
+
+	cf_free(as_event_loop_cpus);
+	as_event_loop_cpus = NULL;
+	as_event_loop_n_cpus = 0;
+
+	if (n_cpus > 0) {
+		as_event_loop_cpus = cf_malloc(sizeof(int) * n_cpus);
+		memcpy(as_event_loop_cpus, cpus, sizeof(int) * n_cpus);
+		as_event_loop_n_cpus = n_cpus;
+	}
+	return true;
+#else
+	if (n_cpus > 0) {
+		as_log_error("Event loop cpu pinning is not supported on this platform");
+		return false;
+	}
+	return true;
+#endif
+}
+
 as_event_loop*
 as_event_create_loops(uint32_t capacity)
 {
@@ -118,6 +158,11 @@ as_event_create_loops(uint32_t capacity)
 		as_queue_init(&event_loop->queue, sizeof(as_event_commander), AS_EVENT_QUEUE_INITIAL_CAPACITY);
 		as_queue_init(&event_loop->pipe_cb_queue, sizeof(as_queued_pipe_cb), AS_EVENT_QUEUE_INITIAL_CAPACITY);
 		event_loop->pipe_cb_calling = false;
+		event_loop->completions = NULL;
+		event_loop->steal_victim = NULL;
+		event_loop->steal_pending = 0;
+		event_loop->read_buf = NULL;
+		event_loop->read_conn = NULL;
 
 		if (! as_event_create_loop(event_loop)) {
 			as_event_close_loops();
@@ -168,6 +213,11 @@ as_event_set_external_loop(void* loop)
 	as_queue_init(&event_loop->queue, sizeof(as_event_commander), AS_EVENT_QUEUE_INITIAL_CAPACITY);
 	as_queue_init(&event_loop->pipe_cb_queue, sizeof(as_queued_pipe_cb), AS_EVENT_QUEUE_INITIAL_CAPACITY);
 	event_loop->pipe_cb_calling = false;
+	event_loop->completions = NULL;
+	event_loop->steal_victim = NULL;
+	event_loop->steal_pending = 0;
+	event_loop->read_buf = NULL;
+	event_loop->read_conn = NULL;
 	as_event_register_external_loop(event_loop);
 
 	if (current > 0) {
@@ -225,6 +275,11 @@ as_event_close_loops()
 		}
 		as_event_destroy_loops();
 	}
+
+	// Cpu list only applies to loops created before this close.
+	cf_free(as_event_loop_cpus);
+	as_event_loop_cpus = NULL;
+	as_event_loop_n_cpus = 0;
 	return status;
 }
 
@@ -237,6 +292,9 @@ as_event_destroy_loops()
 #endif
 
 	if (as_event_loops) {
+		for (uint32_t i = 0; i < as_event_loop_size; i++) {
+			as_completion_queue_destroy(&as_event_loops[i]);
+		}
 		cf_free(as_event_loops);
 		as_event_loops = NULL;
 		as_event_loop_size = 0;
@@ -247,18 +305,203 @@ as_event_destroy_loops()
  * PRIVATE FUNCTIONS
  *****************************************************************************/
 
-static void as_event_command_execute_in_loop(as_event_command* cmd);
 static void as_event_command_begin(as_event_command* cmd);
 
+int
+as_event_loop_cpu(uint32_t index)
+{
+	if (as_event_loop_n_cpus == 0) {
+		return -1;
+	}
+	return as_event_loop_cpus[index % as_event_loop_n_cpus];
+}
+
+bool
+as_event_thread_create(as_event_loop* event_loop, void* (*worker)(void*), void* udata)
+{
+#if defined(__linux__)
+	int cpu = as_event_loop_cpu(event_loop->index);
+
+	if (cpu >= 0) {
+		// Set affinity before thread starts, so the loop and its first allocations are
+		// placed on the pinned cpu's NUMA node.
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu, &cpus);
+
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		int rv = pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpus);
+
+		if (rv == 0) {
+			rv = pthread_create(&event_loop->thread, &attr, worker, udata);
+		}
+		else {
+			as_log_warn("Failed to pin event loop %u to cpu %d: %d", event_loop->index, cpu, rv);
+			rv = pthread_create(&event_loop->thread, NULL, worker, udata);
+		}
+		pthread_attr_destroy(&attr);
+		return rv == 0;
+	}
+#endif
+	return pthread_create(&event_loop->thread, NULL, worker, udata) == 0;
+}
+
+static inline uint32_t
+as_event_loop_load(as_cluster* cluster, as_event_loop* event_loop)
+{
+	// Commands started on loop plus commands waiting in loop's queue.  Both are read
+	// without synchronization because load balancing does not need to be exact.
+	int pending = cluster->pending[event_loop->index];
+	uint32_t queued = as_queue_size(&event_loop->queue);
+	return pending > 0 ? (uint32_t)pending + queued : queued;
+}
+
+as_event_loop*
+as_event_loop_select(as_cluster* cluster, as_event_loop* loops, uint32_t size, uint64_t r)
+{
+	// Choose less loaded of two distinct random loops.  This avoids the herd behavior
+	// of always choosing the least loaded loop when load counts are stale.
+	uint32_t i1 = (uint32_t)r % size;
+	uint32_t i2 = (uint32_t)(r >> 32) % (size - 1);
+
+	if (i2 >= i1) {
+		i2++;
+	}
+
+	as_event_loop* l1 = &loops[i1];
+	as_event_loop* l2 = &loops[i2];
+	return as_event_loop_load(cluster, l2) < as_event_loop_load(cluster, l1) ? l2 : l1;
+}
+
+as_event_loop*
+as_event_loop_balance(as_cluster* cluster)
+{
+	uint32_t size = as_event_loop_size;
+
+	if (size <= 1) {
+		return as_event_loop_get();
+	}
+	return as_event_loop_select(cluster, as_event_loops, size, as_random_get_uint64());
+}
+
+static inline bool
+as_event_stealable(as_event_loop* thief, as_event_commander* qcmd)
+{
+	if (qcmd->executable != (as_event_executable)as_event_command_execute_in_loop) {
+		return false;
+	}
+
+	as_event_command* cmd = qcmd->udata;
+
+	// Skip commands whose cluster has already been closed on the thief loop.  Otherwise,
+	// stolen commands increment the thief's pending count before the thief's cluster
+	// close callback runs, so the cluster is not destroyed while they are in flight.
+	return (cmd->flags & AS_ASYNC_FLAGS_STEALABLE) && cmd->cluster->pending[thief->index] >= 0;
+}
+
+uint32_t
+as_event_steal_queued(as_event_loop* victim, as_event_loop* thief, as_event_commander* stolen)
+{
+	as_event_commander qcmd;
+	uint32_t n = 0;
+
+	pthread_mutex_lock(&victim->lock);
+
+	// Victim keeps the older half of its queue.  as_queue only supports FIFO access, so
+	// rotate the queue once and push back entries that are not stolen in original order.
+	uint32_t size = as_queue_size(&victim->queue);
+	uint32_t keep = size - size / 2;
+
+	for (uint32_t i = 0; i < size; i++) {
+		as_queue_pop(&victim->queue, &qcmd);
+
+		if (i >= keep && n < AS_EVENT_STEAL_MAX && as_event_stealable(thief, &qcmd)) {
+			stolen[n++] = qcmd;
+		}
+		else {
+			as_queue_push(&victim->queue, &qcmd);
+		}
+	}
+	pthread_mutex_unlock(&victim->lock);
+	return n;
+}
+
+static void
+as_event_steal(as_event_loop* thief)
+{
+	as_event_commander stolen[AS_EVENT_STEAL_MAX];
+	uint32_t n = as_event_steal_queued(thief->steal_victim, thief, stolen);
+
+	as_store_uint32(&thief->steal_pending, 0);
+
+	for (uint32_t i = 0; i < n; i++) {
+		as_event_command* cmd = stolen[i].udata;
+		cmd->event_loop = thief;
+		as_event_command_execute_in_loop(cmd);
+	}
+}
+
+static void
+as_event_steal_request(as_cluster* cluster, as_event_loop* victim)
+{
+	uint32_t backlog = as_queue_size(&victim->queue);
+
+	if (backlog < AS_EVENT_STEAL_THRESHOLD) {
+		return;
+	}
+
+	// Find least loaded loop with at most half the victim's backlog.
+	as_event_loop* thief = NULL;
+	uint32_t min = backlog / 2;
+
+	for (uint32_t i = 0; i < as_event_loop_size; i++) {
+		as_event_loop* event_loop = &as_event_loops[i];
+
+		if (event_loop == victim || as_load_uint32(&event_loop->steal_pending)) {
+			continue;
+		}
+
+		uint32_t load = as_event_loop_load(cluster, event_loop);
+
+		if (load < min) {
+			min = load;
+			thief = event_loop;
+		}
+	}
+
+	// Allow only one outstanding steal request per thief.
+	if (! thief || ! as_cas_uint32(&thief->steal_pending, 0, 1)) {
+		return;
+	}
+	thief->steal_victim = victim;
+
+	if (! as_event_execute(thief, (as_event_executable)as_event_steal, thief)) {
+		as_store_uint32(&thief->steal_pending, 0);
+	}
+}
+
 as_status
 as_event_command_execute(as_event_command* cmd, as_error* err)
 {
 	// Initialize read buffer (buf) to be located after write buffer.
 	cmd->write_offset = (uint32_t)(cmd->buf - (uint8_t*)cmd);
 	cmd->buf += cmd->write_len;
+	cmd->in_flight = false;
 
 	as_event_loop* event_loop = cmd->event_loop;
 
+	if (cmd->type <= AS_ASYNC_TYPE_VALUE && as_completion_backlog(event_loop)) {
+		// Completion ring is full.  Reject command instead of adding to the completions
+		// held on the event loop.
+		if (cmd->node) {
+			as_node_release(cmd->node);
+		}
+		as_command_pool_free(cmd);
+		return as_error_update(err, AEROSPIKE_ERR_ASYNC_QUEUE_FULL,
+			"Completion ring of event loop %u is full", event_loop->index);
+	}
+
 	// Avoid recursive error death spiral by forcing command to be queued to
 	// event loop when consecutive recursive errors reaches an approximate limit.
 	if (as_in_event_loop(event_loop->thread) && event_loop->errors < 5) {
@@ -269,23 +512,32 @@ as_event_command_execute(as_event_command* cmd, as_error* err)
 		// Send command through queue so it can be executed in event loop thread.
 		if (cmd->total_deadline > 0) {
 			// Convert total timeout to deadline.
-			cmd->total_deadline += cf_getms();
+			cmd->total_deadline += cf_getus();
 		}
 		cmd->state = AS_ASYNC_STATE_REGISTERED;
 
+		// Command may complete on event loop thread as soon as it is queued.
+		as_cluster* cluster = cmd->cluster;
+		bool stealable = cmd->flags & AS_ASYNC_FLAGS_STEALABLE;
+
 		if (! as_event_execute(cmd->event_loop, (as_event_executable)as_event_command_execute_in_loop, cmd)) {
 			event_loop->errors++;  // Not in event loop thread, so not exactly accurate.
 			if (cmd->node) {
 				as_node_release(cmd->node);
 			}
-			cf_free(cmd);
+			as_command_pool_free(cmd);
 			return as_error_set_message(err, AEROSPIKE_ERR_CLIENT, "Failed to queue command");
 		}
+
+		if (stealable) {
+			// Ask an idle loop to take queued commands when this loop falls behind.
+			as_event_steal_request(cluster, event_loop);
+		}
 	}
 	return AEROSPIKE_OK;
 }
 
-static void
+void
 as_event_command_execute_in_loop(as_event_command* cmd)
 {
 	as_event_loop* event_loop = cmd->event_loop;
@@ -301,7 +553,7 @@ as_event_command_execute_in_loop(as_event_command* cmd)
 	}
 
 	if (cmd->total_deadline > 0) {
-		uint64_t now = cf_getms();
+		uint64_t now = cf_getus();
 		uint64_t total_timeout;
 
 		if (cmd->state == AS_ASYNC_STATE_REGISTERED) {
@@ -348,31 +600,69 @@ as_event_command_execute_in_loop(as_event_command* cmd)
 static void
 as_event_command_begin(as_event_command* cmd)
 {
+	cmd->breaker_probe = 0;
+
+	if (cmd->in_flight) {
+		// Previous attempt is done.  Retry may use another node.
+		as_node_end_command(cmd->node);
+		cmd->in_flight = false;
+	}
+
 	if (cmd->partition) {
 		// If in retry, need to release node from prior attempt.
 		if (cmd->node) {
 			as_node_release(cmd->node);
 		}
 
-		if (cmd->cluster->shm_info) {
-			cmd->node = as_partition_shm_get_node(cmd->cluster, cmd->partition, cmd->replica, cmd->flags & AS_ASYNC_FLAGS_MASTER, cmd->flags & AS_ASYNC_FLAGS_CP_MODE);
-		}
-		else {
-			cmd->node = as_partition_get_node(cmd->cluster, cmd->partition, cmd->replica, cmd->flags & AS_ASYNC_FLAGS_MASTER, cmd->flags & AS_ASYNC_FLAGS_CP_MODE);
-		}
+		uint32_t skipped = 0;
 
-		if (! cmd->node) {
-			as_error err;
-			as_error_set_message(&err, AEROSPIKE_ERR_CLIENT, "Cluster is empty");
+		while (true) {
+			if (cmd->cluster->shm_info) {
+				cmd->node = as_partition_shm_get_node(cmd->cluster, cmd->partition, cmd->replica, cmd->replica_index, cmd->flags & AS_ASYNC_FLAGS_CP_MODE);
+			}
+			else {
+				cmd->node = as_partition_get_node(cmd->cluster, cmd->partition, cmd->replica, cmd->replica_index, cmd->flags & AS_ASYNC_FLAGS_CP_MODE);
+			}
 
-			if (cmd->flags & AS_ASYNC_FLAGS_HAS_TIMER) {
-				as_event_stop_timer(cmd);
+			if (! cmd->node) {
+				as_error err;
+				as_error_set_message(&err, AEROSPIKE_ERR_CLIENT, "No available node for key");
+
+				if (cmd->flags & AS_ASYNC_FLAGS_HAS_TIMER) {
+					as_event_stop_timer(cmd);
+				}
+				as_event_error_callback(cmd, &err);
+				return;
 			}
-			as_event_error_callback(cmd, &err);
-			return;
+
+			if (as_node_breaker_begin(cmd->node, &cmd->breaker_probe)) {
+				break;
+			}
+
+			// Another command claimed the probe of this node's open circuit breaker.
+			// Nothing was sent, so move to the next replica without counting a retry.
+			// Commands that can only use the master fail fast.
+			if (cmd->replica == AS_POLICY_REPLICA_MASTER || ++skipped >= AS_MAX_REPLICAS) {
+				as_error err;
+				as_error_update(&err, AEROSPIKE_ERR_INVALID_NODE, "Node %s circuit breaker is open",
+					cmd->node->name);
+
+				if (cmd->flags & AS_ASYNC_FLAGS_HAS_TIMER) {
+					as_event_stop_timer(cmd);
+				}
+				as_event_error_callback(cmd, &err);
+				return;
+			}
+			as_node_release(cmd->node);
+			cmd->replica_index++;
 		}
 	}
 
+	if (cmd->cluster->shm_info && cmd->type != AS_ASYNC_TYPE_CONNECTOR) {
+		as_node_begin_command(cmd->node);
+		cmd->in_flight = true;
+	}
+
 	if (cmd->pipe_listener) {
 		as_pipe_get_connection(cmd);
 		return;
@@ -381,8 +671,8 @@ as_event_command_begin(as_event_command* cmd)
 	as_conn_pool* pool = &cmd->node->async_conn_pools[cmd->event_loop->index];
 	as_async_connection* conn;
 
-	// Find connection.
-	while (as_conn_pool_get(pool, &conn)) {
+	// Find connection.  Connection warm-up commands always open a new connection.
+	while (cmd->type != AS_ASYNC_TYPE_CONNECTOR && as_conn_pool_get(pool, &conn)) {
 		// Verify that socket is active and receive buffer is empty.
 		int len = as_event_validate_connection(&conn->base);
 
@@ -433,7 +723,7 @@ as_event_socket_timeout(as_event_command* cmd)
 
 		if (cmd->total_deadline > 0) {
 			// Check total timeout.
-			uint64_t now = cf_getms();
+			uint64_t now = cf_getus();
 
 			if (now >= cmd->total_deadline) {
 				cmd->iteration++;
@@ -460,6 +750,8 @@ as_event_socket_timeout(as_event_command* cmd)
 		return;
 	}
 
+	as_node_breaker_result(cmd->node, AEROSPIKE_ERR_TIMEOUT, cmd->breaker_probe);
+
 	if (cmd->pipe_listener) {
 		as_pipe_timeout(cmd, true);
 		return;
@@ -486,6 +778,8 @@ as_event_socket_timeout(as_event_command* cmd)
 void
 as_event_total_timeout(as_event_command* cmd)
 {
+	as_node_breaker_result(cmd->node, AEROSPIKE_ERR_TIMEOUT, cmd->breaker_probe);
+
 	if (cmd->pipe_listener) {
 		as_pipe_timeout(cmd, false);
 		return;
@@ -510,14 +804,23 @@ as_event_command_retry(as_event_command* cmd, bool alternate)
 		return false;
 	}
 
+	uint64_t now = 0;
+
 	if (cmd->total_deadline > 0) {
 		// Check total timeout.
-		uint64_t now = cf_getms();
+		now = cf_getus();
 
 		if (now >= cmd->total_deadline) {
 			return false;
 		}
+	}
 
+	// Check cluster wide retry budget.  Only spend a token on a retry that will be sent.
+	if (! as_cluster_retry_withdraw(cmd->cluster)) {
+		return false;
+	}
+
+	if (cmd->total_deadline > 0) {
 		if (cmd->flags & AS_ASYNC_FLAGS_USING_SOCKET_TIMER) {
 			uint64_t remaining = cmd->total_deadline - now;
 
@@ -537,7 +840,7 @@ as_event_command_retry(as_event_command* cmd, bool alternate)
 	}
 
 	if (alternate) {
-		cmd->flags ^= AS_ASYNC_FLAGS_MASTER;  // Alternate between master and prole.
+		cmd->replica_index++;  // Move to next replica.
 	}
 
 	// Retry command at the end of the queue so other commands have a chance to run first.
@@ -557,6 +860,9 @@ as_event_put_connection(as_event_command* cmd, as_conn_pool* pool)
 static inline void
 as_event_response_complete(as_event_command* cmd)
 {
+	as_node_breaker_result(cmd->node, AEROSPIKE_OK, cmd->breaker_probe);
+	as_cluster_retry_deposit(cmd->cluster);
+
 	if (cmd->pipe_listener != NULL) {
 		as_pipe_response_complete(cmd);
 		return;
@@ -689,9 +995,28 @@ as_event_executor_complete(as_event_command* cmd)
 	as_event_command_release(cmd);
 }
 
+static inline as_completion_type
+as_completion_type_of(as_event_command* cmd)
+{
+	switch (cmd->type) {
+		case AS_ASYNC_TYPE_RECORD:
+			return AS_COMPLETION_RECORD;
+		case AS_ASYNC_TYPE_VALUE:
+			return AS_COMPLETION_VALUE;
+		default:
+			return AS_COMPLETION_WRITE;
+	}
+}
+
 void
 as_event_error_callback(as_event_command* cmd, as_error* err)
 {
+	if (as_completion_enabled(cmd->event_loop) && cmd->type <= AS_ASYNC_TYPE_VALUE) {
+		as_completion_add(cmd->event_loop, as_completion_type_of(cmd), err, NULL, NULL, cmd->udata);
+		as_event_command_release(cmd);
+		return;
+	}
+
 	switch (cmd->type) {
 		case AS_ASYNC_TYPE_WRITE:
 			((as_async_write_command*)cmd)->listener(err, cmd->udata, cmd->event_loop);
@@ -702,6 +1027,10 @@ as_event_error_callback(as_event_command* cmd, as_error* err)
 		case AS_ASYNC_TYPE_VALUE:
 			((as_async_value_command*)cmd)->listener(err, 0, cmd->udata, cmd->event_loop);
 			break;
+		case AS_ASYNC_TYPE_CONNECTOR:
+			// Connection warm-up is retried on next cluster tend.
+			as_log_debug("Node %s async connection warm-up failed: %s", cmd->node->name, err->message);
+			break;
 			
 		default:
 			// Handle command that is part of a group (batch, scan, query).
@@ -735,6 +1064,8 @@ as_event_parse_error(as_event_command* cmd, as_error* err)
 void
 as_event_socket_error(as_event_command* cmd, as_error* err)
 {
+	as_node_breaker_result(cmd->node, err->code, cmd->breaker_probe);
+
 	if (cmd->pipe_listener) {
 		// Retry pipeline commands.
 		as_pipe_socket_error(cmd, err, true);
@@ -753,6 +1084,8 @@ as_event_socket_error(as_event_command* cmd, as_error* err)
 void
 as_event_response_error(as_event_command* cmd, as_error* err)
 {
+	as_node_breaker_result(cmd->node, err->code, cmd->breaker_probe);
+
 	if (cmd->pipe_listener != NULL) {
 		as_pipe_response_error(cmd, err);
 		return;
@@ -787,6 +1120,100 @@ as_event_response_error(as_event_command* cmd, as_error* err)
 	as_event_error_callback(cmd, err);
 }
 
+static bool
+as_event_command_read_body(as_event_command* cmd)
+{
+	as_proto* proto = (as_proto*)cmd->buf;
+	as_proto_swap_from_be(proto);
+	size_t size = proto->sz;
+
+	cmd->len = (uint32_t)size;
+	cmd->pos = 0;
+	cmd->state = AS_ASYNC_STATE_COMMAND_READ_BODY;
+
+	// Info responses, like the connection warm-up reply, can be shorter than a record header.
+	if (proto->type == AS_MESSAGE_TYPE && cmd->len < sizeof(as_msg)) {
+		as_error err;
+		as_error_update(&err, AEROSPIKE_ERR_CLIENT, "Invalid record header size: %u", cmd->len);
+		as_event_parse_error(cmd, &err);
+		return false;
+	}
+
+	if (cmd->len > cmd->read_capacity) {
+		if (cmd->flags & AS_ASYNC_FLAGS_FREE_BUF) {
+			as_command_pool_free(cmd->buf);
+		}
+		cmd->buf = as_command_pool_alloc(size, NULL);
+		cmd->read_capacity = cmd->len;
+		cmd->flags |= AS_ASYNC_FLAGS_FREE_BUF;
+	}
+	return true;
+}
+
+bool
+as_event_command_parse_buffer(as_event_command* cmd, uint8_t* buf, uint32_t size)
+{
+	// Bytes that follow a command's response belong to the command's next block
+	// (batch, scan, query) or to the next reader of a pipelined connection.
+	as_event_loop* event_loop = cmd->event_loop;
+	as_event_connection* conn = cmd->conn;
+	uint8_t* p = buf;
+	uint8_t* end = buf + size;
+	bool done = false;
+
+	while (true) {
+		uint32_t len = cmd->len - cmd->pos;
+		uint32_t avail = (uint32_t)(end - p);
+
+		if (len > avail) {
+			len = avail;
+		}
+
+		memcpy(cmd->buf + cmd->pos, p, len);
+		cmd->pos += len;
+		cmd->flags |= AS_ASYNC_FLAGS_EVENT_RECEIVED;
+		p += len;
+
+		if (cmd->pos < cmd->len) {
+			// Wait for rest of response.
+			return done;
+		}
+
+		if (cmd->state == AS_ASYNC_STATE_COMMAND_READ_HEADER) {
+			if (! as_event_command_read_body(cmd)) {
+				return true;
+			}
+			continue;
+		}
+
+		// Connection is released when its last reader completes, so only look for
+		// the next reader if there is one now.
+		bool next_reader = p < end && conn->pipeline &&
+			cf_ll_size(&((as_pipe_connection*)conn)->readers) > 1;
+
+		event_loop->read_conn = conn;
+
+		if (! cmd->parse_results(cmd)) {
+			// Batch, scan, query is not finished.
+			cmd->len = sizeof(as_proto);
+			cmd->pos = 0;
+			cmd->state = AS_ASYNC_STATE_COMMAND_READ_HEADER;
+			continue;
+		}
+
+		done = true;
+
+		if (! next_reader || event_loop->read_conn != conn) {
+			// No more responses expected or connection was canceled.
+			event_loop->read_conn = NULL;
+			return true;
+		}
+
+		event_loop->read_conn = NULL;
+		cmd = as_pipe_link_to_command(cf_ll_get_head(&((as_pipe_connection*)conn)->readers));
+	}
+}
+
 bool
 as_event_command_parse_header(as_event_command* cmd)
 {
@@ -794,7 +1221,13 @@ as_event_command_parse_header(as_event_command* cmd)
 	
 	if (msg->result_code == AEROSPIKE_OK) {
 		as_event_response_complete(cmd);
-		((as_async_write_command*)cmd)->listener(0, cmd->udata, cmd->event_loop);
+
+		if (as_completion_enabled(cmd->event_loop)) {
+			as_completion_add(cmd->event_loop, AS_COMPLETION_WRITE, NULL, NULL, NULL, cmd->udata);
+		}
+		else {
+			((as_async_write_command*)cmd)->listener(0, cmd->udata, cmd->event_loop);
+		}
 		as_event_command_release(cmd);
 	}
 	else {
@@ -816,30 +1249,41 @@ as_event_command_parse_result(as_event_command* cmd)
 	
 	switch (status) {
 		case AEROSPIKE_OK: {
-			as_record rec;
-			
-			if (msg->n_ops < 1000) {
-				as_record_inita(&rec, msg->n_ops);
+			as_record rec_local;
+			as_record* rec = &rec_local;
+
+			if (as_completion_enabled(cmd->event_loop)) {
+				// Record is owned by completion until batch is delivered.
+				rec = as_record_new(msg->n_ops);
+			}
+			else if (msg->n_ops < 1000) {
+				as_record_inita(rec, msg->n_ops);
 			}
 			else {
-				as_record_init(&rec, msg->n_ops);
+				as_record_init(rec, msg->n_ops);
 			}
 			
-			rec.gen = msg->generation;
-			rec.ttl = cf_server_void_time_to_ttl(msg->record_ttl);
+			rec->gen = msg->generation;
+			rec->ttl = cf_server_void_time_to_ttl(msg->record_ttl);
 			
 			p = as_command_ignore_fields(p, msg->n_fields);
-			status = as_command_parse_bins(&p, &err, &rec, msg->n_ops, cmd->deserialize);
+			status = as_command_parse_bins(&p, &err, rec, msg->n_ops, cmd->deserialize);
 
 			if (status == AEROSPIKE_OK) {
 				as_event_response_complete(cmd);
-				((as_async_record_command*)cmd)->listener(0, &rec, cmd->udata, cmd->event_loop);
+
+				if (as_completion_enabled(cmd->event_loop)) {
+					as_completion_add(cmd->event_loop, AS_COMPLETION_RECORD, NULL, rec, NULL, cmd->udata);
+					as_event_command_release(cmd);
+					break;
+				}
+				((as_async_record_command*)cmd)->listener(0, rec, cmd->udata, cmd->event_loop);
 				as_event_command_release(cmd);
 			}
 			else {
 				as_event_response_error(cmd, &err);
 			}
-			as_record_destroy(&rec);
+			as_record_destroy(rec);
 			break;
 		}
 			
@@ -874,6 +1318,12 @@ as_event_command_parse_success_failure(as_event_command* cmd)
 			
 			if (status == AEROSPIKE_OK) {
 				as_event_response_complete(cmd);
+
+				if (as_completion_enabled(cmd->event_loop)) {
+					as_completion_add(cmd->event_loop, AS_COMPLETION_VALUE, NULL, NULL, val, cmd->udata);
+					as_event_command_release(cmd);
+					break;
+				}
 				((as_async_value_command*)cmd)->listener(0, val, cmd->udata, cmd->event_loop);
 				as_event_command_release(cmd);
 				as_val_destroy(val);
@@ -906,14 +1356,185 @@ as_event_command_free(as_event_command* cmd)
 {
 	cmd->cluster->pending[cmd->event_loop->index]--;
 
+	if (cmd->in_flight) {
+		as_node_end_command(cmd->node);
+	}
+
 	if (cmd->node) {
 		as_node_release(cmd->node);
 	}
 
 	if (cmd->flags & AS_ASYNC_FLAGS_FREE_BUF) {
-		cf_free(cmd->buf);
+		as_command_pool_free(cmd->buf);
+	}
+	as_command_pool_free(cmd);
+}
+
+/******************************************************************************
+ * CONNECTION WARM-UP FUNCTIONS
+ *****************************************************************************/
+
+typedef struct {
+	as_event_command command;
+	uint8_t space[];
+} as_event_connector_command;
+
+typedef struct {
+	as_node* node;
+	as_event_loop* event_loop;
+} as_event_balance_state;
+
+static bool
+as_event_connector_parse(as_event_command* cmd)
+{
+	// Info response is not used.  Put connected and authenticated connection into pool.
+	as_event_response_complete(cmd);
+	as_event_command_release(cmd);
+	return true;
+}
+
+static void
+as_event_connector_execute(as_cluster* cluster, as_node* node, as_event_loop* event_loop)
+{
+	// Send the smallest info request, so the new connection goes through the normal
+	// connect, authenticate, write and read path before it is put into the pool.
+	static const char names[] = "node\n";
+	size_t names_len = sizeof(names) - 1;
+	size_t write_size = sizeof(as_proto) + names_len;
+	size_t s = sizeof(as_event_connector_command) + write_size + AS_AUTHENTICATION_MAX_SIZE;
+
+	as_event_command* cmd = (as_event_command*)as_command_pool_alloc(s, &s);
+	as_event_connector_command* ccmd = (as_event_connector_command*)cmd;
+	cmd->total_deadline = (uint64_t)cluster->conn_timeout_ms * 1000;
+	cmd->socket_timeout = 0;
+	cmd->max_retries = 0;
+	cmd->iteration = 0;
+	cmd->replica = AS_POLICY_REPLICA_MASTER;
+	cmd->event_loop = event_loop;
+	cmd->cluster = cluster;
+	as_node_reserve(node);
+	cmd->node = node;
+	cmd->partition = NULL;
+	cmd->udata = NULL;
+	cmd->parse_results = as_event_connector_parse;
+	cmd->pipe_listener = NULL;
+	cmd->buf = ccmd->space;
+	cmd->read_capacity = (uint32_t)(s - write_size - sizeof(as_event_connector_command));
+	cmd->type = AS_ASYNC_TYPE_CONNECTOR;
+	cmd->state = AS_ASYNC_STATE_UNREGISTERED;
+	cmd->flags = 0;
+	cmd->replica_index = 0;
+	cmd->deserialize = false;
+
+	as_proto* proto = (as_proto*)cmd->buf;
+	proto->sz = names_len;
+	proto->version = AS_MESSAGE_VERSION;
+	proto->type = AS_INFO_MESSAGE_TYPE;
+	as_proto_swap_to_be(proto);
+	memcpy(cmd->buf + sizeof(as_proto), names, names_len);
+	cmd->write_len = (uint32_t)write_size;
+
+	as_error err;
+	as_status status = as_event_command_execute(cmd, &err);
+
+	if (status != AEROSPIKE_OK) {
+		as_log_debug("Node %s async connection warm-up failed: %s", node->name, err.message);
+	}
+}
+
+static void
+as_event_balance_connections_cb(as_event_balance_state* state)
+{
+	as_node* node = state->node;
+	as_event_loop* event_loop = state->event_loop;
+	as_cluster* cluster = node->cluster;
+
+	if (cluster->pending[event_loop->index] >= 0 && node->active) {
+		as_conn_pool* pool = &node->async_conn_pools[event_loop->index];
+		uint32_t min = as_conn_pool_share(cluster->async_min_conns_per_node,
+										  as_event_loop_size, event_loop->index);
+		as_async_connection* conn;
+
+		// Close idle connections that are not needed to cover recent peak usage.
+		// Connections are popped directly from the queue, so balancing does not count
+		// as pool usage.
+		uint32_t trim = as_conn_pool_trim_count(pool, min);
+		uint32_t trimmed = 0;
+
+		while (trimmed < trim && as_queue_pop(&pool->queue, &conn)) {
+			as_event_release_connection(&conn->base, pool);
+			trimmed++;
+		}
+
+		if (trimmed > 0) {
+			as_faa_uint64(&node->async_conns_trimmed, trimmed);
+		}
+
+		as_conn_pool* pipe_pool = &node->pipe_conn_pools[event_loop->index];
+		trimmed = as_pipe_trim_connections(pipe_pool, as_conn_pool_trim_count(pipe_pool, 0));
+
+		if (trimmed > 0) {
+			as_faa_uint64(&node->pipe_conns_trimmed, trimmed);
+		}
+
+		if (min > 0) {
+			uint32_t now = (uint32_t)cf_get_seconds();
+			uint32_t margin = (cluster->tend_interval + 999) / 1000;
+			uint32_t size = as_queue_size(&pool->queue);
+
+			// Close pooled connections that would expire before the next tend.
+			for (uint32_t i = 0; i < size && as_queue_pop(&pool->queue, &conn); i++) {
+				if (as_event_connection_expiring(&conn->base, now, margin) ||
+					! as_conn_pool_put(pool, &conn)) {
+					as_event_release_connection(&conn->base, pool);
+				}
+			}
+
+			// Pool total includes connections in use and connections being opened.
+			uint32_t total = pool->total;
+
+			for (uint32_t i = total; i < min; i++) {
+				as_event_connector_execute(cluster, node, event_loop);
+			}
+		}
+	}
+	as_node_release(node);
+	cf_free(state);
+}
+
+void
+as_event_balance_connections(as_node* node)
+{
+	as_cluster* cluster = node->cluster;
+
+	// Cluster tend thread holds tend_lock, so async_closing can not change while
+	// balance callbacks are queued.  Event loop queues are processed in order, so
+	// these callbacks run before the cluster close callbacks.
+	if (cluster->async_closing) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < as_event_loop_size; i++) {
+		// Pool totals are read without locks.  Do not wake event loops that have no
+		// connections to this node and no minimum to maintain.
+		if (as_load_uint32(&node->async_conn_pools[i].total) == 0 &&
+			as_load_uint32(&node->pipe_conn_pools[i].total) == 0 &&
+			as_conn_pool_share(cluster->async_min_conns_per_node, as_event_loop_size, i) == 0) {
+			continue;
+		}
+
+		as_event_loop* event_loop = &as_event_loops[i];
+
+		as_event_balance_state* state = cf_malloc(sizeof(as_event_balance_state));
+		as_node_reserve(node);
+		state->node = node;
+		state->event_loop = event_loop;
+
+		if (! as_event_execute(event_loop, (as_event_executable)as_event_balance_connections_cb, state)) {
+			as_node_release(node);
+			cf_free(state);
+		}
 	}
-	cf_free(cmd);
 }
 
 /******************************************************************************
@@ -987,6 +1608,11 @@ as_event_close_cluster(as_cluster* cluster)
 		as_monitor_init(monitor);
 	}
 
+	// Stop cluster tend thread from queuing connection warm-up to event loops.
+	pthread_mutex_lock(&cluster->tend_lock);
+	cluster->async_closing = true;
+	pthread_mutex_unlock(&cluster->tend_lock);
+
 	uint32_t* event_loop_count = cf_malloc(sizeof(uint32_t));
 	*event_loop_count = as_event_loop_size;
 
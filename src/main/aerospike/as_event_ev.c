@@ -20,6 +20,7 @@
 #include <aerospike/as_async.h>
 #include <aerospike/as_atomic.h>
 #include <aerospike/as_log_macros.h>
+#include <aerospike/as_monitor.h>
 #include <aerospike/as_pipe.h>
 #include <aerospike/as_proto.h>
 #include <aerospike/as_socket.h>
@@ -42,6 +43,12 @@ extern bool as_event_threads_created;
 
 #if defined(AS_USE_LIBEV)
 
+typedef struct {
+	as_event_loop* event_loop;
+	as_monitor monitor;
+	bool created;
+} as_ev_thread_data;
+
 static void
 as_ev_close_loop(as_event_loop* event_loop)
 {
@@ -55,6 +62,7 @@ as_ev_close_loop(as_event_loop* event_loop)
 	// Cleanup event loop resources.
 	as_queue_destroy(&event_loop->queue);
 	as_queue_destroy(&event_loop->pipe_cb_queue);
+	cf_free(event_loop->read_buf);
 	pthread_mutex_destroy(&event_loop->lock);
 }
 
@@ -93,36 +101,63 @@ as_ev_wakeup(struct ev_loop* loop, ev_async* wakeup, int revents)
 	}
 }
 
+static inline void
+as_ev_init_loop(as_event_loop* event_loop)
+{
+	ev_async_init(&event_loop->wakeup, as_ev_wakeup);
+	event_loop->wakeup.data = event_loop;
+	ev_async_start(event_loop->loop, &event_loop->wakeup);	
+}
+
 static void*
 as_ev_worker(void* udata)
 {
-	struct ev_loop* loop = udata;
+	as_ev_thread_data* data = udata;
+	as_event_loop* event_loop = data->event_loop;
+
+	// Create loop in event loop thread, so loop memory is placed on the NUMA node
+	// of the cpu this thread is pinned to.
+	struct ev_loop* loop = ev_loop_new(EVFLAG_AUTO);
+
+	if (! loop) {
+		as_log_error("Failed to create event loop");
+		as_monitor_notify(&data->monitor);
+		return NULL;
+	}
+
+	event_loop->loop = loop;
+	as_ev_init_loop(event_loop);
+	data->created = true;
+	as_monitor_notify(&data->monitor);
+
 	ev_loop(loop, 0);
 	ev_loop_destroy(loop);
 	as_tls_thread_cleanup();
 	return NULL;
 }
 
-static inline void
-as_ev_init_loop(as_event_loop* event_loop)
-{
-	ev_async_init(&event_loop->wakeup, as_ev_wakeup);
-	event_loop->wakeup.data = event_loop;
-	ev_async_start(event_loop->loop, &event_loop->wakeup);	
-}
-
 bool
 as_event_create_loop(as_event_loop* event_loop)
 {
-	event_loop->loop = ev_loop_new(EVFLAG_AUTO);
-	
-	if (! event_loop->loop) {
-		as_log_error("Failed to create event loop");
+	as_ev_thread_data thread_data;
+	thread_data.event_loop = event_loop;
+	thread_data.created = false;
+	as_monitor_init(&thread_data.monitor);
+
+	if (! as_event_thread_create(event_loop, as_ev_worker, &thread_data)) {
+		as_monitor_destroy(&thread_data.monitor);
 		return false;
 	}
-	as_ev_init_loop(event_loop);
-	
-	return pthread_create(&event_loop->thread, NULL, as_ev_worker, event_loop->loop) == 0;
+
+	// Must wait until loop is created in event loop thread.
+	as_monitor_wait(&thread_data.monitor);
+	as_monitor_destroy(&thread_data.monitor);
+
+	if (! thread_data.created) {
+		pthread_join(event_loop->thread, NULL);
+		return false;
+	}
+	return true;
 }
 
 void
@@ -425,9 +460,9 @@ as_ev_command_peek_block(as_event_command* cmd)
 		// till next iteration.
 		if (cmd->len > cmd->read_capacity) {
 			if (cmd->flags & AS_ASYNC_FLAGS_FREE_BUF) {
-				cf_free(cmd->buf);
+				as_command_pool_free(cmd->buf);
 			}
-			cmd->buf = cf_malloc(size);
+			cmd->buf = as_command_pool_alloc(size, NULL);
 			cmd->read_capacity = cmd->len;
 			cmd->flags |= AS_ASYNC_FLAGS_FREE_BUF;
 		}
@@ -476,11 +511,54 @@ as_ev_parse_authentication(as_event_command* cmd)
 	return AS_EVENT_READ_COMPLETE;
 }
 
+static int
+as_ev_command_read_buffered(as_event_command* cmd)
+{
+	// Read as much as is available, so response header and body usually arrive together.
+	int fd = cmd->conn->socket.fd;
+	uint8_t* buf = as_event_get_read_buffer(cmd->event_loop);
+	ssize_t bytes = read(fd, buf, AS_EVENT_READ_BUFFER_SIZE);
+
+	if (bytes > 0) {
+		if (as_event_command_parse_buffer(cmd, buf, (uint32_t)bytes)) {
+			return AS_EVENT_COMMAND_DONE;
+		}
+		return AS_EVENT_READ_COMPLETE;
+	}
+
+	if (bytes < 0) {
+		int e = as_last_error();
+
+		if (e == EWOULDBLOCK) {
+			as_ev_watch_read(cmd);
+			return AS_EVENT_READ_INCOMPLETE;
+		}
+
+		if (! as_event_socket_retry(cmd)) {
+			as_error err;
+			as_socket_error(fd, cmd->node, &err, AEROSPIKE_ERR_ASYNC_CONNECTION, "Socket read failed", e);
+			as_event_socket_error(cmd, &err);
+		}
+		return AS_EVENT_READ_ERROR;
+	}
+
+	if (! as_event_socket_retry(cmd)) {
+		as_error err;
+		as_socket_error(fd, cmd->node, &err, AEROSPIKE_ERR_ASYNC_CONNECTION, "Socket read closed by peer", 0);
+		as_event_socket_error(cmd, &err);
+	}
+	return AS_EVENT_READ_ERROR;
+}
+
 static int
 as_ev_command_read(as_event_command* cmd)
 {
 	int rv;
 
+	if (! cmd->conn->socket.ctx && as_event_read_buffered(cmd)) {
+		return as_ev_command_read_buffered(cmd);
+	}
+
 	if (cmd->state == AS_ASYNC_STATE_COMMAND_READ_HEADER) {
 		// Read response length
 		rv = as_ev_read(cmd);
@@ -498,9 +576,9 @@ as_ev_command_read(as_event_command* cmd)
 		
 		if (cmd->len > cmd->read_capacity) {
 			if (cmd->flags & AS_ASYNC_FLAGS_FREE_BUF) {
-				cf_free(cmd->buf);
+				as_command_pool_free(cmd->buf);
 			}
-			cmd->buf = cf_malloc(size);
+			cmd->buf = as_command_pool_alloc(size, NULL);
 			cmd->read_capacity = cmd->len;
 			cmd->flags |= AS_ASYNC_FLAGS_FREE_BUF;
 		}
@@ -749,6 +827,10 @@ as_ev_try_family_connections(as_event_command* cmd, int family, int begin, int e
 		return -1001;
 	}
 
+	if (sock->ctx) {
+		as_tls_set_session(sock, &cmd->node->tls_session);
+	}
+
 	// Try addresses.
 	as_address* addresses = cmd->node->addresses;
 	socklen_t size = (family == AF_INET)? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
@@ -786,6 +868,7 @@ as_ev_connect_error(as_event_command* cmd, as_address* primary, int rv)
 	cf_free(cmd->conn);
 	as_event_decr_conn(cmd);
 	cmd->event_loop->errors++;
+	as_node_breaker_result(cmd->node, AEROSPIKE_ERR_ASYNC_CONNECTION, cmd->breaker_probe);
 
 	if (as_event_command_retry(cmd, true)) {
 		return;
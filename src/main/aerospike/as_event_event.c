@@ -20,6 +20,7 @@
 #include <aerospike/as_async.h>
 #include <aerospike/as_atomic.h>
 #include <aerospike/as_log_macros.h>
+#include <aerospike/as_monitor.h>
 #include <aerospike/as_pipe.h>
 #include <aerospike/as_proto.h>
 #include <aerospike/as_socket.h>
@@ -33,6 +34,12 @@
 #include <event.h>
 #include <event2/thread.h>
 
+typedef struct {
+	as_event_loop* event_loop;
+	as_monitor monitor;
+	bool created;
+} as_event_thread_data;
+
 /******************************************************************************
  * GLOBALS
  *****************************************************************************/
@@ -77,6 +84,7 @@ as_event_close_loop(as_event_loop* event_loop)
 	// Cleanup event loop resources.
 	as_queue_destroy(&event_loop->queue);
 	as_queue_destroy(&event_loop->pipe_cb_queue);
+	cf_free(event_loop->read_buf);
 	pthread_mutex_destroy(&event_loop->lock);
 }
 
@@ -115,21 +123,84 @@ as_event_wakeup(evutil_socket_t socket, short revents, void* udata)
 	}
 }
 
+#if LIBEVENT_VERSION_NUMBER < 0x02010000
+void event_base_add_virtual(struct event_base*);
+#endif
+
+static inline struct event_base*
+as_event_base_new()
+{
+#if !defined(_MSC_VER)
+	return event_base_new();
+#else
+	struct event_config* config = event_config_new();
+	event_config_set_flag(config, EVENT_BASE_FLAG_STARTUP_IOCP);
+	struct event_base* loop = event_base_new_with_config(config);
+	event_config_free(config);
+	return loop;
+#endif
+}
+
+static inline void
+as_event_init_loop(as_event_loop* event_loop)
+{
+	if (evthread_make_base_notifiable(event_loop->loop) == -1) {
+        as_log_error("evthread_make_base_notifiable failed");
+        return;
+    }
+
+	evtimer_assign(&event_loop->wakeup, event_loop->loop, as_event_wakeup, event_loop);
+	/*
+	event_assign(&event_loop->wakeup, event_loop->loop, -1, EV_PERSIST | EV_READ, as_event_wakeup, event_loop);
+
+	if (event_add(&event_loop->wakeup, NULL) == -1) {
+        as_log_error("as_event_init_loop: event_add failed");
+		return;
+	}
+	*/
+}
+
 static void*
 as_event_worker(void* udata)
 {
+	as_event_thread_data* data = udata;
+	as_event_loop* event_loop = data->event_loop;
+
 #if defined(_MSC_VER)
 	// event_base_dispatch() requires that WSAStartup() be called 
 	// in this thread on windows.
 	WORD version = MAKEWORD(2, 2);
-	WSADATA data;
-	if (WSAStartup(version, &data) != 0) {
+	WSADATA wsa_data;
+	if (WSAStartup(version, &wsa_data) != 0) {
 		as_log_error("WSAStartup() failed");
+		as_monitor_notify(&data->monitor);
+		return NULL;
+	}
+#endif
+
+	// Create loop in event loop thread, so loop memory is placed on the NUMA node
+	// of the cpu this thread is pinned to.
+	struct event_base* loop = as_event_base_new();
+
+	if (! loop) {
+		as_log_error("Failed to create event loop");
+		as_monitor_notify(&data->monitor);
+#if defined(_MSC_VER)
+		WSACleanup();
+#endif
 		return NULL;
 	}
+
+	event_loop->loop = loop;
+
+	// Add a virtual event to prevent event_base_dispatch() from returning prematurely.
+#if LIBEVENT_VERSION_NUMBER < 0x02010000
+	event_base_add_virtual(loop);
 #endif
 
-	struct event_base* loop = udata;
+	as_event_init_loop(event_loop);
+	data->created = true;
+	as_monitor_notify(&data->monitor);
 
 #if LIBEVENT_VERSION_NUMBER < 0x02010000
 	int status = event_base_dispatch(loop);
@@ -150,54 +221,28 @@ as_event_worker(void* udata)
 	return NULL;
 }
 
-static inline void
-as_event_init_loop(as_event_loop* event_loop)
-{
-	if (evthread_make_base_notifiable(event_loop->loop) == -1) {
-        as_log_error("evthread_make_base_notifiable failed");
-        return;
-    }
-
-	evtimer_assign(&event_loop->wakeup, event_loop->loop, as_event_wakeup, event_loop);
-	/*
-	event_assign(&event_loop->wakeup, event_loop->loop, -1, EV_PERSIST | EV_READ, as_event_wakeup, event_loop);
-
-	if (event_add(&event_loop->wakeup, NULL) == -1) {
-        as_log_error("as_event_init_loop: event_add failed");
-		return;
-	}
-	*/
-}
-
-#if LIBEVENT_VERSION_NUMBER < 0x02010000
-void event_base_add_virtual(struct event_base*);
-#endif
-
 bool
 as_event_create_loop(as_event_loop* event_loop)
 {
-#if !defined(_MSC_VER)
-	event_loop->loop = event_base_new();
-#else
-	struct event_config* config = event_config_new();
-	event_config_set_flag(config, EVENT_BASE_FLAG_STARTUP_IOCP);
-	event_loop->loop = event_base_new_with_config(config);
-	event_config_free(config);
-#endif
+	as_event_thread_data thread_data;
+	thread_data.event_loop = event_loop;
+	thread_data.created = false;
+	as_monitor_init(&thread_data.monitor);
 
-	if (! event_loop->loop) {
-		as_log_error("Failed to create event loop");
+	if (! as_event_thread_create(event_loop, as_event_worker, &thread_data)) {
+		as_monitor_destroy(&thread_data.monitor);
 		return false;
 	}
 
-	// Add a virtual event to prevent event_base_dispatch() from returning prematurely.
-#if LIBEVENT_VERSION_NUMBER < 0x02010000
-	event_base_add_virtual(event_loop->loop);
-#endif
-
-	as_event_init_loop(event_loop);
+	// Must wait until loop is created in event loop thread.
+	as_monitor_wait(&thread_data.monitor);
+	as_monitor_destroy(&thread_data.monitor);
 
-	return pthread_create(&event_loop->thread, NULL, as_event_worker, event_loop->loop) == 0;
+	if (! thread_data.created) {
+		pthread_join(event_loop->thread, NULL);
+		return false;
+	}
+	return true;
 }
 
 void
@@ -506,9 +551,9 @@ as_event_command_peek_block(as_event_command* cmd)
 		// till next iteration.
 		if (cmd->len > cmd->read_capacity) {
 			if (cmd->flags & AS_ASYNC_FLAGS_FREE_BUF) {
-				cf_free(cmd->buf);
+				as_command_pool_free(cmd->buf);
 			}
-			cmd->buf = cf_malloc(size);
+			cmd->buf = as_command_pool_alloc(size, NULL);
 			cmd->read_capacity = cmd->len;
 			cmd->flags |= AS_ASYNC_FLAGS_FREE_BUF;
 		}
@@ -557,10 +602,57 @@ as_event_parse_authentication(as_event_command* cmd)
 	return AS_EVENT_READ_COMPLETE;
 }
 
+static int
+as_event_command_read_buffered(as_event_command* cmd)
+{
+	// Read as much as is available, so response header and body usually arrive together.
+	as_socket_fd fd = cmd->conn->socket.fd;
+	uint8_t* buf = as_event_get_read_buffer(cmd->event_loop);
+#if !defined(_MSC_VER)
+	int bytes = (int)read(fd, buf, AS_EVENT_READ_BUFFER_SIZE);
+#else
+	int bytes = (int)recv(fd, buf, AS_EVENT_READ_BUFFER_SIZE, 0);
+#endif
+
+	if (bytes > 0) {
+		if (as_event_command_parse_buffer(cmd, buf, (uint32_t)bytes)) {
+			return AS_EVENT_COMMAND_DONE;
+		}
+		return AS_EVENT_READ_COMPLETE;
+	}
+
+	if (bytes < 0) {
+		int e = as_last_error();
+
+		if (e == AS_WOULDBLOCK) {
+			as_event_watch_read(cmd);
+			return AS_EVENT_READ_INCOMPLETE;
+		}
+
+		if (! as_event_socket_retry(cmd)) {
+			as_error err;
+			as_socket_error(fd, cmd->node, &err, AEROSPIKE_ERR_ASYNC_CONNECTION, "Socket read failed", e);
+			as_event_socket_error(cmd, &err);
+		}
+		return AS_EVENT_READ_ERROR;
+	}
+
+	if (! as_event_socket_retry(cmd)) {
+		as_error err;
+		as_socket_error(fd, cmd->node, &err, AEROSPIKE_ERR_ASYNC_CONNECTION, "Socket read closed by peer", 0);
+		as_event_socket_error(cmd, &err);
+	}
+	return AS_EVENT_READ_ERROR;
+}
+
 static int
 as_event_command_read(as_event_command* cmd)
 {
 	int rv;
+
+	if (! cmd->conn->socket.ctx && as_event_read_buffered(cmd)) {
+		return as_event_command_read_buffered(cmd);
+	}
 	
 	if (cmd->state == AS_ASYNC_STATE_COMMAND_READ_HEADER) {
 		// Read response length
@@ -579,9 +671,9 @@ as_event_command_read(as_event_command* cmd)
 		
 		if (cmd->len > cmd->read_capacity) {
 			if (cmd->flags & AS_ASYNC_FLAGS_FREE_BUF) {
-				cf_free(cmd->buf);
+				as_command_pool_free(cmd->buf);
 			}
-			cmd->buf = cf_malloc(size);
+			cmd->buf = as_command_pool_alloc(size, NULL);
 			cmd->read_capacity = cmd->len;
 			cmd->flags |= AS_ASYNC_FLAGS_FREE_BUF;
 		}
@@ -829,6 +921,10 @@ as_event_try_family_connections(as_event_command* cmd, int family, int begin, in
 		return -1001;
 	}
 
+	if (sock->ctx) {
+		as_tls_set_session(sock, &cmd->node->tls_session);
+	}
+
 	// Try addresses.
 	as_address* addresses = cmd->node->addresses;
 	socklen_t size = (family == AF_INET)? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
@@ -866,6 +962,7 @@ as_event_connect_error(as_event_command* cmd, as_address* primary, int rv)
 	cf_free(cmd->conn);
 	as_event_decr_conn(cmd);
 	cmd->event_loop->errors++;
+	as_node_breaker_result(cmd->node, AEROSPIKE_ERR_ASYNC_CONNECTION, cmd->breaker_probe);
 
 	if (as_event_command_retry(cmd, true)) {
 		return;
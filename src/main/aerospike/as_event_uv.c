@@ -78,6 +78,7 @@ as_uv_close_loop(as_event_loop* event_loop)
 	// Cleanup event loop resources.
 	as_queue_destroy(&event_loop->queue);
 	as_queue_destroy(&event_loop->pipe_cb_queue);
+	cf_free(event_loop->read_buf);
 	pthread_mutex_destroy(&event_loop->lock);
 }
 
@@ -182,7 +183,7 @@ as_event_create_loop(as_event_loop* event_loop)
 	thread_data.event_loop = event_loop;
 	as_monitor_init(&thread_data.monitor);
 	
-	if (pthread_create(&event_loop->thread, NULL, as_uv_worker, &thread_data) != 0) {
+	if (! as_event_thread_create(event_loop, as_uv_worker, &thread_data)) {
 		return false;
 	}
 	
@@ -255,7 +256,14 @@ static void
 as_uv_command_buffer(uv_handle_t* handle, size_t suggested_size, uv_buf_t* buf)
 {
 	as_event_command* cmd = as_uv_get_command(handle->data);
-	*buf = uv_buf_init((char*)cmd->buf + cmd->pos, cmd->len - cmd->pos);
+
+	if (as_event_read_buffered(cmd)) {
+		// Read as much as is available, so response header and body usually arrive together.
+		*buf = uv_buf_init((char*)as_event_get_read_buffer(cmd->event_loop), AS_EVENT_READ_BUFFER_SIZE);
+	}
+	else {
+		*buf = uv_buf_init((char*)cmd->buf + cmd->pos, cmd->len - cmd->pos);
+	}
 }
 
 static void
@@ -278,42 +286,32 @@ as_uv_command_read(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf)
 		return;
 	}
 
-	cmd->flags |= AS_ASYNC_FLAGS_EVENT_RECEIVED;
-	cmd->pos += (uint32_t)nread;
-	
-	if (cmd->pos < cmd->len) {
-		// Read not finished.
+	if (nread == 0) {
+		// Read would block.
 		return;
 	}
 
-	if (cmd->state == AS_ASYNC_STATE_COMMAND_READ_HEADER) {
-		as_proto* proto = (as_proto*)cmd->buf;
-		as_proto_swap_from_be(proto);
-		size_t size = proto->sz;
-		
-		cmd->len = (uint32_t)size;
-		cmd->pos = 0;
-		cmd->state = AS_ASYNC_STATE_COMMAND_READ_BODY;
-		
-		if (cmd->len < sizeof(as_msg)) {
-			uv_read_stop(stream);
-			as_error err;
-			as_error_update(&err, AEROSPIKE_ERR_CLIENT, "Invalid record header size: %u", cmd->len);
-			as_event_parse_error(cmd, &err);
-			return;
-		}
-		
-		if (cmd->len > cmd->read_capacity) {
-			if (cmd->flags & AS_ASYNC_FLAGS_FREE_BUF) {
-				cf_free(cmd->buf);
+	if (buf->base == (char*)cmd->event_loop->read_buf) {
+		if (as_event_command_parse_buffer(cmd, (uint8_t*)buf->base, (uint32_t)nread)) {
+			as_event_connection* conn = stream->data;
+
+			// Keep reading if pipelined responses are still expected.
+			if (! conn->pipeline || cf_ll_size(&((as_pipe_connection*)conn)->readers) == 0) {
+				uv_read_stop(stream);
 			}
-			cmd->buf = cf_malloc(size);
-			cmd->read_capacity = cmd->len;
-			cmd->flags |= AS_ASYNC_FLAGS_FREE_BUF;
 		}
 		return;
 	}
 
+	// Oversized response body was read directly into command buffer.
+	cmd->flags |= AS_ASYNC_FLAGS_EVENT_RECEIVED;
+	cmd->pos += (uint32_t)nread;
+	
+	if (cmd->pos < cmd->len) {
+		// Read not finished.
+		return;
+	}
+
 	as_pipe_connection* conn_to_read = NULL;
 
 	if (cmd->pipe_listener != NULL) {
@@ -569,6 +567,7 @@ as_uv_connect_error(as_event_command* cmd, as_error* err)
 	uv_close((uv_handle_t*)cmd->conn, as_uv_connection_closed);
 	as_event_decr_conn(cmd);
 	cmd->event_loop->errors++;
+	as_node_breaker_result(cmd->node, AEROSPIKE_ERR_ASYNC_CONNECTION, cmd->breaker_probe);
 
 	if (! as_event_command_retry(cmd, true)) {
 		if (cmd->flags & AS_ASYNC_FLAGS_HAS_TIMER) {
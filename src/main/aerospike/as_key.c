@@ -43,6 +43,7 @@ as_key_cons(as_key* key, bool free, const as_namespace ns, const char * set, con
 	strcpy(key->ns, ns);
 	strcpy(key->set, set);
 	key->valuep = (as_key_value *) valuep;
+	key->nsh = NULL;
 	
 	if ( digest == NULL ) {
 		key->digest.init = false;
@@ -0,0 +1,564 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_near_cache.h>
+#include <citrusleaf/alloc.h>
+#include <citrusleaf/cf_clock.h>
+#include <string.h>
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+typedef struct as_near_cache_copy_s {
+	uint8_t* bins;
+	uint32_t size;
+	uint32_t gen;
+	uint32_t ttl;
+	uint16_t n_bins;
+} as_near_cache_copy;
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static inline as_near_cache_shard*
+as_near_cache_get_shard(as_near_cache* cache, const uint8_t* digest)
+{
+	// Digest is a cryptographic hash, so any bytes are evenly distributed.
+	// Use different bytes for shard, bucket and version slot so they are independent.
+	return &cache->shards[*(uint32_t*)(digest + 4) & cache->shard_mask];
+}
+
+static inline uint32_t
+as_near_cache_bucket(uint32_t n_buckets, const uint8_t* digest)
+{
+	return *(uint32_t*)(digest + 8) & (n_buckets - 1);
+}
+
+static inline uint32_t*
+as_near_cache_version(as_near_cache_shard* shard, const uint8_t* digest)
+{
+	return &shard->versions[*(uint32_t*)(digest + 12) & (AS_NEAR_CACHE_VERSIONS - 1)];
+}
+
+static inline uint64_t
+as_near_cache_expiration(uint32_t void_time, uint64_t now)
+{
+	// Zero void time indicates record never expires.
+	if (void_time == 0) {
+		return 0;
+	}
+	return now + ((uint64_t)cf_server_void_time_to_ttl(void_time) * 1000);
+}
+
+static as_near_cache_entry*
+as_near_cache_find(as_near_cache_shard* shard, const as_key* key)
+{
+	as_near_cache_entry* entry = shard->buckets[as_near_cache_bucket(shard->n_buckets, key->digest.value)];
+
+	while (entry) {
+		if (memcmp(entry->digest, key->digest.value, AS_DIGEST_VALUE_SIZE) == 0 &&
+			strcmp(entry->ns, key->ns) == 0) {
+			return entry;
+		}
+		entry = entry->next;
+	}
+	return NULL;
+}
+
+static void
+as_near_cache_grow(as_near_cache_shard* shard)
+{
+	uint32_t n_buckets = shard->n_buckets * 2;
+	as_near_cache_entry** buckets = cf_calloc(n_buckets, sizeof(as_near_cache_entry*));
+
+	for (uint32_t i = 0; i < shard->n_buckets; i++) {
+		as_near_cache_entry* entry = shard->buckets[i];
+
+		while (entry) {
+			as_near_cache_entry* next = entry->next;
+			uint32_t b = as_near_cache_bucket(n_buckets, entry->digest);
+			entry->next = buckets[b];
+			buckets[b] = entry;
+			entry = next;
+		}
+	}
+	cf_free(shard->buckets);
+	shard->buckets = buckets;
+	shard->n_buckets = n_buckets;
+}
+
+static void
+as_near_cache_insert(as_near_cache_shard* shard, as_near_cache_entry* entry)
+{
+	if (shard->n_entries >= shard->n_buckets) {
+		as_near_cache_grow(shard);
+	}
+
+	uint32_t b = as_near_cache_bucket(shard->n_buckets, entry->digest);
+	entry->next = shard->buckets[b];
+	shard->buckets[b] = entry;
+
+	// Insert behind clock hand, so new entry is the last entry the hand visits.
+	as_near_cache_entry* hand = shard->hand;
+
+	if (hand) {
+		entry->clock_next = hand;
+		entry->clock_prev = hand->clock_prev;
+		hand->clock_prev->clock_next = entry;
+		hand->clock_prev = entry;
+	}
+	else {
+		entry->clock_next = entry;
+		entry->clock_prev = entry;
+		shard->hand = entry;
+	}
+	shard->memory += sizeof(as_near_cache_entry) + entry->size;
+	shard->n_entries++;
+}
+
+static void
+as_near_cache_remove(as_near_cache_shard* shard, as_near_cache_entry* entry)
+{
+	as_near_cache_entry** pp = &shard->buckets[as_near_cache_bucket(shard->n_buckets, entry->digest)];
+
+	while (*pp != entry) {
+		pp = &(*pp)->next;
+	}
+	*pp = entry->next;
+
+	if (entry->clock_next == entry) {
+		shard->hand = NULL;
+	}
+	else {
+		entry->clock_prev->clock_next = entry->clock_next;
+		entry->clock_next->clock_prev = entry->clock_prev;
+
+		if (shard->hand == entry) {
+			shard->hand = entry->clock_next;
+		}
+	}
+	shard->memory -= sizeof(as_near_cache_entry) + entry->size;
+	shard->n_entries--;
+	cf_free(entry);
+}
+
+static void
+as_near_cache_evict(as_near_cache_shard* shard, uint64_t size)
+{
+	// CLOCK eviction.  Entries read since the hand last passed get a second chance.
+	while (shard->hand && shard->memory + size > shard->max_memory) {
+		as_near_cache_entry* entry = shard->hand;
+
+		if (entry->referenced) {
+			entry->referenced = 0;
+			shard->hand = entry->clock_next;
+		}
+		else {
+			as_near_cache_remove(shard, entry);
+			shard->evictions++;
+		}
+	}
+}
+
+static void
+as_near_cache_copy_entry(as_near_cache_entry* entry, uint64_t now, as_near_cache_copy* copy)
+{
+	// Copy bins so they can be parsed outside the shard lock.
+	copy->bins = entry->size ? cf_malloc(entry->size) : NULL;
+	memcpy(copy->bins, entry->data, entry->size);
+	copy->size = entry->size;
+	copy->gen = entry->gen;
+	copy->ttl = entry->expire_ms ? (uint32_t)((entry->expire_ms - now + 999) / 1000) : (uint32_t)-1;
+	copy->n_bins = entry->n_bins;
+}
+
+static uint16_t
+as_near_cache_filter_bins(uint8_t* p, uint16_t n_bins, const char* bins[], uint8_t* trg)
+{
+	uint16_t n = 0;
+
+	for (uint16_t i = 0; i < n_bins; i++) {
+		// Bin layout: size(4) op(1) type(1) version(1) name_size(1) name value.
+		uint32_t len = cf_swap_from_be32(*(uint32_t*)p) + 4;
+		uint8_t name_size = p[7];
+		const char* name = (const char*)p + 8;
+
+		for (const char** b = bins; *b && (*b)[0]; b++) {
+			if (strlen(*b) == name_size && memcmp(*b, name, name_size) == 0) {
+				memcpy(trg, p, len);
+				trg += len;
+				n++;
+				break;
+			}
+		}
+		p += len;
+	}
+	return n;
+}
+
+static as_status
+as_near_cache_parse(as_error* err, as_near_cache_copy* copy, const char* bins[], bool deserialize, as_record** rec)
+{
+	uint8_t* p = copy->bins;
+	uint16_t n_bins = copy->n_bins;
+	uint8_t* filtered = NULL;
+
+	if (bins && copy->size > 0) {
+		filtered = cf_malloc(copy->size);
+		n_bins = as_near_cache_filter_bins(copy->bins, copy->n_bins, bins, filtered);
+		p = filtered;
+	}
+
+	as_command_parse_result_data data;
+	data.record = rec;
+	data.deserialize = deserialize;
+
+	as_status status = as_command_parse_record(err, p, n_bins, copy->gen, copy->ttl, &data);
+	cf_free(filtered);
+	return status;
+}
+
+static as_status
+as_near_cache_command(
+	as_cluster* cluster, as_error* err, const as_policy_read* policy, const as_key* key,
+	uint8_t read_attr, as_parse_results_fn parse_results_fn, void* udata
+	)
+{
+	uint16_t n_fields;
+	size_t size = as_command_key_size(policy->key, key, &n_fields);
+
+	uint8_t* cmd = as_command_init(size);
+	uint8_t* p = as_command_write_header_read(cmd, read_attr, policy->consistency_level,
+		policy->linearize_read, as_policy_server_timeout(&policy->base), n_fields, 0);
+
+	p = as_command_write_key(p, policy->key, key);
+	size = as_command_write_end(cmd, p);
+
+	as_command_node cn;
+	as_command_node_init(&cn, key, policy->replica);
+
+	as_status status = as_command_execute(cluster, err, &policy->base, &cn, cmd, size, parse_results_fn, udata, true);
+
+	as_command_free(cmd, size);
+	return status;
+}
+
+static bool
+as_near_cache_revalidate(
+	as_near_cache* cache, as_near_cache_shard* shard, const as_key* key, uint32_t version,
+	as_msg* msg, uint64_t now, as_near_cache_copy* copy
+	)
+{
+	bool valid = false;
+
+	pthread_mutex_lock(&shard->lock);
+
+	as_near_cache_entry* entry = as_near_cache_find(shard, key);
+
+	if (entry && entry->gen == msg->generation && *as_near_cache_version(shard, key->digest.value) == version) {
+		// Record has not changed.  Touch may have changed expiration.
+		entry->validated_ms = now;
+		entry->expire_ms = as_near_cache_expiration(msg->record_ttl, now);
+		entry->referenced = 1;
+		shard->revalidations++;
+		as_near_cache_copy_entry(entry, now, copy);
+		valid = true;
+	}
+	pthread_mutex_unlock(&shard->lock);
+	return valid;
+}
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+as_near_cache*
+as_near_cache_create(const as_config_near_cache* config)
+{
+	uint32_t n_shards = 1;
+
+	while (n_shards < config->n_shards) {
+		n_shards <<= 1;
+	}
+
+	as_near_cache* cache = cf_malloc(sizeof(as_near_cache));
+	cache->shards = cf_calloc(n_shards, sizeof(as_near_cache_shard));
+	cache->shard_mask = n_shards - 1;
+	cache->revalidate_ms = config->revalidate_ms;
+
+	for (uint32_t i = 0; i < n_shards; i++) {
+		as_near_cache_shard* shard = &cache->shards[i];
+		pthread_mutex_init(&shard->lock, NULL);
+		shard->n_buckets = 64;
+		shard->buckets = cf_calloc(shard->n_buckets, sizeof(as_near_cache_entry*));
+		shard->max_memory = config->max_memory / n_shards;
+	}
+	return cache;
+}
+
+void
+as_near_cache_destroy(as_near_cache* cache)
+{
+	for (uint32_t i = 0; i <= cache->shard_mask; i++) {
+		as_near_cache_shard* shard = &cache->shards[i];
+
+		for (uint32_t j = 0; j < shard->n_buckets; j++) {
+			as_near_cache_entry* entry = shard->buckets[j];
+
+			while (entry) {
+				as_near_cache_entry* next = entry->next;
+				cf_free(entry);
+				entry = next;
+			}
+		}
+		cf_free(shard->buckets);
+		pthread_mutex_destroy(&shard->lock);
+	}
+	cf_free(cache->shards);
+	cf_free(cache);
+}
+
+void
+as_near_cache_invalidate(as_near_cache* cache, const as_key* key)
+{
+	as_near_cache_shard* shard = as_near_cache_get_shard(cache, key->digest.value);
+
+	pthread_mutex_lock(&shard->lock);
+
+	// Reads of this key that are already in progress must not cache their result.
+	(*as_near_cache_version(shard, key->digest.value))++;
+
+	as_near_cache_entry* entry = as_near_cache_find(shard, key);
+
+	if (entry) {
+		as_near_cache_remove(shard, entry);
+		shard->invalidations++;
+	}
+	pthread_mutex_unlock(&shard->lock);
+}
+
+as_status
+as_near_cache_read(
+	as_cluster* cluster, as_error* err, const as_policy_read* policy, const as_key* key,
+	const char* bins[], as_record** rec
+	)
+{
+	as_near_cache* cache = cluster->near_cache;
+	as_near_cache_shard* shard = as_near_cache_get_shard(cache, key->digest.value);
+	as_near_cache_copy copy;
+	uint64_t now = cf_getms();
+	uint32_t gen = 0;
+	bool stale = false;
+	as_status status;
+
+	pthread_mutex_lock(&shard->lock);
+
+	uint32_t version = *as_near_cache_version(shard, key->digest.value);
+	as_near_cache_entry* entry = as_near_cache_find(shard, key);
+
+	if (entry) {
+		if (entry->expire_ms && entry->expire_ms <= now) {
+			as_near_cache_remove(shard, entry);
+			shard->invalidations++;
+		}
+		else if (now - entry->validated_ms < cache->revalidate_ms) {
+			entry->referenced = 1;
+			shard->hits++;
+			as_near_cache_copy_entry(entry, now, &copy);
+			pthread_mutex_unlock(&shard->lock);
+
+			status = as_near_cache_parse(err, &copy, bins, policy->deserialize, rec);
+			cf_free(copy.bins);
+			return status;
+		}
+		else {
+			gen = entry->gen;
+			stale = true;
+		}
+	}
+	pthread_mutex_unlock(&shard->lock);
+
+	if (stale) {
+		// Read generation only.  The full record is only transferred if it changed.
+		as_proto_msg msg;
+		status = as_near_cache_command(cluster, err, policy, key, AS_MSG_INFO1_READ | AS_MSG_INFO1_GET_NOBINDATA,
+			as_command_parse_header, &msg);
+
+		if (status == AEROSPIKE_OK) {
+			if (msg.m.generation == gen && as_near_cache_revalidate(cache, shard, key, version, &msg.m, now, &copy)) {
+				status = as_near_cache_parse(err, &copy, bins, policy->deserialize, rec);
+				cf_free(copy.bins);
+				return status;
+			}
+		}
+		else {
+			if (status == AEROSPIKE_ERR_RECORD_NOT_FOUND) {
+				as_near_cache_invalidate(cache, key);
+			}
+			return status;
+		}
+	}
+
+	// Shard statistics are only modified under shard lock.
+	pthread_mutex_lock(&shard->lock);
+	shard->misses++;
+	pthread_mutex_unlock(&shard->lock);
+
+	as_command_raw_record result;
+	status = as_near_cache_command(cluster, err, policy, key, AS_MSG_INFO1_READ | AS_MSG_INFO1_GET_ALL,
+		as_command_parse_raw, &result);
+
+	if (status != AEROSPIKE_OK) {
+		if (status == AEROSPIKE_ERR_RECORD_NOT_FOUND && stale) {
+			as_near_cache_invalidate(cache, key);
+		}
+		return status;
+	}
+
+	as_near_cache_put(cache, key, version, &result.msg, result.bins, result.size);
+
+	copy.bins = result.bins;
+	copy.size = result.size;
+	copy.gen = result.msg.generation;
+	copy.ttl = cf_server_void_time_to_ttl(result.msg.record_ttl);
+	copy.n_bins = result.msg.n_ops;
+
+	status = as_near_cache_parse(err, &copy, bins, policy->deserialize, rec);
+	cf_free(result.buf);
+	return status;
+}
+
+bool
+as_near_cache_get_fresh(as_near_cache* cache, const as_key* key, bool deserialize, as_record* rec, uint32_t* version)
+{
+	as_near_cache_shard* shard = as_near_cache_get_shard(cache, key->digest.value);
+	as_near_cache_copy copy;
+	uint64_t now = cf_getms();
+
+	pthread_mutex_lock(&shard->lock);
+
+	*version = *as_near_cache_version(shard, key->digest.value);
+	as_near_cache_entry* entry = as_near_cache_find(shard, key);
+
+	if (! entry || now - entry->validated_ms >= cache->revalidate_ms) {
+		shard->misses++;
+		pthread_mutex_unlock(&shard->lock);
+		return false;
+	}
+
+	if (entry->expire_ms && entry->expire_ms <= now) {
+		as_near_cache_remove(shard, entry);
+		shard->invalidations++;
+		shard->misses++;
+		pthread_mutex_unlock(&shard->lock);
+		return false;
+	}
+
+	entry->referenced = 1;
+	shard->hits++;
+	as_near_cache_copy_entry(entry, now, &copy);
+	pthread_mutex_unlock(&shard->lock);
+
+	as_record_init(rec, copy.n_bins);
+	rec->gen = copy.gen;
+	rec->ttl = copy.ttl;
+
+	as_error err;
+	uint8_t* p = copy.bins;
+	as_status status = as_command_parse_bins(&p, &err, rec, copy.n_bins, deserialize);
+	cf_free(copy.bins);
+
+	if (status != AEROSPIKE_OK) {
+		// Read record from server instead.
+		as_record_destroy(rec);
+		as_record_init(rec, 0);
+		return false;
+	}
+	return true;
+}
+
+void
+as_near_cache_put(as_near_cache* cache, const as_key* key, uint32_t version, as_msg* msg, uint8_t* bins, uint32_t size)
+{
+	as_near_cache_shard* shard = as_near_cache_get_shard(cache, key->digest.value);
+	uint64_t entry_size = sizeof(as_near_cache_entry) + size;
+	as_near_cache_entry* entry = NULL;
+	uint64_t now = cf_getms();
+
+	if (entry_size <= shard->max_memory) {
+		// Build entry outside shard lock.
+		entry = cf_malloc(entry_size);
+		entry->validated_ms = now;
+		entry->expire_ms = as_near_cache_expiration(msg->record_ttl, now);
+		entry->gen = msg->generation;
+		entry->size = size;
+		entry->n_bins = msg->n_ops;
+		entry->referenced = 0;
+		memcpy(entry->digest, key->digest.value, AS_DIGEST_VALUE_SIZE);
+		as_strncpy(entry->ns, key->ns, AS_NAMESPACE_MAX_SIZE);
+		memcpy(entry->data, bins, size);
+	}
+
+	pthread_mutex_lock(&shard->lock);
+
+	if (*as_near_cache_version(shard, key->digest.value) != version) {
+		// Key was written while record was being read.  Record may be stale.
+		pthread_mutex_unlock(&shard->lock);
+		cf_free(entry);
+		return;
+	}
+
+	as_near_cache_entry* old = as_near_cache_find(shard, key);
+
+	if (old) {
+		as_near_cache_remove(shard, old);
+	}
+
+	if (entry) {
+		as_near_cache_evict(shard, entry_size);
+		as_near_cache_insert(shard, entry);
+	}
+	pthread_mutex_unlock(&shard->lock);
+}
+
+bool
+as_near_cache_get_stats(as_cluster* cluster, as_near_cache_stats* stats)
+{
+	as_near_cache* cache = cluster->near_cache;
+
+	if (! cache) {
+		return false;
+	}
+
+	memset(stats, 0, sizeof(as_near_cache_stats));
+
+	for (uint32_t i = 0; i <= cache->shard_mask; i++) {
+		as_near_cache_shard* shard = &cache->shards[i];
+
+		pthread_mutex_lock(&shard->lock);
+		stats->hits += shard->hits;
+		stats->revalidations += shard->revalidations;
+		stats->misses += shard->misses;
+		stats->evictions += shard->evictions;
+		stats->invalidations += shard->invalidations;
+		stats->entries += shard->n_entries;
+		stats->memory += shard->memory;
+		pthread_mutex_unlock(&shard->lock);
+	}
+	return true;
+}
@@ -23,8 +23,10 @@
 #include <aerospike/as_event_internal.h>
 #include <aerospike/as_info.h>
 #include <aerospike/as_log_macros.h>
+#include <aerospike/as_partition.h>
 #include <aerospike/as_peers.h>
 #include <aerospike/as_queue.h>
+#include <aerospike/as_shm_cluster.h>
 #include <aerospike/as_socket.h>
 #include <aerospike/as_string.h>
 #include <aerospike/as_tls.h>
@@ -33,6 +35,10 @@
 // Replicas take ~2K per namespace, so this will cover most deployments:
 #define INFO_STACK_BUF_SIZE (16 * 1024)
 
+// Maximum sync connections opened for one node in one tend.  Tend holds tend_lock
+// while connecting, so large minimums are reached over several tends.
+#define AS_NODE_WARMUP_MAX_PER_TEND 8
+
 /******************************************************************************
  * Function declarations.
  *****************************************************************************/
@@ -85,6 +91,8 @@ as_node_create(
 	node->ref_count = 1;
 	node->peers_generation = 0xFFFFFFFF;
 	node->partition_generation = 0xFFFFFFFF;
+	node->rebalance_generation = 0xFFFFFFFF;
+	node->rack_id = AS_RACK_UNKNOWN;
 	node->cluster = cluster;
 
 	strcpy(node->name, node_info->name);
@@ -96,6 +104,7 @@ as_node_create(
 	as_node_add_address(node, addr);
 	
 	as_vector_init(&node->aliases, sizeof(as_alias), 2);
+	as_vector_init(&node->partition_bitmaps, sizeof(as_partition_bitmap), 4);
 	if (is_alias) {
 		as_node_add_alias(node, hostname, port);
 	}
@@ -108,6 +117,10 @@ as_node_create(
 		as_tls_set_name(&node->info_socket, node->tls_name);
 	}
 
+	if (cluster->tls_ctx.ssl_ctx) {
+		as_tls_session_init(&node->tls_session);
+	}
+
 	// Create connection pool queues.
 	node->conn_pool_locks = cf_malloc(sizeof(as_conn_pool_lock) * cluster->conn_pools_per_node);
 	node->conn_iter = 0;
@@ -136,8 +149,22 @@ as_node_create(
 	node->friends = 0;
 	node->failures = 0;
 	node->index = 0;
+	node->latency_sum = 0;
+	node->latency_count = 0;
+	node->sync_conns_trimmed = 0;
+	node->async_conns_trimmed = 0;
+	node->pipe_conns_trimmed = 0;
+	node->breaker_trips = 0;
+	node->breaker_retry_ms = 0;
+	node->breaker_commands = 0;
+	node->breaker_errors = 0;
+	node->breaker_probe = 0;
+	node->breaker_state = AS_BREAKER_CLOSED;
+	node->adaptive_timeout_us = 0;
+	memset(node->latency_buckets, 0, sizeof(node->latency_buckets));
 	node->active = true;
 	node->partition_changed = false;
+	node->rebalance_changed = false;
 	return node;
 }
 
@@ -175,10 +202,15 @@ as_node_destroy(as_node* node)
 	// Release memory.
 	cf_free(node->addresses);
 	as_vector_destroy(&node->aliases);
+	as_partition_bitmaps_destroy(&node->partition_bitmaps);
 
 	if (node->tls_name) {
 		cf_free(node->tls_name);
 	}
+
+	if (node->cluster->tls_ctx.ssl_ctx) {
+		as_tls_session_destroy(&node->tls_session);
+	}
 	cf_free(node);
 }
 
@@ -267,6 +299,10 @@ as_node_try_family_connections(as_node* node, int family, int begin, int end, in
 	if (rv < 0) {
 		return rv;
 	}
+
+	if (sock->ctx) {
+		as_tls_set_session(sock, &node->tls_session);
+	}
 	
 	// Try addresses.
 	as_address* addresses = node->addresses;
@@ -485,6 +521,199 @@ as_node_get_connection(as_error* err, as_node* node, uint32_t socket_timeout, ui
 						   node->name, node->cluster->max_conns_per_node);
 }
 
+static uint32_t
+as_node_balance_pool(
+	as_node* node, as_conn_pool_lock* pool_lock, uint32_t min, uint32_t margin, uint32_t* warmup
+	)
+{
+	as_cluster* cluster = node->cluster;
+	as_conn_pool* pool = &pool_lock->pool;
+	as_socket sock;
+
+	// Close idle sockets that are not needed to cover recent peak usage.  Lock is held
+	// for one socket at a time, so transaction threads are not blocked while sockets close.
+	// Sockets are popped directly from the queue, so tend does not count as pool usage.
+	pthread_mutex_lock(&pool_lock->lock);
+	uint32_t trim = as_conn_pool_trim_count(pool, min);
+	pthread_mutex_unlock(&pool_lock->lock);
+
+	uint32_t trimmed = 0;
+
+	while (trimmed < trim) {
+		pthread_mutex_lock(&pool_lock->lock);
+		bool status = as_queue_pop(&pool->queue, &sock);
+
+		if (status) {
+			as_conn_pool_dec(pool);
+		}
+		pthread_mutex_unlock(&pool_lock->lock);
+
+		if (! status) {
+			break;
+		}
+		as_socket_close(&sock);
+		trimmed++;
+	}
+
+	if (min == 0) {
+		return trimmed;
+	}
+
+	// Rotate through pooled sockets once and close sockets that would expire before
+	// the next tend.
+	uint32_t now = (uint32_t)cf_get_seconds();
+
+	pthread_mutex_lock(&pool_lock->lock);
+	uint32_t size = as_queue_size(&pool->queue);
+	pthread_mutex_unlock(&pool_lock->lock);
+
+	for (uint32_t i = 0; i < size; i++) {
+		pthread_mutex_lock(&pool_lock->lock);
+
+		if (! as_queue_pop(&pool->queue, &sock)) {
+			pthread_mutex_unlock(&pool_lock->lock);
+			break;
+		}
+
+		if (! as_socket_expiring(&sock, now, margin)) {
+			bool status = as_conn_pool_put(pool, &sock);
+			pthread_mutex_unlock(&pool_lock->lock);
+
+			if (! status) {
+				as_node_close_connection(&sock);
+			}
+			continue;
+		}
+		as_conn_pool_dec(pool);
+		pthread_mutex_unlock(&pool_lock->lock);
+		as_socket_close(&sock);
+	}
+
+	// Open connections until pool reaches its minimum or this tend's warm-up limit.
+	while (*warmup > 0) {
+		pthread_mutex_lock(&pool_lock->lock);
+		bool create = pool->total < min && as_conn_pool_inc(pool);
+		pthread_mutex_unlock(&pool_lock->lock);
+
+		if (! create) {
+			break;
+		}
+
+		as_error err;
+		uint64_t deadline_ms = cf_getms() + cluster->conn_timeout_ms;
+
+		if (as_node_create_connection(&err, node, 0, deadline_ms, pool_lock, &sock) != AEROSPIKE_OK) {
+			// Pool count has already been decremented.  Try again on next tend.
+			as_log_debug("Node %s connection warm-up failed: %s", node->name, err.message);
+			*warmup = 0;
+			break;
+		}
+		as_node_put_connection(&sock, cluster->max_socket_idle);
+		(*warmup)--;
+	}
+	return trimmed;
+}
+
+void
+as_node_balance_connections(as_node* node)
+{
+	as_cluster* cluster = node->cluster;
+	uint32_t margin = (cluster->tend_interval + 999) / 1000;
+	uint32_t max = cluster->conn_pools_per_node;
+	uint32_t warmup = AS_NODE_WARMUP_MAX_PER_TEND;
+	uint32_t trimmed = 0;
+
+	for (uint32_t i = 0; i < max; i++) {
+		uint32_t min = as_conn_pool_share(cluster->min_conns_per_node, max, i);
+		trimmed += as_node_balance_pool(node, &node->conn_pool_locks[i], min, margin, &warmup);
+	}
+
+	if (trimmed > 0) {
+		as_faa_uint64(&node->sync_conns_trimmed, trimmed);
+		as_log_debug("Node %s trimmed %u idle connections", node->name, trimmed);
+	}
+
+	if (as_event_loop_capacity > 0) {
+		as_event_balance_connections(node);
+	}
+}
+
+void
+as_node_tend_breaker(as_node* node)
+{
+	as_cluster* cluster = node->cluster;
+
+	if (cluster->breaker_error_pct == 0) {
+		return;
+	}
+
+	// Start a new measurement window each tend.
+	uint32_t commands = as_fas_uint32(&node->breaker_commands, 0);
+	uint32_t errors = as_fas_uint32(&node->breaker_errors, 0);
+
+	if (as_load_uint8(&node->breaker_state) != AS_BREAKER_CLOSED ||
+		commands < cluster->breaker_min_commands ||
+		(uint64_t)errors * 100 < (uint64_t)commands * cluster->breaker_error_pct) {
+		return;
+	}
+
+	// Publish retry time before state, so routing threads never see an open breaker
+	// with a stale retry time.
+	as_store_uint64(&node->breaker_retry_ms, cf_getms() + cluster->breaker_open_ms);
+	as_store_uint8(&node->breaker_state, AS_BREAKER_OPEN);
+	node->breaker_trips++;
+	as_log_warn("Node %s circuit breaker opened: %u errors in %u commands", node->name, errors, commands);
+}
+
+void
+as_node_tend_latency(as_node* node)
+{
+	as_cluster* cluster = node->cluster;
+
+	if (cluster->timeout_percentile == 0) {
+		return;
+	}
+
+	// Start a new measurement window each tend.
+	uint32_t buckets[AS_LATENCY_BUCKETS];
+	uint64_t total = 0;
+
+	for (uint32_t i = 0; i < AS_LATENCY_BUCKETS; i++) {
+		buckets[i] = as_fas_uint32(&node->latency_buckets[i], 0);
+		total += buckets[i];
+	}
+
+	if (total == 0) {
+		// Keep previous timeout when node was idle.
+		return;
+	}
+
+	// Find bucket containing percentile.  Its upper bound is the latency estimate.
+	uint64_t target = (total * cluster->timeout_percentile + 99) / 100;
+	uint64_t count = 0;
+	uint32_t index = 0;
+
+	while (index < AS_LATENCY_BUCKETS - 1) {
+		count += buckets[index];
+
+		if (count >= target) {
+			break;
+		}
+		index++;
+	}
+
+	uint64_t timeout = (1ULL << index) * cluster->timeout_multiplier;
+
+	if (timeout < cluster->min_timeout_us) {
+		timeout = cluster->min_timeout_us;
+	}
+
+	if (timeout > UINT32_MAX) {
+		timeout = UINT32_MAX;
+	}
+	as_store_uint32(&node->adaptive_timeout_us, (uint32_t)timeout);
+}
+
 static inline as_status
 as_node_get_info_connection(as_error* err, as_node* node, uint64_t deadline_ms)
 {
@@ -586,6 +815,7 @@ as_node_verify_name(as_error* err, as_node* node, const char* name)
 static const char INFO_STR_CHECK_PEERS[] = "node\npeers-generation\npartition-generation\n";
 static const char INFO_STR_CHECK[] = "node\npartition-generation\nservices\n";
 static const char INFO_STR_CHECK_SVCALT[] = "node\npartition-generation\nservices-alternate\n";
+static const char INFO_STR_REBALANCE_GEN[] = "rebalance-generation\n";
 
 static as_status
 as_node_process_response(as_cluster* cluster, as_error* err, as_node* node, as_vector* values,
@@ -615,6 +845,13 @@ as_node_process_response(as_cluster* cluster, as_error* err, as_node* node, as_v
 				node->partition_changed = true;
 			}
 		}
+		else if (strcmp(nv->name, "rebalance-generation") == 0) {
+			uint32_t gen = (uint32_t)strtoul(nv->value, NULL, 10);
+			if (node->rebalance_generation != gen) {
+				as_log_debug("Node %s rebalance generation changed: %u", node->name, gen);
+				node->rebalance_changed = true;
+			}
+		}
 		else if (strcmp(nv->name, "services") == 0 || strcmp(nv->name, "services-alternate") == 0) {
 			as_peers_parse_services(peers, cluster, node, nv->value);
 		}
@@ -655,6 +892,16 @@ as_node_refresh(as_cluster* cluster, as_error* err, as_node* node, as_peers* pee
 			command_len = sizeof(INFO_STR_CHECK) - 1;
 		}
 	}
+
+	if (cluster->rack_aware) {
+		// Append rebalance generation so racks are only requested when they may have changed.
+		size_t len = sizeof(INFO_STR_REBALANCE_GEN) - 1;
+		char* rack_command = alloca(command_len + len);
+		memcpy(rack_command, command, command_len);
+		memcpy(rack_command + command_len, INFO_STR_REBALANCE_GEN, len);
+		command = rack_command;
+		command_len += len;
+	}
 	
 	uint8_t stack_buf[INFO_STACK_BUF_SIZE];
 	uint8_t* buf = as_node_get_info(err, node, command, command_len, deadline_ms, stack_buf);
@@ -835,3 +1082,105 @@ as_node_refresh_partitions(as_cluster* cluster, as_error* err, as_node* node, as
 	as_vector_destroy(&values);
 	return status;
 }
+
+static const char INFO_STR_GET_RACKS[] = "rebalance-generation\nrack-ids\n";
+
+int
+as_node_parse_racks(as_node* node, char* p)
+{
+	// Format: <ns1>:<rack1>;<ns2>:<rack2>;...
+	// Rack is configured per namespace, but nodes are only placed on one rack in practice.
+	// If namespaces disagree, the node's rack is unknown and it is not preferred for any namespace.
+	int rack_id = AS_RACK_UNKNOWN;
+	bool found = false;
+
+	while (*p) {
+		char* ns = p;
+
+		while (*p && *p != ':') {
+			p++;
+		}
+
+		if (*p == 0) {
+			as_log_warn("Node %s invalid rack-ids: %s", node->name, ns);
+			return AS_RACK_UNKNOWN;
+		}
+		*p++ = 0;
+
+		int rack = (int)strtol(p, &p, 10);
+
+		if (! found) {
+			rack_id = rack;
+			found = true;
+		}
+		else if (rack != rack_id) {
+			as_log_warn("Node %s has different racks per namespace. Rack is ignored.", node->name);
+			return AS_RACK_UNKNOWN;
+		}
+
+		while (*p && *p != ';') {
+			p++;
+		}
+
+		if (*p == ';') {
+			p++;
+		}
+	}
+	return rack_id;
+}
+
+static as_status
+as_node_process_racks(as_cluster* cluster, as_error* err, as_node* node, as_vector* values)
+{
+	for (uint32_t i = 0; i < values->size; i++) {
+		as_name_value* nv = as_vector_get(values, i);
+
+		if (strcmp(nv->name, "rebalance-generation") == 0) {
+			node->rebalance_generation = (uint32_t)strtoul(nv->value, NULL, 10);
+		}
+		else if (strcmp(nv->name, "rack-ids") == 0) {
+			int rack_id = as_node_parse_racks(node, nv->value);
+
+			if (rack_id != node->rack_id) {
+				as_log_debug("Node %s rack: %d", node->name, rack_id);
+
+				// Make volatile write so changes are reflected in other threads.
+				as_store_int32(&node->rack_id, rack_id);
+
+				if (cluster->shm_info) {
+					as_shm_update_rack(cluster->shm_info, node, rack_id);
+				}
+			}
+		}
+		else {
+			return as_error_update(err, AEROSPIKE_ERR_CLIENT, "Node %s did not request info '%s'", node->name, nv->name);
+		}
+	}
+	return AEROSPIKE_OK;
+}
+
+as_status
+as_node_refresh_racks(as_cluster* cluster, as_error* err, as_node* node)
+{
+	uint64_t deadline_ms = as_socket_deadline(cluster->conn_timeout_ms);
+	uint8_t stack_buf[INFO_STACK_BUF_SIZE];
+	uint8_t* buf = as_node_get_info(err, node, INFO_STR_GET_RACKS, sizeof(INFO_STR_GET_RACKS) - 1, deadline_ms, stack_buf);
+
+	if (! buf) {
+		as_node_close_info_connection(node);
+		return err->code;
+	}
+
+	as_vector values;
+	as_vector_inita(&values, sizeof(as_name_value), 2);
+
+	as_info_parse_multi_response((char*)buf, &values);
+	as_status status = as_node_process_racks(cluster, err, node, &values);
+
+	if (buf != stack_buf) {
+		cf_free(buf);
+	}
+
+	as_vector_destroy(&values);
+	return status;
+}
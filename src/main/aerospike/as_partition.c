@@ -22,8 +22,10 @@
 #include <aerospike/as_policy.h>
 #include <aerospike/as_shm_cluster.h>
 #include <aerospike/as_string.h>
+#include <citrusleaf/alloc.h>
 #include <citrusleaf/cf_b64.h>
 #include <stdlib.h>
+#include <string.h>
 
 /******************************************************************************
  * Functions
@@ -36,8 +38,8 @@ as_partition_table_print(as_partition_table* table)
 	for (uint32_t i = 0; i < table->size; i++) {
 		as_partition* p = &table->partitions[i];
 		
-		if (p->master) {
-			printf("%u %s\n", i, p->master->name);
+		if (p->nodes[0]) {
+			printf("%u %s\n", i, p->nodes[0]->name);
 		}
 		else {
 			printf("%u null\n", i);
@@ -89,13 +91,11 @@ as_partition_table_destroy(as_partition_table* table)
 {
 	for (uint32_t i = 0; i < table->size; i++) {
 		as_partition* p = &table->partitions[i];
-		
-		if (p->master) {
-			as_node_release(p->master);
-		}
-		
-		if (p->prole) {
-			as_node_release(p->prole);
+
+		for (uint32_t j = 0; j < AS_MAX_REPLICAS; j++) {
+			if (p->nodes[j]) {
+				as_node_release(p->nodes[j]);
+			}
 		}
 	}
 	cf_free(table);
@@ -113,11 +113,14 @@ as_partition_tables_create(uint32_t capacity)
 }
 
 static inline as_node*
-reserve_master(as_cluster* cluster, as_node* node)
+reserve_master(as_cluster* cluster, as_node* node, bool reserve)
 {
 	// Make volatile reference so changes to tend thread will be reflected in this thread.
-	if (node && as_load_uint8(&node->active)) {
-		as_node_reserve(node);
+	// Master with an open circuit breaker fails fast.
+	if (node && as_load_uint8(&node->active) && as_node_breaker_allow(node)) {
+		if (reserve) {
+			as_node_reserve(node);
+		}
 		return node;
 	}
 	// When master only specified, both AP and CP modes should never get random nodes.
@@ -125,60 +128,129 @@ reserve_master(as_cluster* cluster, as_node* node)
 }
 
 static inline as_node*
-reserve_node(as_cluster* cluster, as_node* node, bool cp_mode)
+reserve_node(as_cluster* cluster, as_node* node, bool cp_mode, bool reserve)
 {
 	// Make volatile reference so changes to tend thread will be reflected in this thread.
 	if (node && as_load_uint8(&node->active)) {
-		as_node_reserve(node);
+		if (reserve) {
+			as_node_reserve(node);
+		}
 		return node;
 	}
-	return cp_mode ? NULL : as_node_get_random(cluster);
-}
 
-static as_node*
-reserve_node_alternate(as_cluster* cluster, as_node* chosen, as_node* alternate, bool cp_mode)
-{
-	// Make volatile reference so changes to tend thread will be reflected in this thread.
-	if (as_load_uint8(&chosen->active)) {
-		as_node_reserve(chosen);
-		return chosen;
+	if (cp_mode) {
+		return NULL;
 	}
-	return reserve_node(cluster, alternate, cp_mode);
+	return reserve ? as_node_get_random(cluster) : as_node_get_random_epoch(cluster);
 }
 
 static uint32_t g_randomizer = 0;
 
-as_node*
-as_partition_get_node(as_cluster* cluster, as_partition* p, as_policy_replica replica, bool use_master, bool cp_mode)
+static inline uint32_t
+load_nodes(as_partition* p, as_node** nodes)
 {
 	// Make volatile reference so changes to tend thread will be reflected in this thread.
-	as_node* master = (as_node*)as_load_ptr(&p->master);
+	uint32_t n = 0;
 
-	if (replica == AS_POLICY_REPLICA_MASTER) {
-		return reserve_master(cluster, master);
+	for (uint32_t i = 0; i < AS_MAX_REPLICAS; i++) {
+		as_node* node = (as_node*)as_load_ptr(&p->nodes[i]);
+
+		if (node) {
+			nodes[n++] = node;
+		}
 	}
+	return n;
+}
 
-	as_node* prole = (as_node*)as_load_ptr(&p->prole);
+static inline uint32_t
+load_rack_nodes(as_cluster* cluster, as_partition* p, as_node** nodes)
+{
+	// Order replicas on client's rack first, then other replicas.  Replica order is
+	// otherwise preserved, so retries try other replicas on the same rack before
+	// falling back to other racks.
+	as_node* others[AS_MAX_REPLICAS];
+	uint32_t n = 0;
+	uint32_t n_others = 0;
+
+	for (uint32_t i = 0; i < AS_MAX_REPLICAS; i++) {
+		as_node* node = (as_node*)as_load_ptr(&p->nodes[i]);
+
+		if (node) {
+			if (as_load_int32(&node->rack_id) == cluster->rack_id) {
+				nodes[n++] = node;
+			}
+			else {
+				others[n_others++] = node;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < n_others; i++) {
+		nodes[n++] = others[i];
+	}
+	return n;
+}
 
-	if (! prole) {
-		return reserve_node(cluster, master, cp_mode);
+static inline as_node*
+get_node(as_cluster* cluster, as_partition* p, as_policy_replica replica, uint32_t sequence, bool cp_mode, bool reserve)
+{
+	if (replica == AS_POLICY_REPLICA_MASTER) {
+		// Make volatile reference so changes to tend thread will be reflected in this thread.
+		return reserve_master(cluster, (as_node*)as_load_ptr(&p->nodes[0]), reserve);
 	}
 
-	if (! master) {
-		return reserve_node(cluster, prole, cp_mode);
+	as_node* nodes[AS_MAX_REPLICAS];
+	uint32_t n = (replica == AS_POLICY_REPLICA_PREFER_RACK && cluster->rack_aware)?
+		load_rack_nodes(cluster, p, nodes) : load_nodes(p, nodes);
+
+	if (n == 0) {
+		return reserve_node(cluster, NULL, cp_mode, reserve);
 	}
 
 	if (replica == AS_POLICY_REPLICA_ANY) {
-		// Alternate between master and prole for reads with global iterator.
-		uint32_t r = as_faa_uint32(&g_randomizer, 1);
-		use_master = (r & 1);
+		// Spread reads over all replicas with global iterator.
+		sequence += as_faa_uint32(&g_randomizer, 1);
+	}
+
+	// AS_POLICY_REPLICA_SEQUENCE and AS_POLICY_REPLICA_PREFER_RACK start at the first node
+	// and move to the next node each time sequence is incremented on retry.
+	// Use first active node from that position.
+	// Skip nodes with an open circuit breaker.
+	bool blocked = false;
+
+	for (uint32_t i = 0; i < n; i++) {
+		as_node* node = nodes[(sequence + i) % n];
+
+		if (as_load_uint8(&node->active)) {
+			if (! as_node_breaker_allow(node)) {
+				blocked = true;
+				continue;
+			}
+
+			if (reserve) {
+				as_node_reserve(node);
+			}
+			return node;
+		}
 	}
 
-	// AS_POLICY_REPLICA_SEQUENCE uses the use_master preference without modification.
-	if (use_master) {
-		return reserve_node_alternate(cluster, master, prole, cp_mode);
+	if (blocked) {
+		// Fail fast instead of sending to a random node that would proxy to a blocked node.
+		return NULL;
 	}
-	return reserve_node_alternate(cluster, prole, master, cp_mode);
+	return reserve_node(cluster, NULL, cp_mode, reserve);
+}
+
+as_node*
+as_partition_get_node(as_cluster* cluster, as_partition* p, as_policy_replica replica, uint32_t sequence, bool cp_mode)
+{
+	return get_node(cluster, p, replica, sequence, cp_mode, true);
+}
+
+as_node*
+as_partition_get_node_epoch(as_cluster* cluster, as_partition* p, as_policy_replica replica, uint32_t sequence, bool cp_mode)
+{
+	return get_node(cluster, p, replica, sequence, cp_mode, false);
 }
 
 as_partition_table*
@@ -209,8 +281,10 @@ as_partition_tables_find_node(as_partition_tables* tables, as_node* node)
 			p = &table->partitions[j];
 			
 			// Use reference equality for performance.
-			if (p->master == node || p->prole == node) {
-				return true;
+			for (uint32_t k = 0; k < AS_MAX_REPLICAS; k++) {
+				if (p->nodes[k] == node) {
+					return true;
+				}
 			}
 		}
 	}
@@ -223,56 +297,44 @@ force_replicas_refresh(as_node* node)
 	node->partition_generation = (uint32_t)-1;
 }
 
+/**
+ * Use non-inline function for garbarge collector function pointer reference.
+ * Forward to inlined release.
+ */
 static void
-as_partition_update(as_partition* p, as_node* node, bool master, bool owns, uint32_t regime)
+release_node(as_node* node)
+{
+	as_node_release(node);
+}
+
+static void
+as_partition_update(as_vector* gc, as_partition* p, as_node* node, uint32_t replica, bool owns, uint32_t regime)
 {
 	// Volatile reads are not necessary because the tend thread exclusively modifies partition.
 	// Volatile writes are used so other threads can view change.
-	if (master) {
-		if (node == p->master) {
-			if (! owns) {
-				set_node(&p->master, NULL);
-				as_node_release(node);
-			}
-		}
-		else {
-			if (owns && (regime == 0 || regime >= p->regime)) {
-				as_node* tmp = p->master;
-				as_node_reserve(node);
-				set_node(&p->master, node);
-
-				if (regime > p->regime) {
-					p->regime = regime;
-				}
-
-				if (tmp) {
-					force_replicas_refresh(tmp);
-					as_node_release(tmp);
-				}
-			}
+	// Replaced node references are released through the garbage collector because
+	// request threads may still be using the node without holding a reference.
+	as_node** trg = &p->nodes[replica];
+
+	if (node == *trg) {
+		if (! owns) {
+			set_node(trg, NULL);
+			as_gc_add(gc, node, (as_release_fn)release_node);
 		}
 	}
 	else {
-		if (node == p->prole) {
-			if (! owns) {
-				set_node(&p->prole, NULL);
-				as_node_release(node);
-			}
-		}
-		else {
-			if (owns && (regime == 0 || regime >= p->regime)) {
-				as_node* tmp = p->prole;
-				as_node_reserve(node);
-				set_node(&p->prole, node);
+		if (owns && (regime == 0 || regime >= p->regime)) {
+			as_node* tmp = *trg;
+			as_node_reserve(node);
+			set_node(trg, node);
 
-				if (regime > p->regime) {
-					p->regime = regime;
-				}
+			if (regime > p->regime) {
+				p->regime = regime;
+			}
 
-				if (tmp) {
-					force_replicas_refresh(tmp);
-					as_node_release(tmp);
-				}
+			if (tmp) {
+				force_replicas_refresh(tmp);
+				as_gc_add(gc, tmp, (as_release_fn)release_node);
 			}
 		}
 	}
@@ -294,24 +356,132 @@ as_partition_vector_get(as_vector* tables, const char* ns)
 }
 
 static void
-decode_and_update(char* bitmap_b64, uint32_t len, as_partition_table* table, as_node* node, bool master, uint32_t regime)
+decode_and_update(as_vector* gc, char* bitmap_b64, uint32_t len, as_partition_table* table, as_node* node, uint32_t replica, uint32_t regime)
 {
 	// Size allows for padding - is actual size rounded up to multiple of 3.
-	uint8_t* bitmap = (uint8_t*)alloca(cf_b64_decoded_buf_size(len));
+	uint8_t* visit = (uint8_t*)alloca(cf_b64_decoded_buf_size(len));
 
 	// For now - for speed - trust validity of encoded characters.
-	cf_b64_decode(bitmap_b64, len, bitmap, NULL);
+	const uint8_t* bitmap = as_partition_bitmap_update(node, table->ns, replica, bitmap_b64, len, visit);
 
-	// Expand the bitmap.
-	for (uint32_t i = 0; i < table->size; i++) {
-		bool owns = ((bitmap[i >> 3] & (0x80 >> (i & 7))) != 0);
+	// Expand the bitmap.  Partitions not owned by node before or after this update
+	// can not reference node, so they are skipped.
+	uint32_t max = table->size;
+
+	for (uint32_t i = as_partition_bitmap_next(visit, 0, max); i < max; i = as_partition_bitmap_next(visit, i + 1, max)) {
+		bool owns = as_partition_bitmap_get(bitmap, i);
 		/*
 		if (owns) {
-			as_log_debug("Set partition %s:%s:%u:%s", master? "master" : "prole", table->ns, i, node->name);
+			as_log_debug("Set partition %u:%s:%u:%s", replica, table->ns, i, node->name);
 		}
 		*/
-		as_partition_update(&table->partitions[i], node, master, owns, regime);
+		as_partition_update(gc, &table->partitions[i], node, replica, owns, regime);
+	}
+}
+
+const uint8_t*
+as_partition_bitmap_update(
+	as_node* node, const char* ns, uint32_t replica, const char* bitmap_b64, uint32_t len,
+	uint8_t* visit
+	)
+{
+	as_vector* bitmaps = &node->partition_bitmaps;
+	uint32_t size = cf_b64_decoded_buf_size(len);
+	as_partition_bitmap* pb = NULL;
+
+	for (uint32_t i = 0; i < bitmaps->size; i++) {
+		as_partition_bitmap* item = as_vector_get(bitmaps, i);
+
+		if (item->replica == replica && strcmp(item->ns, ns) == 0) {
+			pb = item;
+			break;
+		}
+	}
+
+	if (! pb || pb->encoded_len != len) {
+		if (pb) {
+			cf_free(pb->encoded);
+			cf_free(pb->bitmap);
+		}
+		else {
+			pb = as_vector_reserve(bitmaps);
+			as_strncpy(pb->ns, ns, sizeof(pb->ns));
+			pb->replica = replica;
+		}
+		pb->encoded_len = len;
+		pb->encoded = cf_malloc(len);
+		pb->bitmap = cf_malloc(size);
+		memcpy(pb->encoded, bitmap_b64, len);
+		cf_b64_decode(bitmap_b64, len, pb->bitmap, NULL);
+
+		// No previous bitmap, so all partitions must be visited.
+		memset(visit, 0xFF, size);
+		return pb->bitmap;
+	}
+
+	// Partitions owned in previous bitmap must be visited so ownership can be removed.
+	memcpy(visit, pb->bitmap, size);
+
+	if (memcmp(pb->encoded, bitmap_b64, len) == 0) {
+		return pb->bitmap;
+	}
+
+	// Each 4 character group decodes independently into 3 bytes, so only decode
+	// groups that changed.  Rebalance usually moves a small number of partitions.
+	for (uint32_t i = 0, j = 0; i < len; i += 4, j += 3) {
+		if (memcmp(pb->encoded + i, bitmap_b64 + i, 4) != 0) {
+			cf_b64_decode(bitmap_b64 + i, 4, pb->bitmap + j, NULL);
+		}
+	}
+	memcpy(pb->encoded, bitmap_b64, len);
+
+	for (uint32_t i = 0; i < size; i++) {
+		visit[i] |= pb->bitmap[i];
+	}
+	return pb->bitmap;
+}
+
+uint32_t
+as_partition_bitmap_next(const uint8_t* bitmap, uint32_t id, uint32_t max)
+{
+	while (id < max) {
+		uint32_t byte = id >> 3;
+
+		if ((id & 63) == 0 && id + 64 <= max) {
+			// Skip 64 partitions at a time when none are set.
+			uint64_t word;
+			memcpy(&word, bitmap + byte, sizeof(word));
+
+			if (word == 0) {
+				id += 64;
+				continue;
+			}
+		}
+
+		uint8_t bits = bitmap[byte] & (0xFF >> (id & 7));
+
+		if (bits == 0) {
+			id = (byte + 1) << 3;
+			continue;
+		}
+
+		while (! (bits & (0x80 >> (id & 7)))) {
+			id++;
+		}
+		return (id < max)? id : max;
+	}
+	return max;
+}
+
+void
+as_partition_bitmaps_destroy(as_vector* bitmaps)
+{
+	for (uint32_t i = 0; i < bitmaps->size; i++) {
+		as_partition_bitmap* pb = as_vector_get(bitmaps, i);
+		cf_free(pb->encoded);
+		cf_free(pb->bitmap);
 	}
+	as_vector_destroy(bitmaps);
 }
 
 static void
@@ -336,10 +506,7 @@ as_partition_tables_copy_add(as_cluster* cluster, as_partition_tables* tables_ol
 	set_partition_tables(cluster, tables_new);
 	
 	// Put old tables on garbage collector stack.
-	as_gc_item item;
-	item.data = tables_old;
-	item.release_fn = (as_release_fn)release_partition_tables;
-	as_vector_append(cluster->gc, &item);
+	as_gc_add(cluster->gc, tables_old, (as_release_fn)release_partition_tables);
 }
 
 bool
@@ -391,7 +558,7 @@ as_partition_tables_update(as_cluster* cluster, as_node* node, char* buf, bool m
 			}
 
 			if (cluster->shm_info) {
-				as_shm_update_partitions(cluster->shm_info, ns, bitmap_b64, len, node, master, 0);
+				as_shm_update_partitions(cluster->shm_info, ns, bitmap_b64, len, node, master? 0 : 1, 0);
 			}
 			else {
 				as_partition_table* table = as_partition_tables_get(tables, ns);
@@ -406,7 +573,7 @@ as_partition_tables_update(as_cluster* cluster, as_node* node, char* buf, bool m
 				}
 
 				// Decode partition bitmap and update client's view.
-				decode_and_update(bitmap_b64, (uint32_t)len, table, node, master, 0);
+				decode_and_update(cluster->gc, bitmap_b64, (uint32_t)len, table, node, master? 0 : 1, 0);
 			}
 			ns = ++p;
 		}
@@ -481,7 +648,7 @@ as_partition_tables_update_all(as_cluster* cluster, as_node* node, char* buf, bo
 			
 			int replica_count = atoi(begin);
 			
-			// Parse master and one prole partition bitmaps.
+			// Parse master and prole partition bitmaps.
 			for (int i = 0; i < replica_count; i++) {
 				begin = ++p;
 				
@@ -500,14 +667,14 @@ as_partition_tables_update_all(as_cluster* cluster, as_node* node, char* buf, bo
 					return false;
 				}
 				
-				// Only handle first two levels.  Do not process other proles.
+				// Only handle first AS_MAX_REPLICAS levels.  Do not process other proles.
 				// Level 0: master
-				// Level 1: prole 1
-				if (i < 2) {
-					bool master = (i == 0);
+				// Level 1..n: proles in sequence order
+				if (i < AS_MAX_REPLICAS) {
+					uint32_t replica = (uint32_t)i;
 					
 					if (cluster->shm_info) {
-						as_shm_update_partitions(cluster->shm_info, ns, begin, len, node, master, regime);
+						as_shm_update_partitions(cluster->shm_info, ns, begin, len, node, replica, regime);
 					}
 					else {
 						as_partition_table* table = as_partition_tables_get(tables, ns);
@@ -522,7 +689,7 @@ as_partition_tables_update_all(as_cluster* cluster, as_node* node, char* buf, bo
 						}
 						
 						// Decode partition bitmap and update client's view.
-						decode_and_update(begin, (uint32_t)len, table, node, master, regime);
+						decode_and_update(cluster->gc, begin, (uint32_t)len, table, node, replica, regime);
 					}
 				}
 			}
@@ -101,6 +101,11 @@ cancel_connection(as_event_command* cmd, as_error* err, int32_t source, bool ret
 
 	conn->canceling = true;
 
+	// Stop parsing buffered responses for this connection.
+	if (loop->read_conn == conn) {
+		loop->read_conn = NULL;
+	}
+
 	if (source != CANCEL_CONNECTION_TIMEOUT) {
 		assert(cmd == conn->writer || cf_ll_get_head(&conn->readers) == &cmd->pipe_link);
 	}
@@ -499,3 +504,40 @@ as_pipe_read_start(as_event_command* cmd)
 
 	loop->pipe_cb_calling = false;
 }
+
+uint32_t
+as_pipe_trim_connections(as_conn_pool* pool, uint32_t count)
+{
+	uint32_t size = as_queue_size(&pool->queue);
+	uint32_t trimmed = 0;
+	as_pipe_connection* conn;
+
+	// Rotate through pooled connections once.  Only connections without a writer or readers
+	// are idle.  Their watcher has already been stopped in next_reader().
+	for (uint32_t i = 0; i < size && trimmed < count && as_queue_pop(&pool->queue, &conn); i++) {
+		if (conn->canceling) {
+			as_log_trace("Pipeline connection %p is being canceled", conn);
+			conn->in_pool = false;
+			continue;
+		}
+
+		if (conn->canceled) {
+			as_log_trace("Pipeline connection %p was canceled earlier", conn);
+			as_event_release_connection((as_event_connection*)conn, pool);
+			continue;
+		}
+
+		if (conn->writer == NULL && cf_ll_size(&conn->readers) == 0) {
+			as_log_trace("Trimming idle pipeline connection %p", conn);
+			as_event_release_connection((as_event_connection*)conn, pool);
+			trimmed++;
+			continue;
+		}
+
+		if (! as_conn_pool_put(pool, &conn)) {
+			// Connection is closed by next_reader() when its readers are done.
+			conn->in_pool = false;
+		}
+	}
+	return trimmed;
+}
@@ -69,6 +69,7 @@ as_record_defaults(as_record* rec, bool free, uint16_t nbins)
 	rec->key.ns[0] = '\0';
 	rec->key.set[0] = '\0';
 	rec->key.valuep = NULL;
+	rec->key.nsh = NULL;
 
 	rec->key.digest.init = false;
 	memset(rec->key.digest.value, 0, AS_DIGEST_VALUE_SIZE);
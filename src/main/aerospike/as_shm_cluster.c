@@ -79,7 +79,7 @@ as_shm_dump_partition_table(as_partition_table_shm* table, uint32_t n_partitions
 
 	for (uint32_t i = 0; i < n_partitions; i++) {
 		as_partition_shm* p = &table->partitions[i];
-		printf("%d %d\n", i, p->master);
+		printf("%d %d\n", i, p->nodes[0]);
 	}
 }
 
@@ -166,6 +166,7 @@ as_shm_add_nodes(as_cluster* cluster, as_vector* /* <as_node*> */ nodes_to_add)
 				node_shm->tls_name[0] = 0;
 			}
 			node_shm->features = node_to_add->features;
+			node_shm->rack_id = node_to_add->rack_id;
 			node_shm->active = true;
 			as_swlock_write_unlock(&node_shm->lock);
 			
@@ -189,6 +190,7 @@ as_shm_add_nodes(as_cluster* cluster, as_vector* /* <as_node*> */ nodes_to_add)
 					node_shm->tls_name[0] = 0;
 				}
 				node_shm->features = node_to_add->features;
+				node_shm->rack_id = node_to_add->rack_id;
 				node_shm->active = true;
 				as_swlock_write_unlock(&node_shm->lock);
 				
@@ -305,8 +307,10 @@ as_shm_partition_tables_find_node(as_cluster_shm* cluster_shm, as_node* node)
 		for (uint32_t j = 0; j < max_partitions; j++) {
 			p = &table->partitions[j];
 
-			if (p->master == node_index || p->prole == node_index) {
-				return true;
+			for (uint32_t k = 0; k < AS_MAX_REPLICAS; k++) {
+				if (p->nodes[k] == node_index) {
+					return true;
+				}
 			}
 		}
 		table = as_shm_next_partition_table(cluster_shm, table);
@@ -360,70 +364,73 @@ as_shm_force_replicas_refresh(as_shm_info* shm_info, uint32_t node_index)
 	}
 }
 
+static inline void
+as_shm_partition_write(as_partition_table_shm* table, bool* writing)
+{
+	// Only start table write when a partition actually changes, so unchanged tables are not
+	// copied and their cache lines are not invalidated in other processes.
+	if (! *writing) {
+		as_partition_table_shm_write_begin(table);
+		*writing = true;
+	}
+}
+
 static void
-as_shm_partition_update(as_shm_info* shm_info, as_partition_shm* p, uint32_t node_index, bool master, bool owns, uint32_t regime)
+as_shm_partition_update(as_shm_info* shm_info, as_partition_table_shm* table, as_partition_shm* p, uint32_t node_index, uint32_t replica, bool owns, uint32_t regime, bool* writing)
 {
 	// node_index starts at one (zero indicates unset).
-	if (master) {
-		if (node_index == p->master) {
-			if (! owns) {
-				as_store_uint32(&p->master, 0);
-			}
-		}
-		else {
-			if (owns && (regime == 0 || regime >= as_load_uint32(&p->regime))) {
-				if (p->master) {
-					as_shm_force_replicas_refresh(shm_info, p->master);
-				}
-				as_store_uint32(&p->master, node_index);
+	uint32_t* trg = &p->nodes[replica];
 
-				if (regime > p->regime) {
-					as_store_uint32(&p->regime, regime);
-				}
-			}
+	if (node_index == *trg) {
+		if (! owns) {
+			as_shm_partition_write(table, writing);
+			as_store_uint32(trg, 0);
 		}
 	}
 	else {
-		if (node_index == p->prole) {
-			if (! owns) {
-				as_store_uint32(&p->prole, 0);
+		if (owns && (regime == 0 || regime >= as_load_uint32(&p->regime))) {
+			as_shm_partition_write(table, writing);
+
+			if (*trg) {
+				as_shm_force_replicas_refresh(shm_info, *trg);
 			}
-		}
-		else {
-			if (owns && (regime == 0 || regime >= as_load_uint32(&p->regime))) {
-				if (p->prole) {
-					as_shm_force_replicas_refresh(shm_info, p->prole);
-				}
-				as_store_uint32(&p->prole, node_index);
+			as_store_uint32(trg, node_index);
 
-				if (regime > p->regime) {
-					as_store_uint32(&p->regime, regime);
-				}
+			if (regime > p->regime) {
+				as_store_uint32(&p->regime, regime);
 			}
 		}
 	}
 }
 
 static void
-as_shm_decode_and_update(as_shm_info* shm_info, char* bitmap_b64, int64_t len, as_partition_table_shm* table, uint32_t node_index, bool master, uint32_t regime)
+as_shm_decode_and_update(as_shm_info* shm_info, char* bitmap_b64, int64_t len, as_partition_table_shm* table, as_node* node, uint32_t replica, uint32_t regime)
 {
 	// Size allows for padding - is actual size rounded up to multiple of 3.
-	uint8_t* bitmap = (uint8_t*)alloca(cf_b64_decoded_buf_size((uint32_t)len));
+	uint8_t* visit = (uint8_t*)alloca(cf_b64_decoded_buf_size((uint32_t)len));
 	
 	// For now - for speed - trust validity of encoded characters.
-	cf_b64_decode(bitmap_b64, (uint32_t)len, bitmap, NULL);
+	const uint8_t* bitmap = as_partition_bitmap_update(node, table->ns, replica, bitmap_b64, (uint32_t)len, visit);
 	
-	// Expand the bitmap.
+	// Expand the bitmap.  Partitions not owned by node before or after this update
+	// can not reference node, so they are skipped.
 	uint32_t max = shm_info->cluster_shm->n_partitions;
+	uint32_t node_index = node->index + 1;
+	bool writing = false;
 
-	for (uint32_t i = 0; i < max; i++) {
-		bool owns = ((bitmap[i >> 3] & (0x80 >> (i & 7))) != 0);
-		as_shm_partition_update(shm_info, &table->partitions[i], node_index, master, owns, regime);
+	for (uint32_t i = as_partition_bitmap_next(visit, 0, max); i < max; i = as_partition_bitmap_next(visit, i + 1, max)) {
+		bool owns = as_partition_bitmap_get(bitmap, i);
+		as_shm_partition_update(shm_info, table, &table->partitions[i], node_index, replica, owns, regime, &writing);
+	}
+
+	// Readers in other processes use the second copy until the update ends.
+	if (writing) {
+		as_partition_table_shm_write_end(table, max);
 	}
 }
 
 void
-as_shm_update_partitions(as_shm_info* shm_info, const char* ns, char* bitmap_b64, int64_t len, as_node* node, bool master, uint32_t regime)
+as_shm_update_partitions(as_shm_info* shm_info, const char* ns, char* bitmap_b64, int64_t len, as_node* node, uint32_t replica, uint32_t regime)
 {
 	as_cluster_shm* cluster_shm = shm_info->cluster_shm;
 	as_partition_table_shm* table = as_shm_find_partition_table(cluster_shm, ns);
@@ -433,19 +440,31 @@ as_shm_update_partitions(as_shm_info* shm_info, const char* ns, char* bitmap_b64
 	}
 	
 	if (table) {
-		as_shm_decode_and_update(shm_info, bitmap_b64, len, table, node->index + 1, master, regime);
+		as_shm_decode_and_update(shm_info, bitmap_b64, len, table, node, replica, regime);
 	}
 }
 
+void
+as_shm_update_rack(as_shm_info* shm_info, as_node* node, int rack_id)
+{
+	// This function is called by shared memory master tending thread.
+	// Rack is read from shared memory so all attached processes see the change.
+	as_node_shm* node_shm = &shm_info->cluster_shm->nodes[node->index];
+	as_store_int32(&node_shm->rack_id, rack_id);
+}
+
 static inline as_node*
-as_shm_reserve_master(as_cluster* cluster, as_node** local_nodes, uint32_t node_index)
+as_shm_reserve_master(as_cluster* cluster, as_node** local_nodes, uint32_t node_index, bool reserve)
 {
 	// node_index starts at one (zero indicates unset).
 	if (node_index) {
 		as_node* node = (as_node*)as_load_ptr(&local_nodes[node_index-1]);
 
-		if (node && as_load_uint8(&node->active)) {
-			as_node_reserve(node);
+		// Master with an open circuit breaker fails fast.
+		if (node && as_load_uint8(&node->active) && as_node_breaker_allow(node)) {
+			if (reserve) {
+				as_node_reserve(node);
+			}
 			return node;
 		}
 	}
@@ -454,36 +473,141 @@ as_shm_reserve_master(as_cluster* cluster, as_node** local_nodes, uint32_t node_
 }
 
 static inline as_node*
-as_shm_reserve_node(as_cluster* cluster, as_node** local_nodes, uint32_t node_index, bool cp_mode)
+as_shm_reserve_node(as_cluster* cluster, as_node** local_nodes, uint32_t node_index, bool cp_mode, bool reserve)
 {
 	// node_index starts at one (zero indicates unset).
 	if (node_index) {
 		as_node* node = (as_node*)as_load_ptr(&local_nodes[node_index-1]);
 
 		if (node && as_load_uint8(&node->active)) {
-			as_node_reserve(node);
+			if (reserve) {
+				as_node_reserve(node);
+			}
 			return node;
 		}
 	}
-	return cp_mode ? NULL : as_node_get_random(cluster);
+
+	if (cp_mode) {
+		return NULL;
+	}
+	return reserve ? as_node_get_random(cluster) : as_node_get_random_epoch(cluster);
+}
+
+static uint32_t g_shm_randomizer = 0;
+
+static inline uint32_t
+as_shm_load_nodes(as_node** local_nodes, as_partition_shm* snapshot, as_node** nodes)
+{
+	// node_index starts at one (zero indicates unset).
+	uint32_t n = 0;
+
+	for (uint32_t i = 0; i < AS_MAX_REPLICAS; i++) {
+		uint32_t node_index = snapshot->nodes[i];
+
+		if (node_index) {
+			as_node* node = (as_node*)as_load_ptr(&local_nodes[node_index-1]);
+
+			if (node) {
+				nodes[n++] = node;
+			}
+		}
+	}
+	return n;
+}
+
+static inline uint32_t
+as_shm_load_rack_nodes(as_cluster* cluster, as_node** local_nodes, as_partition_shm* snapshot, as_node** nodes)
+{
+	// Order replicas on client's rack first, then other replicas.  Racks are read from
+	// shared memory because only the tend master process refreshes node racks.
+	as_node_shm* nodes_shm = cluster->shm_info->cluster_shm->nodes;
+	as_node* others[AS_MAX_REPLICAS];
+	uint32_t n = 0;
+	uint32_t n_others = 0;
+
+	for (uint32_t i = 0; i < AS_MAX_REPLICAS; i++) {
+		uint32_t node_index = snapshot->nodes[i];
+
+		if (node_index) {
+			as_node* node = (as_node*)as_load_ptr(&local_nodes[node_index-1]);
+
+			if (node) {
+				if (as_load_int32(&nodes_shm[node_index-1].rack_id) == cluster->rack_id) {
+					nodes[n++] = node;
+				}
+				else {
+					others[n_others++] = node;
+				}
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < n_others; i++) {
+		nodes[n++] = others[i];
+	}
+	return n;
 }
 
 static as_node*
-as_shm_reserve_node_alternate(as_cluster* cluster, as_node** local_nodes, uint32_t chosen_index, uint32_t alternate_index, bool cp_mode)
+as_shm_get_node(as_cluster* cluster, as_partition_shm* p, as_policy_replica replica, uint32_t sequence, bool cp_mode, bool reserve)
 {
-	// index values start at one (zero indicates unset).
-	as_node* chosen = (as_node*)as_load_ptr(&local_nodes[chosen_index-1]);
-	
 	// Make volatile reference so changes to tend thread will be reflected in this thread.
-	if (chosen && as_load_uint8(&chosen->active)) {
-		as_node_reserve(chosen);
-		return chosen;
+	as_cluster_shm* cluster_shm = cluster->shm_info->cluster_shm;
+	as_node** local_nodes = cluster->shm_info->local_nodes;
+
+	// Read all replicas from the same partition table update.
+	as_partition_shm snapshot;
+	as_partition_shm_read(as_shm_find_partition_table_by_partition(cluster_shm, p), p, cluster_shm->n_partitions, &snapshot);
+
+	if (replica == AS_POLICY_REPLICA_MASTER) {
+		return as_shm_reserve_master(cluster, local_nodes, snapshot.nodes[0], reserve);
+	}
+
+	as_node* nodes[AS_MAX_REPLICAS];
+	uint32_t n = (replica == AS_POLICY_REPLICA_PREFER_RACK && cluster->rack_aware)?
+		as_shm_load_rack_nodes(cluster, local_nodes, &snapshot, nodes) :
+		as_shm_load_nodes(local_nodes, &snapshot, nodes);
+
+	if (n == 0) {
+		return as_shm_reserve_node(cluster, local_nodes, 0, cp_mode, reserve);
+	}
+
+	if (replica == AS_POLICY_REPLICA_ANY) {
+		// Spread reads over all replicas with global iterator.
+		sequence += as_faa_uint32(&g_shm_randomizer, 1);
+	}
+
+	// AS_POLICY_REPLICA_SEQUENCE and AS_POLICY_REPLICA_PREFER_RACK start at the first node
+	// and move to the next node each time sequence is incremented on retry.
+	// Use first active node from that position.
+	// Skip nodes with an open circuit breaker.
+	bool blocked = false;
+
+	for (uint32_t i = 0; i < n; i++) {
+		as_node* node = nodes[(sequence + i) % n];
+
+		if (as_load_uint8(&node->active)) {
+			if (! as_node_breaker_allow(node)) {
+				blocked = true;
+				continue;
+			}
+
+			if (reserve) {
+				as_node_reserve(node);
+			}
+			return node;
+		}
 	}
-	return as_shm_reserve_node(cluster, local_nodes, alternate_index, cp_mode);
+
+	if (blocked) {
+		// Fail fast instead of sending to a random node that would proxy to a blocked node.
+		return NULL;
+	}
+	return as_shm_reserve_node(cluster, local_nodes, 0, cp_mode, reserve);
 }
 
-as_status
-as_shm_cluster_get_node(as_cluster* cluster, as_error* err, const char* ns, const uint8_t* digest, as_policy_replica replica, bool use_master, as_node** node_pp)
+static as_status
+as_shm_cluster_find_node(as_cluster* cluster, as_error* err, const char* ns, const uint8_t* digest, as_policy_replica replica, uint32_t sequence, bool reserve, as_node** node_pp)
 {
 	as_cluster_shm* cluster_shm = cluster->shm_info->cluster_shm;
 	as_partition_table_shm* table = as_shm_find_partition_table(cluster_shm, ns);
@@ -495,51 +619,251 @@ as_shm_cluster_get_node(as_cluster* cluster, as_error* err, const char* ns, cons
 
 	uint32_t partition_id = as_partition_getid(digest, cluster_shm->n_partitions);
 	as_partition_shm* p = &table->partitions[partition_id];
-	as_node* node = as_partition_shm_get_node(cluster, p, replica, use_master, table->cp_mode);
+	as_node* node = as_shm_get_node(cluster, p, replica, sequence, table->cp_mode, reserve);
 
 	if (! node) {
 		*node_pp = NULL;
-		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "Invalid node for key.");
+		return as_error_update(err, AEROSPIKE_ERR_CLIENT, "No available node for key.");
 	}
 
 	*node_pp = node;
 	return AEROSPIKE_OK;
 }
 
-static uint32_t g_shm_randomizer = 0;
+as_status
+as_shm_cluster_get_node(as_cluster* cluster, as_error* err, const char* ns, const uint8_t* digest, as_policy_replica replica, uint32_t sequence, as_node** node_pp)
+{
+	return as_shm_cluster_find_node(cluster, err, ns, digest, replica, sequence, true, node_pp);
+}
+
+as_status
+as_shm_cluster_get_node_epoch(as_cluster* cluster, as_error* err, const char* ns, const uint8_t* digest, as_policy_replica replica, uint32_t sequence, as_node** node_pp)
+{
+	return as_shm_cluster_find_node(cluster, err, ns, digest, replica, sequence, false, node_pp);
+}
 
 as_node*
-as_partition_shm_get_node(as_cluster* cluster, as_partition_shm* p, as_policy_replica replica, bool use_master, bool cp_mode)
+as_partition_shm_get_node(as_cluster* cluster, as_partition_shm* p, as_policy_replica replica, uint32_t sequence, bool cp_mode)
 {
-	// Make volatile reference so changes to tend thread will be reflected in this thread.
-	as_node** local_nodes = cluster->shm_info->local_nodes;
-	uint32_t master = as_load_uint32(&p->master);
+	return as_shm_get_node(cluster, p, replica, sequence, cp_mode, true);
+}
 
-	if (replica == AS_POLICY_REPLICA_MASTER) {
-		return as_shm_reserve_master(cluster, local_nodes, master);
+as_node*
+as_partition_shm_get_node_epoch(as_cluster* cluster, as_partition_shm* p, as_policy_replica replica, uint32_t sequence, bool cp_mode)
+{
+	return as_shm_get_node(cluster, p, replica, sequence, cp_mode, false);
+}
+
+static void
+as_shm_node_stats_local(as_cluster* cluster, as_node* node, as_shm_node_stats* stats)
+{
+	// Pool counts are read without locks.  Slightly stale values are acceptable for stats.
+	uint32_t conns = 0;
+
+	for (uint32_t i = 0; i < cluster->conn_pools_per_node; i++) {
+		conns += as_load_uint32(&node->conn_pool_locks[i].pool.total);
+	}
+
+	if (node->async_conn_pools) {
+		for (uint32_t i = 0; i < as_event_loop_size; i++) {
+			conns += as_load_uint32(&node->async_conn_pools[i].total);
+			conns += as_load_uint32(&node->pipe_conn_pools[i].total);
+		}
+	}
+
+	stats->conns = conns;
+
+	// Commands count themselves while they run, so pipelined commands are included too.
+	stats->in_flight = as_load_uint32(&node->in_flight);
+}
+
+static void
+as_shm_update_latency(as_node_shm* node_shm, uint32_t sample)
+{
+	// EWMA with weight 1/8 for new samples.  Processes publish independently, so use CAS.
+	uint32_t old;
+	uint32_t val;
+
+	do {
+		old = as_load_uint32(&node_shm->latency_us);
+		val = (old == 0)? sample : (uint32_t)((int64_t)old + (((int64_t)sample - (int64_t)old) / 8));
+	} while (! as_cas_uint32(&node_shm->latency_us, old, val));
+}
+
+static as_process_stats_shm*
+as_shm_claim_process_stats(as_shm_info* shm_info, uint32_t pid, uint64_t now)
+{
+	as_cluster_shm* cluster_shm = shm_info->cluster_shm;
+	uint32_t nodes_capacity = as_load_uint32(&cluster_shm->nodes_capacity);
+	uint32_t max = as_load_uint32(&cluster_shm->processes_capacity);
+
+	for (uint32_t i = 0; i < max; i++) {
+		as_process_stats_shm* ps = as_shm_get_process_stats(cluster_shm, i);
+		uint64_t ts = as_load_uint64(&ps->timestamp);
+
+		// Free slots and slots of processes that exited without cleanup are stale.
+		// Claim by timestamp, so other processes see the slot as taken immediately.
+		if (ts + shm_info->takeover_threshold_ms > now || ! as_cas_uint64(&ps->timestamp, ts, now)) {
+			continue;
+		}
+
+		// Hide slot from readers while counts of previous owner are cleared.
+		as_store_uint32(&ps->pid, 0);
+
+		for (uint32_t j = 0; j < nodes_capacity; j++) {
+			as_store_uint32(&ps->nodes[j].conns, 0);
+			as_store_uint32(&ps->nodes[j].in_flight, 0);
+		}
+		as_store_uint32(&ps->pid, pid);
+		return ps;
 	}
+	return NULL;
+}
 
-	uint32_t prole = as_load_uint32(&p->prole);
+void
+as_shm_publish_node_stats(as_cluster* cluster)
+{
+	// Called by every attached process's tend thread.  Each process writes only its own
+	// slot, so counts of a process that crashes stop being counted once its slot is stale.
+	as_shm_info* shm_info = cluster->shm_info;
+	as_cluster_shm* cluster_shm = shm_info->cluster_shm;
+	as_process_stats_shm* ps = shm_info->process_stats;
+	uint32_t pid = getpid();
+	uint64_t now = cf_getms();
 
-	if (! prole) {
-		return as_shm_reserve_node(cluster, local_nodes, master, cp_mode);
+	if (! as_load_uint8(&cluster_shm->ready)) {
+		// Segment layout is not initialized yet.
+		return;
 	}
 
-	if (! master) {
-		return as_shm_reserve_node(cluster, local_nodes, prole, cp_mode);
+	if (! ps || as_load_uint32(&ps->pid) != pid) {
+		// Slot was never claimed or was reclaimed while this process was not publishing.
+		ps = shm_info->process_stats = as_shm_claim_process_stats(shm_info, pid, now);
+
+		if (! ps) {
+			// Retried every tend, so only warn when slots first run out.
+			if (! shm_info->process_stats_warned) {
+				as_log_warn("Shared memory node stats slots are full: %u. Increase shm_max_processes",
+					as_load_uint32(&cluster_shm->processes_capacity));
+				shm_info->process_stats_warned = true;
+			}
+		}
+		else {
+			shm_info->process_stats_warned = false;
+		}
 	}
 
-	if (replica == AS_POLICY_REPLICA_ANY) {
-		// Alternate between master and prole for reads with global iterator.
-		uint32_t r = as_faa_uint32(&g_shm_randomizer, 1);
-		use_master = (r & 1);
+	uint32_t max = as_load_uint32(&cluster_shm->nodes_size);
+
+	for (uint32_t i = 0; i < max; i++) {
+		as_node_shm* node_shm = &cluster_shm->nodes[i];
+		as_node* node = as_load_ptr(&shm_info->local_nodes[i]);
+		as_shm_node_stats stats = {0, 0, 0};
+
+		if (node) {
+			as_shm_node_stats_local(cluster, node, &stats);
+
+			uint32_t count = as_fas_uint32(&node->latency_count, 0);
+			uint64_t sum = as_fas_uint64(&node->latency_sum, 0);
+
+			if (count > 0) {
+				as_shm_update_latency(node_shm, (uint32_t)(sum / count));
+			}
+		}
+
+		if (ps) {
+			as_store_uint32(&ps->nodes[i].conns, stats.conns);
+			as_store_uint32(&ps->nodes[i].in_flight, stats.in_flight);
+		}
 	}
 
-	// AS_POLICY_REPLICA_SEQUENCE uses the use_master preference without modification.
-	if (use_master) {
-		return as_shm_reserve_node_alternate(cluster, local_nodes, master, prole, cp_mode);
+	if (ps) {
+		as_store_uint64(&ps->timestamp, now);
+	}
+}
+
+static void
+as_shm_unpublish_node_stats(as_shm_info* shm_info)
+{
+	// Release this process's slot before detaching.
+	as_process_stats_shm* ps = shm_info->process_stats;
+
+	if (! ps || as_load_uint32(&ps->pid) != (uint32_t)getpid()) {
+		return;
+	}
+
+	as_store_uint32(&ps->pid, 0);
+	as_store_uint64(&ps->timestamp, 0);
+	shm_info->process_stats = NULL;
+}
+
+bool
+as_shm_get_node_stats(as_cluster* cluster, const char* node_name, as_shm_node_stats* stats)
+{
+	as_shm_info* shm_info = cluster->shm_info;
+
+	if (! shm_info) {
+		return false;
+	}
+
+	as_cluster_shm* cluster_shm = shm_info->cluster_shm;
+	int index = as_shm_find_node_index(cluster_shm, node_name);
+
+	if (index < 0) {
+		return false;
+	}
+
+	// Sum counts of processes that published recently.
+	uint64_t now = cf_getms();
+	uint32_t conns = 0;
+	uint32_t in_flight = 0;
+	uint32_t max = as_load_uint32(&cluster_shm->processes_capacity);
+
+	for (uint32_t i = 0; i < max; i++) {
+		as_process_stats_shm* ps = as_shm_get_process_stats(cluster_shm, i);
+
+		if (as_load_uint32(&ps->pid) == 0) {
+			continue;
+		}
+
+		uint64_t ts = as_load_uint64(&ps->timestamp);
+
+		if (ts + shm_info->takeover_threshold_ms <= now) {
+			// Process exited without releasing its slot.
+			continue;
+		}
+
+		conns += as_load_uint32(&ps->nodes[index].conns);
+		in_flight += as_load_uint32(&ps->nodes[index].in_flight);
+	}
+
+	stats->conns = conns;
+	stats->in_flight = in_flight;
+	stats->latency_us = as_load_uint32(&cluster_shm->nodes[index].latency_us);
+	return true;
+}
+
+static void
+as_shm_reset_partition_table_seqs(as_cluster_shm* cluster_shm)
+{
+	// A previous tend master may have died in the middle of a partition table update.
+	// Restore the first copy from the last consistent copy that readers are using and complete
+	// the sequence.  Partitions are corrected on next tend.
+	as_partition_table_shm* table = as_shm_get_partition_tables(cluster_shm);
+	uint32_t max = as_load_uint32(&cluster_shm->partition_tables_size);
+	uint32_t n_partitions = cluster_shm->n_partitions;
+
+	for (uint32_t i = 0; i < max; i++) {
+		if (as_load_uint32(&table->seq) & 1) {
+			memcpy(table->partitions, &table->partitions[n_partitions], sizeof(as_partition_shm) * n_partitions);
+			as_partition_table_shm_write_end(table, n_partitions);
+		}
+		else {
+			// Readers are on the first copy.  Second copy may be partially updated.
+			memcpy(&table->partitions[n_partitions], table->partitions, sizeof(as_partition_shm) * n_partitions);
+		}
+		table = as_shm_next_partition_table(cluster_shm, table);
 	}
-	return as_shm_reserve_node_alternate(cluster, local_nodes, prole, master, cp_mode);
 }
 
 static void
@@ -547,6 +871,7 @@ as_shm_takeover_cluster(as_shm_info* shm_info, as_cluster_shm* cluster_shm, uint
 {
 	as_log_info("Take over shared memory cluster: %d", pid);
 	as_store_uint32(&cluster_shm->owner_pid, pid);
+	as_shm_reset_partition_table_seqs(cluster_shm);
 	shm_info->is_tend_master = true;
 }
 
@@ -646,8 +971,19 @@ as_shm_tender(void* userdata)
 				nodes_gen = gen;
 				as_shm_reset_nodes(cluster);
 			}
+
+			// Circuit breakers and adaptive timeouts track this process's commands, so
+			// each process evaluates its own nodes.
+			as_nodes* nodes = cluster->nodes;
+
+			for (uint32_t i = 0; i < nodes->size; i++) {
+				as_node_tend_breaker(nodes->array[i]);
+				as_node_tend_latency(nodes->array[i]);
+			}
 		}
 
+		as_shm_publish_node_stats(cluster);
+
 		// Convert tend interval into absolute timeout.
 		cf_clock_current_add(&delta, &abstime);
 		
@@ -691,7 +1027,8 @@ as_shm_create(as_cluster* cluster, as_error* err, as_config* config)
 	uint32_t n_partitions = 4096;
 	
 	uint32_t size = sizeof(as_cluster_shm) + (sizeof(as_node_shm) * config->shm_max_nodes) +
-		((sizeof(as_partition_table_shm) + (sizeof(as_partition_shm) * n_partitions)) * config->shm_max_namespaces);
+		((sizeof(as_partition_table_shm) + (sizeof(as_partition_shm) * n_partitions * AS_SHM_PARTITION_COPIES)) * config->shm_max_namespaces) +
+		(as_shm_process_stats_size(config->shm_max_nodes) * config->shm_max_processes);
 	
 	uint32_t pid = getpid();
 
@@ -786,6 +1123,8 @@ as_shm_create(as_cluster* cluster, as_error* err, as_config* config)
 	// Initialize local data.
 	as_shm_info* shm_info = cf_malloc(sizeof(as_shm_info));
 	shm_info->local_nodes = cf_calloc(config->shm_max_nodes, sizeof(as_node*));
+	shm_info->process_stats = NULL;
+	shm_info->process_stats_warned = false;
 	shm_info->cluster_shm = cluster_shm;
 	shm_info->shm_id = id;
 	shm_info->takeover_threshold_ms = config->shm_takeover_threshold_sec * 1000;
@@ -799,7 +1138,8 @@ as_shm_create(as_cluster* cluster, as_error* err, as_config* config)
 		cluster_shm->nodes_capacity = config->shm_max_nodes;
 		cluster_shm->partition_tables_capacity = config->shm_max_namespaces;
 		cluster_shm->partition_tables_offset = sizeof(as_cluster_shm) + (sizeof(as_node_shm) * config->shm_max_nodes);
-		cluster_shm->partition_table_byte_size = sizeof(as_partition_table_shm) + (sizeof(as_partition_shm) * n_partitions);
+		cluster_shm->partition_table_byte_size = sizeof(as_partition_table_shm) + (sizeof(as_partition_shm) * n_partitions * AS_SHM_PARTITION_COPIES);
+		cluster_shm->processes_capacity = config->shm_max_processes;
 		cluster_shm->timestamp = cf_getms();
 
 		as_store_uint32(&cluster_shm->owner_pid, pid);
@@ -854,6 +1194,8 @@ as_shm_destroy(as_cluster* cluster)
 		return;
 	}
 
+	as_shm_unpublish_node_stats(shm_info);
+
 #if !defined(_MSC_VER)
 	// Detach shared memory.
 	shmdt(shm_info->cluster_shm);
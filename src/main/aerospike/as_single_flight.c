@@ -0,0 +1,258 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_single_flight.h>
+#include <citrusleaf/alloc.h>
+#include <citrusleaf/cf_clock.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static uint32_t
+as_single_flight_bins_size(const char* bins[])
+{
+	uint32_t size = 0;
+
+	if (bins) {
+		for (uint32_t i = 0; bins[i] != NULL && bins[i][0] != '\0'; i++) {
+			size += (uint32_t)strlen(bins[i]) + 1;
+		}
+	}
+	return size;
+}
+
+static as_flight*
+as_single_flight_find(
+	as_single_flight_shard* shard, const as_policy_read* policy, const as_key* key, uint32_t version,
+	bool all, const char* names, uint32_t bins_size
+	)
+{
+	as_flight* flight = shard->flights;
+
+	while (flight) {
+		if (memcmp(flight->digest, key->digest.value, AS_DIGEST_VALUE_SIZE) == 0 &&
+			flight->version == version && flight->all == all && flight->bins_size == bins_size &&
+			flight->replica == policy->replica &&
+			flight->consistency_level == policy->consistency_level &&
+			flight->linearize_read == policy->linearize_read &&
+			memcmp(flight->bins, names, bins_size) == 0 && strcmp(flight->ns, key->ns) == 0) {
+			return flight;
+		}
+		flight = flight->next;
+	}
+	return NULL;
+}
+
+static void
+as_single_flight_unlink(as_single_flight_shard* shard, as_flight* flight)
+{
+	as_flight** pp = &shard->flights;
+
+	while (*pp != flight) {
+		pp = &(*pp)->next;
+	}
+	*pp = flight->next;
+}
+
+static as_status
+as_single_flight_command(
+	as_cluster* cluster, as_error* err, const as_policy_read* policy, const as_key* key,
+	const char* bins[], as_command_raw_record* raw
+	)
+{
+	uint16_t n_fields;
+	size_t size = as_command_key_size(policy->key, key, &n_fields);
+	int nvalues = 0;
+
+	if (bins) {
+		for (nvalues = 0; bins[nvalues] != NULL && bins[nvalues][0] != '\0'; nvalues++) {
+			as_status status = as_command_bin_name_size(err, bins[nvalues], &size);
+
+			if (status != AEROSPIKE_OK) {
+				return status;
+			}
+		}
+	}
+
+	uint8_t read_attr = bins ? AS_MSG_INFO1_READ : AS_MSG_INFO1_READ | AS_MSG_INFO1_GET_ALL;
+	uint8_t* cmd = as_command_init(size);
+	uint8_t* p = as_command_write_header_read(cmd, read_attr, policy->consistency_level,
+		policy->linearize_read, as_policy_server_timeout(&policy->base), n_fields, nvalues);
+
+	p = as_command_write_key(p, policy->key, key);
+
+	for (int i = 0; i < nvalues; i++) {
+		p = as_command_write_bin_name(p, bins[i]);
+	}
+	size = as_command_write_end(cmd, p);
+
+	as_command_node cn;
+	as_command_node_init(&cn, key, policy->replica);
+
+	as_status status = as_command_execute(cluster, err, &policy->base, &cn, cmd, size, as_command_parse_raw, raw, true);
+
+	as_command_free(cmd, size);
+	return status;
+}
+
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+as_single_flight*
+as_single_flight_create(void)
+{
+	as_single_flight* sf = cf_malloc(sizeof(as_single_flight));
+
+	for (uint32_t i = 0; i < AS_SINGLE_FLIGHT_SHARDS; i++) {
+		as_single_flight_shard* shard = &sf->shards[i];
+		pthread_mutex_init(&shard->lock, NULL);
+		shard->flights = NULL;
+		memset(shard->versions, 0, sizeof(shard->versions));
+	}
+	sf->command = as_single_flight_command;
+	return sf;
+}
+
+void
+as_single_flight_destroy(as_single_flight* sf)
+{
+	for (uint32_t i = 0; i < AS_SINGLE_FLIGHT_SHARDS; i++) {
+		pthread_mutex_destroy(&sf->shards[i].lock);
+	}
+	cf_free(sf);
+}
+
+as_status
+as_single_flight_read(
+	as_cluster* cluster, as_error* err, const as_policy_read* policy, const as_key* key,
+	const char* bins[], as_record** rec
+	)
+{
+	// Flatten bin names for comparison with in-flight reads.
+	uint32_t bins_size = as_single_flight_bins_size(bins);
+	char* names = alloca(bins_size + 1);
+	char* n = names;
+
+	for (uint32_t i = 0; n < names + bins_size; i++) {
+		size_t len = strlen(bins[i]) + 1;
+		memcpy(n, bins[i], len);
+		n += len;
+	}
+
+	bool all = bins == NULL;
+	as_single_flight* sf = cluster->single_flight;
+	as_single_flight_shard* shard = as_single_flight_get_shard(sf, key->digest.value);
+
+	pthread_mutex_lock(&shard->lock);
+
+	// Reads that started before the last completed write of this key are not joined.
+	uint32_t version = as_load_uint32(as_single_flight_version(shard, key->digest.value));
+	as_flight* flight = as_single_flight_find(shard, policy, key, version, all, names, bins_size);
+
+	if (flight) {
+		// Join read in progress, but do not wait longer than this caller's own timeout.
+		flight->ref_count++;
+
+		uint64_t timeout = as_policy_total_timeout_us(&policy->base);
+
+		if (timeout > 0) {
+			struct timespec abstime;
+			struct timespec delta;
+			delta.tv_sec = (time_t)(timeout / 1000000);
+			delta.tv_nsec = (long)(timeout % 1000000) * 1000;
+			cf_clock_current_add(&delta, &abstime);
+
+			while (! flight->done) {
+				if (pthread_cond_timedwait(&flight->cond, &shard->lock, &abstime) == ETIMEDOUT &&
+					! flight->done) {
+					// First caller still holds a reference, so this is never the last one.
+					flight->ref_count--;
+					pthread_mutex_unlock(&shard->lock);
+					return as_error_update(err, AEROSPIKE_ERR_TIMEOUT,
+						"Timeout: total=%" PRIu64 "us waiting for read in progress", timeout);
+				}
+			}
+		}
+		else {
+			while (! flight->done) {
+				pthread_cond_wait(&flight->cond, &shard->lock);
+			}
+		}
+		pthread_mutex_unlock(&shard->lock);
+	}
+	else {
+		// Start new read.  Callers that arrive after it completes start another read,
+		// so results are never older than the caller.
+		flight = cf_malloc(sizeof(as_flight) + bins_size);
+		pthread_cond_init(&flight->cond, NULL);
+		flight->ref_count = 1;
+		flight->version = version;
+		flight->replica = policy->replica;
+		flight->consistency_level = policy->consistency_level;
+		flight->linearize_read = policy->linearize_read;
+		flight->bins_size = bins_size;
+		flight->done = false;
+		flight->all = all;
+		memcpy(flight->digest, key->digest.value, AS_DIGEST_VALUE_SIZE);
+		as_strncpy(flight->ns, key->ns, AS_NAMESPACE_MAX_SIZE);
+		memcpy(flight->bins, names, bins_size);
+		flight->next = shard->flights;
+		shard->flights = flight;
+		pthread_mutex_unlock(&shard->lock);
+
+		as_error_init(&flight->err);
+		flight->raw.buf = NULL;
+		flight->status = sf->command(cluster, &flight->err, policy, key, bins, &flight->raw);
+
+		pthread_mutex_lock(&shard->lock);
+		flight->done = true;
+		as_single_flight_unlink(shard, flight);
+		pthread_cond_broadcast(&flight->cond);
+		pthread_mutex_unlock(&shard->lock);
+	}
+
+	// Completed reads are not modified, so each caller can parse without the lock.
+	as_status status = flight->status;
+
+	if (status == AEROSPIKE_OK) {
+		as_msg* msg = &flight->raw.msg;
+		as_command_parse_result_data data;
+		data.record = rec;
+		data.deserialize = policy->deserialize;
+
+		status = as_command_parse_record(err, flight->raw.bins, msg->n_ops, msg->generation,
+			cf_server_void_time_to_ttl(msg->record_ttl), &data);
+	}
+	else {
+		as_error_copy(err, &flight->err);
+	}
+
+	pthread_mutex_lock(&shard->lock);
+	bool last = --flight->ref_count == 0;
+	pthread_mutex_unlock(&shard->lock);
+
+	if (last) {
+		cf_free(flight->raw.buf);
+		pthread_cond_destroy(&flight->cond);
+		cf_free(flight);
+	}
+	return status;
+}
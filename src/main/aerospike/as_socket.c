@@ -160,6 +160,9 @@ as_socket_wrap(as_socket* sock, int family, as_socket_fd fd, as_tls_context* ctx
 	sock->family = family;
 #endif
 	sock->idle_check.max_socket_idle = sock->idle_check.last_used = 0;
+	sock->rbuf = NULL;
+	sock->rbuf_pos = 0;
+	sock->rbuf_len = 0;
 
 	if (ctx->ssl_ctx) {
 		if (as_tls_wrap(ctx, sock, tls_name) < 0) {
@@ -228,6 +231,11 @@ as_socket_close(as_socket* sock)
 	}
 	as_close(sock->fd);
 	sock->fd = -1;
+
+	if (sock->rbuf) {
+		cf_free(sock->rbuf);
+		sock->rbuf = NULL;
+	}
 }
 
 as_status
@@ -304,18 +312,24 @@ as_socket_validate(as_socket* sock)
 		}
 	}
 
+	if (sock->rbuf_len > sock->rbuf_pos) {
+		// Buffered data from a previous command is unexpected, so treat it the same
+		// as unread data on the socket.
+		return (int)(sock->rbuf_len - sock->rbuf_pos);
+	}
+
 	return as_socket_validate_fd(sock->fd);
 }
 
 as_status
-as_socket_write_deadline(
+as_socket_write_deadline_us(
 	as_error* err, as_socket* sock, struct as_node_s* node, uint8_t *buf, size_t buf_len,
-	uint32_t socket_timeout, uint64_t deadline
+	uint32_t socket_timeout_us, uint64_t deadline_us
 	)
 {
 	if (sock->ctx) {
 		as_status status = AEROSPIKE_OK;
-		int rv = as_tls_write(sock, buf, buf_len, socket_timeout, deadline);
+		int rv = as_tls_write(sock, buf, buf_len, socket_timeout_us, deadline_us);
 
 		if (rv < 0) {
 			status = as_socket_error(sock->fd, node, err, AEROSPIKE_ERR_CONNECTION, "TLS write error", rv);
@@ -335,14 +349,17 @@ as_socket_write_deadline(
 
 	size_t pos = 0;
 	as_status status = AEROSPIKE_OK;
-	uint32_t timeout;
-	int try = 0;
+	uint64_t timeout;
+
+	// Socket send buffer usually has room for the command, so only wait on poll
+	// after send would block.
+	bool wait = false;
 
 	do {
-		if (deadline > 0) {
-			uint64_t now = cf_getms();
+		if (deadline_us > 0) {
+			uint64_t now = cf_getus();
 
-			if (now > deadline) {
+			if (now > deadline_us) {
 				// Timeout.  Do not set error string to avoid affecting performance.
 				// Calling functions usually retry, so the error string is not used anyway.
 				status = err->code = AEROSPIKE_ERR_TIMEOUT;
@@ -350,103 +367,90 @@ as_socket_write_deadline(
 				break;
 			}
 
-			timeout = (uint32_t)(deadline - now);
+			timeout = deadline_us - now;
 
-			if (socket_timeout > 0 && socket_timeout < timeout) {
-				timeout = socket_timeout;
+			if (socket_timeout_us > 0 && socket_timeout_us < timeout) {
+				timeout = socket_timeout_us;
 			}
 		}
 		else {
-			timeout = socket_timeout;
+			timeout = socket_timeout_us;
 		}
 
-		int rv = as_poll_socket(&poll, sock->fd, timeout, false);
+		if (wait) {
+			int rv = as_poll_socket(&poll, sock->fd, timeout, false);
 
-		// we only have one fd, so we know it's ours, but select seems confused sometimes - do the safest thing
-		if (rv > 0) {		
-#if defined(__linux__) 
-			int w_bytes = (int)send(sock->fd, buf + pos, buf_len - pos, MSG_NOSIGNAL);
-#elif defined(_MSC_VER)
-			int w_bytes = send(sock->fd, buf + pos, (int)(buf_len - pos), 0);
-#else
-			int w_bytes = (int)write(sock->fd, buf + pos, buf_len - pos);
-#endif
-		
-			if (w_bytes > 0) {
-				pos += w_bytes;
-			}
-			else if (w_bytes == 0) {
-				// We shouldn't see 0 returned unless we try to write 0 bytes, which we don't.
-				status = as_error_set_message(err, AEROSPIKE_ERR_CONNECTION, "Bad file descriptor");
+			// we only have one fd, so we know it's ours, but select seems confused sometimes - do the safest thing
+			if (rv == 0) {
+				// Timeout.  Do not set error string to avoid affecting performance.
+				// Calling functions usually retry, so the error string is not used anyway.
+				status = err->code = AEROSPIKE_ERR_TIMEOUT;
+				err->message[0] = 0;
 				break;
 			}
-			else {
+
+			if (rv < 0) {
 				int e = as_last_error();
-				if (as_socket_is_error(e)) {
+				if (rv == -1 && (e != AS_EINTR || as_socket_stop_on_interrupt)) {
 					status = as_socket_error(sock->fd, node, err, AEROSPIKE_ERR_CONNECTION, "Socket write error", e);
 					break;
 				}
+				continue;
 			}
 		}
-		else if (rv == 0) {
-			// Timeout.  Do not set error string to avoid affecting performance.
-			// Calling functions usually retry, so the error string is not used anyway.
-			status = err->code = AEROSPIKE_ERR_TIMEOUT;
-			err->message[0] = 0;
+
+#if defined(__linux__) 
+		int w_bytes = (int)send(sock->fd, buf + pos, buf_len - pos, MSG_NOSIGNAL);
+#elif defined(_MSC_VER)
+		int w_bytes = send(sock->fd, buf + pos, (int)(buf_len - pos), 0);
+#else
+		int w_bytes = (int)write(sock->fd, buf + pos, buf_len - pos);
+#endif
+	
+		if (w_bytes > 0) {
+			pos += w_bytes;
+			wait = false;
+		}
+		else if (w_bytes == 0) {
+			// We shouldn't see 0 returned unless we try to write 0 bytes, which we don't.
+			status = as_error_set_message(err, AEROSPIKE_ERR_CONNECTION, "Bad file descriptor");
 			break;
 		}
 		else {
 			int e = as_last_error();
-			if (rv == -1 && (e != AS_EINTR || as_socket_stop_on_interrupt)) {
+			if (as_socket_is_error(e)) {
 				status = as_socket_error(sock->fd, node, err, AEROSPIKE_ERR_CONNECTION, "Socket write error", e);
 				break;
 			}
+			wait = true;
 		}
-	
-		try++;
-	
 	} while (pos < buf_len);
 
 	as_poll_destroy(&poll);
 	return status;
 }
 
-as_status
-as_socket_read_deadline(
-	as_error* err, as_socket* sock, as_node* node, uint8_t *buf, size_t buf_len,
-	uint32_t socket_timeout, uint64_t deadline
+/**
+ * Read at least min_len and at most max_len bytes from socket.
+ */
+static as_status
+as_socket_read_fd(
+	as_error* err, as_socket* sock, as_node* node, uint8_t *buf, size_t min_len, size_t max_len,
+	uint32_t socket_timeout_us, uint64_t deadline_us, size_t* read_len
 	)
 {
-	if (sock->ctx) {
-		as_status status = AEROSPIKE_OK;
-		int rv = as_tls_read(sock, buf, buf_len, socket_timeout, deadline);
-
-		if (rv < 0) {
-			status = as_socket_error(sock->fd, node, err, AEROSPIKE_ERR_CONNECTION, "TLS read error", rv);
-		}
-		else if (rv == 1) {
-			// Do not set error string to avoid affecting performance.
-			// Calling functions usually retry, so the error string is
-			// not used anyway.
-			status = err->code = AEROSPIKE_ERR_TIMEOUT;
-			err->message[0] = 0;
-		}
-		return status;
-	}
-
 	as_poll poll;
 	as_poll_init(&poll, sock->fd);
 
 	size_t pos = 0;
 	as_status status = AEROSPIKE_OK;
-	uint32_t timeout;
-	int try = 0;
+	uint64_t timeout;
 
 	do {
-		if (deadline > 0) {
-			uint64_t now = cf_getms();
+		if (deadline_us > 0) {
+			uint64_t now = cf_getus();
 
-			if (now > deadline) {
+			if (now > deadline_us) {
 				// Timeout.  Do not set error string to avoid affecting performance.
 				// Calling functions usually retry, so the error string is not used anyway.
 				status = err->code = AEROSPIKE_ERR_TIMEOUT;
@@ -454,23 +458,23 @@ as_socket_read_deadline(
 				break;
 			}
 
-			timeout = (uint32_t)(deadline - now);
+			timeout = deadline_us - now;
 
-			if (socket_timeout > 0 && socket_timeout < timeout) {
-				timeout = socket_timeout;
+			if (socket_timeout_us > 0 && socket_timeout_us < timeout) {
+				timeout = socket_timeout_us;
 			}
 		}
 		else {
-			timeout = socket_timeout;
+			timeout = socket_timeout_us;
 		}
 
 		int rv = as_poll_socket(&poll, sock->fd, timeout, true);
 
 		if (rv > 0) {
 #if !defined(_MSC_VER)
-			int r_bytes = (int)read(sock->fd, buf + pos, buf_len - pos);
+			int r_bytes = (int)read(sock->fd, buf + pos, max_len - pos);
 #else
-			int r_bytes = (int)recv(sock->fd, buf + pos, (int)(buf_len - pos), 0);
+			int r_bytes = (int)recv(sock->fd, buf + pos, (int)(max_len - pos), 0);
 #endif
 
 			if (r_bytes > 0) {
@@ -503,11 +507,77 @@ as_socket_read_deadline(
 				break;
 			}
 		}
-	
-		try++;
-	
-	} while (pos < buf_len);
+	} while (pos < min_len);
 
 	as_poll_destroy(&poll);
+	*read_len = pos;
 	return status;
 }
+
+as_status
+as_socket_read_deadline_us(
+	as_error* err, as_socket* sock, as_node* node, uint8_t *buf, size_t buf_len,
+	uint32_t socket_timeout_us, uint64_t deadline_us
+	)
+{
+	if (sock->ctx) {
+		as_status status = AEROSPIKE_OK;
+		int rv = as_tls_read(sock, buf, buf_len, socket_timeout_us, deadline_us);
+
+		if (rv < 0) {
+			status = as_socket_error(sock->fd, node, err, AEROSPIKE_ERR_CONNECTION, "TLS read error", rv);
+		}
+		else if (rv == 1) {
+			// Do not set error string to avoid affecting performance.
+			// Calling functions usually retry, so the error string is
+			// not used anyway.
+			status = err->code = AEROSPIKE_ERR_TIMEOUT;
+			err->message[0] = 0;
+		}
+		return status;
+	}
+
+	// Serve bytes left over from previous read first.
+	size_t pos = 0;
+	uint32_t avail = sock->rbuf_len - sock->rbuf_pos;
+
+	if (avail > 0) {
+		pos = (avail < buf_len)? avail : buf_len;
+		memcpy(buf, sock->rbuf + sock->rbuf_pos, pos);
+		sock->rbuf_pos += (uint32_t)pos;
+
+		if (pos == buf_len) {
+			return AEROSPIKE_OK;
+		}
+	}
+
+	size_t remaining = buf_len - pos;
+	size_t len;
+
+	if (remaining >= AS_SOCKET_READ_BUFFER_SIZE) {
+		// Large reads go directly to caller's buffer.
+		return as_socket_read_fd(err, sock, node, buf + pos, remaining, remaining,
+			socket_timeout_us, deadline_us, &len);
+	}
+
+	// Read as much as is available, so the following header or body reads of the
+	// same response do not need their own system calls.
+	if (! sock->rbuf) {
+		sock->rbuf = cf_malloc(AS_SOCKET_READ_BUFFER_SIZE);
+	}
+
+	as_status status = as_socket_read_fd(err, sock, node, sock->rbuf, remaining,
+		AS_SOCKET_READ_BUFFER_SIZE, socket_timeout_us, deadline_us, &len);
+
+	if (status) {
+		// Socket will be closed, so discard partial data.
+		sock->rbuf_pos = 0;
+		sock->rbuf_len = 0;
+		return status;
+	}
+
+	memcpy(buf + pos, sock->rbuf, remaining);
+	sock->rbuf_pos = (uint32_t)remaining;
+	sock->rbuf_len = (uint32_t)len;
+	return AEROSPIKE_OK;
+}
@@ -36,11 +36,13 @@ static bool cert_blacklist_check(void* cert_blacklist,
 static void cert_blacklist_destroy(void* cert_blacklist);
 
 static void manage_sigpipe();
+static int as_tls_new_session(SSL* ssl, SSL_SESSION* sess);
 
 static bool s_tls_inited = false;
 static pthread_mutex_t s_tls_init_mutex = PTHREAD_MUTEX_INITIALIZER;
 static int s_ex_name_index = -1;
 static int s_ex_ctxt_index = -1;
+static int s_ex_session_index = -1;
 
 typedef enum as_tls_protocol_e {
 	// SSLv2 is always disabled per RFC 6176, we maintain knowledge of
@@ -137,31 +139,31 @@ protocols_parse(as_config_tls* tlscfg, uint16_t* oprotocols, as_error* errp)
 }
 
 static int
-wait_socket(as_socket_fd fd, uint32_t socket_timeout, uint64_t deadline, bool read)
+wait_socket(as_socket_fd fd, uint32_t socket_timeout_us, uint64_t deadline_us, bool read)
 {
 	as_poll poll;
 	as_poll_init(&poll, fd);
 
-	uint32_t timeout;
+	uint64_t timeout;
 	int rv;
 
 	while (true) {
-		if (deadline > 0) {
-			uint64_t now = cf_getms();
+		if (deadline_us > 0) {
+			uint64_t now = cf_getus();
 
-			if (now > deadline) {
+			if (now > deadline_us) {
 				rv = 1;  // timeout
 				break;
 			}
 
-			timeout = (uint32_t)(deadline - now);
+			timeout = deadline_us - now;
 
-			if (socket_timeout > 0 && socket_timeout < timeout) {
-				timeout = socket_timeout;
+			if (socket_timeout_us > 0 && socket_timeout_us < timeout) {
+				timeout = socket_timeout_us;
 			}
 		}
 		else {
-			timeout = socket_timeout;
+			timeout = socket_timeout_us;
 		}
 
 		rv = as_poll_socket(&poll, fd, timeout, read);
@@ -256,6 +258,7 @@ as_tls_check_init()
 
 		s_ex_name_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
 		s_ex_ctxt_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+		s_ex_session_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
 		
 		as_fence_memory();
 		
@@ -403,6 +406,8 @@ as_tls_context_setup(as_config_tls* tlscfg,
 	octx->ssl_ctx = NULL;
 	octx->cert_blacklist = NULL;
 	octx->log_session_info = false;
+	octx->session_hits = 0;
+	octx->session_misses = 0;
 
 	if (! tlscfg->enable) {
 		return AEROSPIKE_OK;
@@ -610,6 +615,11 @@ as_tls_context_setup(as_config_tls* tlscfg,
 
 	SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, verify_callback);
 
+	// Sessions are cached per node by as_tls_new_session(), so the
+	// context's internal client cache is not needed.
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ctx, as_tls_new_session);
+
 	manage_sigpipe();
 
 	octx->ssl_ctx = ctx;
@@ -720,6 +730,80 @@ as_tls_set_name(as_socket* sock, const char* tls_name)
 	SSL_set_ex_data(sock->ssl, s_ex_name_index, (void*)tls_name);
 }
 
+void
+as_tls_session_init(as_tls_session* session)
+{
+	pthread_mutex_init(&session->lock, NULL);
+	session->session = NULL;
+}
+
+void
+as_tls_session_destroy(as_tls_session* session)
+{
+	if (session->session) {
+		SSL_SESSION_free(session->session);
+		session->session = NULL;
+	}
+	pthread_mutex_destroy(&session->lock);
+}
+
+void
+as_tls_set_session(as_socket* sock, as_tls_session* session)
+{
+	SSL_set_ex_data(sock->ssl, s_ex_session_index, session);
+
+	pthread_mutex_lock(&session->lock);
+
+	if (session->session) {
+		// SSL_set_session() takes its own reference.
+		SSL_set_session(sock->ssl, session->session);
+	}
+	pthread_mutex_unlock(&session->lock);
+}
+
+static int
+as_tls_new_session(SSL* ssl, SSL_SESSION* sess)
+{
+	// Called when the server issues a session.  TLS 1.3 servers send session tickets
+	// after the handshake, so sessions can not be captured when connect completes.
+	as_tls_session* session = SSL_get_ex_data(ssl, s_ex_session_index);
+
+	if (! session) {
+		// Connection is not associated with a node (seed and info connections).
+		return 0;
+	}
+
+	pthread_mutex_lock(&session->lock);
+	SSL_SESSION* prev = session->session;
+	session->session = sess;
+	pthread_mutex_unlock(&session->lock);
+
+	if (prev) {
+		SSL_SESSION_free(prev);
+	}
+
+	// Keep reference to session.
+	return 1;
+}
+
+static void
+as_tls_session_update(as_socket* sock)
+{
+	as_tls_session* session = SSL_get_ex_data(sock->ssl, s_ex_session_index);
+
+	if (! session) {
+		// Connection is not associated with a node (seed and info connections).
+		return;
+	}
+
+	if (SSL_session_reused(sock->ssl)) {
+		as_incr_uint64(&sock->ctx->session_hits);
+	}
+	else {
+		as_incr_uint64(&sock->ctx->session_misses);
+	}
+}
+
 static void
 log_session_info(as_socket* sock)
 {
@@ -756,6 +840,7 @@ as_tls_connect_once(as_socket* sock)
 	int rv = SSL_connect(sock->ssl);
 	if (rv == 1) {
 		log_session_info(sock);
+		as_tls_session_update(sock);
 		return 1;
 	}
 
@@ -798,13 +883,15 @@ as_tls_connect_once(as_socket* sock)
 int
 as_tls_connect(as_socket* sock, uint64_t deadline)
 {
+	// Millisecond and microsecond clocks share the same monotonic time base.
+	uint64_t deadline_us = deadline * 1000;
 	int rv;
 
 #if defined(_MSC_VER)
 	// Windows SSL_connect() will fail with SSL_ERROR_SYSCALL if non-blocking
 	// socket has not completed TCP connect.  Wait on socket before calling
 	// SSL_connect() when on Windows.
-	rv = wait_socket(sock->fd, 0, deadline, false);
+	rv = wait_socket(sock->fd, 0, deadline_us, false);
 	if (rv != 0) {
 		as_log_warn("wait_writable failed: %d", rv);
 		return rv;
@@ -815,6 +902,7 @@ as_tls_connect(as_socket* sock, uint64_t deadline)
 		rv = SSL_connect(sock->ssl);
 		if (rv == 1) {
 			log_session_info(sock);
+			as_tls_session_update(sock);
 			return 0;
 		}
 
@@ -823,7 +911,7 @@ as_tls_connect(as_socket* sock, uint64_t deadline)
 		char errbuf[1024];
 		switch (sslerr) {
 		case SSL_ERROR_WANT_READ:
-			rv = wait_socket(sock->fd, 0, deadline, true);
+			rv = wait_socket(sock->fd, 0, deadline_us, true);
 			if (rv != 0) {
 				as_log_warn("wait_readable failed: %d", rv);
 				return rv;
@@ -831,7 +919,7 @@ as_tls_connect(as_socket* sock, uint64_t deadline)
 			// loop back around and retry
 			break;
 		case SSL_ERROR_WANT_WRITE:
-			rv = wait_socket(sock->fd, 0, deadline, false);
+			rv = wait_socket(sock->fd, 0, deadline_us, false);
 			if (rv != 0) {
 				as_log_warn("wait_writable failed: %d", rv);
 				return rv;
@@ -981,7 +1069,7 @@ as_tls_read_once(as_socket* sock, void* buf, size_t len)
 }
 
 int
-as_tls_read(as_socket* sock, void* bufp, size_t len, uint32_t socket_timeout, uint64_t deadline)
+as_tls_read(as_socket* sock, void* bufp, size_t len, uint32_t socket_timeout_us, uint64_t deadline_us)
 {
 	uint8_t* buf = (uint8_t *) bufp;
 	size_t pos = 0;
@@ -1008,14 +1096,14 @@ as_tls_read(as_socket* sock, void* bufp, size_t len, uint32_t socket_timeout, ui
 			char errbuf[1024];
 			switch (sslerr) {
 			case SSL_ERROR_WANT_READ:
-				rv = wait_socket(sock->fd, socket_timeout, deadline, true);
+				rv = wait_socket(sock->fd, socket_timeout_us, deadline_us, true);
 				if (rv != 0) {
 					return rv;
 				}
 				// loop back around and retry
 				break;
 			case SSL_ERROR_WANT_WRITE:
-				rv = wait_socket(sock->fd, socket_timeout, deadline, false);
+				rv = wait_socket(sock->fd, socket_timeout_us, deadline_us, false);
 				if (rv != 0) {
 					return rv;
 				}
@@ -1096,7 +1184,7 @@ as_tls_write_once(as_socket* sock, void* buf, size_t len)
 }
 
 int
-as_tls_write(as_socket* sock, void* bufp, size_t len, uint32_t socket_timeout, uint64_t deadline)
+as_tls_write(as_socket* sock, void* bufp, size_t len, uint32_t socket_timeout_us, uint64_t deadline_us)
 {
 	uint8_t* buf = (uint8_t *) bufp;
 	size_t pos = 0;
@@ -1115,14 +1203,14 @@ as_tls_write(as_socket* sock, void* bufp, size_t len, uint32_t socket_timeout, u
 			char errbuf[1024];
 			switch (sslerr) {
 			case SSL_ERROR_WANT_READ:
-				rv = wait_socket(sock->fd, socket_timeout, deadline, true);
+				rv = wait_socket(sock->fd, socket_timeout_us, deadline_us, true);
 				if (rv != 0) {
 					return rv;
 				}
 				// loop back around and retry
 				break;
 			case SSL_ERROR_WANT_WRITE:
-				rv = wait_socket(sock->fd, socket_timeout, deadline, false);
+				rv = wait_socket(sock->fd, socket_timeout_us, deadline_us, false);
 				if (rv != 0) {
 					return rv;
 				}
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_node.h>
+
+#include <string.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void
+adaptive_init(as_cluster* cluster, as_node* node)
+{
+	// Detached cluster and node, so live commands and cluster tend never see the
+	// settings or latency buckets.
+	memset(cluster, 0, sizeof(as_cluster));
+	cluster->timeout_percentile = 99;
+	cluster->timeout_multiplier = 3;
+	cluster->min_timeout_us = 100;
+
+	memset(node, 0, sizeof(as_node));
+	node->cluster = cluster;
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( cluster_adaptive_timeout, "adaptive socket timeout follows latency percentile" ) {
+	as_cluster cluster;
+	as_node node;
+	adaptive_init(&cluster, &node);
+
+	// 99th percentile of 99 fast commands and one 5ms command.  100us falls in the
+	// bucket bounded by 128us.  Minimum is below the estimate, so it does not apply.
+	for (uint32_t i = 0; i < 99; i++) {
+		as_node_add_latency_bucket(&node, 100);
+	}
+	as_node_add_latency_bucket(&node, 5000);
+	as_node_tend_latency(&node);
+	uint32_t adaptive = node.adaptive_timeout_us;
+	assert_int_eq( adaptive, 384 );
+
+	// Adaptive timeout only replaces larger policy socket timeouts.  Smaller socket
+	// timeouts are kept and no socket timeout stays disabled.
+	assert_int_eq( as_node_socket_timeout(&node, 0), 0 );
+	assert_int_eq( as_node_socket_timeout(&node, 200), 200 );
+	assert_int_eq( as_node_socket_timeout(&node, 384), 384 );
+	assert_int_eq( as_node_socket_timeout(&node, 1000000), adaptive );
+
+	// Minimum applies.
+	cluster.min_timeout_us = 10000;
+	as_node_add_latency_bucket(&node, 100);
+	as_node_tend_latency(&node);
+	assert_int_eq( node.adaptive_timeout_us, 10000 );
+
+	node.adaptive_timeout_us = 0;
+	assert_int_eq( as_node_socket_timeout(&node, 1000000), 1000000 );
+}
+
+TEST( cluster_adaptive_retry_budget, "retry budget earns tokens from responses" ) {
+	as_cluster cluster;
+	as_node node;
+	adaptive_init(&cluster, &node);
+
+	// Budget of 2 retries earning 1 retry per 2 responses.
+	cluster.retry_budget_pct = 50;
+	cluster.retry_tokens_max = 200;
+	cluster.retry_tokens = 200;
+
+	assert_true( as_cluster_retry_withdraw(&cluster) );
+	assert_true( as_cluster_retry_withdraw(&cluster) );
+	assert_false( as_cluster_retry_withdraw(&cluster) );
+
+	as_cluster_retry_deposit(&cluster);
+	assert_false( as_cluster_retry_withdraw(&cluster) );
+	as_cluster_retry_deposit(&cluster);
+	assert_true( as_cluster_retry_withdraw(&cluster) );
+
+	// Deposits stop at the maximum, even when one deposit would pass it.
+	cluster.retry_budget_pct = 30;
+
+	for (uint32_t i = 0; i < 10; i++) {
+		as_cluster_retry_deposit(&cluster);
+	}
+	assert_int_eq( cluster.retry_tokens, 200 );
+
+	// Disabled budget never limits retries.
+	cluster.retry_budget_pct = 0;
+	cluster.retry_tokens = 0;
+	assert_true( as_cluster_retry_withdraw(&cluster) );
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( cluster_adaptive, "adaptive socket timeout and retry budget tests" ) {
+	suite_add( cluster_adaptive_timeout );
+	suite_add( cluster_adaptive_retry_budget );
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_node.h>
+#include <aerospike/as_string.h>
+#include <citrusleaf/cf_clock.h>
+
+#include <string.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void
+breaker_init(as_cluster* cluster, as_node* node)
+{
+	// Detached cluster and node, so breaker state is never shared with live commands.
+	memset(cluster, 0, sizeof(as_cluster));
+	cluster->breaker_error_pct = 50;
+	cluster->breaker_min_commands = 4;
+	cluster->breaker_open_ms = 200;
+
+	memset(node, 0, sizeof(as_node));
+	node->cluster = cluster;
+	as_strncpy(node->name, "BB9000000000000", sizeof(node->name));
+	node->breaker_state = AS_BREAKER_CLOSED;
+}
+
+static void
+breaker_open(as_node* node)
+{
+	as_node_breaker_result(node, AEROSPIKE_OK, 0);
+	as_node_breaker_result(node, AEROSPIKE_ERR_TIMEOUT, 0);
+	as_node_breaker_result(node, AEROSPIKE_ERR_CONNECTION, 0);
+	as_node_breaker_result(node, AEROSPIKE_ERR_TIMEOUT, 0);
+	as_node_tend_breaker(node);
+}
+
+static void
+breaker_expire(as_node* node)
+{
+	// End open period without waiting for it.
+	node->breaker_retry_ms = cf_getms();
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( cluster_breaker_open, "breaker opens when error rate exceeds threshold" ) {
+	as_cluster cluster;
+	as_node node;
+	breaker_init(&cluster, &node);
+
+	// Too few commands.
+	as_node_breaker_result(&node, AEROSPIKE_ERR_TIMEOUT, 0);
+	as_node_breaker_result(&node, AEROSPIKE_ERR_TIMEOUT, 0);
+	as_node_breaker_result(&node, AEROSPIKE_ERR_TIMEOUT, 0);
+	as_node_tend_breaker(&node);
+	assert_int_eq( node.breaker_state, AS_BREAKER_CLOSED );
+
+	// Tend starts a new window.
+	assert_int_eq( node.breaker_commands, 0 );
+	assert_int_eq( node.breaker_errors, 0 );
+
+	// Error rate below threshold.  Server errors show the node is reachable and client
+	// errors are ignored.
+	as_node_breaker_result(&node, AEROSPIKE_OK, 0);
+	as_node_breaker_result(&node, AEROSPIKE_OK, 0);
+	as_node_breaker_result(&node, AEROSPIKE_ERR_RECORD_NOT_FOUND, 0);
+	as_node_breaker_result(&node, AEROSPIKE_ERR_CLIENT, 0);
+	as_node_breaker_result(&node, AEROSPIKE_ERR_TIMEOUT, 0);
+	assert_int_eq( node.breaker_commands, 4 );
+	assert_int_eq( node.breaker_errors, 1 );
+	as_node_tend_breaker(&node);
+	assert_int_eq( node.breaker_state, AS_BREAKER_CLOSED );
+
+	// Error rate above threshold.
+	breaker_open(&node);
+	assert_int_eq( node.breaker_state, AS_BREAKER_OPEN );
+	assert_int_eq( node.breaker_trips, 1 );
+
+	uint32_t probe = 1;
+	assert_false( as_node_breaker_allow(&node) );
+	assert_false( as_node_breaker_begin(&node, &probe) );
+	assert_int_eq( probe, 0 );
+
+	// Disabled breaker ignores results.
+	breaker_init(&cluster, &node);
+	cluster.breaker_error_pct = 0;
+	breaker_open(&node);
+	assert_int_eq( node.breaker_commands, 0 );
+	assert_int_eq( node.breaker_state, AS_BREAKER_CLOSED );
+}
+
+TEST( cluster_breaker_probe, "only the probe closes a half open breaker" ) {
+	as_cluster cluster;
+	as_node node;
+	breaker_init(&cluster, &node);
+	breaker_open(&node);
+	breaker_expire(&node);
+
+	// Node can be selected by any command, but only one command claims the probe.
+	assert_true( as_node_breaker_allow(&node) );
+
+	uint32_t probe;
+	assert_true( as_node_breaker_begin(&node, &probe) );
+	assert_int_ne( probe, 0 );
+	assert_int_eq( node.breaker_state, AS_BREAKER_HALF_OPEN );
+
+	uint32_t other;
+	assert_false( as_node_breaker_allow(&node) );
+	assert_false( as_node_breaker_begin(&node, &other) );
+	assert_int_eq( other, 0 );
+
+	// Commands started before the breaker opened do not close or reopen it.
+	as_node_breaker_result(&node, AEROSPIKE_OK, 0);
+	assert_int_eq( node.breaker_state, AS_BREAKER_HALF_OPEN );
+	as_node_breaker_result(&node, AEROSPIKE_ERR_TIMEOUT, 0);
+	assert_int_eq( node.breaker_state, AS_BREAKER_HALF_OPEN );
+
+	// Successful probe closes breaker.
+	as_node_breaker_result(&node, AEROSPIKE_OK, probe);
+	assert_int_eq( node.breaker_state, AS_BREAKER_CLOSED );
+	assert_true( as_node_breaker_allow(&node) );
+	assert_true( as_node_breaker_begin(&node, &other) );
+	assert_int_eq( other, 0 );
+}
+
+TEST( cluster_breaker_reopen, "failed probe reopens breaker" ) {
+	as_cluster cluster;
+	as_node node;
+	breaker_init(&cluster, &node);
+	breaker_open(&node);
+	breaker_expire(&node);
+
+	uint32_t probe;
+	assert_true( as_node_breaker_begin(&node, &probe) );
+
+	// Failed probe starts a new open period.
+	as_node_breaker_result(&node, AEROSPIKE_ERR_CONNECTION, probe);
+	assert_int_eq( node.breaker_state, AS_BREAKER_OPEN );
+	assert_true( node.breaker_retry_ms > cf_getms() );
+	assert_false( as_node_breaker_allow(&node) );
+
+	// Probe that does not complete within the open period is replaced.
+	breaker_expire(&node);
+	uint32_t stale;
+	assert_true( as_node_breaker_begin(&node, &stale) );
+	breaker_expire(&node);
+	assert_true( as_node_breaker_begin(&node, &probe) );
+	assert_int_ne( probe, stale );
+
+	// Replaced probe no longer owns the breaker.
+	as_node_breaker_result(&node, AEROSPIKE_OK, stale);
+	assert_int_eq( node.breaker_state, AS_BREAKER_HALF_OPEN );
+	as_node_breaker_result(&node, AEROSPIKE_OK, probe);
+	assert_int_eq( node.breaker_state, AS_BREAKER_CLOSED );
+
+	// Trip count only covers breaker opened by tend.
+	assert_int_eq( node.breaker_trips, 1 );
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( cluster_breaker, "node circuit breaker tests" ) {
+	suite_add( cluster_breaker_open );
+	suite_add( cluster_breaker_probe );
+	suite_add( cluster_breaker_reopen );
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_node.h>
+#include <aerospike/as_string.h>
+
+#include <string.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static int
+rack_parse(const char* response)
+{
+	static as_node node;
+	as_strncpy(node.name, "BB9000000000000", sizeof(node.name));
+
+	// Response is parsed in place.
+	char buf[256];
+	as_strncpy(buf, response, sizeof(buf));
+	return as_node_parse_racks(&node, buf);
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( cluster_rack_parse, "parse rack-ids info response" ) {
+	assert_int_eq( rack_parse("test:1"), 1 );
+	assert_int_eq( rack_parse("test:0"), 0 );
+	assert_int_eq( rack_parse("test:12;"), 12 );
+
+	// All namespaces on the same rack.
+	assert_int_eq( rack_parse("test:3;bar:3"), 3 );
+	assert_int_eq( rack_parse("test:3;bar:3;baz:3;"), 3 );
+
+	// Namespaces on different racks.
+	assert_int_eq( rack_parse("test:3;bar:4"), AS_RACK_UNKNOWN );
+	assert_int_eq( rack_parse("test:3;bar:3;baz:4"), AS_RACK_UNKNOWN );
+
+	// No namespaces.
+	assert_int_eq( rack_parse(""), AS_RACK_UNKNOWN );
+
+	// Malformed responses.
+	assert_int_eq( rack_parse("test"), AS_RACK_UNKNOWN );
+	assert_int_eq( rack_parse("test:3;bar"), AS_RACK_UNKNOWN );
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( cluster_rack, "cluster rack tests" ) {
+	suite_add( cluster_rack_parse );
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_event.h>
+#include <aerospike/as_event_internal.h>
+#include <aerospike/as_node.h>
+#include <aerospike/as_pipe.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void
+trim_pool_init(as_conn_pool* pool, uint32_t in_use, uint32_t idle)
+{
+	as_conn_pool_init(pool, sizeof(void*), 100);
+
+	// Connections are never dereferenced by as_conn_pool_trim_count().
+	for (uint32_t i = 0; i < in_use + idle; i++) {
+		as_conn_pool_inc(pool);
+	}
+
+	for (uint32_t i = 0; i < idle; i++) {
+		void* conn = pool;
+		as_conn_pool_put(pool, &conn);
+	}
+	pool->peak = in_use;
+}
+
+static void
+trim_pool_close(as_conn_pool* pool, uint32_t count)
+{
+	void* conn;
+
+	for (uint32_t i = 0; i < count; i++) {
+		as_queue_pop(&pool->queue, &conn);
+		as_conn_pool_dec(pool);
+	}
+}
+
+static void
+trim_pool_destroy(as_conn_pool* pool)
+{
+	void* conn;
+
+	while (as_queue_pop(&pool->queue, &conn)) {
+	}
+	as_conn_pool_destroy(pool);
+}
+
+#if defined(AS_USE_LIBEV) || defined(AS_USE_LIBEVENT)
+
+static as_pipe_connection*
+trim_pipe_create(as_conn_pool* pool)
+{
+	as_pipe_connection* conn = cf_malloc(sizeof(as_pipe_connection));
+	as_socket_init(&conn->base.socket);
+	conn->base.watching = 0;
+	conn->base.pipeline = true;
+	conn->writer = NULL;
+	cf_ll_init(&conn->readers, NULL, false);
+	conn->canceling = false;
+	conn->canceled = false;
+	conn->in_pool = true;
+
+	as_conn_pool_inc(pool);
+	as_conn_pool_put(pool, &conn);
+	return conn;
+}
+
+#endif
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( cluster_trim_count, "trim count shrinks pool by half of excess over peak usage" ) {
+	as_conn_pool pool;
+
+	// All idle and no peak.  Half of the connections are trimmed.
+	trim_pool_init(&pool, 0, 10);
+	assert_int_eq( as_conn_pool_trim_count(&pool, 0), 5 );
+	trim_pool_destroy(&pool);
+
+	// Minimum is kept.
+	trim_pool_init(&pool, 0, 10);
+	assert_int_eq( as_conn_pool_trim_count(&pool, 4), 3 );
+	trim_pool_destroy(&pool);
+
+	// Peak usage is kept.  Peak was recorded when connections were taken from the pool.
+	trim_pool_init(&pool, 0, 10);
+	void* conn;
+
+	for (uint32_t i = 0; i < 8; i++) {
+		as_conn_pool_get(&pool, &conn);
+	}
+
+	for (uint32_t i = 0; i < 8; i++) {
+		as_conn_pool_put(&pool, &conn);
+	}
+	assert_int_eq( pool.peak, 8 );
+	assert_int_eq( as_conn_pool_trim_count(&pool, 0), 1 );
+
+	// Trim starts a new period, so peak no longer covers connections that were returned.
+	assert_int_eq( pool.peak, 0 );
+	trim_pool_destroy(&pool);
+
+	// Excess is limited to idle connections, because connections in use can't be closed.
+	trim_pool_init(&pool, 8, 2);
+	pool.peak = 0;
+	assert_int_eq( as_conn_pool_trim_count(&pool, 0), 1 );
+
+	// Next period starts with the connections still in use.
+	assert_int_eq( pool.peak, 8 );
+	assert_int_eq( as_conn_pool_trim_count(&pool, 0), 1 );
+	trim_pool_destroy(&pool);
+
+	// Nothing to trim when pool is within target.
+	trim_pool_init(&pool, 0, 4);
+	assert_int_eq( as_conn_pool_trim_count(&pool, 4), 0 );
+	assert_int_eq( as_conn_pool_trim_count(&pool, 10), 0 );
+	trim_pool_destroy(&pool);
+
+	// Empty pool.
+	trim_pool_init(&pool, 0, 0);
+	assert_int_eq( as_conn_pool_trim_count(&pool, 0), 0 );
+	trim_pool_destroy(&pool);
+
+	// Pool shrinks gradually to the minimum on successive idle periods.
+	trim_pool_init(&pool, 0, 16);
+	uint32_t expected[] = {7, 4, 2, 1, 0};
+
+	for (uint32_t i = 0; i < sizeof(expected) / sizeof(uint32_t); i++) {
+		uint32_t trim = as_conn_pool_trim_count(&pool, 2);
+		assert_int_eq( trim, expected[i] );
+		trim_pool_close(&pool, trim);
+	}
+	assert_int_eq( pool.total, 2 );
+	trim_pool_destroy(&pool);
+}
+
+#if defined(AS_USE_LIBEV) || defined(AS_USE_LIBEVENT)
+
+TEST( cluster_trim_pipe, "pipeline trim closes only idle connections" ) {
+	as_conn_pool pool;
+	as_conn_pool_init(&pool, sizeof(as_pipe_connection*), 100);
+
+	as_event_command writer;
+	as_event_command reader;
+
+	trim_pipe_create(&pool);
+	as_pipe_connection* writing = trim_pipe_create(&pool);
+	writing->writer = &writer;
+	as_pipe_connection* reading = trim_pipe_create(&pool);
+	cf_ll_append(&reading->readers, &reader.pipe_link);
+	trim_pipe_create(&pool);
+	as_pipe_connection* canceled = trim_pipe_create(&pool);
+	canceled->canceled = true;
+	as_pipe_connection* canceling = trim_pipe_create(&pool);
+	canceling->canceling = true;
+
+	assert_int_eq( pool.total, 6 );
+
+	// Both idle connections are closed.  Canceled connection is closed too, but is not
+	// counted as trimmed.  Canceling connection leaves the pool and is closed by its
+	// cancel path.
+	assert_int_eq( as_pipe_trim_connections(&pool, 10), 2 );
+	assert_int_eq( pool.total, 3 );
+	assert_int_eq( as_queue_size(&pool.queue), 2 );
+	assert_false( canceling->in_pool );
+
+	// Busy connections stay in the pool in their original order.
+	as_pipe_connection* conn;
+	assert_true( as_queue_pop(&pool.queue, &conn) );
+	assert_true( conn == writing );
+	assert_true( as_queue_pop(&pool.queue, &conn) );
+	assert_true( conn == reading );
+
+	// Trim stops at count.
+	as_queue_push(&pool.queue, &writing);
+	trim_pipe_create(&pool);
+	trim_pipe_create(&pool);
+	assert_int_eq( as_pipe_trim_connections(&pool, 1), 1 );
+	assert_int_eq( as_queue_size(&pool.queue), 2 );
+
+	// Writer is done, so all pooled connections are idle.  Zero count trims nothing.
+	writing->writer = NULL;
+	assert_int_eq( as_pipe_trim_connections(&pool, 0), 0 );
+	assert_int_eq( as_pipe_trim_connections(&pool, 10), 2 );
+	assert_int_eq( as_queue_size(&pool.queue), 0 );
+
+	// Only reading and canceling connections remain outside the pool.
+	assert_int_eq( pool.total, 2 );
+	as_event_release_connection((as_event_connection*)reading, &pool);
+	as_event_release_connection((as_event_connection*)canceling, &pool);
+	assert_int_eq( pool.total, 0 );
+	as_conn_pool_destroy(&pool);
+}
+
+#endif
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( cluster_trim, "connection pool trim tests" ) {
+	suite_add( cluster_trim_count );
+#if defined(AS_USE_LIBEV) || defined(AS_USE_LIBEVENT)
+	suite_add( cluster_trim_pipe );
+#endif
+}
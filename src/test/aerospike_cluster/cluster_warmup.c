@@ -0,0 +1,136 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/aerospike.h>
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_event.h>
+#include <aerospike/as_node.h>
+#include <aerospike/as_sleep.h>
+#include <citrusleaf/cf_clock.h>
+
+#include "../test.h"
+#include "../aerospike_test.h"
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+// Sync minimum is larger than the connections tend opens per node, so several tends
+// are needed to reach it.
+#define SYNC_MIN 20
+#define ASYNC_MIN 6
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static uint32_t
+warmup_sync_idle(as_cluster* cluster, as_node* node)
+{
+	uint32_t idle = 0;
+
+	for (uint32_t i = 0; i < cluster->conn_pools_per_node; i++) {
+		as_conn_pool_lock* pool_lock = &node->conn_pool_locks[i];
+		pthread_mutex_lock(&pool_lock->lock);
+		idle += as_queue_size(&pool_lock->pool.queue);
+		pthread_mutex_unlock(&pool_lock->lock);
+	}
+	return idle;
+}
+
+static uint32_t
+warmup_async_idle(as_node* node)
+{
+	uint32_t idle = 0;
+
+	// Async pools are owned by their event loops.  Sizes are only read here to poll
+	// for progress, so stale values just delay the result.
+	for (uint32_t i = 0; i < as_event_loop_size; i++) {
+		idle += as_queue_size(&node->async_conn_pools[i].queue);
+	}
+	return idle;
+}
+
+static bool
+warmup_filled(as_cluster* cluster)
+{
+	as_nodes* nodes = as_nodes_reserve(cluster);
+	bool filled = nodes->size > 0;
+
+	for (uint32_t i = 0; i < nodes->size && filled; i++) {
+		as_node* node = nodes->array[i];
+
+		// Idle connections have completed connect, authentication and, for async, the
+		// warm-up info command.
+		if (warmup_sync_idle(cluster, node) < SYNC_MIN ||
+			warmup_async_idle(node) < ASYNC_MIN) {
+			filled = false;
+		}
+	}
+	as_nodes_release(nodes);
+	return filled;
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( cluster_warmup_fill, "tend fills sync and async pools to their minimums" ) {
+	if (g_tls.enable) {
+		// TLS settings are owned by the shared client instance.
+		info("skipped when TLS is enabled");
+		return;
+	}
+
+	as_config config;
+	as_config_init(&config);
+	assert_true( as_config_add_hosts(&config, g_host, g_port) );
+	as_config_set_user(&config, g_user, g_password);
+	config.min_conns_per_node = SYNC_MIN;
+	config.async_min_conns_per_node = ASYNC_MIN;
+	config.tender_interval = 250;
+
+	aerospike client;
+	aerospike_init(&client, &config);
+
+	as_error err;
+	as_status status = aerospike_connect(&client, &err);
+
+	if (status != AEROSPIKE_OK) {
+		aerospike_destroy(&client);
+	}
+	assert_int_eq( status, AEROSPIKE_OK );
+
+	uint64_t deadline = cf_getms() + 10000;
+	bool filled = false;
+
+	while (! (filled = warmup_filled(client.cluster)) && cf_getms() < deadline) {
+		as_sleep(50);
+	}
+
+	aerospike_close(&client, &err);
+	aerospike_destroy(&client);
+
+	assert_true( filled );
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( cluster_warmup, "cluster connection warm-up tests" ) {
+	suite_add( cluster_warmup_fill );
+}
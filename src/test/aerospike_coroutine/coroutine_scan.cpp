@@ -0,0 +1,173 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/aerospike.h>
+#include <aerospike/as_coroutine.h>
+#include <aerospike/as_event.h>
+#include <aerospike/as_monitor.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_scan.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define NAMESPACE "test"
+#define SET "test_coroutine"
+#define N_RECORDS 100
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * Coroutine that starts immediately and frees its frame when it returns.
+ */
+struct task {
+	struct promise_type {
+		task get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+static as_monitor monitor;
+static std::atomic<int> failures(0);
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void
+fail(const char* msg, const aerospike_coro::status& s)
+{
+	fprintf(stderr, "FAIL: %s: %d %s\n", msg, s.code, s.message.c_str());
+	failures++;
+}
+
+static task
+scan_records(aerospike* as)
+{
+	{
+		for (int64_t i = 0; i < N_RECORDS; i++) {
+			as_key key;
+			as_key_init_int64(&key, NAMESPACE, SET, i);
+
+			as_record rec;
+			as_record_init(&rec, 1);
+			as_record_set_int64(&rec, "a", i);
+
+			auto res = co_await aerospike_coro::put(as, &key, &rec);
+			as_record_destroy(&rec);
+			as_key_destroy(&key);
+
+			if (! res.ok()) {
+				fail("put", res);
+				as_monitor_notify(&monitor);
+				co_return;
+			}
+		}
+
+		as_scan scan;
+		as_scan_init(&scan, NAMESPACE, SET);
+
+		auto stream = aerospike_coro::scan(as, &scan);
+		int64_t count = 0;
+		int64_t sum = 0;
+
+		while (as_record* rec = co_await stream.next()) {
+			count++;
+			sum += as_record_get_int64(rec, "a", 0);
+		}
+		as_scan_destroy(&scan);
+
+		if (! stream.result().ok()) {
+			fail("scan", stream.result());
+		}
+		else if (count != N_RECORDS || sum != (int64_t)N_RECORDS * (N_RECORDS - 1) / 2) {
+			fprintf(stderr, "FAIL: scan returned %lld records with sum %lld\n",
+				(long long)count, (long long)sum);
+			failures++;
+		}
+	}
+	// Stream is destroyed before the main thread is released.
+	as_monitor_notify(&monitor);
+}
+
+/******************************************************************************
+ * MAIN
+ *****************************************************************************/
+
+int
+main(int argc, char* argv[])
+{
+	const char* host = argc > 1 ? argv[1] : "127.0.0.1";
+	int port = argc > 2 ? atoi(argv[2]) : 3000;
+
+	// Use several event loops, so stream records can arrive from different threads.
+	if (as_event_create_loops(2) == 0) {
+		fprintf(stderr, "FAIL: failed to create event loops\n");
+		return 1;
+	}
+
+	as_config config;
+	as_config_init(&config);
+
+	if (! as_config_add_hosts(&config, host, (uint16_t)port)) {
+		fprintf(stderr, "FAIL: invalid host %s\n", host);
+		as_event_close_loops();
+		return 1;
+	}
+
+	aerospike as;
+	aerospike_init(&as, &config);
+
+	as_error err;
+
+	if (aerospike_connect(&as, &err) != AEROSPIKE_OK) {
+		fprintf(stderr, "FAIL: connect: %d %s\n", err.code, err.message);
+		aerospike_destroy(&as);
+		as_event_close_loops();
+		return 1;
+	}
+
+	as_monitor_init(&monitor);
+	as_monitor_begin(&monitor);
+	scan_records(&as);
+	as_monitor_wait(&monitor);
+	as_monitor_destroy(&monitor);
+
+	aerospike_close(&as, &err);
+	aerospike_destroy(&as);
+	as_event_close_loops();
+
+	if (failures) {
+		return 1;
+	}
+	printf("coroutine scan: ok\n");
+	return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_event.h>
+#include <aerospike/as_event_internal.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define N_LOOPS 4
+#define N_QUEUED 40
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void
+event_loops_init(as_event_loop* loops, uint32_t size)
+{
+	memset(loops, 0, sizeof(as_event_loop) * size);
+
+	for (uint32_t i = 0; i < size; i++) {
+		loops[i].index = i;
+		pthread_mutex_init(&loops[i].lock, NULL);
+		as_queue_init(&loops[i].queue, sizeof(as_event_commander), 64);
+	}
+}
+
+static void
+event_loops_destroy(as_event_loop* loops, uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i++) {
+		as_queue_destroy(&loops[i].queue);
+		pthread_mutex_destroy(&loops[i].lock);
+	}
+}
+
+static void
+event_queue_command(as_event_loop* event_loop, as_event_command* cmd)
+{
+	as_event_commander qcmd;
+	qcmd.executable = (as_event_executable)as_event_command_execute_in_loop;
+	qcmd.udata = cmd;
+	as_queue_push(&event_loop->queue, &qcmd);
+}
+
+static void
+event_noop(void* udata)
+{
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( event_balance_select, "commands are spread over less loaded event loops" ) {
+	as_event_loop loops[N_LOOPS];
+	event_loops_init(loops, N_LOOPS);
+
+	int pending[N_LOOPS] = {0, 0, 0, 50};
+	as_cluster cluster;
+	memset(&cluster, 0, sizeof(as_cluster));
+	cluster.pending = pending;
+
+	uint32_t counts[N_LOOPS] = {0};
+
+	for (uint32_t i = 0; i < 10000; i++) {
+		uint64_t r = ((uint64_t)rand() << 32) | (uint32_t)rand();
+		as_event_loop* event_loop = as_event_loop_select(&cluster, loops, N_LOOPS, r);
+		counts[event_loop->index]++;
+	}
+
+	// Most loaded loop always loses its pairing.  Others are chosen about equally.
+	assert_int_eq( counts[3], 0 );
+
+	for (uint32_t i = 0; i < 3; i++) {
+		assert_true( counts[i] > 2500 );
+	}
+
+	// Queued commands count as load too.
+	pending[3] = 0;
+	as_event_commander qcmd = {event_noop, NULL};
+	as_queue_push(&loops[0].queue, &qcmd);
+
+	memset(counts, 0, sizeof(counts));
+
+	for (uint32_t i = 0; i < 10000; i++) {
+		uint64_t r = ((uint64_t)rand() << 32) | (uint32_t)rand();
+		as_event_loop* event_loop = as_event_loop_select(&cluster, loops, N_LOOPS, r);
+		counts[event_loop->index]++;
+	}
+	assert_int_eq( counts[0], 0 );
+	assert_true( counts[3] > 2500 );
+
+	event_loops_destroy(loops, N_LOOPS);
+}
+
+TEST( event_balance_steal, "idle loop steals newer half of queued commands" ) {
+	as_event_loop loops[2];
+	event_loops_init(loops, 2);
+
+	as_event_loop* victim = &loops[0];
+	as_event_loop* thief = &loops[1];
+
+	int pending[2] = {0, 0};
+	as_cluster cluster;
+	memset(&cluster, 0, sizeof(as_cluster));
+	cluster.pending = pending;
+
+	as_event_command* cmds = calloc(N_QUEUED, sizeof(as_event_command));
+
+	for (uint32_t i = 0; i < N_QUEUED; i++) {
+		cmds[i].cluster = &cluster;
+
+		// Every third command is bound to its loop.
+		if (i % 3 != 0) {
+			cmds[i].flags = AS_ASYNC_FLAGS_STEALABLE;
+		}
+		event_queue_command(victim, &cmds[i]);
+	}
+
+	// Other queued work is never stolen.
+	as_event_commander other = {event_noop, NULL};
+	as_queue_push(&victim->queue, &other);
+
+	as_event_commander stolen[AS_EVENT_STEAL_MAX];
+	uint32_t n = as_event_steal_queued(victim, thief, stolen);
+
+	// Older half (21 entries) is kept.  Stealable commands in newer half are taken.
+	uint32_t expected = 0;
+
+	for (uint32_t i = 21; i < N_QUEUED; i++) {
+		if (i % 3 != 0) {
+			expected++;
+		}
+	}
+	assert_int_eq( n, expected );
+
+	for (uint32_t i = 0; i < n; i++) {
+		as_event_command* cmd = stolen[i].udata;
+		assert_true( cmd->flags & AS_ASYNC_FLAGS_STEALABLE );
+		assert_true( cmd - cmds >= 21 );
+	}
+
+	// Remaining entries keep their original order.
+	assert_int_eq( as_queue_size(&victim->queue), N_QUEUED + 1 - n );
+
+	as_event_commander qcmd;
+	int64_t last = -1;
+
+	while (as_queue_pop(&victim->queue, &qcmd)) {
+		if (qcmd.executable == event_noop) {
+			assert_int_eq( last, N_QUEUED - 1 );
+			continue;
+		}
+		int64_t index = (as_event_command*)qcmd.udata - cmds;
+		assert_true( index > last );
+		last = index;
+	}
+
+	// Commands are not stolen once their cluster has been closed on the thief loop.
+	for (uint32_t i = 0; i < N_QUEUED; i++) {
+		cmds[i].flags = AS_ASYNC_FLAGS_STEALABLE;
+		event_queue_command(victim, &cmds[i]);
+	}
+	pending[1] = -1;
+	assert_int_eq( as_event_steal_queued(victim, thief, stolen), 0 );
+	assert_int_eq( as_queue_size(&victim->queue), N_QUEUED );
+
+	// Empty queue.
+	pending[1] = 0;
+	while (as_queue_pop(&victim->queue, &qcmd)) {
+	}
+	assert_int_eq( as_event_steal_queued(victim, thief, stolen), 0 );
+
+	free(cmds);
+	event_loops_destroy(loops, 2);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( event_balance, "event loop balance and steal tests" ) {
+	suite_add( event_balance_select );
+	suite_add( event_balance_steal );
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_event.h>
+#include <aerospike/as_event_internal.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "../test.h"
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( event_cpus_list, "event loop cpu list is copied and cycled" ) {
+	// Test loops are already created, so changing the list does not move them.
+	assert_int_eq( as_event_loop_cpu(0), -1 );
+
+#if defined(__linux__)
+	int cpus[] = {0, 0, 0};
+	assert_true( as_event_set_loop_cpus(cpus, 2) );
+
+	// List is copied.
+	cpus[1] = 1;
+	assert_int_eq( as_event_loop_cpu(1), 0 );
+
+	assert_true( as_event_set_loop_cpus(cpus, 2) );
+	assert_int_eq( as_event_loop_cpu(0), 0 );
+	assert_int_eq( as_event_loop_cpu(1), 1 );
+	assert_int_eq( as_event_loop_cpu(2), 0 );
+	assert_int_eq( as_event_loop_cpu(3), 1 );
+
+	// Invalid cpus are rejected and previous list is kept.
+	cpus[2] = -1;
+	assert_false( as_event_set_loop_cpus(cpus, 3) );
+	cpus[2] = CPU_SETSIZE;
+	assert_false( as_event_set_loop_cpus(cpus, 3) );
+	assert_int_eq( as_event_loop_cpu(3), 1 );
+
+	// Zero cpus disables pinning.
+	assert_true( as_event_set_loop_cpus(NULL, 0) );
+	assert_int_eq( as_event_loop_cpu(0), -1 );
+#else
+	int cpus[] = {0};
+	assert_false( as_event_set_loop_cpus(cpus, 1) );
+	assert_true( as_event_set_loop_cpus(NULL, 0) );
+	assert_int_eq( as_event_loop_cpu(0), -1 );
+#endif
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( event_cpus, "event loop cpu pinning tests" ) {
+	suite_add( event_cpus_list );
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_command.h>
+#include <aerospike/as_event.h>
+#include <aerospike/as_event_internal.h>
+#include <aerospike/as_pipe.h>
+
+#include <string.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define MAX_BLOCKS 8
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+typedef struct {
+	as_event_command cmd;
+	uint8_t buf[256];
+	uint8_t tags[MAX_BLOCKS];
+	uint32_t blocks;
+	bool cancel;
+} read_command;
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static bool
+read_parse(as_event_command* cmd)
+{
+	// Record each block.  Command is done after the block marked last, like batch and
+	// scan commands.
+	read_command* rc = (read_command*)cmd;
+	as_msg* msg = (as_msg*)cmd->buf;
+
+	if (rc->blocks < MAX_BLOCKS) {
+		rc->tags[rc->blocks] = cmd->buf[sizeof(as_msg)];
+	}
+	rc->blocks++;
+
+	if (! (msg->info3 & AS_MSG_INFO3_LAST)) {
+		return false;
+	}
+
+	if (cmd->conn->pipeline) {
+		as_pipe_connection* conn = (as_pipe_connection*)cmd->conn;
+
+		if (rc->cancel) {
+			// Emulate connection cancel while parsing, which clears the loop's read
+			// connection and releases the connection's remaining readers.
+			conn->canceling = true;
+			cmd->event_loop->read_conn = NULL;
+		}
+		else {
+			// Completed reader leaves the connection, like as_pipe_response_complete().
+			cf_ll_delete(&conn->readers, &cmd->pipe_link);
+		}
+	}
+	return true;
+}
+
+static void
+read_init(read_command* rc, as_event_loop* loop, as_event_connection* conn)
+{
+	memset(rc, 0, sizeof(read_command));
+	rc->cmd.event_loop = loop;
+	rc->cmd.conn = conn;
+	rc->cmd.buf = rc->buf;
+	rc->cmd.read_capacity = sizeof(rc->buf);
+	rc->cmd.len = sizeof(as_proto);
+	rc->cmd.pos = 0;
+	rc->cmd.state = AS_ASYNC_STATE_COMMAND_READ_HEADER;
+	rc->cmd.parse_results = read_parse;
+}
+
+static uint8_t*
+read_response(uint8_t* p, uint32_t extra, uint8_t tag, bool last)
+{
+	// Proto header, message header and extra bytes starting with tag.
+	uint8_t* begin = p;
+	p += sizeof(as_proto);
+
+	as_msg* msg = (as_msg*)p;
+	memset(msg, 0, sizeof(as_msg));
+	msg->info3 = last ? AS_MSG_INFO3_LAST : 0;
+	p += sizeof(as_msg);
+
+	memset(p, 0, extra);
+	p[0] = tag;
+	p += extra;
+
+	as_command_write_end(begin, p);
+	return p;
+}
+
+static void
+read_pipe_init(as_pipe_connection* conn, read_command* readers, uint32_t n, as_event_loop* loop)
+{
+	memset(conn, 0, sizeof(as_pipe_connection));
+	conn->base.pipeline = true;
+	cf_ll_init(&conn->readers, NULL, false);
+
+	for (uint32_t i = 0; i < n; i++) {
+		read_init(&readers[i], loop, &conn->base);
+		cf_ll_append(&conn->readers, &readers[i].cmd.pipe_link);
+	}
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( event_read_blocks, "batch and scan blocks in one read" ) {
+	as_event_loop loop;
+	memset(&loop, 0, sizeof(as_event_loop));
+
+	as_event_connection conn;
+	memset(&conn, 0, sizeof(as_event_connection));
+
+	uint8_t buf[512];
+	uint8_t* p = read_response(buf, 1, 1, false);
+	p = read_response(p, 40, 2, false);
+	p = read_response(p, 3, 3, true);
+	uint32_t size = (uint32_t)(p - buf);
+
+	// All blocks are parsed from one read.
+	read_command rc;
+	read_init(&rc, &loop, &conn);
+	assert_true( as_event_command_parse_buffer(&rc.cmd, buf, size) );
+	assert_int_eq( rc.blocks, 3 );
+	assert_int_eq( rc.tags[0], 1 );
+	assert_int_eq( rc.tags[1], 2 );
+	assert_int_eq( rc.tags[2], 3 );
+	assert_null( loop.read_conn );
+
+	// Single response.
+	p = read_response(buf, 5, 9, true);
+	read_init(&rc, &loop, &conn);
+	assert_true( as_event_command_parse_buffer(&rc.cmd, buf, (uint32_t)(p - buf)) );
+	assert_int_eq( rc.blocks, 1 );
+	assert_int_eq( rc.tags[0], 9 );
+}
+
+TEST( event_read_split, "batch and scan blocks split across reads" ) {
+	as_event_loop loop;
+	memset(&loop, 0, sizeof(as_event_loop));
+
+	as_event_connection conn;
+	memset(&conn, 0, sizeof(as_event_connection));
+
+	uint8_t buf[512];
+	uint8_t* p = read_response(buf, 1, 1, false);
+	p = read_response(p, 40, 2, false);
+	p = read_response(p, 3, 3, true);
+	uint32_t size = (uint32_t)(p - buf);
+
+	// Split reads at every chunk size, so splits fall inside proto headers, message
+	// headers and bodies and on the boundaries between blocks.
+	for (uint32_t chunk = 1; chunk < size; chunk++) {
+		read_command rc;
+		read_init(&rc, &loop, &conn);
+
+		uint32_t offset = 0;
+		bool done = false;
+
+		while (offset < size) {
+			uint32_t len = (size - offset < chunk)? size - offset : chunk;
+
+			// Command is not done before its last byte arrives.
+			assert_false( done );
+			done = as_event_command_parse_buffer(&rc.cmd, buf + offset, len);
+			offset += len;
+		}
+
+		assert_true( done );
+		assert_int_eq( rc.blocks, 3 );
+		assert_int_eq( rc.tags[0], 1 );
+		assert_int_eq( rc.tags[1], 2 );
+		assert_int_eq( rc.tags[2], 3 );
+	}
+}
+
+TEST( event_read_pipeline, "pipelined responses in one read" ) {
+	as_event_loop loop;
+	memset(&loop, 0, sizeof(as_event_loop));
+
+	as_pipe_connection conn;
+	read_command readers[3];
+	read_pipe_init(&conn, readers, 3, &loop);
+
+	uint8_t buf[512];
+	uint8_t* p = read_response(buf, 1, 1, true);
+	p = read_response(p, 8, 2, true);
+	p = read_response(p, 1, 3, true);
+	uint32_t size = (uint32_t)(p - buf);
+
+	// Responses of all readers are parsed from one read.
+	assert_true( as_event_command_parse_buffer(&readers[0].cmd, buf, size) );
+
+	for (uint32_t i = 0; i < 3; i++) {
+		assert_int_eq( readers[i].blocks, 1 );
+		assert_int_eq( readers[i].tags[0], i + 1 );
+	}
+	assert_int_eq( cf_ll_size(&conn.readers), 0 );
+	assert_null( loop.read_conn );
+
+	// Read ends inside second response.  Rest of second response and third response
+	// arrive in the next read, which starts at the second reader.
+	read_pipe_init(&conn, readers, 3, &loop);
+	uint32_t split = (uint32_t)(read_response(buf, 1, 1, true) - buf) + 10;
+
+	assert_true( as_event_command_parse_buffer(&readers[0].cmd, buf, split) );
+	assert_int_eq( readers[0].blocks, 1 );
+	assert_int_eq( readers[1].blocks, 0 );
+	assert_int_eq( readers[1].cmd.state, AS_ASYNC_STATE_COMMAND_READ_BODY );
+	assert_int_eq( readers[1].cmd.pos, 10 - sizeof(as_proto) );
+	assert_int_eq( cf_ll_size(&conn.readers), 2 );
+
+	as_event_command* next = as_pipe_link_to_command(cf_ll_get_head(&conn.readers));
+	assert_true( next == &readers[1].cmd );
+	assert_true( as_event_command_parse_buffer(next, buf + split, size - split) );
+	assert_int_eq( readers[1].tags[0], 2 );
+	assert_int_eq( readers[2].tags[0], 3 );
+	assert_int_eq( cf_ll_size(&conn.readers), 0 );
+}
+
+TEST( event_read_cancel, "pipelined responses are not parsed after cancel" ) {
+	as_event_loop loop;
+	memset(&loop, 0, sizeof(as_event_loop));
+
+	as_pipe_connection conn;
+	read_command readers[3];
+	read_pipe_init(&conn, readers, 3, &loop);
+
+	uint8_t buf[512];
+	uint8_t* p = read_response(buf, 1, 1, true);
+	p = read_response(p, 8, 2, true);
+	p = read_response(p, 1, 3, true);
+	uint32_t size = (uint32_t)(p - buf);
+
+	// Connection is canceled while the first response is parsed.  Later responses in
+	// the same read belong to readers that the cancel releases, so they are skipped.
+	readers[0].cancel = true;
+	assert_true( as_event_command_parse_buffer(&readers[0].cmd, buf, size) );
+	assert_int_eq( readers[0].blocks, 1 );
+	assert_int_eq( readers[1].blocks, 0 );
+	assert_int_eq( readers[1].cmd.pos, 0 );
+	assert_int_eq( readers[2].blocks, 0 );
+	assert_null( loop.read_conn );
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( event_read, "async response read buffer tests" ) {
+	suite_add( event_read_blocks );
+	suite_add( event_read_split );
+	suite_add( event_read_pipeline );
+	suite_add( event_read_cancel );
+}
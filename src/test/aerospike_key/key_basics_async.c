@@ -17,7 +17,9 @@
 #include <aerospike/aerospike.h>
 #include <aerospike/aerospike_key.h>
 #include <aerospike/as_arraylist.h>
+#include <aerospike/as_atomic.h>
 #include <aerospike/as_buffer.h>
+#include <aerospike/as_completion.h>
 #include <aerospike/as_error.h>
 #include <aerospike/as_hashmap.h>
 #include <aerospike/as_integer.h>
@@ -27,11 +29,14 @@
 #include <aerospike/as_monitor.h>
 #include <aerospike/as_record.h>
 #include <aerospike/as_serializer.h>
+#include <aerospike/as_sleep.h>
 #include <aerospike/as_status.h>
 #include <aerospike/as_string.h>
 #include <aerospike/as_stringmap.h>
 #include <aerospike/as_val.h>
 #include <aerospike/as_event.h>
+#include <aerospike/as_event_internal.h>
+#include <citrusleaf/cf_clock.h>
 
 #include "../test.h"
 
@@ -337,6 +342,353 @@ TEST(key_basics_async_operate, "async operate")
 	as_monitor_wait(&monitor);
 }
 
+
+#define BATCH_COMPLETION_COUNT 50
+
+static uint32_t batch_completions;
+
+static void
+as_batch_completion_listener(as_completion* completions, uint32_t n_completions, void* udata, as_event_loop* event_loop)
+{
+	atf_test_result* __result__ = udata;
+	bool valid = true;
+
+	for (uint32_t i = 0; i < n_completions; i++) {
+		if (completions[i].err || completions[i].type != AS_COMPLETION_WRITE || completions[i].udata != udata) {
+			valid = false;
+		}
+	}
+	batch_completions += n_completions;
+
+	if (! valid || batch_completions == BATCH_COMPLETION_COUNT) {
+		// Restore per command listeners for remaining tests.
+		as_event_loop_set_completion_listener(event_loop, NULL, NULL, 0);
+		assert_async(&monitor, valid);
+		as_monitor_notify(&monitor);
+	}
+}
+
+static void
+as_put_batch_unexpected(as_error* err, void* udata, as_event_loop* event_loop)
+{
+	atf_test_result* __result__ = udata;
+	fail_async(&monitor, "Per command listener called in batch completion mode");
+}
+
+static void
+as_put_batch_start(as_error* err, void* udata, as_event_loop* event_loop)
+{
+	assert_success_async(&monitor, err, udata);
+
+	// Running in event loop thread, so completion mode can be changed here.
+	batch_completions = 0;
+	as_event_loop_set_completion_listener(event_loop, as_batch_completion_listener, udata, 16);
+
+	as_record rec;
+	as_record_inita(&rec, 1);
+
+	for (uint32_t i = 0; i < BATCH_COMPLETION_COUNT; i++) {
+		as_key key;
+		as_key_init_int64(&key, NAMESPACE, SET, 1000 + i);
+		as_record_set_int64(&rec, "a", i);
+
+		as_error e;
+		as_status status = aerospike_key_put_async(as, &e, NULL, &key, &rec, as_put_batch_unexpected, udata, event_loop, NULL);
+
+		if (status != AEROSPIKE_OK) {
+			as_event_loop_set_completion_listener(event_loop, NULL, NULL, 0);
+			fail_async(&monitor, "Error %d: %s", e.code, e.message);
+			break;
+		}
+	}
+	as_record_destroy(&rec);
+}
+
+TEST(key_basics_async_batch_completion, "async batch completion delivery")
+{
+	as_monitor_begin(&monitor);
+
+	as_key key;
+	as_key_init(&key, NAMESPACE, SET, "pa6");
+
+	as_record rec;
+	as_record_inita(&rec, 1);
+	as_record_set_int64(&rec, "a", 1);
+
+	as_error err;
+	as_status status = aerospike_key_put_async(as, &err, NULL, &key, &rec, as_put_batch_start, __result__, 0, NULL);
+	as_key_destroy(&key);
+	as_record_destroy(&rec);
+
+	assert_int_eq(status, AEROSPIKE_OK);
+	as_monitor_wait(&monitor);
+}
+
+#define RING_COMPLETION_COUNT 50
+
+static as_completion_ring completion_ring;
+
+static void
+as_put_ring_start(as_error* err, void* udata, as_event_loop* event_loop)
+{
+	assert_success_async(&monitor, err, udata);
+
+	// Ring is much smaller than the number of commands, so completions are held on the
+	// event loop until the test thread drains the ring.
+	as_event_loop_set_completion_ring(event_loop, &completion_ring);
+
+	as_record rec;
+	as_record_inita(&rec, 1);
+
+	for (uint32_t i = 0; i < RING_COMPLETION_COUNT; i++) {
+		as_key key;
+		as_key_init_int64(&key, NAMESPACE, SET, 1100 + i);
+		as_record_set_int64(&rec, "a", i);
+
+		as_error e;
+		as_status status = aerospike_key_put_async(as, &e, NULL, &key, &rec, as_put_batch_unexpected, udata, event_loop, NULL);
+
+		if (status != AEROSPIKE_OK) {
+			fail_async(&monitor, "Error %d: %s", e.code, e.message);
+			break;
+		}
+	}
+	as_record_destroy(&rec);
+}
+
+static void
+as_put_ring_stop(void* udata)
+{
+	as_event_loop* event_loop = udata;
+	as_event_loop_set_completion_ring(event_loop, NULL);
+	as_monitor_notify(&monitor);
+}
+
+TEST(key_basics_async_completion_ring, "async completion ring backpressure")
+{
+	assert_true(as_completion_ring_init(&completion_ring, 4));
+
+	as_monitor_begin(&monitor);
+
+	as_event_loop* event_loop = as_event_loop_get();
+
+	as_key key;
+	as_key_init(&key, NAMESPACE, SET, "pa7");
+
+	as_record rec;
+	as_record_inita(&rec, 1);
+	as_record_set_int64(&rec, "a", 1);
+
+	as_error err;
+	as_status status = aerospike_key_put_async(as, &err, NULL, &key, &rec, as_put_ring_start, __result__, event_loop, NULL);
+	as_key_destroy(&key);
+	as_record_destroy(&rec);
+
+	assert_int_eq(status, AEROSPIKE_OK);
+
+	uint32_t received = 0;
+	bool valid = true;
+	uint64_t deadline = cf_getms() + 10000;
+
+	while (received < RING_COMPLETION_COUNT && cf_getms() < deadline) {
+		as_completion completions[3];
+		uint32_t n = as_completion_ring_drain(&completion_ring, completions, 3);
+
+		for (uint32_t i = 0; i < n; i++) {
+			if (completions[i].err || completions[i].type != AS_COMPLETION_WRITE ||
+				completions[i].udata != __result__) {
+				valid = false;
+			}
+			as_completion_destroy(&completions[i]);
+		}
+		received += n;
+
+		if (n == 0) {
+			as_sleep(1);
+		}
+	}
+
+	// Restore per command listeners from the event loop thread.
+	as_event_execute(event_loop, as_put_ring_stop, event_loop);
+	as_monitor_wait(&monitor);
+	as_completion_ring_destroy(&completion_ring);
+
+	assert_true(valid);
+	assert_int_eq(received, RING_COMPLETION_COUNT);
+}
+
+#define RING_FULL_COUNT 6
+
+static uint32_t ring_loop_runs;
+
+static void
+as_put_ring_full_start(as_error* err, void* udata, as_event_loop* event_loop)
+{
+	assert_success_async(&monitor, err, udata);
+
+	// Completions of these commands do not fit in the ring.
+	as_event_loop_set_completion_ring(event_loop, &completion_ring);
+
+	as_record rec;
+	as_record_inita(&rec, 1);
+
+	for (uint32_t i = 0; i < RING_FULL_COUNT; i++) {
+		as_key key;
+		as_key_init_int64(&key, NAMESPACE, SET, 1200 + i);
+		as_record_set_int64(&rec, "a", i);
+
+		as_error e;
+		as_status status = aerospike_key_put_async(as, &e, NULL, &key, &rec, as_put_batch_unexpected, udata, event_loop, NULL);
+
+		if (status != AEROSPIKE_OK) {
+			fail_async(&monitor, "Error %d: %s", e.code, e.message);
+			break;
+		}
+	}
+	as_record_destroy(&rec);
+}
+
+static void
+as_ring_loop_run(void* udata)
+{
+	as_incr_uint32(&ring_loop_runs);
+}
+
+static bool
+as_ring_wait(as_event_loop* event_loop, bool backlog, uint64_t deadline)
+{
+	while (as_completion_backlog(event_loop) != backlog) {
+		if (cf_getms() >= deadline) {
+			return false;
+		}
+		as_sleep(1);
+	}
+	return true;
+}
+
+TEST(key_basics_async_completion_ring_full, "async completion ring full does not block event loop")
+{
+	assert_true(as_completion_ring_init(&completion_ring, 2));
+
+	as_monitor_begin(&monitor);
+
+	as_event_loop* event_loop = as_event_loop_get();
+
+	as_key key;
+	as_key_init(&key, NAMESPACE, SET, "pa8");
+
+	as_record rec;
+	as_record_inita(&rec, 1);
+	as_record_set_int64(&rec, "a", 1);
+
+	as_error err;
+	as_status status = aerospike_key_put_async(as, &err, NULL, &key, &rec, as_put_ring_full_start, __result__, event_loop, NULL);
+	assert_int_eq(status, AEROSPIKE_OK);
+
+	// Ring is not drained, so the remaining completions are held on the event loop.
+	uint64_t deadline = cf_getms() + 10000;
+	bool backlog = as_ring_wait(event_loop, true, deadline);
+
+	// Event loop keeps running while the ring is full.
+	ring_loop_runs = 0;
+	as_event_execute(event_loop, as_ring_loop_run, NULL);
+
+	while (as_load_uint32(&ring_loop_runs) == 0 && cf_getms() < deadline) {
+		as_sleep(1);
+	}
+	uint32_t runs = as_load_uint32(&ring_loop_runs);
+
+	// New single record commands are rejected until the ring has room.
+	as_status full = aerospike_key_put_async(as, &err, NULL, &key, &rec, as_put_batch_unexpected, __result__, event_loop, NULL);
+	as_key_destroy(&key);
+	as_record_destroy(&rec);
+
+	uint32_t received = 0;
+	bool valid = true;
+
+	while (received < RING_FULL_COUNT && cf_getms() < deadline) {
+		as_completion completions[2];
+		uint32_t n = as_completion_ring_drain(&completion_ring, completions, 2);
+
+		for (uint32_t i = 0; i < n; i++) {
+			if (completions[i].err || completions[i].type != AS_COMPLETION_WRITE ||
+				completions[i].udata != __result__) {
+				valid = false;
+			}
+			as_completion_destroy(&completions[i]);
+		}
+		received += n;
+
+		if (n == 0) {
+			as_sleep(1);
+		}
+	}
+	bool cleared = as_ring_wait(event_loop, false, deadline);
+
+	as_event_execute(event_loop, as_put_ring_stop, event_loop);
+	as_monitor_wait(&monitor);
+	as_completion_ring_destroy(&completion_ring);
+
+	assert_true(backlog);
+	assert_int_eq(runs, 1);
+	assert_int_eq(full, AEROSPIKE_ERR_ASYNC_QUEUE_FULL);
+	assert_true(valid);
+	assert_int_eq(received, RING_FULL_COUNT);
+	assert_true(cleared);
+}
+
+#define LARGE_SIZE (64 * 1024)
+
+static void
+as_get_large_callback(as_error* err, as_record* rec, void* udata, as_event_loop* event_loop)
+{
+	assert_success_async(&monitor, err, udata);
+
+	as_bytes* bytes = as_record_get_bytes(rec, "a");
+	assert_async(&monitor, bytes != NULL);
+	assert_int_eq_async(&monitor, as_bytes_size(bytes), LARGE_SIZE);
+	assert_int_eq_async(&monitor, as_bytes_get(bytes)[LARGE_SIZE - 1], 5);
+	as_monitor_notify(&monitor);
+}
+
+static void
+as_put_large_callback(as_error* err, void* udata, as_event_loop* event_loop)
+{
+	assert_success_async(&monitor, err, udata);
+
+	as_key key;
+	as_key_init(&key, NAMESPACE, SET, "pa7");
+
+	as_error e;
+	as_status status = aerospike_key_get_async(as, &e, NULL, &key, as_get_large_callback, udata, event_loop, NULL);
+	assert_status_async(&monitor, status, &e);
+}
+
+TEST(key_basics_async_get_large, "async get larger than event loop read buffer")
+{
+	as_monitor_begin(&monitor);
+
+	as_key key;
+	as_key_init(&key, NAMESPACE, SET, "pa7");
+
+	// Exceed event loop read buffer so response body is read directly into command buffer.
+	uint8_t* blob = malloc(LARGE_SIZE);
+	memset(blob, 5, LARGE_SIZE);
+
+	as_record rec;
+	as_record_inita(&rec, 1);
+	as_record_set_raw(&rec, "a", blob, LARGE_SIZE);
+
+	as_error err;
+	as_status status = aerospike_key_put_async(as, &err, NULL, &key, &rec, as_put_large_callback, __result__, 0, NULL);
+	as_key_destroy(&key);
+	as_record_destroy(&rec);
+	free(blob);
+
+	assert_int_eq(status, AEROSPIKE_OK);
+	as_monitor_wait(&monitor);
+}
+
 /******************************************************************************
  * TEST SUITE
  *****************************************************************************/
@@ -351,4 +703,8 @@ SUITE(key_basics_async, "aerospike_key basic tests")
 	suite_add(key_basics_async_exists);
 	suite_add(key_basics_async_remove);
 	suite_add(key_basics_async_operate);
+	suite_add(key_basics_async_batch_completion);
+	suite_add(key_basics_async_completion_ring);
+	suite_add(key_basics_async_completion_ring_full);
+	suite_add(key_basics_async_get_large);
 }
@@ -0,0 +1,364 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+#include <aerospike/as_atomic.h>
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_single_flight.h>
+#include <aerospike/as_sleep.h>
+#include <aerospike/as_status.h>
+#include <citrusleaf/cf_clock.h>
+
+#include <pthread.h>
+#include <string.h>
+
+#include "../test.h"
+#include "../aerospike_test.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define NAMESPACE "test"
+#define SET "test_coalesce"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+typedef struct {
+	aerospike* client;
+	as_key* key;
+	const char** bins;
+	as_policy_read policy;
+	as_status status;
+	int64_t value;
+} key_coalesce_data;
+
+static as_single_flight_command_fn key_coalesce_real;
+static uint32_t key_coalesce_sent;
+static uint32_t key_coalesce_released;
+
+// Count requests and hold them until released, so joining callers can be counted first.
+static as_status
+key_coalesce_command(
+	as_cluster* cluster, as_error* err, const as_policy_read* policy, const as_key* key,
+	const char* bins[], as_command_raw_record* raw
+	)
+{
+	as_incr_uint32(&key_coalesce_sent);
+
+	while (! as_load_uint32(&key_coalesce_released)) {
+		as_sleep(1);
+	}
+	return key_coalesce_real(cluster, err, policy, key, bins, raw);
+}
+
+static void
+key_coalesce_reset(void)
+{
+	as_store_uint32(&key_coalesce_sent, 0);
+	as_store_uint32(&key_coalesce_released, 0);
+}
+
+static void
+key_coalesce_init(key_coalesce_data* data, aerospike* client, as_key* key, const char** bins)
+{
+	data->client = client;
+	data->key = key;
+	data->bins = bins;
+	as_policy_read_init(&data->policy);
+	data->policy.coalesce = true;
+	data->policy.base.total_timeout = 10000;
+	data->status = AEROSPIKE_ERR_CLIENT;
+	data->value = 0;
+}
+
+static void*
+key_coalesce_read(void* udata)
+{
+	key_coalesce_data* data = udata;
+
+	as_error err;
+	as_record* rec = NULL;
+
+	if (data->bins) {
+		data->status = aerospike_key_select(data->client, &err, &data->policy, data->key, data->bins, &rec);
+	}
+	else {
+		data->status = aerospike_key_get(data->client, &err, &data->policy, data->key, &rec);
+	}
+
+	if (data->status == AEROSPIKE_OK) {
+		data->value = as_record_get_int64(rec, "a", 0);
+		as_record_destroy(rec);
+	}
+	return NULL;
+}
+
+static void
+key_coalesce_start(key_coalesce_data* data, pthread_t* threads, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; i++) {
+		pthread_create(&threads[i], NULL, key_coalesce_read, &data[i]);
+	}
+}
+
+static void
+key_coalesce_join(pthread_t* threads, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; i++) {
+		pthread_join(threads[i], NULL);
+	}
+}
+
+// Return number of callers using reads of key, including the callers that started them.
+static uint32_t
+key_coalesce_refs(aerospike* client, as_key* key)
+{
+	as_single_flight_shard* shard = as_single_flight_get_shard(client->cluster->single_flight,
+		key->digest.value);
+	uint32_t refs = 0;
+
+	pthread_mutex_lock(&shard->lock);
+
+	for (as_flight* flight = shard->flights; flight; flight = flight->next) {
+		if (memcmp(flight->digest, key->digest.value, AS_DIGEST_VALUE_SIZE) == 0) {
+			refs += flight->ref_count;
+		}
+	}
+	pthread_mutex_unlock(&shard->lock);
+	return refs;
+}
+
+static bool
+key_coalesce_wait(aerospike* client, as_key* key, uint32_t refs)
+{
+	uint64_t deadline = cf_getms() + 5000;
+
+	while (key_coalesce_refs(client, key) != refs) {
+		if (cf_getms() >= deadline) {
+			return false;
+		}
+		as_sleep(1);
+	}
+	return true;
+}
+
+// Release held requests and wait for all readers.  Readers must be joined before asserting,
+// because they reference data on the caller's stack.
+static void
+key_coalesce_finish(pthread_t* threads, uint32_t n)
+{
+	as_store_uint32(&key_coalesce_released, 1);
+	key_coalesce_join(threads, n);
+}
+
+static void
+key_coalesce_run(atf_test_result* __result__, aerospike* client)
+{
+	as_error err;
+
+	as_key key;
+	as_key_init_int64(&key, NAMESPACE, SET, 7005);
+	as_key_digest(&key);
+
+	as_record rec;
+	as_record_init(&rec, 2);
+	as_record_set_int64(&rec, "a", 7005);
+	as_record_set_int64(&rec, "b", 1);
+
+	as_status rc = aerospike_key_put(client, &err, NULL, &key, &rec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	as_record_destroy(&rec);
+
+	const char* bins[] = {"a", NULL};
+	key_coalesce_data data[16];
+	pthread_t threads[16];
+
+	// Same key and bins.  One request is sent.
+	key_coalesce_reset();
+
+	for (uint32_t i = 0; i < 16; i++) {
+		key_coalesce_init(&data[i], client, &key, NULL);
+	}
+	key_coalesce_start(data, threads, 16);
+	bool joined = key_coalesce_wait(client, &key, 16);
+	key_coalesce_finish(threads, 16);
+
+	assert_true(joined);
+	assert_int_eq(as_load_uint32(&key_coalesce_sent), 1);
+
+	for (uint32_t i = 0; i < 16; i++) {
+		assert_int_eq(data[i].status, AEROSPIKE_OK);
+		assert_int_eq(data[i].value, 7005);
+	}
+
+	// Mix get and select.  Reads with different bins are not merged.
+	key_coalesce_reset();
+
+	for (uint32_t i = 0; i < 16; i++) {
+		key_coalesce_init(&data[i], client, &key, (i % 2) ? bins : NULL);
+	}
+	key_coalesce_start(data, threads, 16);
+	joined = key_coalesce_wait(client, &key, 16);
+	key_coalesce_finish(threads, 16);
+
+	assert_true(joined);
+	assert_int_eq(as_load_uint32(&key_coalesce_sent), 2);
+
+	for (uint32_t i = 0; i < 16; i++) {
+		assert_int_eq(data[i].status, AEROSPIKE_OK);
+		assert_int_eq(data[i].value, 7005);
+	}
+
+	// Reads with different replica, consistency level or linearize setting are not merged.
+	key_coalesce_reset();
+
+	for (uint32_t i = 0; i < 8; i++) {
+		key_coalesce_init(&data[i], client, &key, NULL);
+	}
+	data[2].policy.replica = AS_POLICY_REPLICA_MASTER;
+	data[3].policy.replica = AS_POLICY_REPLICA_MASTER;
+	data[4].policy.consistency_level = AS_POLICY_CONSISTENCY_LEVEL_ALL;
+	data[5].policy.consistency_level = AS_POLICY_CONSISTENCY_LEVEL_ALL;
+	data[6].policy.linearize_read = true;
+	data[7].policy.linearize_read = true;
+
+	key_coalesce_start(data, threads, 8);
+	joined = key_coalesce_wait(client, &key, 8);
+	key_coalesce_finish(threads, 8);
+
+	assert_true(joined);
+	assert_int_eq(as_load_uint32(&key_coalesce_sent), 4);
+
+	// Linearized reads are only supported by strong consistency namespaces, so their
+	// status depends on the server configuration.
+	for (uint32_t i = 0; i < 6; i++) {
+		assert_int_eq(data[i].status, AEROSPIKE_OK);
+		assert_int_eq(data[i].value, 7005);
+	}
+	assert_int_eq(data[6].status, data[7].status);
+
+	// Read that starts after a write completes does not join a read that started before it.
+	key_coalesce_reset();
+	key_coalesce_init(&data[0], client, &key, NULL);
+	key_coalesce_init(&data[1], client, &key, NULL);
+
+	key_coalesce_start(&data[0], &threads[0], 1);
+	joined = key_coalesce_wait(client, &key, 1);
+
+	as_record_init(&rec, 1);
+	as_record_set_int64(&rec, "a", 7006);
+	rc = aerospike_key_put(client, &err, NULL, &key, &rec);
+	as_record_destroy(&rec);
+
+	key_coalesce_start(&data[1], &threads[1], 1);
+	joined = joined && key_coalesce_wait(client, &key, 2);
+	key_coalesce_finish(threads, 2);
+
+	assert_true(joined);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	assert_int_eq(as_load_uint32(&key_coalesce_sent), 2);
+	assert_int_eq(data[1].status, AEROSPIKE_OK);
+	assert_int_eq(data[1].value, 7006);
+
+	// Caller that joins a read waits no longer than its own total timeout.
+	key_coalesce_reset();
+	key_coalesce_init(&data[0], client, &key, NULL);
+	key_coalesce_init(&data[1], client, &key, NULL);
+	data[1].policy.base.total_timeout_us = 50000;
+
+	key_coalesce_start(&data[0], &threads[0], 1);
+	joined = key_coalesce_wait(client, &key, 1);
+	key_coalesce_start(&data[1], &threads[1], 1);
+	key_coalesce_join(&threads[1], 1);
+
+	// Caller that timed out no longer references the read.
+	uint32_t refs = key_coalesce_refs(client, &key);
+	key_coalesce_finish(threads, 1);
+
+	assert_true(joined);
+	assert_int_eq(data[1].status, AEROSPIKE_ERR_TIMEOUT);
+	assert_int_eq(refs, 1);
+	assert_int_eq(as_load_uint32(&key_coalesce_sent), 1);
+	assert_int_eq(data[0].status, AEROSPIKE_OK);
+	assert_int_eq(data[0].value, 7006);
+
+	// Errors are shared too.  Remove also starts a new version, so none of these callers
+	// can join an earlier read.
+	rc = aerospike_key_remove(client, &err, NULL, &key);
+	assert_int_eq(rc, AEROSPIKE_OK);
+
+	key_coalesce_reset();
+
+	for (uint32_t i = 0; i < 16; i++) {
+		key_coalesce_init(&data[i], client, &key, NULL);
+	}
+	key_coalesce_start(data, threads, 16);
+	joined = key_coalesce_wait(client, &key, 16);
+	key_coalesce_finish(threads, 16);
+
+	assert_true(joined);
+	assert_int_eq(as_load_uint32(&key_coalesce_sent), 1);
+
+	for (uint32_t i = 0; i < 16; i++) {
+		assert_int_eq(data[i].status, AEROSPIKE_ERR_RECORD_NOT_FOUND);
+	}
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_coalesce_shared , "concurrent reads share one request" ) {
+
+	if (g_tls.enable) {
+		info("skipped when TLS is enabled");
+		return;
+	}
+
+	as_config config;
+	test_config_init(&config);
+
+	aerospike client;
+	assert_true(test_client_connect(&client, &config));
+
+	// Hold requests so callers that join them can be counted.
+	as_single_flight* sf = client.cluster->single_flight;
+	key_coalesce_real = sf->command;
+	sf->command = key_coalesce_command;
+
+	key_coalesce_run(__result__, &client);
+	test_client_close(&client);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_coalesce, "coalesced read tests" ) {
+	suite_add( key_coalesce_shared );
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+#include <aerospike/as_command_pool.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define NAMESPACE "test"
+#define SET "test_pool"
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_command_pool_reuse , "large puts reuse pooled command buffers" ) {
+
+	as_error err;
+
+	as_key key;
+	as_key_init_int64(&key, NAMESPACE, SET, 7002);
+
+	// Exceed stack buffer size so command buffers come from the pool.
+	uint32_t size = 64 * 1024;
+	uint8_t* blob = malloc(size);
+	memset(blob, 7, size);
+
+	as_record rec;
+	as_record_init(&rec, 1);
+	as_record_set_raw(&rec, "a", blob, size);
+
+	as_command_pool_stats before;
+	as_command_pool_get_stats(&before);
+
+	for (int i = 0; i < 10; i++) {
+		as_status rc = aerospike_key_put(as, &err, NULL, &key, &rec);
+		assert_int_eq(rc, AEROSPIKE_OK);
+	}
+
+	as_command_pool_stats after;
+	as_command_pool_get_stats(&after);
+	as_record_destroy(&rec);
+	free(blob);
+
+	// Only the first put can miss in this thread's cache.
+	assert_true(after.hits - before.hits >= 9);
+
+	as_status rc = aerospike_key_remove(as, &err, NULL, &key);
+	assert_int_eq(rc, AEROSPIKE_OK);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_command_pool, "pooled command buffer tests" ) {
+	suite_add( key_command_pool_reuse );
+}
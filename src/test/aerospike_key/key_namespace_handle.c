@@ -0,0 +1,82 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_namespace_handle.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define NAMESPACE "test"
+#define SET "test_nsh"
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_namespace_handle_put_get , "put/get using resolved namespace handle" ) {
+
+	as_error err;
+
+	as_namespace_handle nsh;
+	as_status rc = aerospike_namespace_resolve(as, &err, NAMESPACE, &nsh);
+	assert_int_eq(rc, AEROSPIKE_OK);
+
+	as_key key;
+	as_key_init_int64(&key, NAMESPACE, SET, 7001);
+	as_key_set_namespace_handle(&key, &nsh);
+
+	as_record rec;
+	as_record_init(&rec, 1);
+	as_record_set_int64(&rec, "a", 7001);
+
+	rc = aerospike_key_put(as, &err, NULL, &key, &rec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	as_record_destroy(&rec);
+
+	as_record* rrec = NULL;
+	rc = aerospike_key_get(as, &err, NULL, &key, &rrec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	assert_int_eq(as_record_get_int64(rrec, "a", 0), 7001);
+	as_record_destroy(rrec);
+
+	rc = aerospike_key_remove(as, &err, NULL, &key);
+	assert_int_eq(rc, AEROSPIKE_OK);
+
+	rc = aerospike_namespace_resolve(as, &err, "badns", &nsh);
+	assert_int_ne(rc, AEROSPIKE_OK);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_namespace_handle, "namespace handle tests" ) {
+	suite_add( key_namespace_handle_put_get );
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_near_cache.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+
+#include "../test.h"
+#include "../aerospike_test.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define NAMESPACE "test"
+#define SET "test_near_cache"
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void
+key_near_cache_read_run(atf_test_result* __result__, aerospike* client)
+{
+	as_error err;
+
+	as_key key;
+	as_key_init_int64(&key, NAMESPACE, SET, 7004);
+
+	as_record rec;
+	as_record_init(&rec, 2);
+	as_record_set_int64(&rec, "a", 1);
+	as_record_set_str(&rec, "b", "near");
+
+	as_status rc = aerospike_key_put(client, &err, NULL, &key, &rec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	as_record_destroy(&rec);
+
+	// First read is a miss.  Second read is served from cache.
+	for (int i = 0; i < 2; i++) {
+		as_record* rrec = NULL;
+		rc = aerospike_key_get(client, &err, NULL, &key, &rrec);
+		assert_int_eq(rc, AEROSPIKE_OK);
+		assert_int_eq(as_record_get_int64(rrec, "a", 0), 1);
+		assert_string_eq(as_record_get_str(rrec, "b"), "near");
+		as_record_destroy(rrec);
+	}
+
+	// Select is filtered from cached record.
+	const char* bins[] = {"b", NULL};
+	as_record* rrec = NULL;
+	rc = aerospike_key_select(client, &err, NULL, &key, bins, &rrec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	assert_int_eq(as_record_numbins(rrec), 1);
+	assert_string_eq(as_record_get_str(rrec, "b"), "near");
+	as_record_destroy(rrec);
+
+	as_near_cache_stats stats;
+	assert_true(as_near_cache_get_stats(client->cluster, &stats));
+	assert_int_eq(stats.misses, 1);
+	assert_int_eq(stats.hits, 2);
+	assert_int_eq(stats.entries, 1);
+
+	// Write invalidates cached record.
+	as_record_init(&rec, 1);
+	as_record_set_int64(&rec, "a", 2);
+	rc = aerospike_key_put(client, &err, NULL, &key, &rec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	as_record_destroy(&rec);
+
+	rrec = NULL;
+	rc = aerospike_key_get(client, &err, NULL, &key, &rrec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	assert_int_eq(as_record_get_int64(rrec, "a", 0), 2);
+	as_record_destroy(rrec);
+
+	rc = aerospike_key_remove(client, &err, NULL, &key);
+	assert_int_eq(rc, AEROSPIKE_OK);
+
+	rrec = NULL;
+	rc = aerospike_key_get(client, &err, NULL, &key, &rrec);
+	assert_int_eq(rc, AEROSPIKE_ERR_RECORD_NOT_FOUND);
+
+	as_near_cache_get_stats(client->cluster, &stats);
+	assert_int_eq(stats.misses, 3);
+	assert_int_eq(stats.entries, 0);
+}
+
+static void
+key_near_cache_revalidate_run(atf_test_result* __result__, aerospike* client)
+{
+	as_error err;
+
+	as_key key;
+	as_key_init_int64(&key, NAMESPACE, SET, 7006);
+
+	as_record rec;
+	as_record_init(&rec, 1);
+	as_record_set_int64(&rec, "a", 1);
+
+	as_status rc = aerospike_key_put(client, &err, NULL, &key, &rec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	as_record_destroy(&rec);
+
+	// First read caches record.  Later reads confirm generation with a header only read.
+	for (int i = 0; i < 3; i++) {
+		as_record* rrec = NULL;
+		rc = aerospike_key_get(client, &err, NULL, &key, &rrec);
+		assert_int_eq(rc, AEROSPIKE_OK);
+		assert_int_eq(as_record_get_int64(rrec, "a", 0), 1);
+		assert_int_eq(rrec->gen, 1);
+		as_record_destroy(rrec);
+	}
+
+	as_near_cache_stats stats;
+	assert_true(as_near_cache_get_stats(client->cluster, &stats));
+	assert_int_eq(stats.misses, 1);
+	assert_int_eq(stats.revalidations, 2);
+	assert_int_eq(stats.hits, 0);
+	assert_int_eq(stats.entries, 1);
+
+	// Write through the shared client changes generation without invalidating the cache.
+	as_record_init(&rec, 1);
+	as_record_set_int64(&rec, "a", 2);
+	rc = aerospike_key_put(as, &err, NULL, &key, &rec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	as_record_destroy(&rec);
+
+	// Generation mismatch reads full record and caches it again.
+	for (int i = 0; i < 2; i++) {
+		as_record* rrec = NULL;
+		rc = aerospike_key_get(client, &err, NULL, &key, &rrec);
+		assert_int_eq(rc, AEROSPIKE_OK);
+		assert_int_eq(as_record_get_int64(rrec, "a", 0), 2);
+		assert_int_eq(rrec->gen, 2);
+		as_record_destroy(rrec);
+	}
+
+	as_near_cache_get_stats(client->cluster, &stats);
+	assert_int_eq(stats.misses, 2);
+	assert_int_eq(stats.revalidations, 3);
+	assert_int_eq(stats.entries, 1);
+
+	// Remove through the shared client.  Revalidation finds no record and drops the entry.
+	rc = aerospike_key_remove(as, &err, NULL, &key);
+	assert_int_eq(rc, AEROSPIKE_OK);
+
+	as_record* rrec = NULL;
+	rc = aerospike_key_get(client, &err, NULL, &key, &rrec);
+	assert_int_eq(rc, AEROSPIKE_ERR_RECORD_NOT_FOUND);
+
+	as_near_cache_get_stats(client->cluster, &stats);
+	assert_int_eq(stats.misses, 2);
+	assert_int_eq(stats.invalidations, 1);
+	assert_int_eq(stats.entries, 0);
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_near_cache_read , "read through near cache" ) {
+
+	// Cache is owned by a separate client, so the shared client is never modified.
+	if (g_tls.enable) {
+		info("skipped when TLS is enabled");
+		return;
+	}
+
+	as_config config;
+	test_config_init(&config);
+	config.near_cache.max_memory = 1024 * 1024;
+	config.near_cache.n_shards = 4;
+	config.near_cache.revalidate_ms = 60000;
+
+	aerospike client;
+	assert_true(test_client_connect(&client, &config));
+	key_near_cache_read_run(__result__, &client);
+	test_client_close(&client);
+}
+
+TEST( key_near_cache_revalidate , "near cache revalidates record generation" ) {
+
+	if (g_tls.enable) {
+		info("skipped when TLS is enabled");
+		return;
+	}
+
+	// Revalidate on every read.
+	as_config config;
+	test_config_init(&config);
+	config.near_cache.max_memory = 1024 * 1024;
+	config.near_cache.n_shards = 4;
+	config.near_cache.revalidate_ms = 0;
+
+	aerospike client;
+	assert_true(test_client_connect(&client, &config));
+	key_near_cache_revalidate_run(__result__, &client);
+	test_client_close(&client);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_near_cache, "near cache read tests" ) {
+	suite_add( key_near_cache_read );
+	suite_add( key_near_cache_revalidate );
+}
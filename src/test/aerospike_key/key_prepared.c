@@ -0,0 +1,151 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_integer.h>
+#include <aerospike/as_operations.h>
+#include <aerospike/as_prepared.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+#include <aerospike/as_string.h>
+
+#include <stdio.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define NAMESPACE "test"
+#define SET "test_prepared"
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_prepared_put_operate , "put/operate using prepared command templates" ) {
+
+	as_error err;
+
+	as_key key;
+	as_key_init_str(&key, NAMESPACE, SET, "prep01");
+
+	as_record rec;
+	as_record_init(&rec, 2);
+	as_record_set_int64(&rec, "a", 0);
+	as_record_set_str(&rec, "b", "xxxx");
+
+	as_policy_write wpol;
+	as_policy_write_init(&wpol);
+	wpol.key = AS_POLICY_KEY_SEND;
+
+	as_prepared put;
+	as_status rc = aerospike_prepare_put(as, &err, &wpol, &key, &rec, &put);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	assert_int_eq(put.n_values, 2);
+	as_record_destroy(&rec);
+
+	as_operations ops;
+	as_operations_inita(&ops, 2);
+	as_operations_add_incr(&ops, "a", 1);
+	as_operations_add_read(&ops, "b");
+
+	as_prepared operate;
+	rc = aerospike_prepare_operate(as, &err, NULL, &key, &ops, &operate);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	as_operations_destroy(&ops);
+
+	char kbuf[8];
+	char bbuf[8];
+
+	for (int i = 0; i < 5; i++) {
+		sprintf(kbuf, "prep%02d", i);
+		sprintf(bbuf, "b%03d", i);
+		as_key_init_str(&key, NAMESPACE, SET, kbuf);
+
+		as_integer a;
+		as_integer_init(&a, i * 10);
+		as_string b;
+		as_string_init(&b, bbuf, false);
+		as_val* values[] = {(as_val*)&a, (as_val*)&b};
+
+		rc = aerospike_prepared_execute(as, &err, &put, &key, values, AS_RECORD_DEFAULT_TTL, NULL);
+		assert_int_eq(rc, AEROSPIKE_OK);
+
+		as_integer incr;
+		as_integer_init(&incr, 5);
+		as_val* op_values[] = {(as_val*)&incr, NULL};
+
+		as_record* rrec = NULL;
+		rc = aerospike_prepared_execute(as, &err, &operate, &key, op_values, AS_RECORD_DEFAULT_TTL, &rrec);
+		assert_int_eq(rc, AEROSPIKE_OK);
+		assert_string_eq(as_record_get_str(rrec, "b"), bbuf);
+		as_record_destroy(rrec);
+
+		rrec = NULL;
+		rc = aerospike_key_get(as, &err, NULL, &key, &rrec);
+		assert_int_eq(rc, AEROSPIKE_OK);
+		assert_int_eq(as_record_get_int64(rrec, "a", 0), i * 10 + 5);
+		as_record_destroy(rrec);
+
+		rc = aerospike_key_remove(as, &err, NULL, &key);
+		assert_int_eq(rc, AEROSPIKE_OK);
+	}
+
+	// Values that change the prepared layout are rejected.
+	as_string longer;
+	as_string_init(&longer, "too long", false);
+	as_val* bad[] = {NULL, (as_val*)&longer};
+	rc = aerospike_prepared_execute(as, &err, &put, &key, bad, AS_RECORD_DEFAULT_TTL, NULL);
+	assert_int_eq(rc, AEROSPIKE_ERR_PARAM);
+
+	// Keys outside the prepared namespace and set are rejected.
+	as_integer a;
+	as_integer_init(&a, 1);
+	as_string b;
+	as_string_init(&b, "b000", false);
+	as_val* values[] = {(as_val*)&a, (as_val*)&b};
+
+	as_key other;
+	as_key_init_str(&other, NAMESPACE, "test_other", "prep00");
+	rc = aerospike_prepared_execute(as, &err, &put, &other, values, AS_RECORD_DEFAULT_TTL, NULL);
+	assert_int_eq(rc, AEROSPIKE_ERR_PARAM);
+
+	// Prepared put sends the user key, so a digest only key is rejected.
+	as_key_init_digest(&other, NAMESPACE, SET, key.digest.value);
+	rc = aerospike_prepared_execute(as, &err, &put, &other, values, AS_RECORD_DEFAULT_TTL, NULL);
+	assert_int_eq(rc, AEROSPIKE_ERR_PARAM);
+
+	as_prepared_destroy(&put);
+	as_prepared_destroy(&operate);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_prepared, "prepared command template tests" ) {
+	suite_add( key_prepared_put_operate );
+}
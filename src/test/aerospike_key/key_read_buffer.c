@@ -0,0 +1,105 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+#include <aerospike/as_bytes.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_socket.h>
+#include <aerospike/as_status.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define NAMESPACE "test"
+#define SET "test_read_buffer"
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_read_buffer_get , "get small and large records through socket read buffer" ) {
+
+	as_error err;
+
+	as_key small_key;
+	as_key_init_int64(&small_key, NAMESPACE, SET, 7007);
+
+	as_key large_key;
+	as_key_init_int64(&large_key, NAMESPACE, SET, 7008);
+
+	as_record rec;
+	as_record_inita(&rec, 1);
+	as_record_set_int64(&rec, "a", 77);
+
+	as_status rc = aerospike_key_put(as, &err, NULL, &small_key, &rec);
+	as_record_destroy(&rec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+
+	// Exceed socket read buffer size so body is read directly.
+	uint32_t size = AS_SOCKET_READ_BUFFER_SIZE * 2;
+	uint8_t* blob = malloc(size);
+	memset(blob, 9, size);
+
+	as_record_init(&rec, 1);
+	as_record_set_raw(&rec, "a", blob, size);
+	rc = aerospike_key_put(as, &err, NULL, &large_key, &rec);
+	as_record_destroy(&rec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+
+	// Alternate reads so pooled connections switch between buffered and direct reads.
+	for (int i = 0; i < 10; i++) {
+		as_record* r = NULL;
+		rc = aerospike_key_get(as, &err, NULL, &small_key, &r);
+		assert_int_eq(rc, AEROSPIKE_OK);
+		assert_int_eq(as_record_get_int64(r, "a", 0), 77);
+		as_record_destroy(r);
+
+		r = NULL;
+		rc = aerospike_key_get(as, &err, NULL, &large_key, &r);
+		assert_int_eq(rc, AEROSPIKE_OK);
+		as_bytes* bytes = as_record_get_bytes(r, "a");
+		assert_not_null(bytes);
+		assert_int_eq(as_bytes_size(bytes), size);
+		assert_true(memcmp(as_bytes_get(bytes), blob, size) == 0);
+		as_record_destroy(r);
+	}
+	free(blob);
+
+	aerospike_key_remove(as, &err, NULL, &small_key);
+	aerospike_key_remove(as, &err, NULL, &large_key);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_read_buffer, "socket read buffer tests" ) {
+	suite_add( key_read_buffer_get );
+}
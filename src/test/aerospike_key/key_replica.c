@@ -0,0 +1,162 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_node.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+
+#include "../test.h"
+#include "../aerospike_test.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define NAMESPACE "test"
+#define SET "test_replica"
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_replica_policies , "get using each replica policy" ) {
+
+	as_error err;
+
+	as_key key;
+	as_key_init_int64(&key, NAMESPACE, SET, 7003);
+
+	as_record rec;
+	as_record_init(&rec, 1);
+	as_record_set_int64(&rec, "a", 7003);
+
+	as_status rc = aerospike_key_put(as, &err, NULL, &key, &rec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	as_record_destroy(&rec);
+
+	as_policy_replica replicas[] = {
+		AS_POLICY_REPLICA_MASTER, AS_POLICY_REPLICA_ANY, AS_POLICY_REPLICA_SEQUENCE
+	};
+
+	as_policy_read policy;
+	as_policy_read_init(&policy);
+
+	for (uint32_t i = 0; i < sizeof(replicas) / sizeof(as_policy_replica); i++) {
+		policy.replica = replicas[i];
+
+		// Repeat so ANY rotates through all replicas.
+		for (int j = 0; j < 6; j++) {
+			as_record* rrec = NULL;
+			rc = aerospike_key_get(as, &err, &policy, &key, &rrec);
+			assert_int_eq(rc, AEROSPIKE_OK);
+			assert_int_eq(as_record_get_int64(rrec, "a", 0), 7003);
+			as_record_destroy(rrec);
+		}
+	}
+
+	rc = aerospike_key_remove(as, &err, NULL, &key);
+	assert_int_eq(rc, AEROSPIKE_OK);
+}
+
+TEST( key_replica_prefer_rack , "get using prefer rack replica policy" ) {
+
+	// Prefer rack needs a client that tracks racks.  TLS settings are owned by the
+	// shared client instance.
+	if (g_tls.enable) {
+		info("skipped when TLS is enabled");
+		return;
+	}
+
+	as_error err;
+
+	as_key key;
+	as_key_init_int64(&key, NAMESPACE, SET, 7009);
+
+	as_record rec;
+	as_record_init(&rec, 1);
+	as_record_set_int64(&rec, "a", 7009);
+
+	as_status rc = aerospike_key_put(as, &err, NULL, &key, &rec);
+	assert_int_eq(rc, AEROSPIKE_OK);
+	as_record_destroy(&rec);
+
+	as_policy_read policy;
+	as_policy_read_init(&policy);
+
+	as_config config;
+	test_config_init(&config);
+	config.rack_aware = true;
+
+	aerospike client;
+	assert_true(test_client_connect(&client, &config));
+
+	// Racks are read on the first cluster tend, so the key's node knows its rack after
+	// connect.  The client's rack may not exist on rack aware servers, so only check that
+	// the rack is known.
+	as_node* node = NULL;
+	as_status node_rc = as_cluster_get_node(client.cluster, &err, NAMESPACE,
+		as_key_digest(&key)->value, AS_POLICY_REPLICA_PREFER_RACK, 0, &node);
+	int rack_id = AS_RACK_UNKNOWN;
+
+	if (node_rc == AEROSPIKE_OK) {
+		rack_id = as_load_int32(&node->rack_id);
+		as_node_release(node);
+	}
+
+	policy.replica = AS_POLICY_REPLICA_PREFER_RACK;
+	uint32_t found = 0;
+
+	// Retries move to other racks, so reads succeed regardless of rack layout.
+	for (int j = 0; j < 6; j++) {
+		as_record* rrec = NULL;
+		rc = aerospike_key_get(&client, &err, &policy, &key, &rrec);
+
+		if (rc == AEROSPIKE_OK) {
+			if (as_record_get_int64(rrec, "a", 0) == 7009) {
+				found++;
+			}
+			as_record_destroy(rrec);
+		}
+	}
+
+	test_client_close(&client);
+
+	assert_int_eq(node_rc, AEROSPIKE_OK);
+	assert_int_ne(rack_id, AS_RACK_UNKNOWN);
+	assert_int_eq(found, 6);
+
+	rc = aerospike_key_remove(as, &err, NULL, &key);
+	assert_int_eq(rc, AEROSPIKE_OK);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_replica, "replica policy read tests" ) {
+	suite_add( key_replica_policies );
+	suite_add( key_replica_prefer_rack );
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/aerospike.h>
+#include <aerospike/aerospike_key.h>
+#include <aerospike/as_error.h>
+#include <aerospike/as_record.h>
+#include <aerospike/as_status.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * GLOBAL VARS
+ *****************************************************************************/
+
+extern aerospike * as;
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define NAMESPACE "test"
+#define SET "test_timeout"
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( key_timeout_us , "get with microsecond timeouts" ) {
+
+	as_error err;
+
+	as_key key;
+	as_key_init(&key, NAMESPACE, SET, "foo_us");
+
+	as_record r;
+	as_record_inita(&r, 1);
+	as_record_set_int64(&r, "a", 123);
+
+	as_status rc = aerospike_key_put(as, &err, NULL, &key, &r);
+	as_record_destroy(&r);
+	assert_int_eq( rc, AEROSPIKE_OK );
+
+	as_policy_read policy;
+	as_policy_read_init(&policy);
+	policy.base.socket_timeout_us = 500000;
+	policy.base.total_timeout_us = 1000000;
+
+	as_record* rec = NULL;
+	rc = aerospike_key_get(as, &err, &policy, &key, &rec);
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_int_eq( as_record_get_int64(rec, "a", 0), 123 );
+	as_record_destroy(rec);
+
+	// Deadline expires before command can be sent.
+	policy.base.total_timeout_us = 1;
+	policy.base.max_retries = 0;
+
+	rec = NULL;
+	rc = aerospike_key_get(as, &err, &policy, &key, &rec);
+	assert_int_eq( rc, AEROSPIKE_ERR_TIMEOUT );
+
+	aerospike_key_remove(as, &err, NULL, &key);
+	as_key_destroy(&key);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( key_timeout, "microsecond timeout tests" ) {
+	suite_add( key_timeout_us );
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_node.h>
+#include <aerospike/as_partition.h>
+#include <citrusleaf/cf_b64.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define N_PARTITIONS 4096
+#define BITMAP_SIZE (N_PARTITIONS / 8)
+#define ENCODED_LEN cf_b64_encoded_len(BITMAP_SIZE)
+#define DECODED_SIZE cf_b64_decoded_buf_size(ENCODED_LEN)
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void
+bitmap_set(uint8_t* bitmap, uint32_t id)
+{
+	bitmap[id >> 3] |= 0x80 >> (id & 7);
+}
+
+static void
+bitmap_clear(uint8_t* bitmap, uint32_t id)
+{
+	bitmap[id >> 3] &= ~(0x80 >> (id & 7));
+}
+
+static uint32_t
+bitmap_next_slow(const uint8_t* bitmap, uint32_t id, uint32_t max)
+{
+	for (; id < max; id++) {
+		if (as_partition_bitmap_get(bitmap, id)) {
+			return id;
+		}
+	}
+	return max;
+}
+
+static uint32_t
+bitmap_collect(const uint8_t* bitmap, uint32_t* ids, uint32_t capacity)
+{
+	uint32_t n = 0;
+
+	for (uint32_t i = as_partition_bitmap_next(bitmap, 0, N_PARTITIONS); i < N_PARTITIONS;
+		 i = as_partition_bitmap_next(bitmap, i + 1, N_PARTITIONS)) {
+		if (n < capacity) {
+			ids[n] = i;
+		}
+		n++;
+	}
+	return n;
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( partition_bitmap_next, "next set partition from bitmap" ) {
+	uint8_t bitmap[BITMAP_SIZE];
+	memset(bitmap, 0, sizeof(bitmap));
+
+	// Empty bitmap.
+	assert_int_eq( as_partition_bitmap_next(bitmap, 0, N_PARTITIONS), N_PARTITIONS );
+	assert_int_eq( as_partition_bitmap_next(bitmap, 4000, N_PARTITIONS), N_PARTITIONS );
+	assert_int_eq( as_partition_bitmap_next(bitmap, N_PARTITIONS, N_PARTITIONS), N_PARTITIONS );
+
+	// First partition.
+	bitmap_set(bitmap, 0);
+	assert_int_eq( as_partition_bitmap_next(bitmap, 0, N_PARTITIONS), 0 );
+	assert_int_eq( as_partition_bitmap_next(bitmap, 1, N_PARTITIONS), N_PARTITIONS );
+	bitmap_clear(bitmap, 0);
+
+	// Last partition.
+	bitmap_set(bitmap, N_PARTITIONS - 1);
+	assert_int_eq( as_partition_bitmap_next(bitmap, 0, N_PARTITIONS), N_PARTITIONS - 1 );
+	assert_int_eq( as_partition_bitmap_next(bitmap, N_PARTITIONS - 1, N_PARTITIONS), N_PARTITIONS - 1 );
+	bitmap_clear(bitmap, N_PARTITIONS - 1);
+
+	// Partitions on both sides of a 64 partition boundary.
+	bitmap_set(bitmap, 64);
+	bitmap_set(bitmap, 127);
+	bitmap_set(bitmap, 128);
+	assert_int_eq( as_partition_bitmap_next(bitmap, 0, N_PARTITIONS), 64 );
+	assert_int_eq( as_partition_bitmap_next(bitmap, 65, N_PARTITIONS), 127 );
+	assert_int_eq( as_partition_bitmap_next(bitmap, 128, N_PARTITIONS), 128 );
+	assert_int_eq( as_partition_bitmap_next(bitmap, 129, N_PARTITIONS), N_PARTITIONS );
+
+	// Bits at or beyond max are ignored, including bits in the same byte as max.
+	assert_int_eq( as_partition_bitmap_next(bitmap, 0, 64), 64 );
+	assert_int_eq( as_partition_bitmap_next(bitmap, 65, 100), 100 );
+	bitmap_set(bitmap, 6);
+	assert_int_eq( as_partition_bitmap_next(bitmap, 0, 5), 5 );
+	assert_int_eq( as_partition_bitmap_next(bitmap, 0, 7), 6 );
+
+	// Start in the middle of a byte.
+	assert_int_eq( as_partition_bitmap_next(bitmap, 7, N_PARTITIONS), 64 );
+
+	// Compare every start position against a bit by bit scan.
+	srand(1);
+
+	for (uint32_t i = 0; i < BITMAP_SIZE; i++) {
+		// Leave long runs of empty bytes so 64 partition skips are taken.
+		bitmap[i] = (rand() % 8 == 0)? (uint8_t)rand() : 0;
+	}
+
+	for (uint32_t i = 0; i <= N_PARTITIONS; i++) {
+		assert_int_eq( as_partition_bitmap_next(bitmap, i, N_PARTITIONS),
+					  bitmap_next_slow(bitmap, i, N_PARTITIONS) );
+	}
+}
+
+TEST( partition_bitmap_update, "bitmap update decodes changes and returns partitions to visit" ) {
+	as_node node;
+	memset(&node, 0, sizeof(as_node));
+	as_vector_init(&node.partition_bitmaps, sizeof(as_partition_bitmap), 4);
+
+	uint8_t bitmap[BITMAP_SIZE];
+	char encoded[ENCODED_LEN];
+	uint8_t visit[DECODED_SIZE];
+	uint32_t ids[16];
+
+	// First bitmap for namespace.  All partitions must be visited.
+	memset(bitmap, 0, sizeof(bitmap));
+	bitmap_set(bitmap, 0);
+	bitmap_set(bitmap, 100);
+	bitmap_set(bitmap, N_PARTITIONS - 1);
+	cf_b64_encode(bitmap, BITMAP_SIZE, encoded);
+
+	const uint8_t* decoded = as_partition_bitmap_update(&node, "test", 0, encoded, ENCODED_LEN, visit);
+	assert_int_eq( memcmp(decoded, bitmap, BITMAP_SIZE), 0 );
+	assert_int_eq( bitmap_collect(visit, ids, 16), N_PARTITIONS );
+	assert_int_eq( node.partition_bitmaps.size, 1 );
+
+	// Same bitmap (empty diff).  Only partitions owned by node are visited.
+	const uint8_t* prev = decoded;
+	decoded = as_partition_bitmap_update(&node, "test", 0, encoded, ENCODED_LEN, visit);
+	assert_true( decoded == prev );
+	assert_int_eq( memcmp(decoded, bitmap, BITMAP_SIZE), 0 );
+	assert_int_eq( bitmap_collect(visit, ids, 16), 3 );
+	assert_int_eq( ids[0], 0 );
+	assert_int_eq( ids[1], 100 );
+	assert_int_eq( ids[2], N_PARTITIONS - 1 );
+
+	// Move first and last partitions and add one in the middle.  Both old and new owners
+	// are visited, so ownership can be removed.
+	bitmap_clear(bitmap, 0);
+	bitmap_set(bitmap, 1);
+	bitmap_set(bitmap, 2048);
+	bitmap_clear(bitmap, N_PARTITIONS - 1);
+	bitmap_set(bitmap, N_PARTITIONS - 2);
+	cf_b64_encode(bitmap, BITMAP_SIZE, encoded);
+
+	decoded = as_partition_bitmap_update(&node, "test", 0, encoded, ENCODED_LEN, visit);
+	assert_int_eq( memcmp(decoded, bitmap, BITMAP_SIZE), 0 );
+	assert_int_eq( bitmap_collect(visit, ids, 16), 6 );
+	assert_int_eq( ids[0], 0 );
+	assert_int_eq( ids[1], 1 );
+	assert_int_eq( ids[2], 100 );
+	assert_int_eq( ids[3], 2048 );
+	assert_int_eq( ids[4], N_PARTITIONS - 2 );
+	assert_int_eq( ids[5], N_PARTITIONS - 1 );
+
+	// Remove all partitions.
+	memset(bitmap, 0, sizeof(bitmap));
+	cf_b64_encode(bitmap, BITMAP_SIZE, encoded);
+
+	decoded = as_partition_bitmap_update(&node, "test", 0, encoded, ENCODED_LEN, visit);
+	assert_int_eq( memcmp(decoded, bitmap, BITMAP_SIZE), 0 );
+	assert_int_eq( bitmap_collect(visit, ids, 16), 4 );
+
+	decoded = as_partition_bitmap_update(&node, "test", 0, encoded, ENCODED_LEN, visit);
+	assert_int_eq( bitmap_collect(visit, ids, 16), 0 );
+
+	// Other replica levels and namespaces have their own previous bitmap.
+	bitmap_set(bitmap, 5);
+	cf_b64_encode(bitmap, BITMAP_SIZE, encoded);
+
+	decoded = as_partition_bitmap_update(&node, "test", 1, encoded, ENCODED_LEN, visit);
+	assert_int_eq( memcmp(decoded, bitmap, BITMAP_SIZE), 0 );
+	assert_int_eq( bitmap_collect(visit, ids, 16), N_PARTITIONS );
+
+	decoded = as_partition_bitmap_update(&node, "bar", 0, encoded, ENCODED_LEN, visit);
+	assert_int_eq( bitmap_collect(visit, ids, 16), N_PARTITIONS );
+	assert_int_eq( node.partition_bitmaps.size, 3 );
+
+	// Master bitmap for "test" is still empty, so its diff includes the new partition only.
+	decoded = as_partition_bitmap_update(&node, "test", 0, encoded, ENCODED_LEN, visit);
+	assert_int_eq( bitmap_collect(visit, ids, 16), 1 );
+	assert_int_eq( ids[0], 5 );
+
+	// Length change is decoded in full.
+	char short_encoded[cf_b64_encoded_len(6)];
+	cf_b64_encode(bitmap, 6, short_encoded);
+
+	decoded = as_partition_bitmap_update(&node, "test", 0, short_encoded, sizeof(short_encoded), visit);
+	assert_int_eq( memcmp(decoded, bitmap, 6), 0 );
+	assert_int_eq( bitmap_next_slow(visit, 0, 48), 0 );
+	assert_int_eq( node.partition_bitmaps.size, 3 );
+
+	as_partition_bitmaps_destroy(&node.partition_bitmaps);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( partition_bitmap, "partition bitmap update tests" ) {
+	suite_add( partition_bitmap_next );
+	suite_add( partition_bitmap_update );
+}
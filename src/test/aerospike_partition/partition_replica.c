@@ -0,0 +1,325 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_node.h>
+#include <aerospike/as_partition.h>
+#include <aerospike/as_shm_cluster.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define N_NODES 3
+#define N_PARTITIONS 4
+
+/******************************************************************************
+ * TYPES
+ *****************************************************************************/
+
+/**
+ * Detached cluster with one partition whose replicas are stored in both a process
+ * local partition and a shared memory partition.  Nodes are never tended.
+ */
+typedef struct {
+	as_cluster cluster;
+	as_node* nodes[N_NODES];
+	as_partition p;
+	as_shm_info shm_info;
+	as_partition_shm* p_shm;
+} replica_fixture;
+
+typedef as_node* (*replica_get_fn)(replica_fixture* fx, as_policy_replica replica, uint32_t sequence);
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void
+replica_set(replica_fixture* fx, uint32_t slot, int node_index)
+{
+	fx->p.nodes[slot] = (node_index >= 0)? fx->nodes[node_index] : NULL;
+
+	// Shared memory node index starts at one (zero indicates unset).
+	fx->p_shm->nodes[slot] = (uint32_t)(node_index + 1);
+}
+
+static void
+replica_fixture_init(replica_fixture* fx)
+{
+	memset(fx, 0, sizeof(replica_fixture));
+
+	for (uint32_t i = 0; i < N_NODES; i++) {
+		as_node* node = calloc(1, sizeof(as_node));
+		node->cluster = &fx->cluster;
+		node->index = i;
+		node->active = true;
+		node->breaker_state = AS_BREAKER_CLOSED;
+		fx->nodes[i] = node;
+	}
+
+	// Shared memory layout is cluster header, node array and one partition table.
+	uint32_t nodes_size = sizeof(as_node_shm) * N_NODES;
+	uint32_t table_size = sizeof(as_partition_table_shm) + sizeof(as_partition_shm) * N_PARTITIONS * AS_SHM_PARTITION_COPIES;
+	as_cluster_shm* cluster_shm = calloc(1, sizeof(as_cluster_shm) + nodes_size + table_size);
+	cluster_shm->nodes_size = N_NODES;
+	cluster_shm->nodes_capacity = N_NODES;
+	cluster_shm->n_partitions = N_PARTITIONS;
+	cluster_shm->partition_tables_size = 1;
+	cluster_shm->partition_tables_capacity = 1;
+	cluster_shm->partition_tables_offset = sizeof(as_cluster_shm) + nodes_size;
+	cluster_shm->partition_table_byte_size = table_size;
+
+	as_partition_table_shm* table = as_shm_get_partition_tables(cluster_shm);
+	as_strncpy(table->ns, "test", sizeof(table->ns));
+
+	fx->shm_info.cluster_shm = cluster_shm;
+	fx->shm_info.local_nodes = fx->nodes;
+	fx->cluster.shm_info = &fx->shm_info;
+	fx->p_shm = &table->partitions[N_PARTITIONS - 1];
+
+	for (uint32_t i = 0; i < N_NODES; i++) {
+		replica_set(fx, i, (int)i);
+	}
+}
+
+static void
+replica_set_racks(replica_fixture* fx, int rack0, int rack1, int rack2)
+{
+	int racks[N_NODES] = {rack0, rack1, rack2};
+
+	// Shared memory readers use racks published by the tend master process.
+	for (uint32_t i = 0; i < N_NODES; i++) {
+		fx->nodes[i]->rack_id = racks[i];
+		fx->shm_info.cluster_shm->nodes[i].rack_id = racks[i];
+	}
+}
+
+static void
+replica_fixture_destroy(replica_fixture* fx)
+{
+	for (uint32_t i = 0; i < N_NODES; i++) {
+		free(fx->nodes[i]);
+	}
+	free(fx->shm_info.cluster_shm);
+}
+
+static as_node*
+replica_get_local(replica_fixture* fx, as_policy_replica replica, uint32_t sequence)
+{
+	// CP mode never falls back to a random node, so results only depend on the partition.
+	return as_partition_get_node_epoch(&fx->cluster, &fx->p, replica, sequence, true);
+}
+
+static as_node*
+replica_get_shm(replica_fixture* fx, as_policy_replica replica, uint32_t sequence)
+{
+	return as_partition_shm_get_node_epoch(&fx->cluster, fx->p_shm, replica, sequence, true);
+}
+
+static int
+replica_index(replica_fixture* fx, as_node* node)
+{
+	for (uint32_t i = 0; i < N_NODES; i++) {
+		if (fx->nodes[i] == node) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+static void
+replica_rotation(atf_test_result* __result__, replica_fixture* fx, replica_get_fn get)
+{
+	// Master ignores retry sequence.
+	for (uint32_t i = 0; i < 4; i++) {
+		assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_MASTER, i)), 0 );
+	}
+
+	// Sequence starts at master and moves to the next replica on each retry.
+	for (uint32_t i = 0; i < 6; i++) {
+		assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_SEQUENCE, i)), i % N_NODES );
+	}
+
+	// Any spreads first attempts evenly over all replicas.
+	uint32_t counts[N_NODES] = {0};
+
+	for (uint32_t i = 0; i < 300; i++) {
+		int index = replica_index(fx, get(fx, AS_POLICY_REPLICA_ANY, 0));
+		assert_true( index >= 0 );
+		counts[index]++;
+	}
+
+	for (uint32_t i = 0; i < N_NODES; i++) {
+		assert_int_eq( counts[i], 100 );
+	}
+
+	// Consecutive first attempts use consecutive replicas.  A retry uses the replica after
+	// the one a first attempt would use at the same point.
+	int first = replica_index(fx, get(fx, AS_POLICY_REPLICA_ANY, 0));
+	int next = replica_index(fx, get(fx, AS_POLICY_REPLICA_ANY, 0));
+	assert_int_eq( next, (first + 1) % N_NODES );
+
+	int retry = replica_index(fx, get(fx, AS_POLICY_REPLICA_ANY, 1));
+	assert_int_eq( retry, (next + 2) % N_NODES );
+
+	// Inactive prole is skipped.  Sequence uses the next replica in order.
+	fx->nodes[1]->active = false;
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_SEQUENCE, 0)), 0 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_SEQUENCE, 1)), 2 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_SEQUENCE, 2)), 2 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_SEQUENCE, 3)), 0 );
+
+	memset(counts, 0, sizeof(counts));
+
+	for (uint32_t i = 0; i < 300; i++) {
+		counts[replica_index(fx, get(fx, AS_POLICY_REPLICA_ANY, 0))]++;
+	}
+	assert_int_eq( counts[0], 100 );
+	assert_int_eq( counts[1], 0 );
+	assert_int_eq( counts[2], 200 );
+
+	// Inactive master.  Master only fails, but sequence moves on to the proles.
+	fx->nodes[1]->active = true;
+	fx->nodes[0]->active = false;
+	assert_null( get(fx, AS_POLICY_REPLICA_MASTER, 0) );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_SEQUENCE, 0)), 1 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_SEQUENCE, 2)), 2 );
+	fx->nodes[0]->active = true;
+
+	// Unset third replica.  Retries rotate over the replicas that are known.
+	replica_set(fx, 2, -1);
+
+	for (uint32_t i = 0; i < 4; i++) {
+		assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_SEQUENCE, i)), i % 2 );
+	}
+
+	// No active replica.
+	replica_set(fx, 2, 2);
+
+	for (uint32_t i = 0; i < N_NODES; i++) {
+		fx->nodes[i]->active = false;
+	}
+	assert_null( get(fx, AS_POLICY_REPLICA_SEQUENCE, 0) );
+	assert_null( get(fx, AS_POLICY_REPLICA_ANY, 0) );
+
+	for (uint32_t i = 0; i < N_NODES; i++) {
+		fx->nodes[i]->active = true;
+	}
+
+	// No replicas.
+	for (uint32_t i = 0; i < N_NODES; i++) {
+		replica_set(fx, i, -1);
+	}
+	assert_null( get(fx, AS_POLICY_REPLICA_MASTER, 0) );
+	assert_null( get(fx, AS_POLICY_REPLICA_SEQUENCE, 0) );
+}
+
+static void
+replica_racks(atf_test_result* __result__, replica_fixture* fx, replica_get_fn get)
+{
+	fx->cluster.rack_aware = true;
+	fx->cluster.rack_id = 2;
+
+	// Prole on client's rack is tried first.  Other replicas follow in replica order.
+	replica_set_racks(fx, 1, 2, 1);
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 0)), 1 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 1)), 0 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 2)), 2 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 3)), 1 );
+
+	// Master ignores racks.  Sequence keeps replica order.
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_MASTER, 0)), 0 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_SEQUENCE, 0)), 0 );
+
+	// Several replicas on client's rack keep their replica order.
+	replica_set_racks(fx, 2, 1, 2);
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 0)), 0 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 1)), 2 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 2)), 1 );
+
+	// Last replica on client's rack.
+	replica_set_racks(fx, 1, 1, 2);
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 0)), 2 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 1)), 0 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 2)), 1 );
+
+	// Inactive node on client's rack falls back to the other racks.
+	fx->nodes[2]->active = false;
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 0)), 0 );
+	fx->nodes[2]->active = true;
+
+	// No replica on client's rack or unknown racks.  Replica order is used.
+	replica_set_racks(fx, 1, AS_RACK_UNKNOWN, 3);
+
+	for (uint32_t i = 0; i < N_NODES; i++) {
+		assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, i)), i );
+	}
+
+	// Racks are ignored when client is not rack aware.
+	replica_set_racks(fx, 1, 2, 1);
+	fx->cluster.rack_aware = false;
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 0)), 0 );
+	assert_int_eq( replica_index(fx, get(fx, AS_POLICY_REPLICA_PREFER_RACK, 1)), 1 );
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( partition_replica_local, "process partition reads rotate over three replicas" ) {
+	replica_fixture fx;
+	replica_fixture_init(&fx);
+	replica_rotation(__result__, &fx, replica_get_local);
+	replica_fixture_destroy(&fx);
+}
+
+TEST( partition_replica_shm, "shared memory partition reads rotate over three replicas" ) {
+	replica_fixture fx;
+	replica_fixture_init(&fx);
+	replica_rotation(__result__, &fx, replica_get_shm);
+	replica_fixture_destroy(&fx);
+}
+
+TEST( partition_replica_rack_local, "process partition reads prefer replicas on client rack" ) {
+	replica_fixture fx;
+	replica_fixture_init(&fx);
+	replica_racks(__result__, &fx, replica_get_local);
+	replica_fixture_destroy(&fx);
+}
+
+TEST( partition_replica_rack_shm, "shared memory partition reads prefer replicas on client rack" ) {
+	replica_fixture fx;
+	replica_fixture_init(&fx);
+	replica_racks(__result__, &fx, replica_get_shm);
+	replica_fixture_destroy(&fx);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( partition_replica, "partition replica selection tests" ) {
+	suite_add( partition_replica_local );
+	suite_add( partition_replica_shm );
+	suite_add( partition_replica_rack_local );
+	suite_add( partition_replica_rack_shm );
+}
@@ -466,6 +466,39 @@ TEST( query_foreach_3, "sum(e) where a == 'abc'" ) {
 	as_query_destroy(&q);
 }
 
+TEST( query_foreach_3_parallel, "sum(e) where a == 'abc' (parallel aggregation)" ) {
+	
+	as_error err;
+	as_error_reset(&err);
+
+	int64_t value = 0;
+
+	as_policy_query p;
+	as_policy_query_init(&p);
+	p.parallel_aggregate = true;
+
+	as_query q;
+	as_query_init(&q, NAMESPACE, SET);
+
+	as_query_where_inita(&q, 1);
+	as_query_where(&q, "a", as_string_equals("abc"));
+
+	as_query_apply(&q, UDF_FILE, "sum", NULL);
+
+	aerospike_query_foreach(as, &err, &p, &q, query_foreach_3_callback, &value);
+
+	if ( err.code != AEROSPIKE_OK ) {
+		 fprintf(stderr, "error(%d) %s at [%s:%d]", err.code, err.message, err.file, err.line);
+	}
+
+	info("value: %ld", value);
+
+	assert_int_eq( err.code, AEROSPIKE_OK );
+	assert_int_eq( value, 24275 );
+
+	as_query_destroy(&q);
+}
+
 static bool query_foreach_4_callback(const as_val * v, void * udata) {
 	if ( v != NULL ) {
 		as_integer * result = as_integer_fromval(v);
@@ -1480,6 +1513,7 @@ SUITE( query_foreach, "aerospike_query_foreach tests" ) {
 	suite_add( query_foreach_1 );
 	suite_add( query_foreach_2 );
 	suite_add( query_foreach_3 );
+	suite_add( query_foreach_3_parallel );
 	suite_add( query_foreach_4 );
 	suite_add( query_foreach_5 );
 	suite_add( query_foreach_6 );
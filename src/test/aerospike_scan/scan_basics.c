@@ -525,6 +525,86 @@ TEST( scan_basics_set1_select , "scan "SET1" and select 'bin1'" ) {
 	as_scan_destroy(&scan);
 }
 
+typedef struct scan_columns_check_s {
+	bool failed;
+	bool completed;
+	uint32_t rows;
+	uint32_t nulls;
+	int64_t sum;
+} scan_columns_check;
+
+static bool scan_columns_callback(const as_column_batch * batch, void * udata)
+{
+	scan_columns_check * check = (scan_columns_check *) udata;
+
+	if ( ! batch ) {
+		check->completed = true;
+		return true;
+	}
+
+	const as_column * bin1 = &batch->columns[0];
+	const as_column * bin2 = &batch->columns[1];
+	const as_column * bin3 = &batch->columns[2];
+
+	for ( uint32_t i = 0; i < batch->size; i++ ) {
+		if ( ! as_column_is_valid(bin1, i) || ! as_column_is_valid(bin2, i) ) {
+			check->failed = true;
+			return false;
+		}
+		check->sum += bin1->ints[i];
+
+		// bin2 is "str-<set>-<bin1>".
+		char expected[SET_STRSZ];
+		sprintf(expected, "str-%s-%d", SET1, (int) bin1->ints[i]);
+
+		uint32_t len = bin2->offsets[i + 1] - bin2->offsets[i];
+
+		if ( len != strlen(expected) || memcmp(bin2->data + bin2->offsets[i], expected, len) != 0 ) {
+			check->failed = true;
+			return false;
+		}
+	}
+	check->rows += batch->size;
+
+	// bin3 is a map, so it is null in an integer column.
+	check->nulls += bin3->null_count;
+	return true;
+}
+
+TEST( scan_basics_set1_columns , "scan "SET1" into columns" ) {
+
+	scan_columns_check check = {
+		.failed = false,
+		.completed = false,
+		.rows = 0,
+		.nulls = 0,
+		.sum = 0
+	};
+
+	as_column_def defs[3] = {
+		{"bin1", AS_COLUMN_INTEGER},
+		{"bin2", AS_COLUMN_STRING},
+		{"bin3", AS_COLUMN_INTEGER}
+	};
+
+	as_error err;
+
+	as_scan scan;
+	as_scan_init(&scan, NS, SET1);
+
+	// Use a small batch size so full and partial batches are both delivered.
+	as_status rc = aerospike_scan_columns(as, &err, NULL, &scan, defs, 3, 16, scan_columns_callback, &check);
+
+	assert_int_eq( rc, AEROSPIKE_OK );
+	assert_false( check.failed );
+	assert_true( check.completed );
+	assert_int_eq( check.rows, NUM_RECS_SET1 );
+	assert_int_eq( check.nulls, NUM_RECS_SET1 );
+	assert_int_eq( check.sum, (NUM_RECS_SET1 - 1) * NUM_RECS_SET1 / 2 );
+
+	as_scan_destroy(&scan);
+}
+
 TEST( scan_basics_set1_nodata , "scan "SET1" with no-bin-data" ) {
 
 	scan_check check = {
@@ -935,6 +1015,7 @@ SUITE( scan_basics, "aerospike_scan basic tests" ) {
 	suite_add( scan_basics_set1_concurrent );
 	suite_add( scan_basics_set1_select );
 	suite_add( scan_basics_set1_nodata );
+	suite_add( scan_basics_set1_columns );
 	suite_add( scan_basics_background );
 	suite_add( scan_basics_background_sameid );
 	suite_add( scan_basics_background_poll_job_status );
@@ -0,0 +1,295 @@
+/*
+ * Copyright 2008-2017 Aerospike, Inc.
+ *
+ * Portions may be licensed to Aerospike, Inc. under one or more contributor
+ * license agreements.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+#include <aerospike/as_cluster.h>
+#include <aerospike/as_shm_cluster.h>
+#include <citrusleaf/cf_clock.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../test.h"
+
+/******************************************************************************
+ * MACROS
+ *****************************************************************************/
+
+#define N_PARTITIONS 4096
+#define N_READERS 8
+#define N_READS 2000000
+#define N_REBALANCES 2000
+#define N_PROCESSES 128
+
+/******************************************************************************
+ * STATIC FUNCTIONS
+ *****************************************************************************/
+
+static void
+shm_rebalance(as_partition_table_shm* table, uint32_t master, uint32_t prole)
+{
+	// Swap master and prole one field at a time, like the tender does.
+	as_partition_table_shm_write_begin(table);
+
+	for (uint32_t i = 0; i < N_PARTITIONS; i++) {
+		as_store_uint32(&table->partitions[i].nodes[0], master);
+		as_store_uint32(&table->partitions[i].nodes[1], prole);
+	}
+
+	as_partition_table_shm_write_end(table, N_PARTITIONS);
+}
+
+static int
+shm_read_partitions(as_partition_table_shm* table, volatile uint8_t* done)
+{
+	uint32_t seed = (uint32_t)getpid();
+
+	for (uint32_t i = 0; i < N_READS && ! *done; i++) {
+		seed = seed * 1103515245 + 12345;
+		as_partition_shm* p = &table->partitions[(seed >> 8) % N_PARTITIONS];
+
+		as_partition_shm snapshot;
+		as_partition_shm_read(table, p, N_PARTITIONS, &snapshot);
+
+		// A torn read would return the same node for master and prole.
+		if (snapshot.nodes[0] == snapshot.nodes[1]) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/******************************************************************************
+ * TEST CASES
+ *****************************************************************************/
+
+TEST( shm_partition_seqlock_read_write, "partition reads use last consistent copy during update" ) {
+
+	size_t size = sizeof(as_partition_table_shm) + sizeof(as_partition_shm) * AS_SHM_PARTITION_COPIES;
+	as_partition_table_shm* table = calloc(1, size);
+	as_partition_shm* p = &table->partitions[0];
+	as_partition_shm snapshot;
+
+	// Empty table is consistent.
+	as_partition_shm_read(table, p, 1, &snapshot);
+	assert_int_eq( snapshot.nodes[0], 0 );
+
+	// Reads during an update return the previous update without waiting.  This also covers
+	// a tender that dies before ending the update.
+	as_partition_table_shm_write_begin(table);
+	as_store_uint32(&p->nodes[0], 3);
+	as_store_uint32(&p->regime, 5);
+	assert_int_eq( table->seq & 1, 1 );
+	as_partition_shm_read(table, p, 1, &snapshot);
+	assert_int_eq( snapshot.nodes[0], 0 );
+	assert_int_eq( snapshot.regime, 0 );
+
+	as_partition_table_shm_write_end(table, 1);
+	assert_int_eq( table->seq, 2 );
+	as_partition_shm_read(table, p, 1, &snapshot);
+	assert_int_eq( snapshot.nodes[0], 3 );
+	assert_int_eq( snapshot.regime, 5 );
+
+	// Second copy is brought up to date for the next update.
+	as_partition_table_shm_write_begin(table);
+	as_store_uint32(&p->nodes[0], 4);
+	as_partition_shm_read(table, p, 1, &snapshot);
+	assert_int_eq( snapshot.nodes[0], 3 );
+	assert_int_eq( snapshot.regime, 5 );
+	as_partition_table_shm_write_end(table, 1);
+
+	free(table);
+}
+
+TEST( shm_partition_seqlock, "consistent partition reads from multiple processes during rebalance" ) {
+
+	size_t size = sizeof(as_partition_table_shm) + (sizeof(as_partition_shm) * N_PARTITIONS * AS_SHM_PARTITION_COPIES) + 8;
+	void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	assert_true( mem != MAP_FAILED );
+
+	volatile uint8_t* done = (uint8_t*)mem;
+	as_partition_table_shm* table = (as_partition_table_shm*)((uint8_t*)mem + 8);
+	shm_rebalance(table, 1, 2);
+
+	pid_t pids[N_READERS];
+
+	for (int i = 0; i < N_READERS; i++) {
+		pids[i] = fork();
+
+		if (pids[i] == 0) {
+			_exit(shm_read_partitions(table, done));
+		}
+	}
+
+	// Simulate rebalances by repeatedly swapping master and prole.
+	for (uint32_t i = 0; i < N_REBALANCES; i++) {
+		if (i & 1) {
+			shm_rebalance(table, 1, 2);
+		}
+		else {
+			shm_rebalance(table, 2, 1);
+		}
+	}
+	*done = 1;
+
+	int failures = 0;
+
+	for (int i = 0; i < N_READERS; i++) {
+		int status = 0;
+
+		if (pids[i] < 0 || waitpid(pids[i], &status, 0) < 0 || ! WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			failures++;
+		}
+	}
+
+	assert_int_eq( table->seq & 1, 0 );
+	munmap(mem, size);
+	assert_int_eq( failures, 0 );
+}
+
+TEST( shm_node_stats_stale, "host-wide node stats skip processes that stopped publishing" ) {
+
+	uint32_t nodes_capacity = 2;
+	size_t size = sizeof(as_cluster_shm) + (sizeof(as_node_shm) * nodes_capacity) +
+		(as_shm_process_stats_size(nodes_capacity) * N_PROCESSES);
+	as_cluster_shm* cluster_shm = calloc(1, size);
+	cluster_shm->nodes_size = 1;
+	cluster_shm->nodes_capacity = nodes_capacity;
+	cluster_shm->processes_capacity = N_PROCESSES;
+	cluster_shm->partition_tables_offset = sizeof(as_cluster_shm) + (sizeof(as_node_shm) * nodes_capacity);
+	strcpy(cluster_shm->nodes[0].name, "A1");
+
+	as_shm_info shm_info;
+	memset(&shm_info, 0, sizeof(shm_info));
+	shm_info.cluster_shm = cluster_shm;
+	shm_info.takeover_threshold_ms = 30000;
+
+	as_cluster cluster;
+	memset(&cluster, 0, sizeof(cluster));
+	cluster.shm_info = &shm_info;
+
+	uint64_t now = cf_getms();
+
+	// Live process.
+	as_process_stats_shm* ps = as_shm_get_process_stats(cluster_shm, 0);
+	ps->pid = 100;
+	ps->timestamp = now;
+	ps->nodes[0].conns = 5;
+	ps->nodes[0].in_flight = 2;
+
+	// Process that crashed long ago without releasing its slot.
+	ps = as_shm_get_process_stats(cluster_shm, 7);
+	ps->pid = 200;
+	ps->timestamp = now - 60000;
+	ps->nodes[0].conns = 40;
+	ps->nodes[0].in_flight = 30;
+
+	// Another live process.
+	ps = as_shm_get_process_stats(cluster_shm, N_PROCESSES - 1);
+	ps->pid = 300;
+	ps->timestamp = now;
+	ps->nodes[0].conns = 1;
+
+	as_shm_node_stats stats;
+	assert_true( as_shm_get_node_stats(&cluster, "A1", &stats) );
+	assert_int_eq( stats.conns, 6 );
+	assert_int_eq( stats.in_flight, 2 );
+	assert_false( as_shm_get_node_stats(&cluster, "B1", &stats) );
+
+	free(cluster_shm);
+}
+
+TEST( shm_node_stats_publish, "published in flight counts follow running commands" ) {
+
+	uint32_t nodes_capacity = 1;
+	uint32_t processes = 2;
+	size_t size = sizeof(as_cluster_shm) + (sizeof(as_node_shm) * nodes_capacity) +
+		(as_shm_process_stats_size(nodes_capacity) * processes);
+	as_cluster_shm* cluster_shm = calloc(1, size);
+	cluster_shm->nodes_size = 1;
+	cluster_shm->nodes_capacity = nodes_capacity;
+	cluster_shm->processes_capacity = processes;
+	cluster_shm->partition_tables_offset = sizeof(as_cluster_shm) + (sizeof(as_node_shm) * nodes_capacity);
+	cluster_shm->ready = 1;
+	strcpy(cluster_shm->nodes[0].name, "A1");
+
+	as_cluster cluster;
+	memset(&cluster, 0, sizeof(cluster));
+
+	as_node node;
+	memset(&node, 0, sizeof(node));
+	node.cluster = &cluster;
+	as_node* local_nodes[1] = {&node};
+
+	as_shm_info shm_info;
+	memset(&shm_info, 0, sizeof(shm_info));
+	shm_info.cluster_shm = cluster_shm;
+	shm_info.local_nodes = local_nodes;
+	shm_info.takeover_threshold_ms = 30000;
+	cluster.shm_info = &shm_info;
+
+	// Counts are taken from commands running at publish time.
+	as_node_begin_command(&node);
+	as_node_begin_command(&node);
+	as_node_begin_command(&node);
+	as_node_end_command(&node);
+	as_shm_publish_node_stats(&cluster);
+
+	as_shm_node_stats stats;
+	assert_not_null( shm_info.process_stats );
+	assert_true( as_shm_get_node_stats(&cluster, "A1", &stats) );
+	assert_int_eq( stats.in_flight, 2 );
+
+	as_node_end_command(&node);
+	as_node_end_command(&node);
+	as_shm_publish_node_stats(&cluster);
+	assert_true( as_shm_get_node_stats(&cluster, "A1", &stats) );
+	assert_int_eq( stats.in_flight, 0 );
+
+	// Process that finds all slots taken by live processes is not counted and warns once.
+	uint64_t now = cf_getms();
+
+	for (uint32_t i = 0; i < processes; i++) {
+		as_process_stats_shm* ps = as_shm_get_process_stats(cluster_shm, i);
+		ps->pid = 100 + i;
+		ps->timestamp = now;
+	}
+
+	as_node_begin_command(&node);
+	as_shm_publish_node_stats(&cluster);
+	assert_null( shm_info.process_stats );
+	assert_true( shm_info.process_stats_warned );
+	as_shm_publish_node_stats(&cluster);
+	assert_true( shm_info.process_stats_warned );
+	assert_true( as_shm_get_node_stats(&cluster, "A1", &stats) );
+	assert_int_eq( stats.in_flight, 0 );
+
+	free(cluster_shm);
+}
+
+/******************************************************************************
+ * TEST SUITE
+ *****************************************************************************/
+
+SUITE( shm_partition, "shared memory partition table tests" ) {
+	suite_add( shm_partition_seqlock_read_write );
+	suite_add( shm_partition_seqlock );
+	suite_add( shm_node_stats_stale );
+	suite_add( shm_node_stats_publish );
+}
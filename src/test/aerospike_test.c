@@ -43,8 +43,8 @@ int g_argc = 0;
 char ** g_argv = NULL;
 char g_host[MAX_HOST_SIZE];
 int g_port = 3000;
-static char g_user[AS_USER_SIZE];
-static char g_password[AS_PASSWORD_HASH_SIZE];
+char g_user[AS_USER_SIZE];
+char g_password[AS_PASSWORD_HASH_SIZE];
 as_config_tls g_tls = {0};
 
 /******************************************************************************
@@ -331,6 +331,41 @@ static bool after(atf_plan * plan) {
 	}
 }
 
+/******************************************************************************
+ * FUNCTIONS
+ *****************************************************************************/
+
+void
+test_config_init(as_config* config)
+{
+	as_config_init(config);
+	as_config_add_hosts(config, g_host, g_port);
+	as_config_set_user(config, g_user, g_password);
+}
+
+bool
+test_client_connect(aerospike* client, as_config* config)
+{
+	aerospike_init(client, config);
+
+	as_error err;
+
+	if (aerospike_connect(client, &err) != AEROSPIKE_OK) {
+		error("connect failed: %d %s", err.code, err.message);
+		aerospike_destroy(client);
+		return false;
+	}
+	return true;
+}
+
+void
+test_client_close(aerospike* client)
+{
+	as_error err;
+	aerospike_close(client, &err);
+	aerospike_destroy(client);
+}
+
 /******************************************************************************
  * TEST PLAN
  *****************************************************************************/
@@ -350,6 +385,14 @@ PLAN(aerospike_test) {
 	plan_add(key_apply);
 	plan_add(key_apply2);
 	plan_add(key_operate);
+	plan_add(key_namespace_handle);
+	plan_add(key_command_pool);
+	plan_add(key_prepared);
+	plan_add(key_replica);
+	plan_add(key_near_cache);
+	plan_add(key_coalesce);
+	plan_add(key_timeout);
+	plan_add(key_read_buffer);
 
 	// cdt
 	plan_add(list_basics);
@@ -379,7 +422,22 @@ PLAN(aerospike_test) {
 	// aerospike_scan module
 	plan_add(batch_get);
 
+	// shared memory cluster
+	plan_add(shm_partition);
+
+	// event loop balancing
+	plan_add(event_balance);
+	plan_add(event_cpus);
+	plan_add(event_read);
+	plan_add(cluster_adaptive);
+	plan_add(cluster_breaker);
+	plan_add(cluster_rack);
+	plan_add(cluster_trim);
+	plan_add(partition_bitmap);
+	plan_add(partition_replica);
+
 #if AS_EVENT_LIB_DEFINED
+	plan_add(cluster_warmup);
 	plan_add(key_basics_async);
 	plan_add(list_basics_async);
 	plan_add(map_basics_async);
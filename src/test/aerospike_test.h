@@ -16,7 +16,32 @@
  */
 #pragma once
 
+#include <aerospike/aerospike.h>
+#include <aerospike/as_config.h>
+
 #define MAX_HOST_SIZE 1024
 extern char g_host[MAX_HOST_SIZE];
 extern int g_port;
+extern char g_user[];
+extern char g_password[];
+extern as_config_tls g_tls;
 extern bool g_enable_tls;
+
+/**
+ * Initialize configuration with the command line hosts and user.  Used by tests that
+ * need their own client instance.
+ */
+void
+test_config_init(as_config* config);
+
+/**
+ * Connect a test owned client.  The client is destroyed when the connection fails.
+ */
+bool
+test_client_connect(aerospike* client, as_config* config);
+
+/**
+ * Close and destroy a client connected by test_client_connect().
+ */
+void
+test_client_close(aerospike* client);